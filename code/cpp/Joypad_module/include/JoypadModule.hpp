@@ -14,6 +14,8 @@
 #include <yarp/dev/PolyDriver.h>
 #include <yarp/dev/IJoypadController.h>
 #include <yarp/os/RpcClient.h>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/sig/Vector.h>
 
 /**
  * RFModule useful to handle the Joypad
@@ -36,6 +38,23 @@ private:
     std::string m_joypadInputPortName; /**< Name of the joypad input port name (This is the name of the port opened by the main module). */
     yarp::os::RpcClient m_rpcPort; /**< RPC port. */
 
+    bool m_useGoalStreaming; /**< If true the goal is streamed on m_goalPort instead of being sent through RPC. */
+    std::string m_goalOutputPortName; /**< Name of the goal output port. */
+    std::string m_goalInputPortName; /**< Name of the goal port opened by the main module. */
+    yarp::os::BufferedPort<yarp::sig::Vector> m_goalPort; /**< Port used to stream the goal. */
+    double m_goalThreshold; /**< The goal is sent if one of its components changes more than this value. */
+    double m_goalKeepAlive; /**< The goal is sent at least every m_goalKeepAlive seconds. */
+    double m_lastGoalX{0}; /**< Last x component sent. */
+    double m_lastGoalY{0}; /**< Last y component sent. */
+    double m_lastGoalTime{-1}; /**< Time of the last goal sent (negative if the goal was never sent). */
+
+    /**
+     * Stream the goal on the goal port only if it is changed or the keep-alive interval is expired.
+     * @param x x component of the goal;
+     * @param y y component of the goal.
+     */
+    void streamGoal(double x, double y);
+
     /**
      * Standard deadzone function.
      * @param input input of the deadzone
@@ -10,6 +10,10 @@
 #include "yarp/os/LogStream.h"
 #include <yarp/os/Property.h>
 #include <yarp/os/Bottle.h>
+#include <yarp/os/Time.h>
+
+// std
+#include <cmath>
 
 #include "JoypadModule.hpp"
 
@@ -175,6 +179,35 @@ bool JoypadModule::configure(yarp::os::ResourceFinder &rf)
     }
     m_joypadInputPortName = value->asString();
 
+    // the goal can be also streamed, in this case the RPC port is not used
+    m_useGoalStreaming = rf.check("use_goal_streaming", yarp::os::Value(false)).asBool();
+    if(m_useGoalStreaming)
+    {
+        m_goalOutputPortName = "/" + name + rf.check("GoalOutputPort_name",
+                                                     yarp::os::Value("/goal:o")).asString();
+        m_goalInputPortName = rf.check("GoalInputPort_name",
+                                       yarp::os::Value("/walking-coordinator/goal:i")).asString();
+        m_goalThreshold = rf.check("goal_threshold", yarp::os::Value(0.01)).asDouble();
+        m_goalKeepAlive = rf.check("goal_keep_alive", yarp::os::Value(0.5)).asDouble();
+        if(m_goalThreshold < 0 || m_goalKeepAlive <= 0)
+        {
+            yError() << "[configure] goal_threshold has to be non negative and goal_keep_alive positive.";
+            return false;
+        }
+
+        if(!m_goalPort.open(m_goalOutputPortName))
+        {
+            yError() << "[configure] Unable to open the port " << m_goalOutputPortName;
+            return false;
+        }
+        if(!yarp::os::Network::connect(m_goalOutputPortName, m_goalInputPortName))
+            yInfo() << "Unable to connect to port " << m_goalOutputPortName << " to "
+                    << m_goalInputPortName
+                    << " I'll try to connect the port in the updateModule";
+
+        return true;
+    }
+
     m_rpcPort.open(m_joypadOutputPortName);
     if(!yarp::os::Network::connect(m_joypadOutputPortName, m_joypadInputPortName))
         yInfo() << "Unable to connect to port " << m_joypadOutputPortName << " to "
@@ -199,14 +232,39 @@ bool JoypadModule::close()
 
     // close the ports
     m_rpcPort.close();
+    m_goalPort.close();
 
     return true;
 }
 
+void JoypadModule::streamGoal(double x, double y)
+{
+    double now = yarp::os::Time::now();
+    bool isChanged = std::abs(x - m_lastGoalX) > m_goalThreshold
+        || std::abs(y - m_lastGoalY) > m_goalThreshold;
+    bool isKeepAliveExpired = m_lastGoalTime < 0 || now - m_lastGoalTime >= m_goalKeepAlive;
+
+    if(!isChanged && !isKeepAliveExpired)
+        return;
+
+    yarp::sig::Vector& goal = m_goalPort.prepare();
+    goal.resize(2);
+    goal(0) = x;
+    goal(1) = y;
+    m_goalPort.write();
+
+    m_lastGoalX = x;
+    m_lastGoalY = y;
+    m_lastGoalTime = now;
+}
+
 bool JoypadModule::updateModule()
 {
-    if(yarp::os::Network::isConnected(m_joypadOutputPortName,
-                                      m_joypadInputPortName))
+    // the number of connections is known locally, the name server is used only to connect the ports
+    bool isConnected = m_useGoalStreaming ? m_goalPort.getOutputCount() > 0
+        : m_rpcPort.getOutputCount() > 0;
+
+    if(isConnected)
     {
         double x, y;
         m_joypadController->getAxis(0, x);
@@ -217,6 +275,12 @@ bool JoypadModule::updateModule()
 
         std::swap(x,y);
 
+        if(m_useGoalStreaming)
+        {
+            streamGoal(x, y);
+            return true;
+        }
+
         yarp::os::Bottle cmd, outcome;
         cmd.addString("setGoal");
         cmd.addDouble(x);
@@ -225,9 +289,15 @@ bool JoypadModule::updateModule()
     }
     else
     {
-        // try to connect the ports
-        yarp::os::Network::connect(m_joypadOutputPortName,
-                                   m_joypadInputPortName);
+        // try to connect the ports (the goal is sent as soon as they are connected)
+        if(m_useGoalStreaming)
+        {
+            m_lastGoalTime = -1;
+            yarp::os::Network::connect(m_goalOutputPortName, m_goalInputPortName);
+        }
+        else
+            yarp::os::Network::connect(m_joypadOutputPortName,
+                                       m_joypadInputPortName);
     }
     return true;
 }
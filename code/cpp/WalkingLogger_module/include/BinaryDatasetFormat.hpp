@@ -0,0 +1,30 @@
+/**
+ * @file BinaryDatasetFormat.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef BINARY_DATASET_FORMAT_HPP
+#define BINARY_DATASET_FORMAT_HPP
+
+// std
+#include <cstdint>
+
+/**
+ * Layout of the binary dataset (all the numbers are stored with the byte order of the machine
+ * that wrote the file):
+ * 1. the magic string "WLKDATA1" (8 bytes);
+ * 2. the number of columns N (uint32);
+ * 3. N times: number of characters of the column name (uint32) followed by the name;
+ * 4. the rows, N doubles each one (the first column is the time).
+ */
+namespace BinaryDatasetFormat
+{
+    const char magic[] = "WLKDATA1"; /**< Magic string at the beginning of the file. */
+
+    const std::uint32_t magicSize = 8; /**< Number of characters of the magic string. */
+}
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file BinaryDatasetReader.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef BINARY_DATASET_READER_HPP
+#define BINARY_DATASET_READER_HPP
+
+// std
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * BinaryDatasetReader reads a binary dataset written by BinaryDatasetWriter.
+ */
+class BinaryDatasetReader
+{
+    std::ifstream m_stream; /**< Binary stream. */
+    std::vector<std::string> m_columns; /**< Name of the columns. */
+
+public:
+
+    /**
+     * Open the file and read the header.
+     * @param fileName name of the file.
+     * @return true/false in case of success/failure.
+     */
+    bool open(const std::string& fileName);
+
+    /**
+     * Get the name of the columns.
+     * @return the name of the columns (time included).
+     */
+    const std::vector<std::string>& getColumns() const;
+
+    /**
+     * Read the next row.
+     * @param row vector containing the row.
+     * @return true if a complete row is read, false at the end of the file.
+     */
+    bool readRow(std::vector<double>& row);
+
+    /**
+     * Read all the remaining rows.
+     * @param data matrix stored column by column (data[column][row]).
+     * @return the number of rows.
+     */
+    std::size_t readAll(std::vector<std::vector<double>>& data);
+};
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file BinaryDatasetWriter.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef BINARY_DATASET_WRITER_HPP
+#define BINARY_DATASET_WRITER_HPP
+
+// std
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * BinaryDatasetWriter stores the rows of a dataset in a binary file (see BinaryDatasetFormat.hpp).
+ * The rows are collected in a chunk. When the chunk is full it is handed to a dedicated thread
+ * that writes it on the disk with a single call, meanwhile the rows are collected in a second
+ * chunk.
+ */
+class BinaryDatasetWriter
+{
+    std::ofstream m_stream; /**< Binary stream. */
+    std::size_t m_numberOfColumns{0}; /**< Number of columns (time included). */
+    std::size_t m_chunkSize{0}; /**< Number of doubles of each chunk. */
+
+    std::vector<double> m_activeChunk; /**< Chunk filled by write(). */
+    std::vector<double> m_writerChunk; /**< Chunk written by the writer thread. */
+
+    std::thread m_writerThread; /**< Thread that writes the chunks on the disk. */
+    std::mutex m_mutex; /**< Mutex. */
+    std::condition_variable m_conditionVariable; /**< Synchronizer. */
+    bool m_writeRequired{false}; /**< True if m_writerChunk has to be written. */
+    bool m_closing{false}; /**< True if the writer thread has to be stopped. */
+
+    /**
+     * Main method of the writer thread.
+     */
+    void writerThread();
+
+    /**
+     * Write a chunk on the disk.
+     * @param chunk vector containing the rows.
+     */
+    void writeChunk(std::vector<double>& chunk);
+
+public:
+
+    /**
+     * Destructor.
+     */
+    ~BinaryDatasetWriter();
+
+    /**
+     * Open the file, write the header and start the writer thread.
+     * @param fileName name of the file;
+     * @param columns name of the columns (time included);
+     * @param chunkRows number of rows of each chunk.
+     * @return true/false in case of success/failure.
+     */
+    bool open(const std::string& fileName, const std::vector<std::string>& columns,
+              const std::size_t& chunkRows);
+
+    /**
+     * Add a row.
+     * @param time time of the row;
+     * @param values pointer to the other values of the row (number of columns - 1 values).
+     */
+    void write(const double& time, const double* values);
+
+    /**
+     * Write the remaining rows, stop the thread and close the file.
+     */
+    void close();
+
+    /**
+     * Check if the file is open.
+     * @return true if the file is open false otherwise.
+     */
+    bool isOpen() const;
+};
+
+#endif
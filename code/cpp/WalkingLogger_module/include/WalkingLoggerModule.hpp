@@ -11,6 +11,7 @@
 
 // std
 #include <fstream>
+#include <mutex>
 
 // YARP
 #include <yarp/os/RFModule.h>
@@ -18,6 +19,8 @@
 #include <yarp/os/RpcServer.h>
 #include <yarp/sig/Vector.h>
 
+#include "BinaryDatasetWriter.hpp"
+
 /**
  * RFModule useful to collect data during an experiment.
  */
@@ -25,13 +28,51 @@ class WalkingLoggerModule : public yarp::os::RFModule
 {
     double m_dT; /**< RFModule period. */
     std::ofstream m_stream; /**< std stream. */
+    BinaryDatasetWriter m_binaryWriter; /**< Writer of the binary dataset. */
+    bool m_useBinaryFormat; /**< If true the dataset is stored in binary format. */
+    int m_binaryChunkRows; /**< Number of rows written at once by the binary writer. */
 
     int m_numberOfValues; /**< Number of columns of the dataset. */
     double m_time0; /**< Initial time of a stream. */
 
+    double m_expectedSequenceNumber; /**< Sequence number of the next frame. */
+    int m_receivedFrames; /**< Number of frames received in the current stream. */
+    int m_missingFrames; /**< Number of frames that did not arrive (sum of the gaps). */
+    int m_numberOfGaps; /**< Number of times the sequence number is not the expected one. */
+    int m_outOfOrderFrames; /**< Number of frames received after a more recent one. */
+
     yarp::os::BufferedPort<yarp::sig::Vector> m_dataPort; /**< Data port. */
     yarp::os::RpcServer m_rpcPort; /**< RPC port. */
 
+    std::mutex m_mutex; /**< Mutex protecting the dataset and the statistics of the stream (respond
+                           runs on the thread of the RPC port). */
+
+    /**
+     * Check if a dataset is open.
+     * @return true if a dataset (text or binary) is open false otherwise.
+     */
+    bool isDatasetOpen() const;
+
+    /**
+     * Store a row of the dataset.
+     * @param time time of the row;
+     * @param values pointer to the values of the row (m_numberOfValues values).
+     */
+    void writeRow(const double& time, const double* values);
+
+    /**
+     * Store the frames contained in a message. m_mutex has to be locked by the caller.
+     * @param data received message.
+     * @return true in case of success and false otherwise.
+     */
+    bool storeMessage(const yarp::sig::Vector& data);
+
+    /**
+     * Update the statistics of the stream with the sequence number of a received frame.
+     * @param sequenceNumber sequence number of the frame.
+     */
+    void updateSequence(double sequenceNumber);
+
 public:
 
     /**
@@ -42,6 +83,10 @@ public:
 
     /**
      * Main function of the RFModule.
+     * All the messages received since the last call are stored. A message can contain a single
+     * frame without header (the time is evaluated when the data are received) or a batch of
+     * frames each one preceded by its sequence number and its time stamp. The sequence numbers
+     * are used to count the frames lost between the sender and the logger.
      * @return true in case of success and false otherwise.
      */
     bool updateModule() override;
@@ -60,7 +105,7 @@ public:
      * 1. ("record", <list of the names of the saved variables>);
      * 2. ("quit").
      * @param reply is the response of the server.
-     * 1. 1 in case of success;
+     * 1. 1 in case of success (followed by the number of missing frames for "quit");
      * 2. 0 in case of failure.
      * @return true in case of success and false otherwise.
      */
@@ -0,0 +1,82 @@
+/**
+ * @file BinaryDatasetReader.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "BinaryDatasetFormat.hpp"
+#include "BinaryDatasetReader.hpp"
+
+bool BinaryDatasetReader::open(const std::string& fileName)
+{
+    m_stream.open(fileName.c_str(), std::ios::in | std::ios::binary);
+    if(!m_stream.is_open())
+    {
+        std::cerr << "[open] Unable to open the file " << fileName << std::endl;
+        return false;
+    }
+
+    char magic[BinaryDatasetFormat::magicSize];
+    m_stream.read(magic, BinaryDatasetFormat::magicSize);
+    if(!m_stream || std::memcmp(magic, BinaryDatasetFormat::magic, BinaryDatasetFormat::magicSize) != 0)
+    {
+        std::cerr << "[open] The file " << fileName << " is not a walking dataset." << std::endl;
+        return false;
+    }
+
+    std::uint32_t numberOfColumns;
+    m_stream.read(reinterpret_cast<char*>(&numberOfColumns), sizeof(numberOfColumns));
+
+    m_columns.clear();
+    for(std::uint32_t i = 0; i < numberOfColumns && m_stream; i++)
+    {
+        std::uint32_t nameSize;
+        m_stream.read(reinterpret_cast<char*>(&nameSize), sizeof(nameSize));
+        std::string name(nameSize, ' ');
+        m_stream.read(&name[0], nameSize);
+        m_columns.push_back(name);
+    }
+
+    if(!m_stream)
+    {
+        std::cerr << "[open] Unable to read the header of the file " << fileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+const std::vector<std::string>& BinaryDatasetReader::getColumns() const
+{
+    return m_columns;
+}
+
+bool BinaryDatasetReader::readRow(std::vector<double>& row)
+{
+    row.resize(m_columns.size());
+    m_stream.read(reinterpret_cast<char*>(row.data()), row.size() * sizeof(double));
+
+    // an incomplete row (e.g. the logger was killed while writing) is discarded
+    return static_cast<std::size_t>(m_stream.gcount()) == row.size() * sizeof(double);
+}
+
+std::size_t BinaryDatasetReader::readAll(std::vector<std::vector<double>>& data)
+{
+    data.assign(m_columns.size(), std::vector<double>());
+
+    std::vector<double> row;
+    std::size_t numberOfRows = 0;
+    while(readRow(row))
+    {
+        for(std::size_t i = 0; i < row.size(); i++)
+            data[i].push_back(row[i]);
+        numberOfRows++;
+    }
+    return numberOfRows;
+}
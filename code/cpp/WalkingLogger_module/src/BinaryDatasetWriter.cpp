@@ -0,0 +1,146 @@
+/**
+ * @file BinaryDatasetWriter.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cstdint>
+
+// YARP
+#include <yarp/os/LogStream.h>
+
+#include "BinaryDatasetFormat.hpp"
+#include "BinaryDatasetWriter.hpp"
+
+BinaryDatasetWriter::~BinaryDatasetWriter()
+{
+    close();
+}
+
+bool BinaryDatasetWriter::open(const std::string& fileName, const std::vector<std::string>& columns,
+                               const std::size_t& chunkRows)
+{
+    if(m_stream.is_open())
+    {
+        yError() << "[open] The file is already open.";
+        return false;
+    }
+
+    if(columns.empty() || chunkRows == 0)
+    {
+        yError() << "[open] The number of columns and the number of rows of each chunk have to be "
+                 << "positive numbers.";
+        return false;
+    }
+
+    m_stream.open(fileName.c_str(), std::ios::out | std::ios::binary);
+    if(!m_stream.is_open())
+    {
+        yError() << "[open] Unable to open the file" << fileName;
+        return false;
+    }
+
+    // write the header
+    m_stream.write(BinaryDatasetFormat::magic, BinaryDatasetFormat::magicSize);
+    std::uint32_t numberOfColumns = columns.size();
+    m_stream.write(reinterpret_cast<const char*>(&numberOfColumns), sizeof(numberOfColumns));
+    for(const auto& column : columns)
+    {
+        std::uint32_t nameSize = column.size();
+        m_stream.write(reinterpret_cast<const char*>(&nameSize), sizeof(nameSize));
+        m_stream.write(column.data(), nameSize);
+    }
+
+    m_numberOfColumns = columns.size();
+    m_chunkSize = m_numberOfColumns * chunkRows;
+
+    // the memory of the chunks is allocated only once
+    m_activeChunk.clear();
+    m_activeChunk.reserve(m_chunkSize);
+    m_writerChunk.clear();
+    m_writerChunk.reserve(m_chunkSize);
+
+    m_writeRequired = false;
+    m_closing = false;
+    m_writerThread = std::thread(&BinaryDatasetWriter::writerThread, this);
+
+    return true;
+}
+
+void BinaryDatasetWriter::writerThread()
+{
+    while(true)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_conditionVariable.wait(lock, [&]{return m_writeRequired || m_closing;});
+
+        if(m_writeRequired)
+        {
+            // the active chunk is not used by the writer thread so the lock can be released
+            lock.unlock();
+            writeChunk(m_writerChunk);
+            lock.lock();
+
+            m_writeRequired = false;
+            m_conditionVariable.notify_one();
+        }
+
+        if(m_closing)
+            break;
+    }
+}
+
+void BinaryDatasetWriter::writeChunk(std::vector<double>& chunk)
+{
+    m_stream.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() * sizeof(double));
+    chunk.clear();
+}
+
+void BinaryDatasetWriter::write(const double& time, const double* values)
+{
+    if(!m_stream.is_open())
+        return;
+
+    m_activeChunk.push_back(time);
+    m_activeChunk.insert(m_activeChunk.end(), values, values + m_numberOfColumns - 1);
+
+    if(m_activeChunk.size() + m_numberOfColumns > m_chunkSize)
+    {
+        // wait until the previous chunk is written (it happens only if the disk is slower than
+        // the data stream) then hand over the active chunk
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_conditionVariable.wait(lock, [&]{return !m_writeRequired;});
+        m_activeChunk.swap(m_writerChunk);
+        m_writeRequired = true;
+        m_conditionVariable.notify_one();
+    }
+}
+
+void BinaryDatasetWriter::close()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_closing = true;
+        m_conditionVariable.notify_one();
+    }
+
+    if(m_writerThread.joinable())
+    {
+        m_writerThread.join();
+        m_writerThread = std::thread();
+    }
+
+    if(m_stream.is_open())
+    {
+        writeChunk(m_activeChunk);
+        m_stream.close();
+    }
+}
+
+bool BinaryDatasetWriter::isOpen() const
+{
+    return m_stream.is_open();
+}
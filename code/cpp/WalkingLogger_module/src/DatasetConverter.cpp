@@ -0,0 +1,161 @@
+/**
+ * @file DatasetConverter.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BinaryDatasetReader.hpp"
+
+/**
+ * Convert the binary dataset into the text layout used by the WalkingLoggerModule.
+ * @param reader reader of the binary dataset;
+ * @param fileName name of the output file.
+ * @return true/false in case of success/failure.
+ */
+bool convertToText(BinaryDatasetReader& reader, const std::string& fileName)
+{
+    std::ofstream stream(fileName.c_str());
+    if(!stream.is_open())
+    {
+        std::cerr << "[convertToText] Unable to open the file " << fileName << std::endl;
+        return false;
+    }
+
+    for(const auto& column : reader.getColumns())
+        stream << column << " ";
+    stream << "\n";
+
+    std::vector<double> row;
+    while(reader.readRow(row))
+    {
+        for(const auto& value : row)
+            stream << value << " ";
+        stream << "\n";
+    }
+    return true;
+}
+
+/**
+ * Get a valid MATLAB variable name.
+ * @param name name of the column.
+ * @return the variable name.
+ */
+std::string getMatlabVariableName(const std::string& name)
+{
+    std::string variableName = name;
+    for(auto& character : variableName)
+        if(!std::isalnum(static_cast<unsigned char>(character)))
+            character = '_';
+
+    if(variableName.empty() || !std::isalpha(static_cast<unsigned char>(variableName[0])))
+        variableName = "v_" + variableName;
+
+    return variableName;
+}
+
+/**
+ * Convert the binary dataset into a MATLAB (level 4) MAT-file. Each column is stored in a
+ * variable with the same name, so that the data can be loaded with load().
+ * @param reader reader of the binary dataset;
+ * @param fileName name of the output file.
+ * @return true/false in case of success/failure.
+ */
+bool convertToMat(BinaryDatasetReader& reader, const std::string& fileName)
+{
+    std::ofstream stream(fileName.c_str(), std::ios::out | std::ios::binary);
+    if(!stream.is_open())
+    {
+        std::cerr << "[convertToMat] Unable to open the file " << fileName << std::endl;
+        return false;
+    }
+
+    std::vector<std::vector<double>> data;
+    std::int32_t numberOfRows = reader.readAll(data);
+
+    // the type flag contains the byte order of the machine (0 little endian, 1 big endian),
+    // the data are double precision full matrices
+    const std::uint16_t endiannessTest = 1;
+    std::int32_t type = (*reinterpret_cast<const char*>(&endiannessTest) == 1) ? 0 : 1000;
+
+    const std::vector<std::string>& columns = reader.getColumns();
+    for(std::size_t i = 0; i < columns.size(); i++)
+    {
+        std::string name = getMatlabVariableName(columns[i]);
+
+        // type, rows, columns, imaginary flag and length of the name (null character included)
+        std::int32_t header[5] = {type, numberOfRows, 1, 0,
+                                  static_cast<std::int32_t>(name.size() + 1)};
+        stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+        stream.write(name.c_str(), name.size() + 1);
+        stream.write(reinterpret_cast<const char*>(data[i].data()), data[i].size() * sizeof(double));
+    }
+    return true;
+}
+
+int main(int argc, char * argv[])
+{
+    if(argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <dataset.bin> [--text <file.txt>] [--mat <file.mat>]"
+                  << std::endl
+                  << "If no output is specified the dataset is converted in both the "
+                  << "formats, the output files have the same name of the dataset." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string inputFileName = argv[1];
+    std::string textFileName, matFileName;
+    for(int i = 2; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if(i + 1 >= argc)
+        {
+            std::cerr << "Missing value of the option " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if(option == "--text")
+            textFileName = argv[++i];
+        else if(option == "--mat")
+            matFileName = argv[++i];
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(textFileName.empty() && matFileName.empty())
+    {
+        std::string baseName = inputFileName.substr(0, inputFileName.rfind(".bin"));
+        textFileName = baseName + ".txt";
+        matFileName = baseName + ".mat";
+    }
+
+    if(!textFileName.empty())
+    {
+        BinaryDatasetReader reader;
+        if(!reader.open(inputFileName) || !convertToText(reader, textFileName))
+            return EXIT_FAILURE;
+    }
+
+    if(!matFileName.empty())
+    {
+        BinaryDatasetReader reader;
+        if(!reader.open(inputFileName) || !convertToMat(reader, matFileName))
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -20,36 +20,125 @@ double WalkingLoggerModule::getPeriod()
     return m_dT;
 }
 
+bool WalkingLoggerModule::isDatasetOpen() const
+{
+    return m_stream.is_open() || m_binaryWriter.isOpen();
+}
+
+void WalkingLoggerModule::writeRow(const double& time, const double* values)
+{
+    if(m_useBinaryFormat)
+    {
+        m_binaryWriter.write(time, values);
+        return;
+    }
+
+    m_stream << time << " ";
+    for(int i = 0; i < m_numberOfValues; i++)
+        m_stream << values[i] << " ";
+
+    m_stream << "\n";
+}
+
+void WalkingLoggerModule::updateSequence(double sequenceNumber)
+{
+    m_receivedFrames++;
+
+    if(sequenceNumber < m_expectedSequenceNumber)
+    {
+        // a late frame fills a gap counted before
+        m_outOfOrderFrames++;
+        if(m_missingFrames > 0)
+            m_missingFrames--;
+        return;
+    }
+
+    if(sequenceNumber > m_expectedSequenceNumber)
+    {
+        m_missingFrames += sequenceNumber - m_expectedSequenceNumber;
+        m_numberOfGaps++;
+    }
+    m_expectedSequenceNumber = sequenceNumber + 1;
+}
+
+bool WalkingLoggerModule::storeMessage(const yarp::sig::Vector& data)
+{
+    if(data.size() == m_numberOfValues)
+    {
+        // write into the file
+        double time = yarp::os::Time::now() - m_time0;
+        writeRow(time, data.data());
+        return true;
+    }
+
+    // batch of frames, each frame starts with the sequence number and the time stamp
+    int frameSize = m_numberOfValues + 2;
+    if(data.size() % frameSize != 0)
+    {
+        yError() << "[storeMessage] The size of the vector is different from "
+                 << m_numberOfValues;
+        return false;
+    }
+
+    for(int frame = 0; frame < data.size() / frameSize; frame++)
+    {
+        const double* values = data.data() + frame * frameSize;
+        updateSequence(values[0]);
+        writeRow(values[1] - m_time0, values + 2);
+    }
+    return true;
+}
+
 bool WalkingLoggerModule::close()
 {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
     // close the stream (if it is open)
     if(m_stream.is_open())
         m_stream.close();
 
+    m_binaryWriter.close();
+
     // close the ports
     m_dataPort.close();
     m_rpcPort.close();
+
+    return true;
 }
 
 bool WalkingLoggerModule::respond(const yarp::os::Bottle& command, yarp::os::Bottle& reply)
 {
+    // the dataset is also written by updateModule
+    std::lock_guard<std::mutex> guard(m_mutex);
+
     if (command.get(0).asString() == "quit")
     {
-        if(!m_stream.is_open())
+        if(!isDatasetOpen())
         {
             yError() << "[RPC Server] The stream is not open.";
             reply.addInt(0);
             return true;
         }
-        m_stream.close();
+        // store the frames that are still in the port
+        yarp::sig::Vector *data = NULL;
+        while((data = m_dataPort.read(false)) != NULL)
+            storeMessage(*data);
+
+        if(m_useBinaryFormat)
+            m_binaryWriter.close();
+        else
+            m_stream.close();
         reply.addInt(1);
+        reply.addInt(m_missingFrames);
 
-        yInfo() << "[RPC Server] The stream is closed.";
+        yInfo() << "[RPC Server] The stream is closed." << m_receivedFrames << "frames received,"
+                << m_missingFrames << "missing in" << m_numberOfGaps << "gaps,"
+                << m_outOfOrderFrames << "out of order.";
         return true;
     }
     else if (command.get(0).asString() == "record")
     {
-        if(m_stream.is_open())
+        if(isDatasetOpen())
         {
             yError() << "[RPC Server] The stream is already open.";
             reply.addInt(0);
@@ -68,18 +157,42 @@ bool WalkingLoggerModule::respond(const yarp::os::Bottle& command, yarp::os::Bot
         // get the current time
         m_time0 = yarp::os::Time::now();
 
+        // the sender starts a new sequence for each stream
+        m_expectedSequenceNumber = 0;
+        m_receivedFrames = 0;
+        m_missingFrames = 0;
+        m_numberOfGaps = 0;
+        m_outOfOrderFrames = 0;
+
         // set the file name
         std::time_t t = std::time(nullptr);
         std::tm tm = *std::localtime(&t);
 
         std::stringstream fileName;
-        fileName << "Dataset_" << std::put_time(&tm, "%Y_%m_%d_%H_%M_%S")
-                 << ".txt";
+        fileName << "Dataset_" << std::put_time(&tm, "%Y_%m_%d_%H_%M_%S");
 
-        m_stream.open(fileName.str().c_str());
+        if(m_useBinaryFormat)
+        {
+            std::vector<std::string> columns{"time"};
+            for(int i = 0; i < m_numberOfValues; i++)
+                columns.push_back(command.get(i + 1).asString());
 
-        // write the head of the table
-        m_stream << head << std::endl;
+            fileName << ".bin";
+            if(!m_binaryWriter.open(fileName.str(), columns, m_binaryChunkRows))
+            {
+                yError() << "[RPC Server] Unable to open the binary dataset.";
+                reply.addInt(0);
+                return false;
+            }
+        }
+        else
+        {
+            fileName << ".txt";
+            m_stream.open(fileName.str().c_str());
+
+            // write the head of the table
+            m_stream << head << std::endl;
+        }
 
         reply.addInt(1);
         return true;
@@ -133,6 +246,9 @@ bool WalkingLoggerModule::configure(yarp::os::ResourceFinder &rf)
     }
     m_dataPort.open("/" + getName() + value->asString());
 
+    // the data can be sent in batches, none of them has to be dropped
+    m_dataPort.setStrict();
+
     // set rpc port name
     if(!rf.check("rpc_port_name", value))
     {
@@ -150,38 +266,35 @@ bool WalkingLoggerModule::configure(yarp::os::ResourceFinder &rf)
     // set the RFModule period
     m_dT = rf.check("sampling_time", yarp::os::Value(0.005)).asDouble();
 
+    // the binary dataset is written by a dedicated thread in chunks
+    m_useBinaryFormat = rf.check("use_binary_format", yarp::os::Value(false)).asBool();
+    m_binaryChunkRows = rf.check("binary_chunk_rows", yarp::os::Value(1000)).asInt();
+    if(m_binaryChunkRows <= 0)
+    {
+        yError() << "[configure] The number of rows of each chunk has to be a positive number.";
+        return false;
+    }
+
     return true;
 }
 
 bool WalkingLoggerModule::updateModule()
 {
-    yarp::sig::Vector *data = NULL;
+    std::lock_guard<std::mutex> guard(m_mutex);
 
-    // try to read data from port
-    data = m_dataPort.read(false);
+    yarp::sig::Vector *data = NULL;
 
-    if (data != NULL)
+    // the port is strict, all the messages received since the last call are stored
+    while((data = m_dataPort.read(false)) != NULL)
     {
-        if(!m_stream.is_open())
+        if(!isDatasetOpen())
         {
             yError() << "[updateModule] No stream is open. I cannot store your data.";
             return false;
         }
 
-        if(data->size() != m_numberOfValues)
-        {
-            yError() << "[updateModule] The size of the vector is different from "
-                     << m_numberOfValues;
+        if(!storeMessage(*data))
             return false;
-        }
-
-        // write into the file
-        double time = yarp::os::Time::now() - m_time0;
-        m_stream << time << " ";
-        for(int i = 0; i < m_numberOfValues; i++)
-            m_stream << (*data)[i] << " ";
-
-        m_stream << std::endl;
     }
     return true;
 }
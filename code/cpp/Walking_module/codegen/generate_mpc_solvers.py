@@ -0,0 +1,307 @@
+#!/usr/bin/env python3
+# Copyright (C) 2018 Fondazione Istituto Italiano di Tecnologia (IIT)
+# All Rights Reserved.
+# Authors: Giulio Romualdi <giulio.romualdi@iit.it>
+
+"""Generate the embedded OSQP solvers of the DCM MPC.
+
+The sparse formulation of the MPC (see WalkingController and MPCSolver) has a sparsity pattern
+that depends only on the configuration: the horizon, the weights and the number of inequality
+constraints of each contact configuration. For each configuration a solver is generated with the
+OSQP code generation (parameters = 'matrices', i.e. EMBEDDED = 2) and wrapped in a descriptor
+defined in MPCCodegenInterface.h. The values of the matrices are set at runtime, only the
+sparsity patterns are fixed here.
+
+The script requires the osqp python package (0.6.x), numpy and scipy.
+"""
+
+import argparse
+import math
+import os
+import re
+
+import numpy as np
+import osqp
+import scipy.sparse as sparse
+
+STATE_SIZE = 2
+INPUT_SIZE = 2
+
+# the feet polygons obtained from foot_size are rectangles
+FOOT_VERTICES = 4
+
+# name of the configuration, number of inequality constraints
+# (see WalkingController::initializeControllers())
+CONFIGURATIONS = [('double_support', 2 * FOOT_VERTICES),
+                  ('left_support', FOOT_VERTICES),
+                  ('right_support', FOOT_VERTICES)]
+
+
+def read_ini(file_name):
+    """Read a yarp ini file. It returns a dictionary group -> {key: value string}."""
+    groups = {'': {}}
+    group = ''
+    with open(file_name) as ini_file:
+        for line in ini_file:
+            line = line.split('#')[0].split('//')[0].strip()
+            if not line:
+                continue
+            if line.startswith('['):
+                group = line.strip('[]').split()[0]
+                groups.setdefault(group, {})
+                continue
+            fields = line.split(None, 1)
+            groups[group][fields[0]] = fields[1] if len(fields) > 1 else ''
+    return groups
+
+
+def get_numbers(value):
+    return [float(number) for number in re.findall(r'[-+]?[0-9]*\.?[0-9]+(?:[eE][-+]?[0-9]+)?', value)]
+
+
+def get_triplets(value, size):
+    numbers = get_numbers(value)
+    if len(numbers) % 3 != 0:
+        raise ValueError('Wrong triplets: ' + value)
+    matrix = np.zeros((size, size))
+    for row, column, element in zip(numbers[0::3], numbers[1::3], numbers[2::3]):
+        matrix[int(row), int(column)] += element
+    return sparse.csc_matrix(matrix)
+
+
+def read_configuration(config_dir):
+    coordinator = read_ini(os.path.join(config_dir, 'dcmWalkingCoordinator.ini'))
+    controller = read_ini(os.path.join(config_dir, 'controllerParams.ini'))['']
+    general = coordinator.get('GENERAL', {})
+
+    # the general options are appended to the controller ones
+    # (see WalkingModule::configure())
+    options = dict(controller)
+    for key, value in general.items():
+        options.setdefault(key, value)
+
+    if options.get('mpc_formulation', 'sparse').strip() != 'sparse':
+        print('[generate_mpc_solvers] The condensed formulation is used, the solvers are '
+              'generated anyway for the sparse one.')
+
+    sampling_time = float(options.get('sampling_time', 0.016))
+    horizon = int(round(float(options.get('controllerHorizon', 2.0)) / sampling_time))
+    state_weight = get_triplets(options['stateWeightTriplets'], STATE_SIZE)
+    input_weight = get_triplets(options['inputWeightTriplets'], INPUT_SIZE)
+    com_height = float(options['com_height'])
+    gravity = float(options.get('gravity_acceleration', 9.81))
+    return sampling_time, horizon, state_weight, input_weight, math.sqrt(gravity / com_height)
+
+
+def evaluate_hessian(horizon, state_weight, input_weight):
+    # see WalkingController::evaluateThetaMatrix() and evaluateHessianMatrix()
+    inputs = INPUT_SIZE * horizon
+    theta = sparse.identity(inputs, format='csc') \
+        - sparse.eye(inputs, inputs, k=-INPUT_SIZE, format='csc')
+    input_submatrix = (theta.T @ sparse.kron(sparse.identity(horizon), input_weight) @ theta).tocsc()
+    input_submatrix.data[np.abs(input_submatrix.data) <= 1e-17] = 0
+    input_submatrix.eliminate_zeros()
+
+    hessian = sparse.block_diag([sparse.kron(sparse.identity(horizon + 1), state_weight),
+                                 input_submatrix], format='csc')
+    hessian = sparse.triu(hessian, format='csc')
+    hessian.sort_indices()
+    return hessian
+
+
+def evaluate_constraints(horizon, omega, sampling_time, inequality_constraints):
+    # see WalkingController::evaluateEqualConstraintsMatrix() and the constructor of MPCSolver
+    states = STATE_SIZE * (horizon + 1)
+    variables = states + INPUT_SIZE * horizon
+    rows, columns, values = [], [], []
+    for i in range(states):
+        rows.append(i)
+        columns.append(i)
+        values.append(-1.0)
+    for i in range(horizon):
+        for j in range(STATE_SIZE):
+            rows += [STATE_SIZE * (i + 1) + j, STATE_SIZE * (i + 1) + j]
+            columns += [STATE_SIZE * i + j, states + INPUT_SIZE * i + j]
+            values += [math.exp(omega * sampling_time), 1 - math.exp(omega * sampling_time)]
+
+    # the inequality block is stored even if it is equal to zero, a placeholder is used here
+    for i in range(inequality_constraints):
+        for j in range(INPUT_SIZE):
+            rows.append(states + i)
+            columns.append(states + j)
+            values.append(1.0)
+
+    constraints = sparse.csc_matrix((values, (rows, columns)),
+                                    shape=(states + inequality_constraints, variables))
+    constraints.sort_indices()
+    return constraints
+
+
+def c_array(name, values):
+    return 'static const int {}[{}] = {{{}}};\n'.format(name, len(values),
+                                                        ', '.join(str(v) for v in values))
+
+
+WRAPPER_TEMPLATE = '''/* Generated by generate_mpc_solvers.py. Do not edit. */
+
+#include "osqp.h"
+#include "workspace.h"
+#include "MPCCodegenInterface.h"
+
+{patterns}
+static int updateMatrices(const double* hessianValues, const double* constraintsValues)
+{{
+    return osqp_update_P_A(&workspace, hessianValues, OSQP_NULL, {hessian_nnz},
+                           constraintsValues, OSQP_NULL, {constraints_nnz}) == 0;
+}}
+
+static int updateConstraintsMatrix(const double* constraintsValues)
+{{
+    return osqp_update_A(&workspace, constraintsValues, OSQP_NULL, {constraints_nnz}) == 0;
+}}
+
+static int updateGradient(const double* gradient)
+{{
+    return osqp_update_lin_cost(&workspace, gradient) == 0;
+}}
+
+static int updateBounds(const double* lowerBound, const double* upperBound)
+{{
+    return osqp_update_bounds(&workspace, lowerBound, upperBound) == 0;
+}}
+
+static int warmStartPrimal(const double* primalVariable)
+{{
+    return osqp_warm_start_x(&workspace, primalVariable) == 0;
+}}
+
+static int warmStartDual(const double* dualVariable)
+{{
+    return osqp_warm_start_y(&workspace, dualVariable) == 0;
+}}
+
+static int solve(void)
+{{
+    return osqp_solve(&workspace) == 0 && workspace.info->status_val == OSQP_SOLVED;
+}}
+
+static const double* getPrimalVariable(void)
+{{
+    return workspace.solution->x;
+}}
+
+static const double* getDualVariable(void)
+{{
+    return workspace.solution->y;
+}}
+
+static void getInfo(int* iterations, double* primalResidual, double* dualResidual)
+{{
+    *iterations = workspace.info->iter;
+    *primalResidual = workspace.info->pri_res;
+    *dualResidual = workspace.info->dua_res;
+}}
+
+const WalkingMPCCodegenSolver walking_mpc_{name} = {{
+    "{name}", {variables}, {constraints},
+    {hessian_nnz}, hessianColumns, hessianRows,
+    {constraints_nnz}, constraintsColumns, constraintsRows,
+    updateMatrices, updateConstraintsMatrix, updateGradient, updateBounds,
+    warmStartPrimal, warmStartDual, solve, getPrimalVariable, getDualVariable, getInfo
+}};
+'''
+
+
+def write_if_different(file_name, content):
+    # the files are rewritten only if needed, in this way they are not compiled again
+    if os.path.exists(file_name):
+        with open(file_name) as generated_file:
+            if generated_file.read() == content:
+                return
+    with open(file_name, 'w') as generated_file:
+        generated_file.write(content)
+
+
+def generate_solver(name, output, hessian, constraints, states):
+    folder = os.path.join(output, name)
+    variables = hessian.shape[0]
+    lower_bound = np.zeros(constraints.shape[0])
+    upper_bound = np.zeros(constraints.shape[0])
+    lower_bound[states:] = -np.inf
+    upper_bound[states:] = np.inf
+
+    solver = osqp.OSQP()
+    solver.setup(P=hessian, q=np.zeros(variables), A=constraints, l=lower_bound, u=upper_bound,
+                 verbose=False)
+    solver.codegen(os.path.join(folder, 'osqp'), parameters='matrices', force_rewrite=True,
+                   compile_python_ext=False, LONG=False)
+
+    # the python extension and the example are not compiled
+    sources, include_dirs = [], set()
+    for root, _, files in os.walk(os.path.join(folder, 'osqp')):
+        for file_name in sorted(files):
+            path = os.path.join(root, file_name)
+            if file_name.endswith('.h'):
+                include_dirs.add(root)
+            elif file_name.endswith('.c'):
+                with open(path) as source:
+                    content = source.read()
+                if 'Python.h' not in content and not re.search(r'\bmain\s*\(', content):
+                    sources.append(path)
+
+    patterns = c_array('hessianColumns', hessian.indptr) + c_array('hessianRows', hessian.indices) \
+        + c_array('constraintsColumns', constraints.indptr) \
+        + c_array('constraintsRows', constraints.indices)
+    wrapper = os.path.join(folder, 'walking_mpc_{}.c'.format(name))
+    write_if_different(wrapper, WRAPPER_TEMPLATE.format(name=name, patterns=patterns,
+                                                        variables=variables,
+                                                        constraints=constraints.shape[0],
+                                                        hessian_nnz=hessian.nnz,
+                                                        constraints_nnz=constraints.nnz))
+
+    # only the descriptor is exported, otherwise the symbols of the embedded osqp copies
+    # clash with each other and with the ones of the osqp library
+    write_if_different(os.path.join(folder, 'exports.map'),
+                       '{{\n  global: walking_mpc_{};\n  local: *;\n}};\n'.format(name))
+
+    return sources + [wrapper], sorted(include_dirs)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--config-dir', required=True,
+                        help='directory containing dcmWalkingCoordinator.ini and controllerParams.ini')
+    parser.add_argument('--output', required=True, help='output directory')
+    args = parser.parse_args()
+
+    sampling_time, horizon, state_weight, input_weight, omega = read_configuration(args.config_dir)
+    hessian = evaluate_hessian(horizon, state_weight, input_weight)
+    states = STATE_SIZE * (horizon + 1)
+
+    os.makedirs(args.output, exist_ok=True)
+    cmake = ['# Generated by generate_mpc_solvers.py. Do not edit.',
+             'set(WALKING_MPC_CODEGEN_SOLVERS {})'.format(' '.join(n for n, _ in CONFIGURATIONS))]
+    declarations, registry = [], []
+    for name, inequality_constraints in CONFIGURATIONS:
+        constraints = evaluate_constraints(horizon, omega, sampling_time, inequality_constraints)
+        sources, include_dirs = generate_solver(name, args.output, hessian, constraints, states)
+        cmake.append('set(WALKING_MPC_CODEGEN_{}_SOURCES\n  {})'.format(name.upper(),
+                                                                      '\n  '.join(sources)))
+        cmake.append('set(WALKING_MPC_CODEGEN_{}_INCLUDE_DIRS\n  {})'.format(name.upper(),
+                                                                           '\n  '.join(include_dirs)))
+        declarations.append('extern const WalkingMPCCodegenSolver walking_mpc_{};'.format(name))
+        registry.append('    &walking_mpc_{},'.format(name))
+        print('[generate_mpc_solvers] {}: {} variables, {} constraints (horizon {}).'
+              .format(name, hessian.shape[0], constraints.shape[0], horizon))
+
+    write_if_different(os.path.join(args.output, 'walking_mpc_codegen_solvers.c'),
+                       '/* Generated by generate_mpc_solvers.py. Do not edit. */\n\n'
+                       '#include "MPCCodegenInterface.h"\n\n'
+                       + '\n'.join(declarations) + '\n\n'
+                       'const WalkingMPCCodegenSolver* const walking_mpc_codegen_solvers[] = {\n'
+                       + '\n'.join(registry) + '\n    0\n};\n')
+    write_if_different(os.path.join(args.output, 'sources.cmake'), '\n'.join(cmake) + '\n')
+
+
+if __name__ == '__main__':
+    main()
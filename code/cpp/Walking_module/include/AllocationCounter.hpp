@@ -0,0 +1,36 @@
+/**
+ * @file AllocationCounter.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef ALLOCATION_COUNTER_HPP
+#define ALLOCATION_COUNTER_HPP
+
+// std
+#include <cstddef>
+
+/**
+ * Diagnostic counter of the heap allocations. The global operator new is replaced (and the
+ * calls to malloc, calloc and realloc of the project, e.g. the Eigen temporaries, are wrapped)
+ * only if the project is compiled with the WALKING_COUNT_ALLOCATIONS option, otherwise the
+ * counter is always equal to zero.
+ */
+namespace AllocationCounter
+{
+    /**
+     * Check if the allocations are counted.
+     * @return true if the project is compiled with the WALKING_COUNT_ALLOCATIONS option.
+     */
+    bool isEnabled();
+
+    /**
+     * Get the number of heap allocations made by the calling thread since its creation.
+     * @return the number of allocations.
+     */
+    std::size_t getThreadAllocations();
+}
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * @file BenchmarkPlant.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef BENCHMARK_PLANT_HPP
+#define BENCHMARK_PLANT_HPP
+
+// std
+#include <string>
+#include <vector>
+
+// YARP
+#include <yarp/os/Searchable.h>
+#include <yarp/sig/Vector.h>
+
+// iDynTree
+#include <iDynTree/Core/Transform.h>
+#include <iDynTree/Core/VectorDynSize.h>
+#include <iDynTree/Core/VectorFixSize.h>
+#include <iDynTree/Model/Model.h>
+
+/**
+ * BenchmarkPlant replaces the robot when the controller is benchmarked. The joints track the
+ * position references perfectly while the feet wrenches are generated so that the measured ZMP
+ * is equal to the ZMP reference (ideal 3D-LIPM) or to the ZMP stored in a recorded dataset.
+ */
+class BenchmarkPlant
+{
+    double m_dT; /**< Sampling time. */
+    double m_weight; /**< Weight of the robot [N]. */
+
+    iDynTree::VectorDynSize m_jointPosition; /**< Joint position [rad]. */
+    iDynTree::VectorDynSize m_jointVelocity; /**< Joint velocity [rad/s]. */
+
+    iDynTree::Vector2 m_zmp; /**< ZMP applied by the plant (world frame). */
+
+    bool m_useDataset{false}; /**< True if the ZMP is read from a recorded dataset. */
+    std::vector<iDynTree::Vector2> m_recordedZMP; /**< ZMP stored in the dataset. */
+    std::size_t m_recordedZMPIndex{0}; /**< Index of the next recorded sample. */
+
+    /**
+     * Load the ZMP stored inside a dataset produced by the WalkingLoggerModule (text format).
+     * @param fileName name of the dataset.
+     * @return true/false in case of success/failure.
+     */
+    bool loadDataset(const std::string& fileName);
+
+    /**
+     * Evaluate the wrench of a foot given its CoP.
+     * @param footTransform transformation between the foot and the world frame;
+     * @param normalForce normal force acting on the foot;
+     * @param wrench wrench expressed in the foot frame.
+     */
+    void evaluateFootWrench(const iDynTree::Transform& footTransform, double normalForce,
+                            yarp::sig::Vector& wrench);
+
+public:
+
+    /**
+     * Initialize the plant.
+     * @param config configuration of the benchmark;
+     * @param model model of the robot (used to evaluate its weight);
+     * @param dT sampling time.
+     * @return true/false in case of success/failure.
+     */
+    bool initialize(const yarp::os::Searchable& config, const iDynTree::Model& model, double dT);
+
+    /**
+     * Reset the state of the plant.
+     * @param jointPosition joint position [rad];
+     * @param zmp initial ZMP (world frame).
+     */
+    void reset(const iDynTree::VectorDynSize& jointPosition, const iDynTree::Vector2& zmp);
+
+    /**
+     * Set the joint position references. The velocity is evaluated by finite differences.
+     * @param jointPosition desired joint position [rad].
+     * @return true/false in case of success/failure.
+     */
+    bool setJointReferences(const iDynTree::VectorDynSize& jointPosition);
+
+    /**
+     * Set the ZMP reference. It is ignored if the ZMP is read from a dataset.
+     * @param zmp desired ZMP (world frame).
+     */
+    void setZMPReference(const iDynTree::Vector2& zmp);
+
+    /**
+     * Advance the plant by one sampling time (only the dataset replay depends on it).
+     */
+    void step();
+
+    /**
+     * Get the encoders measurements.
+     * @param positionInDegrees joint position [deg];
+     * @param velocityInDegrees joint velocity [deg/s].
+     */
+    void getEncoders(yarp::sig::Vector& positionInDegrees, yarp::sig::Vector& velocityInDegrees);
+
+    /**
+     * Get the wrenches measured by the feet sensors. The weight of the robot is shared among the
+     * feet in contact.
+     * @param leftFootTransform transformation between the left foot and the world frame;
+     * @param rightFootTransform transformation between the right foot and the world frame;
+     * @param leftInContact true if the left foot is in contact;
+     * @param rightInContact true if the right foot is in contact;
+     * @param leftWrench left foot wrench;
+     * @param rightWrench right foot wrench.
+     */
+    void getWrenches(const iDynTree::Transform& leftFootTransform,
+                     const iDynTree::Transform& rightFootTransform,
+                     bool leftInContact, bool rightInContact,
+                     yarp::sig::Vector& leftWrench, yarp::sig::Vector& rightWrench);
+};
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * @file CodegenMPCSolver.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef CODEGEN_MPC_SOLVER_HPP
+#define CODEGEN_MPC_SOLVER_HPP
+
+// std
+#include <string>
+
+// eigen
+#include <Eigen/Sparse>
+
+#include "MPCSolver.hpp"
+#include "MPCCodegenInterface.h"
+
+/**
+ * CodegenMPCSolver class. It implements the sparse formulation of the DCM MPC (the problem is
+ * built as in MPCSolver) using a solver generated at build time by the OSQP code generation.
+ * The generated solver has a static workspace and a fixed sparsity pattern, it can be used only
+ * if its pattern is equal to the one of the problem (see isCompatible()).
+ */
+class CodegenMPCSolver : public MPCSolver
+{
+    const WalkingMPCCodegenSolver* m_generatedSolver; /**< Generated solver. */
+    Eigen::SparseMatrix<double> m_hessianMatrix; /**< Upper triangular part of the hessian matrix. */
+    bool m_isInitialized{false}; /**< True if the generated solver contains the problem. */
+    double m_solveTime{0}; /**< Time spent by the last solve [s]. */
+
+public:
+
+    /**
+     * Find a generated solver.
+     * @param name name of the contact configuration.
+     * @return the generated solver (nullptr if it does not exist).
+     */
+    static const WalkingMPCCodegenSolver* findGeneratedSolver(const std::string& name);
+
+    /**
+     * Constructor.
+     * @param generatedSolver generated solver (it is not owned by the class and only one
+     * instance can use it since its workspace is static);
+     * please see MPCSolver for the other parameters.
+     */
+    CodegenMPCSolver(const WalkingMPCCodegenSolver* generatedSolver,
+                     const int& stateSize, const int& inputSize,
+                     const int& controllerHorizon,
+                     const int& numberOfInequalityConstraints,
+                     const iDynTree::Triplets& equalConstraintsMatrix,
+                     const iDynSparseMatrix& gradientSubmatrix,
+                     const iDynSparseMatrix& stateWeightStackedMatrix);
+
+    /**
+     * Check if the generated solver was generated for this problem.
+     * @param hessian hessian matrix.
+     * @return true if the dimensions and the sparsity patterns are equal to the generated ones.
+     */
+    bool isCompatible(const iDynSparseMatrix& hessian) const;
+
+    /**
+     * Set the hessian matrix (it can be set only once).
+     * @param hessian hessian matrix.
+     * @return true/false in case of success/failure.
+     */
+    bool setHessianMatrix(const iDynSparseMatrix& hessian) override;
+
+    /**
+     * Set or update the inequality block of the linear constraints matrix.
+     * @param inequalityConstraintsMatrix  matrix of the inequalities constraints (Ax < b).
+     * @return true/false in case of success/failure.
+     */
+    bool setConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityConstraintsMatrix) override;
+
+    /**
+     * Set or update the lower and the upper bounds
+     * @param currentState value of the current state
+     * @param inequalityConstraintsVector vector of the inequalities constraints (Ax < b).
+     * @return true/false in case of success/failure.
+     */
+    bool setBounds(const iDynTree::Vector2& currentState,
+                   const iDynTree::VectorDynSize& inequalityConstraintsVector) override;
+
+    /**
+     * Set or update the gradient
+     * @param referenceSignal reference signal vector;
+     * @param previousControllerOutput previous controller output;
+     * @param resetTrajectory set equal to true if you do not want to use the previous trajectory.
+     * @return true/false in case of success/failure.
+     */
+    bool setGradient(const TrajectoryView<iDynTree::Vector2>& refereceSignal,
+                     const iDynTree::Vector2& previousControllerOutput,
+                     const bool& resetTrajectory) override;
+
+    /**
+     * Get the primal variable.
+     * @param primalVariable primal variable vector
+     * @return true/false in case of success/failure.
+     */
+    bool getPrimalVariable(Eigen::VectorXd& primalVariable) override;
+
+    /**
+     * Set the primal variable (warm start).
+     * @param primalVariable primal variable vector
+     * @return true/false in case of success/failure.
+     */
+    bool setPrimalVariable(const Eigen::VectorXd& primalVariable) override;
+
+    /**
+     * Get the dual variable.
+     * @param dualVariable dual variable vector
+     * @return true/false in case of success/failure.
+     */
+    bool getDualVariable(Eigen::VectorXd& dualVariable) override;
+
+    /**
+     * Set the dual variable (warm start).
+     * @param dualVariable dual variable vector
+     * @return true/false in case of success/failure.
+     */
+    bool setDualVariable(const Eigen::VectorXd& dualVariable) override;
+
+    /**
+     * Get the state of the solver.
+     * @return true if the solver is initialized false otherwise.
+     */
+    bool isInitialized() override;
+
+    /**
+     * Initialize the solver. The matrices, the gradient and the bounds are copied in the
+     * workspace of the generated solver (the KKT matrix is factorized).
+     * @return true/false in case of success/failure.
+     */
+    bool initialize() override;
+
+    /**
+     * Solve the optimization problem.
+     * @return true if the problem is solved, false otherwise.
+     */
+    bool solve() override;
+
+    /**
+     * Get the solver solution
+     * @return the entire solution of the solver
+     */
+    const iDynTree::VectorDynSize& getSolution() override;
+
+    /**
+     * Get the statistics of the last solve (the solve time is measured by the class).
+     * @param statistics statistics of the solver.
+     */
+    void getStatistics(QPSolverStatistics& statistics) override;
+};
+
+#endif
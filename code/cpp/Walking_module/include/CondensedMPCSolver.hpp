@@ -0,0 +1,161 @@
+/**
+ * @file CondensedMPCSolver.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef CONDENSED_MPC_SOLVER_HPP
+#define CONDENSED_MPC_SOLVER_HPP
+
+// std
+#include <memory>
+
+// eigen
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+// iDynTree
+#include <iDynTree/Core/SparseMatrix.h>
+#include <iDynTree/Core/VectorDynSize.h>
+
+// osqp-eigen
+#include <OsqpEigen/OsqpEigen.h>
+
+#include "MPCSolverInterface.hpp"
+#include "Utils.hpp"
+
+/**
+ * CondensedMPCSolver class. It implements the condensed formulation of the DCM MPC: the state
+ * is removed from the optimization variables using the (linear) system dynamics. Optionally
+ * the inputs can be grouped in blocks (move blocking), each block is considered constant.
+ * The optimization variables are the input blocks only and there are no equality constraints.
+ */
+class CondensedMPCSolver : public MPCSolverInterface
+{
+    /**
+     * Pointer to the optimization solver
+     */
+    std::unique_ptr<OsqpEigen::Solver> m_optimizerSolver;
+
+    Eigen::MatrixXd const* m_stateGradientMatrix; /**< Matrix that maps the current state into the gradient. */
+    Eigen::MatrixXd const* m_referenceGradientMatrix; /**< Matrix that maps the stacked reference signal into the gradient. */
+    Eigen::MatrixXd const* m_inputGradientMatrix; /**< Matrix that maps the previous controller output into the gradient. */
+
+    Eigen::SparseMatrix<double> m_constraintsMatrix; /**< Linear constraints matrix. Its sparsity pattern is fixed at construction. */
+
+    Eigen::VectorXd m_lowerBound; /**< Lower bound vector. */
+    Eigen::VectorXd m_upperBound; /**< Upper bound vector. */
+    Eigen::VectorXd m_gradient; /**< Gradient vector. */
+    iDynTree::VectorDynSize m_solution; /**< Solution of the problem. */
+    Eigen::VectorXd m_referenceSignal; /**< Stacked reference signal. */
+    Eigen::Vector2d m_currentState; /**< Current value of the state. */
+
+    int m_stateSize; /**< Size of the state vector (2). */
+    int m_inputSize; /**< Size of the controlled input vector (2). */
+    int m_controllerHorizon; /**< Controller horizon (in steps)*/
+    int m_numberOfBlocks; /**< Number of input blocks. */
+    int m_numberOfInequalityConstraints; /**< Maximum number of inequality constraints*/
+
+public:
+
+    /**
+     * Constructor.
+     * @param stateSize size of the state vector;
+     * @param inputSize size of the controlled input vector;
+     * @param controllerHorizon controller horizon (in steps);
+     * @param numberOfBlocks number of input blocks;
+     * @param numberOfInequalityConstraints maximum number of inequality constraints;
+     * @param stateGradientMatrix matrix that maps the current state into the gradient
+     * (\f$ T^T \Gamma^T \tilde{Q} \Phi \f$);
+     * @param referenceGradientMatrix matrix that maps the reference into the gradient
+     * (\f$ T^T \Gamma^T \tilde{Q} \f$);
+     * @param inputGradientMatrix matrix that maps the previous controller output into the gradient
+     * (\f$ -T^T \Theta^T \tilde{R} e_1 \f$).
+     */
+    CondensedMPCSolver(const int& stateSize, const int& inputSize,
+                       const int& controllerHorizon,
+                       const int& numberOfBlocks,
+                       const int& numberOfInequalityConstraints,
+                       const Eigen::MatrixXd& stateGradientMatrix,
+                       const Eigen::MatrixXd& referenceGradientMatrix,
+                       const Eigen::MatrixXd& inputGradientMatrix);
+
+    /**
+     * Set the hessian matrix.
+     * Please do not call this function to update the hessian matrix! It can be set only once.
+     * @param hessian hessian matrix (\f$ T^T (\Gamma^T \tilde{Q} \Gamma + \Theta^T \tilde{R} \Theta) T \f$).
+     * @return true/false in case of success/failure.
+     */
+    bool setHessianMatrix(const iDynSparseMatrix& hessian) override;
+
+    /**
+     * Set or update the linear constraints matrix.
+     * Only the first input block is constrained.
+     * @param inequalityConstraintsMatrix  matrix of the inequalities constraints (Ax < b). It
+     * can contain less rows than the maximum number of inequality constraints.
+     * @return true/false in case of success/failure.
+     */
+    bool setConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityConstraintsMatrix) override;
+
+    /**
+     * Set or update the upper bounds.
+     * @note The current state is stored and used by setGradient(). Please call this method before
+     * setGradient().
+     * @param currentState value of the current state
+     * @param inequalityConstraintsVector vector of the inequalities constraints (Ax < b)
+     * @return true/false in case of success/failure.
+     */
+    bool setBounds(const iDynTree::Vector2& currentState,
+                   const iDynTree::VectorDynSize& inequalityConstraintsVector) override;
+
+    /**
+     * Set or update the gradient.
+     * The gradient depends on the current state so it is always evaluated from scratch.
+     * @param referenceSignal reference signal vector (it has to contain the reference trajectory
+     * for the whole controller horizon);
+     * @param previousControllerOutput previous controller output;
+     * @param resetTrajectory not used by this formulation.
+     * @return true/false in case of success/failure.
+     */
+    bool setGradient(const TrajectoryView<iDynTree::Vector2>& refereceSignal,
+                     const iDynTree::Vector2& previousControllerOutput,
+                     const bool& resetTrajectory) override;
+
+    bool getPrimalVariable(Eigen::VectorXd& primalVariable) override;
+
+    bool setPrimalVariable(const Eigen::VectorXd& primalVariable) override;
+
+    bool getDualVariable(Eigen::VectorXd& dualVariable) override;
+
+    bool setDualVariable(const Eigen::VectorXd& dualVariable) override;
+
+    int getNumberOfConstraints() const override;
+
+    int getNumberOfEqualityConstraints() const override;
+
+    int getFirstInputIndex() const override;
+
+    bool isInitialized() override;
+
+    bool initialize() override;
+
+    bool solve() override;
+
+    const iDynTree::VectorDynSize& getSolution() override;
+
+    /**
+     * Get the gradient vector of the cost function (evaluated by setGradient()).
+     * @return the gradient vector.
+     */
+    const Eigen::VectorXd& getGradient() const override;
+
+    /**
+     * Get the statistics of the last solve (iterations, residuals and solve time).
+     * @param statistics statistics of the solver.
+     */
+    void getStatistics(QPSolverStatistics& statistics) override;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/**
+ * @file DCMControllerSupervisor.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef DCM_CONTROLLER_SUPERVISOR_HPP
+#define DCM_CONTROLLER_SUPERVISOR_HPP
+
+// YARP
+#include <yarp/os/Searchable.h>
+
+// iDynTree
+#include <iDynTree/Core/VectorFixSize.h>
+
+/**
+ * DCM controller used in the current tick.
+ */
+enum class DCMControllerMode {MPC, Reactive};
+
+/**
+ * DCMControllerSupervisor chooses the DCM controller used in each tick. The reactive controller
+ * is used in the ticks in which the MPC fails or its solve time is longer than a fraction of the
+ * sampling time. While the reactive controller is used the MPC is solved only every
+ * mpc_probe_period ticks (probes), so a late MPC does not slow down the fallback ticks. The MPC is
+ * used again after a number of consecutive healthy probes.
+ * When the controller changes, the difference between the new output and the last applied one is
+ * added to the output and it decays exponentially (bumpless transfer).
+ */
+class DCMControllerSupervisor
+{
+    double m_deadline; /**< Maximum solve time of the MPC [s]. */
+    int m_recoveryTicks; /**< Number of consecutive healthy probes required to use the MPC again. */
+    int m_probePeriod; /**< Number of ticks between two MPC probes when the reactive controller is used. */
+    int m_ticksSinceProbe{0}; /**< Number of ticks since the last time the MPC was solved. */
+    double m_offsetDecay; /**< Decay of the bumpless transfer offset in each tick. */
+
+    DCMControllerMode m_mode{DCMControllerMode::MPC}; /**< Controller used in the current tick. */
+    bool m_isModeChanged{false}; /**< True if the controller is changed in the current tick. */
+    int m_healthyTicks{0}; /**< Number of consecutive probes in which the MPC is healthy. */
+    unsigned int m_numberOfSwitches{0}; /**< Number of switches between the controllers. */
+
+    iDynTree::Vector2 m_offset; /**< Offset added to the output of the controller. */
+    iDynTree::Vector2 m_lastOutput; /**< Last output applied. */
+    bool m_isLastOutputValid{false}; /**< True if an output is already applied. */
+
+public:
+
+    /**
+     * Initialize the supervisor.
+     * @param config yarp searchable configuration variable;
+     * @param samplingTime sampling time of the controller [s].
+     * @return true/false in case of success/failure.
+     */
+    bool initialize(const yarp::os::Searchable& config, double samplingTime);
+
+    /**
+     * Reset the supervisor (the MPC is used and the offset is removed).
+     */
+    void reset();
+
+    /**
+     * Check if the MPC has to be solved in the current tick (always true if the MPC is used).
+     * @return true if the MPC has to be solved, false if the tick is skipped.
+     */
+    bool isMPCSolveRequired() const;
+
+    /**
+     * Update the supervisor in a tick in which the MPC is not solved.
+     */
+    void setMPCSkipped();
+
+    /**
+     * Update the supervisor with the status of the MPC in the current tick.
+     * @param isSolved true if the MPC problem is solved;
+     * @param solveTime time spent by the MPC [s].
+     */
+    void setMPCStatus(bool isSolved, double solveTime);
+
+    /**
+     * Get the controller that has to be used in the current tick.
+     * @return the mode.
+     */
+    DCMControllerMode getMode() const;
+
+    /**
+     * Apply the bumpless transfer to the output of the controller used in the current tick.
+     * @param output output of the controller (desired ZMP). It is modified in place.
+     */
+    void filterOutput(iDynTree::Vector2& output);
+
+    /**
+     * Get the number of switches between the controllers since the module was started.
+     * @return the number of switches.
+     */
+    unsigned int getNumberOfSwitches() const;
+};
+
+#endif
@@ -0,0 +1,109 @@
+/**
+ * @file FilterBank.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef FILTER_BANK_HPP
+#define FILTER_BANK_HPP
+
+// std
+#include <vector>
+
+// Eigen
+#include <Eigen/Dense>
+
+/**
+ * FilterBank conditions a set of signals with first order low pass filters.
+ * The channels are organized in groups (e.g. the joint velocities or the force of a foot) and
+ * all of them are stored in a single buffer, so the unit conversion and the filtering of all
+ * the channels are evaluated in one vectorized pass. Each filter is the Tustin discretization of
+ * 1 / (tau s + 1), as iCub::ctrl::FirstOrderLowPassFilter, and the unit conversion is folded in
+ * its coefficients. A group with a non positive cut frequency is only scaled.
+ * The output of a group can be written directly in a destination buffer (e.g. the data of an
+ * iDynTree vector) at the end of process().
+ */
+class FilterBank
+{
+    /**
+     * Channels of a group.
+     */
+    struct Group
+    {
+        int offset; /**< Index of the first channel in the buffer. */
+        int size; /**< Number of channels. */
+        double scale; /**< Scale factor applied to the input. */
+        double* output; /**< Destination of the output (nullptr if it is not set). */
+    };
+
+    std::vector<Group> m_groups; /**< Groups of the bank. */
+
+    Eigen::ArrayXd m_inputGain; /**< Gain of the current input. */
+    Eigen::ArrayXd m_previousInputGain; /**< Gain of the previous input. */
+    Eigen::ArrayXd m_previousOutputGain; /**< Gain of the previous output. */
+
+    Eigen::ArrayXd m_input; /**< Current input (input units). */
+    Eigen::ArrayXd m_previousInput; /**< Previous input (input units). */
+    Eigen::ArrayXd m_output; /**< Output (output units). */
+
+public:
+
+    /**
+     * Add a group of channels. The buffers are reallocated, so the groups have to be added
+     * before the control loop starts.
+     * @param size number of channels;
+     * @param cutFrequency cut frequency of the filters [Hz] (if it is not positive the channels
+     * are not filtered);
+     * @param samplingTime sampling time [s];
+     * @param scale scale factor applied to the input (e.g. iDynTree::deg2rad(1)).
+     * @return the index of the group (-1 in case of failure).
+     */
+    int addGroup(int size, double cutFrequency, double samplingTime, double scale = 1.0);
+
+    /**
+     * Set the destination of the output of a group.
+     * The buffer has to contain at least the channels of the group and it has to be valid (i.e.
+     * not reallocated) until the bank is used.
+     * @param group index of the group;
+     * @param output destination of the output.
+     * @return true/false in case of success/failure.
+     */
+    bool setOutput(int group, double* output);
+
+    /**
+     * Set the input of a group.
+     * @param group index of the group;
+     * @param input input of the channels (input units).
+     */
+    void setInput(int group, const double* input);
+
+    /**
+     * Initialize the filters of a group in the steady state.
+     * The output is written in the destination of the group.
+     * @param group index of the group;
+     * @param value steady state value (input units).
+     */
+    void init(int group, const double* value);
+
+    /**
+     * Filter all the channels and write the outputs in the destinations.
+     */
+    void process();
+
+    /**
+     * Get the output of a group.
+     * @param group index of the group.
+     * @return pointer to the output of the channels (output units).
+     */
+    const double* getOutput(int group) const;
+
+    /**
+     * Get the number of groups.
+     * @return the number of groups.
+     */
+    int getNumberOfGroups() const;
+};
+
+#endif
@@ -0,0 +1,198 @@
+/**
+ * @file FootprintConstraints.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef FOOTPRINT_CONSTRAINTS_HPP
+#define FOOTPRINT_CONSTRAINTS_HPP
+
+// std
+#include <array>
+#include <cstddef>
+
+// Eigen
+#include <Eigen/Dense>
+
+// YARP
+#include <yarp/os/Searchable.h>
+
+// iDynTree
+#include <iDynTree/Core/MatrixDynSize.h>
+#include <iDynTree/Core/Transform.h>
+#include <iDynTree/Core/VectorDynSize.h>
+#include <iDynTree/Core/VectorFixSize.h>
+#include <iDynTree/ConvexHullHelpers.h>
+
+/**
+ * FootprintConstraints evaluates the half-space representation \f$ A x \le b \f$ of the support
+ * polygon (the rows of A have unit norm, so \f$ b - A x \f$ is the distance from the edges).
+ * The half-spaces of each foot are evaluated once in the foot frame and they are moved rigidly
+ * (the feet are assumed parallel to the ground, only the yaw and the planar position are used).
+ * In double support the two footprints are merged with a fixed-size convex hull routine.
+ * The constraints of each contact configuration are cached, so they are not evaluated again if
+ * the feet land on the same poses. No memory is allocated after setFeetPolygons().
+ */
+class FootprintConstraints
+{
+public:
+    static constexpr std::size_t MaxFootVertices = 8; /**< Maximum number of vertices of a foot polygon. */
+    static constexpr std::size_t MaxConstraints = 2 * MaxFootVertices; /**< Maximum number of half-spaces. */
+
+private:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 2, Eigen::ColMajor, MaxConstraints, 2> ConstraintsMatrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, MaxConstraints, 1> ConstraintsVector;
+
+    /**
+     * Planar pose of a foot.
+     */
+    struct FootPose
+    {
+        double x{0}; /**< Position along x. */
+        double y{0}; /**< Position along y. */
+        double yaw{0}; /**< Rotation around z. */
+
+        bool operator==(const FootPose& other) const
+        {
+            return x == other.x && y == other.y && yaw == other.yaw;
+        }
+    };
+
+    /**
+     * Convex footprint expressed in the foot frame.
+     */
+    struct Footprint
+    {
+        std::array<Eigen::Vector2d, MaxFootVertices> vertices; /**< Vertices (counterclockwise). */
+        ConstraintsMatrix A; /**< Normals of the edges. */
+        ConstraintsVector b; /**< Offsets of the edges. */
+    };
+
+    /**
+     * Constraints of a contact configuration.
+     */
+    struct CachedConstraints
+    {
+        bool isValid{false}; /**< True if the constraints are evaluated. */
+        FootPose leftPose; /**< Pose of the left foot. */
+        FootPose rightPose; /**< Pose of the right foot. */
+        ConstraintsMatrix A; /**< Constraints matrix. */
+        ConstraintsVector b; /**< Constraints vector. */
+    };
+
+    std::array<Footprint, 2> m_footprints; /**< Footprint of the left and of the right foot. */
+    std::array<CachedConstraints, 3> m_cache; /**< Constraints of the double support, left and right support. */
+    const CachedConstraints* m_current{nullptr}; /**< Constraints of the current configuration. */
+
+    iDynTree::MatrixDynSize m_AiDynTree; /**< Current constraints matrix (used by the MPC). */
+    iDynTree::VectorDynSize m_biDynTree; /**< Current constraints vector (used by the MPC). */
+
+    /**
+     * Get the planar pose of a foot.
+     * @param transform transform of the foot.
+     * @return the planar pose.
+     */
+    static FootPose getPose(const iDynTree::Transform& transform);
+
+    /**
+     * Evaluate the convex hull of a set of points (Andrew's monotone chain).
+     * @param points set of points (it is sorted);
+     * @param numberOfPoints number of points;
+     * @param hull vertices of the hull (counterclockwise, the first numberOfPoints elements are used
+     * as buffer).
+     * @return the number of vertices of the hull (at most numberOfPoints).
+     */
+    template <std::size_t N>
+    static std::size_t computeConvexHull(std::array<Eigen::Vector2d, N>& points, std::size_t numberOfPoints,
+                                         std::array<Eigen::Vector2d, 2 * N>& hull);
+
+    /**
+     * Evaluate the half-spaces of a counterclockwise convex polygon.
+     * @param vertices vertices of the polygon;
+     * @param numberOfVertices number of vertices;
+     * @param A normals of the edges;
+     * @param b offsets of the edges.
+     */
+    template <std::size_t N>
+    static void computeHalfSpaces(const std::array<Eigen::Vector2d, N>& vertices, std::size_t numberOfVertices,
+                                  ConstraintsMatrix& A, ConstraintsVector& b);
+
+    /**
+     * Evaluate the constraints of the single support.
+     * @param footIndex index of the foot (0 left, 1 right);
+     * @param pose pose of the foot;
+     * @param constraints evaluated constraints.
+     */
+    void evaluateSingleSupport(std::size_t footIndex, const FootPose& pose, CachedConstraints& constraints) const;
+
+    /**
+     * Evaluate the constraints of the double support.
+     * @param constraints evaluated constraints (the poses are already set).
+     */
+    void evaluateDoubleSupport(CachedConstraints& constraints) const;
+
+public:
+
+    /**
+     * Initialize the feet polygons. The feet are rectangles of dimensions foot_size
+     * ((x_min x_max) (y_min y_max)).
+     * @param config yarp searchable configuration variable.
+     * @return true/false in case of success/failure.
+     */
+    bool initialize(const yarp::os::Searchable& config);
+
+    /**
+     * Set the polygons of the feet (expressed in the foot frames).
+     * @param leftFoot polygon of the left foot;
+     * @param rightFoot polygon of the right foot.
+     * @return true/false in case of success/failure.
+     */
+    bool setFeetPolygons(const iDynTree::Polygon& leftFoot, const iDynTree::Polygon& rightFoot);
+
+    /**
+     * Get the number of vertices of a footprint (the collinear vertices of the polygon are removed).
+     * @param footIndex index of the foot (0 left, 1 right).
+     * @return the number of vertices.
+     */
+    int getNumberOfFootVertices(std::size_t footIndex) const;
+
+    /**
+     * Evaluate the constraints. At least a foot has to be in contact.
+     * @param leftFoot transform of the left foot (nullptr if the foot is not in contact);
+     * @param rightFoot transform of the right foot (nullptr if the foot is not in contact).
+     * @return true/false in case of success/failure.
+     */
+    bool evaluate(const iDynTree::Transform* leftFoot, const iDynTree::Transform* rightFoot);
+
+    /**
+     * Get the constraints matrix.
+     * @return the matrix A.
+     */
+    const iDynTree::MatrixDynSize& getConstraintsMatrix() const;
+
+    /**
+     * Get the constraints vector.
+     * @return the vector b.
+     */
+    const iDynTree::VectorDynSize& getConstraintsVector() const;
+
+    /**
+     * Get the distance of a point from the boundary of the support polygon.
+     * @param point position of the point.
+     * @return the margin (negative outside the polygon).
+     */
+    double computeMargin(const iDynTree::Vector2& point) const;
+
+    /**
+     * Get the minimum margin of a set of points. All the half-spaces are evaluated together for
+     * each point (the operations are vectorized by Eigen).
+     * @param points pointer to the first coordinate (the points are stored as x0 y0 x1 y1 ...);
+     * @param numberOfPoints number of points.
+     * @return the minimum margin (negative if a point is outside the polygon).
+     */
+    double computeMinimumMargin(const double* points, std::size_t numberOfPoints) const;
+};
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file FrameRingBuffer.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef FRAME_RING_BUFFER_HPP
+#define FRAME_RING_BUFFER_HPP
+
+// std
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * FrameRingBuffer is a single-producer single-consumer lock-free ring buffer of fixed-size
+ * frames of doubles. The memory is allocated only once by resize(). The producer writes
+ * directly inside the buffer (beginWrite() / endWrite()), while the consumer copies a batch
+ * of frames with read(). When the buffer is full the new frames are dropped.
+ */
+class FrameRingBuffer
+{
+    std::vector<double> m_buffer; /**< Storage of all the frames. */
+    std::size_t m_frameSize{0}; /**< Number of doubles of each frame. */
+    std::size_t m_numberOfFrames{0}; /**< Maximum number of frames stored. */
+
+    std::atomic<std::size_t> m_head{0}; /**< Number of frames written by the producer. */
+    std::atomic<std::size_t> m_tail{0}; /**< Number of frames read by the consumer. */
+    std::atomic<std::size_t> m_droppedFrames{0}; /**< Number of frames dropped because the buffer was full. */
+
+public:
+
+    /**
+     * Allocate the buffer and reset its content.
+     * @note Please do not call this method while the producer or the consumer are running.
+     * @param frameSize number of doubles of each frame;
+     * @param numberOfFrames maximum number of frames stored.
+     */
+    void resize(std::size_t frameSize, std::size_t numberOfFrames);
+
+    /**
+     * Get the pointer to the next free frame (producer side).
+     * @return the pointer to the frame or nullptr if the buffer is full.
+     */
+    double* beginWrite();
+
+    /**
+     * Publish the frame obtained by beginWrite() (producer side).
+     */
+    void endWrite();
+
+    /**
+     * Copy the oldest frames and remove them from the buffer (consumer side).
+     * @param output pointer to a memory area of at least maxFrames * frameSize doubles;
+     * @param maxFrames maximum number of frames copied.
+     * @return the number of frames copied.
+     */
+    std::size_t read(double* output, std::size_t maxFrames);
+
+    /**
+     * Get the size of a frame.
+     * @return the number of doubles of each frame.
+     */
+    std::size_t getFrameSize() const;
+
+    /**
+     * Get the maximum number of frames stored.
+     * @return the maximum number of frames.
+     */
+    std::size_t getNumberOfFrames() const;
+
+    /**
+     * Get the number of frames dropped since the last call of resize().
+     * @return the number of dropped frames.
+     */
+    std::size_t getDroppedFrames() const;
+};
+
+#endif
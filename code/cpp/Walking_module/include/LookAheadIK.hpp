@@ -0,0 +1,170 @@
+/**
+ * @file LookAheadIK.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef LOOK_AHEAD_IK_HPP
+#define LOOK_AHEAD_IK_HPP
+
+// std
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// YARP
+#include <yarp/os/Searchable.h>
+
+// iDynTree
+#include <iDynTree/Core/VectorDynSize.h>
+#include <iDynTree/Core/VectorFixSize.h>
+#include <iDynTree/Core/Transform.h>
+#include <iDynTree/Model/Model.h>
+
+#include "StableDCMModel.hpp"
+#include "TrajectoryBuffer.hpp"
+#include "WalkingInverseKinematics.hpp"
+
+/**
+ * Data required to evaluate the joint posture of a future tick.
+ */
+struct LookAheadIKRequest
+{
+    std::size_t tick{0}; /**< Tick in which the posture will be used. */
+    std::size_t generation{0}; /**< Generation of the trajectory used to build the request. */
+    iDynTree::Transform leftFootTransform; /**< Desired left foot to world transformation. */
+    iDynTree::Transform rightFootTransform; /**< Desired right foot to world transformation. */
+    double comHeight{0}; /**< Desired CoM height. */
+    iDynTree::Vector2 comPosition; /**< Desired CoM position (x-y) of the current tick. */
+    std::vector<iDynTree::Vector2> dcmPosition; /**< Desired DCM position from the next tick to
+                                                   the one of the request. */
+    iDynTree::Rotation inertial_R_worldFrame; /**< Rotation between the inertial and the world frame. */
+    iDynTree::VectorDynSize jointPosition; /**< Measured joint position (in rad). */
+};
+
+/**
+ * Joint posture evaluated by the look-ahead thread.
+ */
+struct LookAheadIKResult
+{
+    std::size_t tick{0}; /**< Tick in which the posture has to be used. */
+    std::size_t generation{0}; /**< Generation of the trajectory used to evaluate the posture. */
+    bool isValid{false}; /**< True if the posture is evaluated. */
+    iDynTree::VectorDynSize jointPosition; /**< Joint posture (in rad). */
+};
+
+/**
+ * LookAheadIK solves the nonlinear inverse kinematics a few samples ahead in a dedicated thread.
+ * The CoM position of the future samples is predicted with the stable DCM model, the feet
+ * and the CoM height are taken from the planned trajectory. The postures are used by the
+ * control thread as regularization term of the QP-IK, so the nonlinear solver is not in the
+ * critical path.
+ */
+class LookAheadIK
+{
+    std::size_t m_lookAheadSamples; /**< Number of samples between the request and the use of a posture. */
+    std::size_t m_tick{0}; /**< Current tick (used only by the control thread). */
+    std::size_t m_generation{0}; /**< Incremented every time the trajectory changes. */
+
+    WalkingIK m_IKSolver; /**< Inverse kinematics solver (used only by the look-ahead thread). */
+    StableDCMModel m_stableDCMModel; /**< Model used to predict the CoM position (used only by
+                                        the look-ahead thread). */
+
+    LookAheadIKRequest m_request; /**< Last request sent by the control thread. */
+    LookAheadIKRequest m_solverRequest; /**< Request processed by the look-ahead thread. */
+    bool m_isRequestAvailable{false}; /**< True if a new request is available. */
+    std::vector<LookAheadIKResult> m_results; /**< Circular buffer containing the postures
+                                                 (indexed with the tick). */
+    iDynTree::VectorDynSize m_solution; /**< Buffer used by the look-ahead thread. */
+    std::vector<iDynTree::Vector2> m_predictedCoMPosition; /**< CoM position predicted over the
+                                                              look-ahead window. */
+
+    std::thread m_lookAheadThread; /**< Look-ahead thread. */
+    std::condition_variable m_conditionVariable; /**< Used to wake up the thread. */
+    std::mutex m_mutex; /**< Mutex. */
+    bool m_isClosing{false}; /**< True if the thread has to be closed. */
+
+    /**
+     * Main thread method.
+     */
+    void lookAheadThread();
+
+    /**
+     * Evaluate the posture related to the request stored in m_solverRequest.
+     * @return true/false in case of success/failure.
+     */
+    bool solve();
+
+public:
+
+    /**
+     * Deconstructor.
+     */
+    ~LookAheadIK();
+
+    /**
+     * Initialize the object and start the look-ahead thread.
+     * @param config yarp searchable configuration variable (main group);
+     * @param inverseKinematicsOptions options of the inverse kinematics solver;
+     * @param generalOptions options containing the com height and the sampling time;
+     * @param model iDynTree model;
+     * @param jointList list of the controlled joints.
+     * @return true/false in case of success/failure.
+     */
+    bool initialize(const yarp::os::Searchable& config,
+                    yarp::os::Searchable& inverseKinematicsOptions,
+                    const yarp::os::Searchable& generalOptions,
+                    const iDynTree::Model& model,
+                    const std::vector<std::string>& jointList);
+
+    /**
+     * Stop the look-ahead thread.
+     */
+    void stop();
+
+    /**
+     * Discard all the postures evaluated. Please call this method every time the trajectory
+     * is changed.
+     */
+    void reset();
+
+    /**
+     * Ask the evaluation of the posture related to the sample getLookAheadSamples() of the
+     * trajectory. The previous request is discarded if it is not processed yet.
+     * @param trajectory trajectory (the first sample is related to the current tick);
+     * @param comPosition desired CoM position (x-y) of the current tick;
+     * @param inertial_R_worldFrame rotation between the inertial and the world frame;
+     * @param jointPosition measured joint position (in rad).
+     * @return true/false in case of success/failure.
+     */
+    bool setRequest(const TrajectoryBuffer& trajectory, const iDynTree::Vector2& comPosition,
+                    const iDynTree::Rotation& inertial_R_worldFrame,
+                    const iDynTree::VectorDynSize& jointPosition);
+
+    /**
+     * Get the posture related to the current tick and advance the time.
+     * @param jointPosition posture (in rad).
+     * @return true if the posture is available false otherwise.
+     */
+    bool getPosture(iDynTree::VectorDynSize& jointPosition);
+
+    /**
+     * Get the number of samples between the request and the use of a posture.
+     * @return the number of samples.
+     */
+    std::size_t getLookAheadSamples() const;
+
+    /**
+     * Restrict the look-ahead thread to a set of cores.
+     * @param cores list of the cores.
+     * @return true/false in case of success/failure.
+     */
+    bool setThreadAffinity(const std::vector<int>& cores);
+};
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * @file MPCCodegenInterface.h
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef MPC_CODEGEN_INTERFACE_H
+#define MPC_CODEGEN_INTERFACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Descriptor of a DCM MPC solver generated by codegen/generate_mpc_solvers.py (OSQP embedded
+ * code generation). The workspace of the solver is static, none of the functions allocates memory.
+ * The matrices are stored in the compressed sparse column format, the hessian matrix contains
+ * only the upper triangular part. The functions return 1 in case of success and 0 otherwise.
+ */
+typedef struct
+{
+    const char* name; /**< Name of the contact configuration. */
+    int numberOfVariables; /**< Number of optimization variables. */
+    int numberOfConstraints; /**< Number of constraints (equality and inequality). */
+
+    int hessianNonZeros; /**< Number of elements of the hessian matrix. */
+    const int* hessianColumns; /**< Column pointers of the hessian matrix. */
+    const int* hessianRows; /**< Row indices of the hessian matrix. */
+
+    int constraintsNonZeros; /**< Number of elements of the constraints matrix. */
+    const int* constraintsColumns; /**< Column pointers of the constraints matrix. */
+    const int* constraintsRows; /**< Row indices of the constraints matrix. */
+
+    int (*updateMatrices)(const double* hessianValues, const double* constraintsValues);
+    int (*updateConstraintsMatrix)(const double* constraintsValues);
+    int (*updateGradient)(const double* gradient);
+    int (*updateBounds)(const double* lowerBound, const double* upperBound);
+    int (*warmStartPrimal)(const double* primalVariable);
+    int (*warmStartDual)(const double* dualVariable);
+    int (*solve)(void); /**< It returns 1 only if the problem is solved. */
+    const double* (*getPrimalVariable)(void);
+    const double* (*getDualVariable)(void);
+    void (*getInfo)(int* iterations, double* primalResidual, double* dualResidual);
+} WalkingMPCCodegenSolver;
+
+/**
+ * Generated solvers (the last element is a null pointer).
+ */
+extern const WalkingMPCCodegenSolver* const walking_mpc_codegen_solvers[];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -9,8 +9,8 @@
 #ifndef MPC_SOLVER_HPP
 #define MPC_SOLVER_HPP
 
-// std
-#include <deque>
+// eigen
+#include <Eigen/Sparse>
 
 // iDynTree
 #include <iDynTree/Core/SparseMatrix.h>
@@ -19,13 +19,17 @@
 // osqp-eigen
 #include <OsqpEigen/OsqpEigen.h>
 
+#include "MPCSolverInterface.hpp"
 #include "Utils.hpp"
 
 /**
- * MPCSolver class
+ * MPCSolver class. It implements the sparse formulation of the DCM MPC, both the states and the
+ * inputs are optimization variables and the dynamics is enforced by equality constraints.
  */
-class MPCSolver
+class MPCSolver : public MPCSolverInterface
 {
+protected:
+
     /**
      * Pointer to the optimization solver
      */
@@ -34,21 +38,56 @@ class MPCSolver
     iDynSparseMatrix const* m_gradientSubmatrix; /**< Matrix used to evaluate the gradient vector */
     iDynSparseMatrix const* m_stateWeightMatrix; /**< State weight stacked matrix */
 
+    Eigen::SparseMatrix<double> m_constraintsMatrix; /**< Linear constraints matrix. Its sparsity pattern is fixed at construction. */
+
     Eigen::VectorXd m_lowerBound; /**< Lower bound vector. */
     Eigen::VectorXd m_upperBound; /**< Upper bound vector. */
     Eigen::VectorXd m_gradient; /**< Gradient vector. */
+    iDynTree::VectorDynSize m_solution; /**< Solution of the problem. */
 
     int m_stateSize; /**< Size of the state vector (2). */
     int m_inputSize; /**< Size of the controlled input vector (2). */
     int m_controllerHorizon; /**< Controller horizon (in steps)*/
-    int m_numberOfInequalityConstraints; /**< Number of inequality constraints*/
+    int m_numberOfInequalityConstraints; /**< Maximum number of inequality constraints*/
+
+    /**
+     * Update the values of the inequality block of the constraints matrix.
+     * @param inequalityConstraintsMatrix matrix of the inequalities constraints (Ax < b).
+     * @return true/false in case of success/failure.
+     */
+    bool evaluateConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityConstraintsMatrix);
+
+    /**
+     * Evaluate the lower and the upper bounds.
+     * @param currentState value of the current state
+     * @param inequalityConstraintsVector vector of the inequalities constraints (Ax < b).
+     * @return true/false in case of success/failure.
+     */
+    bool evaluateBounds(const iDynTree::Vector2& currentState,
+                        const iDynTree::VectorDynSize& inequalityConstraintsVector);
+
+    /**
+     * Evaluate the gradient vector.
+     * @param referenceSignal reference signal vector;
+     * @param previousControllerOutput previous controller output;
+     * @param resetTrajectory if true the whole gradient is evaluated, otherwise the previous
+     * one is shifted.
+     */
+    void evaluateGradient(const TrajectoryView<iDynTree::Vector2>& referenceSignal,
+                          const iDynTree::Vector2& previousControllerOutput,
+                          bool resetTrajectory);
 
 public:
 
     /**
      * Constructor.
+     * The sparsity pattern of the constraints matrix is built here once and for all: the
+     * inequality block is always stored as a dense numberOfInequalityConstraints x inputSize
+     * block so that the constraints can be changed without reinitializing the solver.
      * @param stateSize size of the state vector;
      * @param inputSize size of the controlled input vector;
+     * @param controllerHorizon controller horizon (in steps);
+     * @param numberOfInequalityConstraints maximum number of inequality constraints;
      * @param equalConstraintsMatrix equal submatrix  of the constraints matrix;
      * @param gradientSubmatrix matrix used to evaluate the gradient vector
      * (\f$-\Theta^T \tilde{R} e_1\f$);
@@ -67,25 +106,28 @@ public:
      * @param hessian hessian matrix.
      * @return true/false in case of success/failure.
      */
-    bool setHessianMatrix(const iDynSparseMatrix& hessian);
+    bool setHessianMatrix(const iDynSparseMatrix& hessian) override;
 
     /**
      * Set or update the linear constraints matrix.
      * If the solver is already set the linear constraints matrix is updated otherwise it is set for
-     * the first time.
-     * @param inequalityConstraintsMatrix  matrix of the inequalities constraints (Ax < b)
+     * the first time. Only the values are changed, hence the solver is never reinitialized.
+     * @param inequalityConstraintsMatrix  matrix of the inequalities constraints (Ax < b). It
+     * can contain less rows than the maximum number of inequality constraints, the remaining
+     * rows are set equal to zero.
      * @return true/false in case of success/failure.
      */
-    bool setConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityConstraintsMatrix);
+    bool setConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityConstraintsMatrix) override;
 
     /**
      * Set or update the lower and the upper bounds
      * @param currentState value of the current state
-     * @param inequalityConstraintsVector vector of the inequalities constraints (Ax < b)
+     * @param inequalityConstraintsVector vector of the inequalities constraints (Ax < b). The
+     * upper bound of the unused inequality constraints is set to infinity.
      * @return true/false in case of success/failure.
      */
     bool setBounds(const iDynTree::Vector2& currentState,
-                   const iDynTree::VectorDynSize& inequalityConstraintsVector);
+                   const iDynTree::VectorDynSize& inequalityConstraintsVector) override;
 
     /**
      * Set or update the gradient
@@ -95,47 +137,91 @@ public:
      * @param resetTrajectory set equal to true if you do not want to use the previous trajectory.
      * @return true/false in case of success/failure.
      */
-    bool setGradient(const std::deque<iDynTree::Vector2>& refereceSignal,
+    bool setGradient(const TrajectoryView<iDynTree::Vector2>& refereceSignal,
                      const iDynTree::Vector2& previousControllerOutput,
-                     const bool& resetTrajectory);
+                     const bool& resetTrajectory) override;
 
     /**
      * Get the primal variable.
      * @param primalVariable primal variable vector
      * @return true/false in case of success/failure.
      */
-    bool getPrimalVariable(Eigen::VectorXd& primalVariable);
+    bool getPrimalVariable(Eigen::VectorXd& primalVariable) override;
 
     /**
      * Set the primal variable.
      * @param primalVariable primal variable vector
      * @return true/false in case of success/failure.
      */
-    bool setPrimalVariable(const Eigen::VectorXd& primalVariable);
+    bool setPrimalVariable(const Eigen::VectorXd& primalVariable) override;
+
+    /**
+     * Get the dual variable.
+     * @param dualVariable dual variable vector
+     * @return true/false in case of success/failure.
+     */
+    bool getDualVariable(Eigen::VectorXd& dualVariable) override;
+
+    /**
+     * Set the dual variable.
+     * @param dualVariable dual variable vector
+     * @return true/false in case of success/failure.
+     */
+    bool setDualVariable(const Eigen::VectorXd& dualVariable) override;
+
+    /**
+     * Get the number of constraints (equality and inequality).
+     * @return the number of constraints.
+     */
+    int getNumberOfConstraints() const override;
+
+    /**
+     * Get the number of equality constraints.
+     * @return the number of equality constraints.
+     */
+    int getNumberOfEqualityConstraints() const override;
+
+    /**
+     * Get the position of the first controlled input inside the solution vector.
+     * @return the index of the first input.
+     */
+    int getFirstInputIndex() const override;
 
     /**
      * Get the state of the solver.
      * @return true if the solver is initialized false otherwise.
      */
-    bool isInitialized();
+    bool isInitialized() override;
 
     /**
      * Initialize the solver.
      * @return true/false in case of success/failure.
      */
-    bool initialize();
+    bool initialize() override;
 
     /**
      * Solve the optimization problem.
      * @return true/false in case of success/failure.
      */
-    bool solve();
+    bool solve() override;
 
     /**
      * Get the solver solution
      * @return the entire solution of the solver
      */
-    iDynTree::VectorDynSize getSolution();
+    const iDynTree::VectorDynSize& getSolution() override;
+
+    /**
+     * Get the gradient vector of the cost function (evaluated by setGradient()).
+     * @return the gradient vector.
+     */
+    const Eigen::VectorXd& getGradient() const override;
+
+    /**
+     * Get the statistics of the last solve (iterations, residuals and solve time).
+     * @param statistics statistics of the solver.
+     */
+    void getStatistics(QPSolverStatistics& statistics) override;
 };
 
 #endif
@@ -0,0 +1,157 @@
+/**
+ * @file MPCSolverInterface.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef MPC_SOLVER_INTERFACE_HPP
+#define MPC_SOLVER_INTERFACE_HPP
+
+// eigen
+#include <Eigen/Dense>
+
+// iDynTree
+#include <iDynTree/Core/MatrixDynSize.h>
+#include <iDynTree/Core/VectorDynSize.h>
+#include <iDynTree/Core/VectorFixSize.h>
+
+#include "SolverStatistics.hpp"
+#include "TrajectoryView.hpp"
+#include "Utils.hpp"
+
+/**
+ * MPCSolverInterface class contains the methods shared by all the DCM MPC formulations.
+ */
+class MPCSolverInterface
+{
+public:
+
+    /**
+     * Destructor.
+     */
+    virtual ~MPCSolverInterface() = default;
+
+    /**
+     * Set the hessian matrix.
+     * Please do not call this function to update the hessian matrix! It can be set only once.
+     * @param hessian hessian matrix.
+     * @return true/false in case of success/failure.
+     */
+    virtual bool setHessianMatrix(const iDynSparseMatrix& hessian) = 0;
+
+    /**
+     * Set or update the linear constraints matrix.
+     * @param inequalityConstraintsMatrix  matrix of the inequalities constraints (Ax < b)
+     * @return true/false in case of success/failure.
+     */
+    virtual bool setConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityConstraintsMatrix) = 0;
+
+    /**
+     * Set or update the lower and the upper bounds
+     * @param currentState value of the current state
+     * @param inequalityConstraintsVector vector of the inequalities constraints (Ax < b)
+     * @return true/false in case of success/failure.
+     */
+    virtual bool setBounds(const iDynTree::Vector2& currentState,
+                           const iDynTree::VectorDynSize& inequalityConstraintsVector) = 0;
+
+    /**
+     * Set or update the gradient
+     * @param referenceSignal reference signal vector (it has to contain the reference trajectory
+     * for the whole controller horizon);
+     * @param previousControllerOutput previous controller output;
+     * @param resetTrajectory set equal to true if you do not want to use the previous trajectory.
+     * @return true/false in case of success/failure.
+     */
+    virtual bool setGradient(const TrajectoryView<iDynTree::Vector2>& refereceSignal,
+                             const iDynTree::Vector2& previousControllerOutput,
+                             const bool& resetTrajectory) = 0;
+
+    /**
+     * Get the primal variable.
+     * @param primalVariable primal variable vector
+     * @return true/false in case of success/failure.
+     */
+    virtual bool getPrimalVariable(Eigen::VectorXd& primalVariable) = 0;
+
+    /**
+     * Set the primal variable.
+     * @param primalVariable primal variable vector
+     * @return true/false in case of success/failure.
+     */
+    virtual bool setPrimalVariable(const Eigen::VectorXd& primalVariable) = 0;
+
+    /**
+     * Get the dual variable.
+     * @param dualVariable dual variable vector
+     * @return true/false in case of success/failure.
+     */
+    virtual bool getDualVariable(Eigen::VectorXd& dualVariable) = 0;
+
+    /**
+     * Set the dual variable.
+     * @param dualVariable dual variable vector
+     * @return true/false in case of success/failure.
+     */
+    virtual bool setDualVariable(const Eigen::VectorXd& dualVariable) = 0;
+
+    /**
+     * Get the number of constraints (equality and inequality).
+     * @return the number of constraints.
+     */
+    virtual int getNumberOfConstraints() const = 0;
+
+    /**
+     * Get the number of equality constraints.
+     * The equality constraints are always stored before the inequality ones.
+     * @return the number of equality constraints.
+     */
+    virtual int getNumberOfEqualityConstraints() const = 0;
+
+    /**
+     * Get the position of the first controlled input inside the solution vector.
+     * @return the index of the first input.
+     */
+    virtual int getFirstInputIndex() const = 0;
+
+    /**
+     * Get the state of the solver.
+     * @return true if the solver is initialized false otherwise.
+     */
+    virtual bool isInitialized() = 0;
+
+    /**
+     * Initialize the solver.
+     * @return true/false in case of success/failure.
+     */
+    virtual bool initialize() = 0;
+
+    /**
+     * Solve the optimization problem.
+     * @return true/false in case of success/failure.
+     */
+    virtual bool solve() = 0;
+
+    /**
+     * Get the solver solution
+     * @return the entire solution of the solver (the vector is owned by the solver and it is
+     * overwritten by the next call)
+     */
+    virtual const iDynTree::VectorDynSize& getSolution() = 0;
+
+    /**
+     * Get the gradient vector of the cost function (evaluated by setGradient()).
+     * @return the gradient vector.
+     */
+    virtual const Eigen::VectorXd& getGradient() const = 0;
+
+    /**
+     * Get the statistics of the last solve (iterations, residuals and solve time).
+     * @param statistics statistics of the solver.
+     */
+    virtual void getStatistics(QPSolverStatistics& statistics) = 0;
+};
+
+#endif
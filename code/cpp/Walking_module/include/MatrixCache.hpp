@@ -0,0 +1,140 @@
+/**
+ * @file MatrixCache.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef MATRIX_CACHE_HPP
+#define MATRIX_CACHE_HPP
+
+// std
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Eigen
+#include <Eigen/Dense>
+
+// iDynTree
+#include <iDynTree/Core/SparseMatrix.h>
+#include <iDynTree/Core/Triplets.h>
+
+#include "Utils.hpp"
+
+/**
+ * MatrixCache stores a set of named matrices (dense or sparse) in a binary file, so the
+ * matrices that are expensive to evaluate can be loaded at the next startup.
+ * The file contains a header (magic, version, number of entries and key), a table of entries
+ * and the data of each entry aligned to 8 bytes: the dense matrices are stored in column-major
+ * order, the sparse ones as values, row indices and column indices. The offsets are relative
+ * to the beginning of the file so the data can be used directly if the file is memory mapped.
+ * The key identifies the configuration used to evaluate the matrices, a file with a different
+ * key is rejected.
+ */
+class MatrixCache
+{
+    /**
+     * Matrix stored in the cache.
+     */
+    struct Entry
+    {
+        bool isSparse{false}; /**< True if the matrix is stored as triplets. */
+        std::uint64_t rows{0}; /**< Number of rows. */
+        std::uint64_t cols{0}; /**< Number of columns. */
+        std::vector<double> values; /**< Values (column-major for the dense matrices). */
+        std::vector<std::int32_t> rowIndices; /**< Row of each value (sparse matrices only). */
+        std::vector<std::int32_t> columnIndices; /**< Column of each value (sparse matrices only). */
+    };
+
+    std::map<std::string, Entry> m_entries; /**< Matrices indexed by name. */
+
+public:
+
+    /**
+     * Maximum length of the name of a matrix.
+     */
+    static constexpr std::size_t MaxNameLength = 39;
+
+    /**
+     * Evaluate the key of a configuration (64 bit FNV-1a hash, it does not depend on the
+     * platform).
+     * @param text text describing the configuration (e.g. the content of a group).
+     * @return the key.
+     */
+    static std::uint64_t computeKey(const std::string& text);
+
+    /**
+     * Remove all the matrices.
+     */
+    void clear();
+
+    /**
+     * Add a dense matrix.
+     * @param name name of the matrix;
+     * @param matrix matrix.
+     */
+    void addMatrix(const std::string& name, const Eigen::MatrixXd& matrix);
+
+    /**
+     * Add a sparse matrix described by triplets.
+     * @param name name of the matrix;
+     * @param triplets triplets;
+     * @param rows number of rows;
+     * @param cols number of columns.
+     */
+    void addTriplets(const std::string& name, const iDynTree::Triplets& triplets,
+                     std::size_t rows, std::size_t cols);
+
+    /**
+     * Add a sparse matrix.
+     * @param name name of the matrix;
+     * @param matrix matrix.
+     */
+    void addSparseMatrix(const std::string& name, const iDynSparseMatrix& matrix);
+
+    /**
+     * Get a dense matrix.
+     * @param name name of the matrix;
+     * @param matrix matrix.
+     * @return true if the matrix is in the cache.
+     */
+    bool getMatrix(const std::string& name, Eigen::MatrixXd& matrix) const;
+
+    /**
+     * Get the triplets of a sparse matrix.
+     * @param name name of the matrix;
+     * @param triplets triplets.
+     * @return true if the matrix is in the cache.
+     */
+    bool getTriplets(const std::string& name, iDynTree::Triplets& triplets) const;
+
+    /**
+     * Get a sparse matrix.
+     * @param name name of the matrix;
+     * @param matrix matrix.
+     * @return true if the matrix is in the cache.
+     */
+    bool getSparseMatrix(const std::string& name, iDynSparseMatrix& matrix) const;
+
+    /**
+     * Write the matrices in a file. The file is written in a temporary file and then renamed,
+     * so a partially written file is never read.
+     * @param fileName name of the file;
+     * @param key key of the configuration.
+     * @return true/false in case of success/failure.
+     */
+    bool write(const std::string& fileName, std::uint64_t key) const;
+
+    /**
+     * Read the matrices from a file.
+     * @param fileName name of the file;
+     * @param key key of the configuration.
+     * @return false if the file does not exist, it is corrupted or its key is different.
+     */
+    bool read(const std::string& fileName, std::uint64_t key);
+};
+
+#endif
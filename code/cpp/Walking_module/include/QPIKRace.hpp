@@ -0,0 +1,118 @@
+/**
+ * @file QPIKRace.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef QPIK_RACE_HPP
+#define QPIK_RACE_HPP
+
+// std
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * QPIKRace solves the same QP-IK problem with two solvers at the same time, each one in a
+ * dedicated worker thread. The race ends when a solver finds a solution or when the budget is
+ * exceeded. The solvers cannot be interrupted: a solver that is still running at the end of the
+ * race is ignored and it does not take part in the next races until it is idle again. The
+ * control thread can access the data of a solver only when it is idle (see isIdle()).
+ */
+class QPIKRace
+{
+public:
+    static constexpr std::size_t NumberOfSolvers = 2; /**< Number of solvers in the race. */
+
+private:
+    /**
+     * State of a worker thread.
+     */
+    struct Worker
+    {
+        std::thread thread; /**< Worker thread. */
+        std::function<bool()> solve; /**< Solve the problem (true if a solution is found). */
+        bool isBusy{false}; /**< True while the solver is running. */
+        bool hasTask{false}; /**< True if the worker has to start the solver. */
+        std::size_t round{0}; /**< Race in which the solver has been started. */
+        unsigned long int wins{0}; /**< Number of races won. */
+    };
+
+    std::array<Worker, NumberOfSolvers> m_workers; /**< Workers. */
+    double m_budget{0}; /**< Maximum duration of a race [s] (if not positive there is no limit). */
+
+    std::size_t m_round{0}; /**< Current race. */
+    int m_winner{-1}; /**< Winner of the current race (-1 if there is no winner). */
+    std::size_t m_finishedSolvers{0}; /**< Solvers that have finished the current race. */
+    unsigned long int m_racesWithoutWinner{0}; /**< Number of races without winner. */
+
+    std::condition_variable m_workerConditionVariable; /**< Used to wake up the workers. */
+    std::condition_variable m_raceConditionVariable; /**< Used to wake up the control thread. */
+    std::mutex m_mutex; /**< Mutex. */
+    bool m_isClosing{false}; /**< True if the threads have to be closed. */
+
+    /**
+     * Main method of a worker thread.
+     * @param index index of the solver.
+     */
+    void workerThread(std::size_t index);
+
+public:
+
+    /**
+     * Deconstructor.
+     */
+    ~QPIKRace();
+
+    /**
+     * Initialize the object and start the worker threads.
+     * @param solvers functions that solve the problem with each solver (they return true if a
+     * solution is found);
+     * @param budget maximum duration of a race [s] (if not positive there is no limit);
+     * @param cores cores of the workers, one for each solver (if empty the threads are not pinned).
+     * @return true/false in case of success/failure.
+     */
+    bool initialize(const std::array<std::function<bool()>, NumberOfSolvers>& solvers,
+                    double budget, const std::vector<int>& cores);
+
+    /**
+     * Stop the worker threads. The method waits the end of the running solvers.
+     */
+    void stop();
+
+    /**
+     * Check if a solver is idle. A solver that is idle remains idle until the next race.
+     * @param solver index of the solver.
+     * @return true if the solver is not running.
+     */
+    bool isIdle(std::size_t solver);
+
+    /**
+     * Run a race. The method returns as soon as a solver finds a solution, when all the
+     * solvers fail or when the budget is exceeded.
+     * @param isProblemSet true for the solvers whose problem is updated (they have to be idle).
+     * @return the index of the winner (-1 if no solver found a solution).
+     */
+    int race(const std::array<bool, NumberOfSolvers>& isProblemSet);
+
+    /**
+     * Get the number of races won by a solver.
+     * @param solver index of the solver.
+     * @return the number of races.
+     */
+    unsigned long int getNumberOfWins(std::size_t solver);
+
+    /**
+     * Get the number of races without winner.
+     * @return the number of races.
+     */
+    unsigned long int getNumberOfRacesWithoutWinner();
+};
+
+#endif
@@ -0,0 +1,160 @@
+/**
+ * @file QPInverseKinematicsProblem.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef QP_INVERSE_KINEMATICS_PROBLEM_HPP
+#define QP_INVERSE_KINEMATICS_PROBLEM_HPP
+
+// std
+#include <memory>
+
+// eigen
+#include <Eigen/Dense>
+
+// iDynTree
+#include <iDynTree/Core/MatrixDynSize.h>
+#include <iDynTree/Core/VectorDynSize.h>
+#include <iDynTree/Core/VectorFixSize.h>
+#include <iDynTree/Core/SparseMatrix.h>
+
+/**
+ * QPIKProblemInterface evaluates the hessian matrix and the gradient vector of the QP-IK problem.
+ * It is shared by the osqp and the qpOASES solvers.
+ */
+class QPIKProblemInterface
+{
+public:
+
+    /**
+     * Destructor.
+     */
+    virtual ~QPIKProblemInterface() = default;
+
+    /**
+     * Initialize the problem.
+     * @param actuatedDOFs number of the actuated DoFs;
+     * @param useCoMAsConstraint true if the CoM is considered as a constraint (it is not a task);
+     * @param neckWeightTriplets weight matrix of the neck orientation task;
+     * @param comWeightTriplets weight matrix of the CoM task (used only if the CoM is not a constraint);
+     * @param jointRegularizationWeights weights of the joint regularization task;
+     * @param jointRegularizationGains gains of the joint regularization task.
+     * @return true/false in case of success/failure.
+     */
+    virtual bool initialize(int actuatedDOFs, bool useCoMAsConstraint,
+                            const iDynTree::Triplets& neckWeightTriplets,
+                            const iDynTree::Triplets& comWeightTriplets,
+                            const iDynTree::VectorDynSize& jointRegularizationWeights,
+                            const iDynTree::VectorDynSize& jointRegularizationGains) = 0;
+
+    /**
+     * Set the jacobian of the neck. Only the angular part is used.
+     * @param neckJacobian jacobian of the neck (6 x (actuatedDOFs + 6), mixed representation).
+     */
+    virtual void setNeckJacobian(const iDynTree::MatrixDynSize& neckJacobian) = 0;
+
+    /**
+     * Set the jacobian of the CoM.
+     * @param comJacobian jacobian of the CoM (3 x (actuatedDOFs + 6), mixed representation).
+     */
+    virtual void setCoMJacobian(const iDynTree::MatrixDynSize& comJacobian) = 0;
+
+    /**
+     * Evaluate the hessian matrix.
+     */
+    virtual void evaluateHessian() = 0;
+
+    /**
+     * Evaluate the gradient vector.
+     * @param comVelocity desired CoM velocity (used only if the CoM is not a constraint);
+     * @param neckCorrection desired angular velocity of the neck;
+     * @param regularizationTerm desired joint position;
+     * @param jointPosition actual joint position.
+     */
+    virtual void evaluateGradient(const iDynTree::Vector3& comVelocity,
+                                  const Eigen::Vector3d& neckCorrection,
+                                  const iDynTree::VectorDynSize& regularizationTerm,
+                                  const iDynTree::VectorDynSize& jointPosition) = 0;
+
+    /**
+     * Get the hessian matrix (it is symmetric).
+     * @return the hessian matrix.
+     */
+    virtual Eigen::Ref<const Eigen::MatrixXd> getHessian() const = 0;
+
+    /**
+     * Get the gradient vector.
+     * @return the gradient vector.
+     */
+    virtual Eigen::Ref<const Eigen::VectorXd> getGradient() const = 0;
+};
+
+/**
+ * QPIKProblem implements the QP-IK problem for a number of actuated DoFs known at compile time,
+ * so all the products between the jacobians are evaluated with fixed size matrices and without
+ * any dynamic memory allocation. If DoFs is equal to Eigen::Dynamic the size is set at runtime.
+ */
+template <int DoFs>
+class QPIKProblem : public QPIKProblemInterface
+{
+    static constexpr int Variables = DoFs == Eigen::Dynamic ? Eigen::Dynamic : DoFs + 6;
+
+    int m_actuatedDOFs; /**< Number of the actuated DoFs. */
+    bool m_useCoMAsConstraint; /**< True if the CoM is added as a constraint. */
+
+    Eigen::Matrix3d m_neckWeightMatrix; /**< Neck weight matrix. */
+    Eigen::Matrix3d m_comWeightMatrix; /**< CoM weight matrix. */
+    Eigen::Matrix<double, DoFs, 1> m_jointRegularizationWeights; /**< Weights of the joint regularization. */
+    Eigen::Matrix<double, DoFs, 1> m_jointRegularizationGradientGains; /**< Element-wise product between
+                                                                           the weights and the gains
+                                                                           of the joint regularization. */
+
+    Eigen::Matrix<double, 3, Variables> m_neckJacobian; /**< Angular part of the neck jacobian. */
+    Eigen::Matrix<double, 3, Variables> m_comJacobian; /**< CoM jacobian. */
+    Eigen::Matrix<double, 3, Variables> m_weightedTaskJacobian; /**< Buffer used to store the product
+                                                                   between a task weight matrix and
+                                                                   the task jacobian. */
+
+    Eigen::Matrix<double, Variables, Variables> m_hessian; /**< Hessian matrix. */
+    Eigen::Matrix<double, Variables, 1> m_gradient; /**< Gradient vector. */
+
+public:
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    bool initialize(int actuatedDOFs, bool useCoMAsConstraint,
+                    const iDynTree::Triplets& neckWeightTriplets,
+                    const iDynTree::Triplets& comWeightTriplets,
+                    const iDynTree::VectorDynSize& jointRegularizationWeights,
+                    const iDynTree::VectorDynSize& jointRegularizationGains) override;
+
+    void setNeckJacobian(const iDynTree::MatrixDynSize& neckJacobian) override;
+
+    void setCoMJacobian(const iDynTree::MatrixDynSize& comJacobian) override;
+
+    void evaluateHessian() override;
+
+    void evaluateGradient(const iDynTree::Vector3& comVelocity,
+                          const Eigen::Vector3d& neckCorrection,
+                          const iDynTree::VectorDynSize& regularizationTerm,
+                          const iDynTree::VectorDynSize& jointPosition) override;
+
+    Eigen::Ref<const Eigen::MatrixXd> getHessian() const override;
+
+    Eigen::Ref<const Eigen::VectorXd> getGradient() const override;
+};
+
+/**
+ * Instantiate the QP-IK problem. A fixed size problem is used if the number of actuated DoFs is
+ * equal to the one of the joints lists stored in app/robots; otherwise the size is set at runtime.
+ * @param actuatedDOFs number of the actuated DoFs.
+ * @return pointer to the problem.
+ */
+std::unique_ptr<QPIKProblemInterface> makeQPIKProblem(int actuatedDOFs);
+
+#include "QPInverseKinematicsProblem.tpp"
+
+#endif
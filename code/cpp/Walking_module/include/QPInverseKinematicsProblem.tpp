@@ -0,0 +1,120 @@
+/**
+ * @file QPInverseKinematicsProblem.tpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// YARP
+#include <yarp/os/LogStream.h>
+
+// iDynTree
+#include <iDynTree/Core/EigenHelpers.h>
+
+template <int DoFs>
+bool QPIKProblem<DoFs>::initialize(int actuatedDOFs, bool useCoMAsConstraint,
+                                   const iDynTree::Triplets& neckWeightTriplets,
+                                   const iDynTree::Triplets& comWeightTriplets,
+                                   const iDynTree::VectorDynSize& jointRegularizationWeights,
+                                   const iDynTree::VectorDynSize& jointRegularizationGains)
+{
+    if(DoFs != Eigen::Dynamic && actuatedDOFs != DoFs)
+    {
+        yError() << "[QPIKProblem::initialize] The problem is defined for" << DoFs << "DoFs.";
+        return false;
+    }
+
+    if(jointRegularizationWeights.size() != actuatedDOFs
+       || jointRegularizationGains.size() != actuatedDOFs)
+    {
+        yError() << "[QPIKProblem::initialize] The size of the joint regularization weights and "
+                 << "gains has to be equal to the number of actuated DoFs.";
+        return false;
+    }
+
+    m_actuatedDOFs = actuatedDOFs;
+    m_useCoMAsConstraint = useCoMAsConstraint;
+
+    m_neckWeightMatrix.setZero();
+    for(const auto& triplet : neckWeightTriplets)
+        m_neckWeightMatrix(triplet.row, triplet.column) = triplet.value;
+
+    m_comWeightMatrix.setZero();
+    for(const auto& triplet : comWeightTriplets)
+        m_comWeightMatrix(triplet.row, triplet.column) = triplet.value;
+
+    // the memory is allocated here only if the size is not known at compile time
+    int numberOfVariables = m_actuatedDOFs + 6;
+    m_jointRegularizationWeights = iDynTree::toEigen(jointRegularizationWeights);
+    m_jointRegularizationGradientGains = iDynTree::toEigen(jointRegularizationWeights).cwiseProduct(
+        iDynTree::toEigen(jointRegularizationGains));
+    m_neckJacobian.setZero(3, numberOfVariables);
+    m_comJacobian.setZero(3, numberOfVariables);
+    m_weightedTaskJacobian.setZero(3, numberOfVariables);
+    m_hessian.setZero(numberOfVariables, numberOfVariables);
+    m_gradient.setZero(numberOfVariables);
+
+    return true;
+}
+
+template <int DoFs>
+void QPIKProblem<DoFs>::setNeckJacobian(const iDynTree::MatrixDynSize& neckJacobian)
+{
+    m_neckJacobian = iDynTree::toEigen(neckJacobian).template block<3, Variables>(3, 0, 3,
+                                                                               m_actuatedDOFs + 6);
+}
+
+template <int DoFs>
+void QPIKProblem<DoFs>::setCoMJacobian(const iDynTree::MatrixDynSize& comJacobian)
+{
+    m_comJacobian = iDynTree::toEigen(comJacobian);
+}
+
+template <int DoFs>
+void QPIKProblem<DoFs>::evaluateHessian()
+{
+    // neck orientation task
+    m_weightedTaskJacobian.noalias() = m_neckWeightMatrix * m_neckJacobian;
+    m_hessian.noalias() = m_neckJacobian.transpose() * m_weightedTaskJacobian;
+
+    // joint regularization task (the first six variables are related to the base)
+    m_hessian.diagonal().tail(m_actuatedDOFs) += m_jointRegularizationWeights;
+
+    // CoM task
+    if(!m_useCoMAsConstraint)
+    {
+        m_weightedTaskJacobian.noalias() = m_comWeightMatrix * m_comJacobian;
+        m_hessian.noalias() += m_comJacobian.transpose() * m_weightedTaskJacobian;
+    }
+}
+
+template <int DoFs>
+void QPIKProblem<DoFs>::evaluateGradient(const iDynTree::Vector3& comVelocity,
+                                         const Eigen::Vector3d& neckCorrection,
+                                         const iDynTree::VectorDynSize& regularizationTerm,
+                                         const iDynTree::VectorDynSize& jointPosition)
+{
+    // neck orientation task
+    m_gradient.noalias() = -m_neckJacobian.transpose() * (m_neckWeightMatrix * neckCorrection);
+
+    // CoM task
+    if(!m_useCoMAsConstraint)
+        m_gradient.noalias() -= m_comJacobian.transpose() * (m_comWeightMatrix * iDynTree::toEigen(comVelocity));
+
+    // joint regularization task
+    m_gradient.tail(m_actuatedDOFs) -= m_jointRegularizationGradientGains.cwiseProduct(
+        iDynTree::toEigen(regularizationTerm) - iDynTree::toEigen(jointPosition));
+}
+
+template <int DoFs>
+Eigen::Ref<const Eigen::MatrixXd> QPIKProblem<DoFs>::getHessian() const
+{
+    return m_hessian;
+}
+
+template <int DoFs>
+Eigen::Ref<const Eigen::VectorXd> QPIKProblem<DoFs>::getGradient() const
+{
+    return m_gradient;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file RealTimeThread.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef REAL_TIME_THREAD_HPP
+#define REAL_TIME_THREAD_HPP
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// YARP
+#include <yarp/os/Searchable.h>
+
+/**
+ * Helper for the threads used by the real-time mode.
+ */
+namespace RealTimeHelper
+{
+    /**
+     * Restrict a thread to a set of cores.
+     * @param thread thread that has to be pinned;
+     * @param cores list of the cores (if empty the affinity is not changed).
+     * @return true/false in case of success/failure.
+     */
+    bool setThreadAffinity(std::thread& thread, const std::vector<int>& cores);
+
+    /**
+     * Restrict the calling thread to a set of cores.
+     * @param cores list of the cores (if empty the affinity is not changed).
+     * @return true/false in case of success/failure.
+     */
+    bool setCurrentThreadAffinity(const std::vector<int>& cores);
+
+    /**
+     * Get a list of cores from a searchable object.
+     * @param config yarp searchable configuration variable;
+     * @param key name of the list;
+     * @param cores list of the cores (empty if the key is not found).
+     * @return true/false in case of success/failure.
+     */
+    bool getCoresFromSearchable(const yarp::os::Searchable& config, const std::string& key,
+                                std::vector<int>& cores);
+}
+
+/**
+ * RealTimeThread calls a function periodically in a dedicated thread with the SCHED_FIFO policy.
+ * The memory of the process is locked and the stack of the thread is prefaulted before the
+ * first call, so the page faults do not happen in the loop.
+ */
+class RealTimeThread
+{
+    std::function<bool()> m_step; /**< Function called every period (the thread stops if it returns false). */
+    double m_period; /**< Period of the thread [s]. */
+    int m_priority; /**< SCHED_FIFO priority (if not positive the default policy is kept). */
+    int m_core; /**< Core of the thread (if negative the thread is not pinned). */
+    bool m_lockMemory; /**< If true all the memory of the process is locked. */
+    std::size_t m_stackPrefaultSize; /**< Number of bytes of the stack touched before the loop. */
+
+    double m_lastPeriod{0}; /**< Measured duration of the last period [s] (used only by the thread). */
+
+    std::thread m_thread; /**< Periodic thread. */
+    std::condition_variable m_conditionVariable; /**< Used to wake up the threads. */
+    std::mutex m_mutex; /**< Mutex. */
+    bool m_isClosing{false}; /**< True if the thread has to be closed. */
+    bool m_isConfigured{false}; /**< True when the thread has applied the real-time settings. */
+    bool m_isConfigurationSuccessful{false}; /**< True if all the real-time settings are applied. */
+    std::atomic<bool> m_isRunning{false}; /**< True while the loop is running. */
+
+    /**
+     * Apply the scheduling policy, the affinity and prefault the stack of the calling thread.
+     * @return true/false in case of success/failure.
+     */
+    bool configureCurrentThread();
+
+    /**
+     * Main thread method.
+     */
+    void periodicThread();
+
+public:
+
+    /**
+     * Deconstructor.
+     */
+    ~RealTimeThread();
+
+    /**
+     * Configure the thread.
+     * @param config yarp searchable configuration variable;
+     * @param period period of the thread [s].
+     * @return true/false in case of success/failure.
+     */
+    bool configure(const yarp::os::Searchable& config, double period);
+
+    /**
+     * Start the thread. The method returns when the real-time settings are applied.
+     * @param step function called every period. The thread stops if it returns false.
+     * @return true/false in case of success/failure.
+     */
+    bool start(const std::function<bool()>& step);
+
+    /**
+     * Stop the thread.
+     */
+    void stop();
+
+    /**
+     * Check if the loop is running.
+     * @return true if the loop is running.
+     */
+    bool isRunning() const;
+
+    /**
+     * Get the measured duration of the last period.
+     * @note Please call this method only inside the step function.
+     * @return the duration of the period [s].
+     */
+    double getLastPeriod() const;
+};
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * @file SPSCQueue.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+// std
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * SPSCQueue is a single-producer single-consumer lock-free queue with a capacity known at
+ * compile time, so it never allocates memory. The elements are copied in push() and in pop().
+ * When the queue is full the new elements are rejected.
+ */
+template <typename T, std::size_t Capacity>
+class SPSCQueue
+{
+    std::array<T, Capacity> m_elements; /**< Storage of the elements. */
+    std::atomic<std::size_t> m_head{0}; /**< Number of elements pushed by the producer. */
+    std::atomic<std::size_t> m_tail{0}; /**< Number of elements popped by the consumer. */
+
+public:
+
+    /**
+     * Add an element at the end of the queue (producer side).
+     * @param element element that has to be added.
+     * @return false if the queue is full.
+     */
+    bool push(const T& element)
+    {
+        std::size_t head = m_head.load(std::memory_order_relaxed);
+        if(head - m_tail.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        m_elements[head % Capacity] = element;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Remove the oldest element from the queue (consumer side).
+     * @param element oldest element.
+     * @return false if the queue is empty.
+     */
+    bool pop(T& element)
+    {
+        std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if(tail == m_head.load(std::memory_order_acquire))
+            return false;
+
+        element = m_elements[tail % Capacity];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif
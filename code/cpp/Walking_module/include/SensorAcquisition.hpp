@@ -0,0 +1,115 @@
+/**
+ * @file SensorAcquisition.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef SENSOR_ACQUISITION_HPP
+#define SENSOR_ACQUISITION_HPP
+
+// std
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+// YARP
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Searchable.h>
+#include <yarp/sig/Vector.h>
+#include <yarp/dev/IEncodersTimed.h>
+
+#include "TripleBuffer.hpp"
+
+/**
+ * Sample of all the sensors used by the walking controller.
+ * A negative time stamp means that the quantity has never been read.
+ */
+struct SensorSnapshot
+{
+    yarp::sig::Vector positionInDegrees; /**< Joint position [deg]. */
+    yarp::sig::Vector velocityInDegrees; /**< Joint velocity [deg/s]. */
+    yarp::sig::Vector leftWrench; /**< Left foot wrench. */
+    yarp::sig::Vector rightWrench; /**< Right foot wrench. */
+
+    double encodersTimeStamp{-1}; /**< Time stamp of the encoders (the most recent joint). */
+    double leftWrenchTimeStamp{-1}; /**< Time instant of the arrival of the left foot wrench. */
+    double rightWrenchTimeStamp{-1}; /**< Time instant of the arrival of the right foot wrench. */
+
+    std::size_t sequenceNumber{0}; /**< Number of samples published before this one. */
+};
+
+/**
+ * SensorAcquisition reads the encoders and the feet wrenches in a dedicated thread and publishes
+ * a coherent time stamped snapshot through a triple buffer. The control loop takes the last
+ * snapshot in constant time.
+ */
+class SensorAcquisition
+{
+    yarp::dev::IEncodersTimed* m_encodersInterface{nullptr}; /**< Encoders interface. */
+    yarp::os::BufferedPort<yarp::sig::Vector>* m_leftWrenchPort{nullptr}; /**< Left foot wrench port. */
+    yarp::os::BufferedPort<yarp::sig::Vector>* m_rightWrenchPort{nullptr}; /**< Right foot wrench port. */
+
+    double m_period; /**< Period of the acquisition thread [s]. */
+
+    SensorSnapshot m_sample; /**< Sample updated by the acquisition thread. */
+    yarp::sig::Vector m_encodersTimeStamps; /**< Time stamps of all the joints. */
+    yarp::sig::Vector m_positionBuffer; /**< Joint position buffer. */
+    yarp::sig::Vector m_velocityBuffer; /**< Joint velocity buffer. */
+
+    TripleBuffer<SensorSnapshot> m_snapshots; /**< Published snapshots. */
+
+    std::thread m_acquisitionThread; /**< Acquisition thread. */
+    std::condition_variable m_conditionVariable; /**< Used to wake up the thread when it is closed. */
+    std::mutex m_mutex; /**< Mutex. */
+    bool m_isClosing{false}; /**< True if the thread has to be closed. */
+
+    /**
+     * Main thread method.
+     */
+    void acquisitionThread();
+
+    /**
+     * Read all the sensors and update the sample.
+     * @return true if at least one quantity has been updated.
+     */
+    bool readSensors();
+
+public:
+
+    /**
+     * Deconstructor.
+     */
+    ~SensorAcquisition();
+
+    /**
+     * Initialize the object and start the acquisition thread.
+     * @param config yarp searchable configuration variable;
+     * @param encodersInterface encoders interface;
+     * @param actuatedDOFs number of the actuated DoFs;
+     * @param leftWrenchPort left foot wrench port;
+     * @param rightWrenchPort right foot wrench port.
+     * @return true/false in case of success/failure.
+     */
+    bool initialize(const yarp::os::Searchable& config,
+                    yarp::dev::IEncodersTimed* encodersInterface, int actuatedDOFs,
+                    yarp::os::BufferedPort<yarp::sig::Vector>* leftWrenchPort,
+                    yarp::os::BufferedPort<yarp::sig::Vector>* rightWrenchPort);
+
+    /**
+     * Stop the acquisition thread.
+     */
+    void stop();
+
+    /**
+     * Get the last snapshot published by the acquisition thread.
+     * @note Please call this method always from the same thread (or with the same mutex
+     * taken), the snapshot is valid until the next call.
+     * @return the last snapshot.
+     */
+    const SensorSnapshot& getLatestSnapshot();
+};
+
+#endif
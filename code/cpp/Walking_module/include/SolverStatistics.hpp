@@ -0,0 +1,46 @@
+/**
+ * @file SolverStatistics.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef SOLVER_STATISTICS_HPP
+#define SOLVER_STATISTICS_HPP
+
+/**
+ * Statistics of a QP solver in the last solve.
+ */
+struct QPSolverStatistics
+{
+    int iterations{0}; /**< Number of iterations (working set recalculations for qpOASES). */
+    double primalResidual{0}; /**< Primal residual (osqp only). */
+    double dualResidual{0}; /**< Dual residual (osqp only). */
+    double solveTime{0}; /**< Time spent by the solver [s]. */
+};
+
+/**
+ * Statistics of the solvers collected in a tick of the control loop. The struct has a fixed size
+ * so it can be filled at each tick without allocating memory. The quantities of the solvers not
+ * used in the tick are equal to zero.
+ */
+struct SolverStatistics
+{
+    double time{0}; /**< Time of the module [s]. */
+    double tickDuration{0}; /**< Time spent by the control loop in the tick [s]. */
+
+    bool isMPCSolved{false}; /**< True if the MPC problem is solved. */
+    bool isMPCUnconstrained{false}; /**< True if the MPC solution is the unconstrained optimum. */
+    bool isReactiveControllerUsed{false}; /**< True if the reactive DCM controller is used. */
+    QPSolverStatistics mpc; /**< Statistics of the MPC solver. */
+    double zmpMargin{0}; /**< Distance between the desired ZMP and the edges of the convex hull [m]. */
+    double zmpHorizonMargin{0}; /**< Minimum margin of the ZMP along the horizon [m] (if checked). */
+
+    QPSolverStatistics qpIK; /**< Statistics of the QP-IK solver (osqp or qpOASES). */
+
+    double ikSolveTime{0}; /**< Time spent by the IPOPT based IK [s]. */
+    int ikConsecutiveFallbacks{0}; /**< Consecutive ticks in which the IK budget is exhausted. */
+};
+
+#endif
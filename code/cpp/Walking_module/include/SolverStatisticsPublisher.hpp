@@ -0,0 +1,74 @@
+/**
+ * @file SolverStatisticsPublisher.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef SOLVER_STATISTICS_PUBLISHER_HPP
+#define SOLVER_STATISTICS_PUBLISHER_HPP
+
+// std
+#include <string>
+
+// YARP
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Searchable.h>
+#include <yarp/sig/Vector.h>
+
+#include "SolverStatistics.hpp"
+
+/**
+ * SolverStatisticsPublisher streams the statistics of the solvers on a YARP port, one tick out
+ * of solver_statistics_decimation. The port is a BufferedPort so the message is sent in
+ * background and the control loop is never blocked.
+ * Each message is a vector containing:
+ * time, tick duration, MPC solved, MPC unconstrained, reactive controller used,
+ * MPC iterations, MPC primal residual, MPC dual residual, MPC solve time, ZMP margin,
+ * ZMP horizon margin, QP-IK iterations, QP-IK primal residual, QP-IK dual residual,
+ * QP-IK solve time, IK solve time, IK consecutive fallbacks.
+ * The times are expressed in seconds and the margins in meters.
+ */
+class SolverStatisticsPublisher
+{
+    yarp::os::BufferedPort<yarp::sig::Vector> m_port; /**< Output port. */
+    int m_decimation{1}; /**< A message is sent every m_decimation ticks. */
+    int m_counter{0}; /**< Number of ticks since the last message. */
+    bool m_isOpen{false}; /**< True if the port is open. */
+
+public:
+
+    /**
+     * Size of the published vector.
+     */
+    static constexpr std::size_t MessageSize = 17;
+
+    /**
+     * Destructor.
+     */
+    ~SolverStatisticsPublisher();
+
+    /**
+     * Configure the publisher and open the port.
+     * If solver_statistics_remote is set the port is connected to it using the carrier
+     * solver_statistics_carrier (shmem by default, both the ports have to be on the same machine).
+     * @param config yarp searchable configuration variable;
+     * @param portPrefix prefix of the port name (e.g. /walking-coordinator).
+     * @return true/false in case of success/failure.
+     */
+    bool configure(const yarp::os::Searchable& config, const std::string& portPrefix);
+
+    /**
+     * Publish the statistics if the decimation counter expired.
+     * @param statistics statistics of the current tick.
+     */
+    void publish(const SolverStatistics& statistics);
+
+    /**
+     * Close the port.
+     */
+    void close();
+};
+
+#endif
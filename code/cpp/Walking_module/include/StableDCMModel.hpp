@@ -10,37 +10,61 @@
 #define STABLE_DCM_MODEL_HPP
 
 // std
-#include <memory>
+#include <vector>
 
 // YARP
 #include <yarp/os/Searchable.h>
-#include <yarp/sig/Vector.h>
-
-// iCub-ctrl
-#include <iCub/ctrl/pids.h>
 
 //iDynTree
 #include <iDynTree/Core/VectorFixSize.h>
 
+#include "TrajectoryView.hpp"
+
+/**
+ * Discretization of the CoM dynamics.
+ * - Trapezoidal: the CoM velocity is integrated with the trapezoidal rule (as iCub::ctrl::Integrator);
+ * - Exact: the DCM is constant during the sampling time, the exact solution of the dynamics is used.
+ */
+enum class LIPMDiscretization {Trapezoidal, Exact};
+
 /**
  * StableDCMModel linear inverted pendulum model.
+ * The CoM follows the stable dynamics \f$ \dot{x} = -\omega (x - \xi) \f$ where \f$ \xi \f$ is the DCM.
  */
 class StableDCMModel
 {
     double m_omega; /**< Inverted time constant of the 3D-LIPM. */
 
-    std::unique_ptr<iCub::ctrl::Integrator> m_comIntegrator{nullptr}; /**< CoM integrator object. */
+    double m_samplingTime; /**< Sampling time of the integrator. */
+    bool m_isInitialized{false}; /**< True if the model is initialized. */
+
+    LIPMDiscretization m_discretization{LIPMDiscretization::Trapezoidal}; /**< Discretization of the dynamics. */
+    double m_stateCoefficient; /**< \f$ e^{-\omega dT} \f$ (exact discretization). */
 
     iDynTree::Vector2 m_dcmPosition; /**< Position of the DCM. */
     iDynTree::Vector2 m_comPosition; /**< Position of the CoM. */
     iDynTree::Vector2 m_comVelocity; /**< Velocity of the CoM. */
+    iDynTree::Vector2 m_previousCoMVelocity; /**< Velocity of the CoM used in the previous
+                                                integration step (trapezoidal rule). */
 
     bool m_isModelPropagated{false}; /**< True if the model is propagated. */
 
+    /**
+     * Advance the state of one sample.
+     * @param dcmPosition DCM position (constant during the sample);
+     * @param comPosition position of the CoM (it is updated);
+     * @param comVelocity velocity of the CoM (it is updated);
+     * @param previousCoMVelocity velocity of the previous step (used by the trapezoidal rule,
+     * it is updated).
+     */
+    void propagate(const iDynTree::Vector2& dcmPosition, iDynTree::Vector2& comPosition,
+                   iDynTree::Vector2& comVelocity, iDynTree::Vector2& previousCoMVelocity) const;
+
 public:
 
     /**
      * Initialize the 3D-LIPM.
+     * The discretization is chosen with lipm_discretization ("trapezoidal" or "exact").
      * @param config config of the 3D-LIPM;
      * @return true on success, false otherwise.
      */
@@ -71,6 +95,18 @@ public:
      */
     bool getCoMVelocity(iDynTree::Vector2& comVelocity);
 
+    /**
+     * Predict the CoM position over a window of DCM references starting from the current state.
+     * The state of the model is not changed.
+     * @param dcmReference DCM position of each sample (if it is shorter than the window the last
+     * sample is used);
+     * @param comPosition predicted CoM position after each sample. Its size is the length of the
+     * window (please allocate it once, it is not resized).
+     * @return true on success, false otherwise.
+     */
+    bool predictCoMPosition(const TrajectoryView<iDynTree::Vector2>& dcmReference,
+                            std::vector<iDynTree::Vector2>& comPosition) const;
+
     /**
      * Reset the Model
      * @param initialValue initial position of the CoM
@@ -0,0 +1,64 @@
+/**
+ * @file StreamedGoal.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef STREAMED_GOAL_HPP
+#define STREAMED_GOAL_HPP
+
+// iDynTree
+#include <iDynTree/Core/VectorFixSize.h>
+
+/**
+ * StreamedGoal stores the latest goal received on the goal port until it is applied. A goal can
+ * be deferred by the controller (e.g. while the planner is evaluating a trajectory), in that case
+ * it is retried at each call of apply(). A newer sample replaces the pending one.
+ */
+class StreamedGoal
+{
+    iDynTree::Vector2 m_goal; /**< Latest goal received. */
+    bool m_isPending{false}; /**< True if the goal is not applied yet. */
+
+public:
+
+    /**
+     * Store a new goal (the pending one is discarded).
+     * @param x desired x position of the CoM;
+     * @param y desired y position of the CoM.
+     */
+    void set(double x, double y);
+
+    /**
+     * Discard the pending goal.
+     */
+    void clear();
+
+    /**
+     * Check if a goal is waiting to be applied.
+     * @return true if the goal is pending false otherwise.
+     */
+    bool isPending() const;
+
+    /**
+     * Get the latest goal received (also if it is already applied or discarded).
+     * @return the goal.
+     */
+    const iDynTree::Vector2& get() const;
+
+    /**
+     * Try to apply the pending goal. The goal is kept if it is deferred.
+     * @param applyGoal function bool(double x, double y, bool& isApplied) that applies the goal.
+     * It returns false if the goal is rejected and sets isApplied to false if the goal is
+     * deferred.
+     * @return false if the goal is rejected (and discarded), true otherwise.
+     */
+    template <typename ApplyFunction>
+    bool apply(ApplyFunction applyGoal);
+};
+
+#include "StreamedGoal.tpp"
+
+#endif
@@ -0,0 +1,26 @@
+/**
+ * @file StreamedGoal.tpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+template <typename ApplyFunction>
+bool StreamedGoal::apply(ApplyFunction applyGoal)
+{
+    if(!m_isPending)
+        return true;
+
+    bool isApplied = false;
+    if(!applyGoal(m_goal(0), m_goal(1), isApplied))
+    {
+        m_isPending = false;
+        return false;
+    }
+
+    if(isApplied)
+        m_isPending = false;
+
+    return true;
+}
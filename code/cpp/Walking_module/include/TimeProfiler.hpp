@@ -10,24 +10,69 @@
 #define TIME_PROFILER_HPP
 
 // std
+#include <chrono>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "TripleBuffer.hpp"
 
 /**
- * Simple timer.
+ * Statistics of a timer evaluated over the last samples (sliding window). All the durations
+ * are expressed in milliseconds.
+ */
+struct TimerStatistics
+{
+    double average{0}; /**< Average duration. */
+    double min{0}; /**< Minimum duration. */
+    double max{0}; /**< Maximum duration. */
+    double p50{0}; /**< Median of the duration. */
+    double p99{0}; /**< 99th percentile of the duration. */
+    unsigned int deadlineMisses{0}; /**< Number of samples (in the window) longer than the deadline. */
+    unsigned long int totalDeadlineMisses{0}; /**< Number of samples longer than the deadline since the
+                                                 timer was created. */
+};
+
+/**
+ * Simple timer. It uses a monotonic clock so the time spent while the thread is blocked is
+ * taken into account.
  */
 class Timer
 {
-    clock_t m_initTime; /**< Init time. */
-    clock_t m_endTime; /**< End time. */
-    double m_averageDuration; /**< Average duration. */
+    std::chrono::steady_clock::time_point m_initTime; /**< Init time. */
+    std::chrono::steady_clock::time_point m_endTime; /**< End time. */
+
+    std::vector<double> m_samples; /**< Last durations, circular buffer (allocated only once). */
+    std::vector<double> m_sortedSamples; /**< Buffer used to evaluate the percentiles. */
+    std::size_t m_numberOfSamples{0}; /**< Number of samples stored in the window. */
+    std::size_t m_nextSample{0}; /**< Position of the next sample in the circular buffer. */
+
+    double m_deadline{0}; /**< Deadline (in ms). If it is not positive the misses are not counted. */
+    unsigned long int m_totalDeadlineMisses{0}; /**< Number of deadline misses. */
+
+    TimerStatistics m_statistics; /**< Statistics of the window evaluated by the last evaluateStatistics(). */
+
+    double m_value{0}; /**< Sample set by setValue(). */
+    bool m_isValueSet{false}; /**< True if the next sample is set by setValue(). */
+    std::string m_unit{"ms"}; /**< Unit of the samples. */
 
 public:
 
     /**
-     * Reset the average duration.
+     * Set the number of samples of the window. When the window is full the oldest sample is
+     * replaced by the new one.
+     * @note The memory is allocated here, please call it before starting the profiling.
+     * @param windowSize number of samples.
      */
-    void resetAverageDuration();
+    void setWindowSize(std::size_t windowSize);
+
+    /**
+     * Set the deadline.
+     * @param deadline deadline (in ms).
+     */
+    void setDeadline(double deadline);
 
     /**
      * Set initial time.
@@ -40,16 +85,39 @@ public:
     void setEndTime();
 
     /**
-     * Evalyate the average duration.
+     * Set the next sample directly (e.g. the time or the number of iterations reported by a
+     * solver). It is used by evaluateDuration() instead of the measured duration.
+     * @param value value of the sample.
+     */
+    void setValue(double value);
+
+    /**
+     * Set the unit of the samples (it is used only in the description of the statistics).
+     * @param unit unit of the samples.
+     */
+    void setUnit(const std::string& unit);
+
+    /**
+     * Get the unit of the samples.
+     * @return the unit of the samples.
+     */
+    const std::string& getUnit() const;
+
+    /**
+     * Evaluate the duration and store it inside the current window.
      */
     void evaluateDuration();
 
     /**
-     * Get the average duration.
-     * @return average duration.
+     * Evaluate the statistics of the samples stored in the window.
      */
-    const double& getAverageDuration() const;
+    void evaluateStatistics();
 
+    /**
+     * Get the statistics evaluated by the last evaluateStatistics().
+     * @return the statistics.
+     */
+    const TimerStatistics& getStatistics() const;
 };
 
 /**
@@ -57,18 +125,55 @@ public:
  */
 class TimeProfiler
 {
-    int m_counter; /**< Counter useful to print the profiling quantities only every m_maxCounter times. */
-    int m_maxCounter; /**< The profiling quantities will be printed every maxCounter cycles. */
+    int m_counter{0}; /**< Counter useful to evaluate the statistics only every m_maxCounter times. */
+    int m_maxCounter{1}; /**< The statistics will be evaluated every maxCounter cycles. */
+    int m_windowSize{0}; /**< Number of samples used by the statistics (if it is not positive
+                            the samples of the last period are used). */
+    double m_deadline{0}; /**< Deadline of the timers (in ms). */
+    bool m_verbose{false}; /**< If true the statistics are printed every m_maxCounter cycles. */
     std::map<std::string, std::unique_ptr<Timer>> m_timers; /**< Dictionary that contains all the timers. */
 
+    TripleBuffer<std::vector<TimerStatistics>> m_publishedStatistics; /**< Statistics of the last window of
+                                                                         all the timers (same order of m_timers). */
+    std::mutex m_readerMutex; /**< Serializes the readers of the published statistics (the profiling thread
+                                 never takes it). */
+
+    /**
+     * Get a human readable description of a list of statistics.
+     * @param statistics statistics of the timers (same order of m_timers).
+     * @return the description.
+     */
+    std::string describe(const std::vector<TimerStatistics>& statistics) const;
+
 public:
 
     /**
-     * Set the output period.
+     * Set the period of the evaluation (and of the printing) of the statistics.
      * @param maxCounter is the period (expressed in cycles).
      */
     void setPeriod(int maxCounter);
 
+    /**
+     * Set the number of samples used by the statistics. It is independent of the period, so
+     * the percentiles can be evaluated over a longer time than the one between two prints.
+     * If it is not set the samples of the last period are used.
+     * @param windowSize is the number of samples (expressed in cycles).
+     */
+    void setWindowSize(int windowSize);
+
+    /**
+     * Set the deadline of all the timers. The number of samples longer than the deadline
+     * is stored.
+     * @param deadline is the deadline (expressed in seconds).
+     */
+    void setDeadline(double deadline);
+
+    /**
+     * Enable the printing of the statistics.
+     * @param verbose if true the statistics are printed every period.
+     */
+    void setVerbose(bool verbose);
+
     /**
      * Add a new timer
      * @param key is the name of the timer.
@@ -76,6 +181,24 @@ public:
      */
     bool addTimer(const std::string& key);
 
+    /**
+     * Add a new counter. A counter is a timer whose samples are set by setValue() (e.g. the
+     * number of iterations of a solver). The deadline is not checked.
+     * @note Please call setDeadline() before adding the counters.
+     * @param key is the name of the counter;
+     * @param unit is the unit of the samples.
+     * @return true/false in case of success/failure.
+     */
+    bool addCounter(const std::string& key, const std::string& unit);
+
+    /**
+     * Set the sample of the timer (or counter) named "key" for the current cycle.
+     * @param key is the name of the timer;
+     * @param value is the value of the sample.
+     * @return true/false in case of success/failure.
+     */
+    bool setValue(const std::string& key, double value);
+
     /**
      * Set the init time for the timer named "key"
      * @param key is the name of the timer.
@@ -91,7 +214,31 @@ public:
     bool setEndTime(const std::string& key);
 
     /**
-     * Print the profiling quantities.
+     * Get the statistics evaluated at the end of the last period for the timer named "key"
+     * @param key is the name of the timer;
+     * @param statistics statistics of the timer.
+     * @return true/false in case of success/failure.
+     */
+    bool getStatistics(const std::string& key, TimerStatistics& statistics) const;
+
+    /**
+     * Get a human readable description of the statistics of all the timers.
+     * @return the description.
+     */
+    std::string getStatisticsDescription() const;
+
+    /**
+     * Get a human readable description of the statistics published at the end of the last
+     * period. Differently from getStatisticsDescription() it can be called by any thread while
+     * the profiling is running.
+     * @note Please do not add timers while the profiling is running.
+     * @return the description.
+     */
+    std::string getPublishedStatisticsDescription();
+
+    /**
+     * Store the profiling quantities. The statistics are evaluated (and optionally printed)
+     * every period.
      */
     void profiling();
 };
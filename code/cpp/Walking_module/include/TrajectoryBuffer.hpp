@@ -0,0 +1,279 @@
+/**
+ * @file TrajectoryBuffer.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef TRAJECTORY_BUFFER_HPP
+#define TRAJECTORY_BUFFER_HPP
+
+// std
+#include <deque>
+#include <memory>
+#include <vector>
+
+// iDynTree
+#include <iDynTree/Core/Transform.h>
+#include <iDynTree/Core/Twist.h>
+#include <iDynTree/Core/VectorFixSize.h>
+
+#include "TrajectoryView.hpp"
+
+/**
+ * Contiguous storage of a single trajectory. The memory is allocated by reserve() only.
+ */
+template <typename T>
+class TrajectoryArray
+{
+    std::unique_ptr<T[]> m_data; /**< Samples. */
+    std::size_t m_capacity{0}; /**< Number of allocated samples. */
+
+public:
+
+    /**
+     * Allocate the memory.
+     * @param capacity number of samples;
+     * @param preservedSamples number of samples (at the beginning) that are kept.
+     */
+    void reserve(std::size_t capacity, std::size_t preservedSamples);
+
+    /**
+     * Move some samples toward the beginning of the array.
+     * @param from index of the first moved sample;
+     * @param to destination index (it has to be lower than from);
+     * @param numberOfSamples number of moved samples.
+     */
+    void move(std::size_t from, std::size_t to, std::size_t numberOfSamples);
+
+    /**
+     * Fill [from, to) with the sample in from - 1.
+     * @param from index of the first sample;
+     * @param to index after the last sample.
+     */
+    void pad(std::size_t from, std::size_t to);
+
+    /**
+     * Copy a trajectory inside the array.
+     * @param input trajectory;
+     * @param position index of the first copied sample.
+     */
+    void copy(const std::vector<T>& input, std::size_t position);
+
+    /**
+     * Copy some samples of another array.
+     * @param input array;
+     * @param from index of the first copied sample of the input array;
+     * @param numberOfSamples number of copied samples;
+     * @param position index of the first copied sample.
+     */
+    void copy(const TrajectoryArray<T>& input, std::size_t from, std::size_t numberOfSamples,
+              std::size_t position);
+
+    /**
+     * Get a view of the array.
+     * @param first index of the first sample;
+     * @param end index after the last stored sample;
+     * @param size size of the trajectory.
+     * @return the view of the trajectory.
+     */
+    TrajectoryView<T> view(std::size_t first, std::size_t end, std::size_t size) const;
+
+    /**
+     * Get a sample of the array.
+     * @param index index of the sample.
+     * @return the sample.
+     */
+    T& operator[](std::size_t index);
+
+    /**
+     * Get a sample of the array.
+     * @param index index of the sample.
+     * @return the sample.
+     */
+    const T& operator[](std::size_t index) const;
+
+    /**
+     * Get the number of allocated samples.
+     * @return the capacity of the array.
+     */
+    std::size_t capacity() const;
+};
+
+/**
+ * Samples of all the trajectories used by the walking controller (structure of arrays).
+ */
+struct TrajectorySamples
+{
+    TrajectoryArray<iDynTree::Transform> leftTrajectory; /**< Trajectory of the left foot. */
+    TrajectoryArray<iDynTree::Transform> rightTrajectory; /**< Trajectory of the right foot. */
+    TrajectoryArray<iDynTree::Twist> leftTwistTrajectory; /**< Twist trajectory of the left foot. */
+    TrajectoryArray<iDynTree::Twist> rightTwistTrajectory; /**< Twist trajectory of the right foot. */
+    TrajectoryArray<iDynTree::Vector2> DCMPositionDesired; /**< Desired DCM position. */
+    TrajectoryArray<iDynTree::Vector2> DCMVelocityDesired; /**< Desired DCM velocity. */
+    TrajectoryArray<bool> leftInContact; /**< Left foot state. */
+    TrajectoryArray<bool> rightInContact; /**< Right foot state. */
+    TrajectoryArray<double> comHeightTrajectory; /**< CoM height trajectory. */
+    TrajectoryArray<double> comHeightVelocity; /**< CoM height velocity. */
+    TrajectoryArray<bool> isLeftFixedFrame; /**< True when the left foot is the fixed frame. */
+
+    /**
+     * Allocate the memory of all the arrays.
+     * @param capacity number of samples;
+     * @param preservedSamples number of samples (at the beginning) that are kept.
+     */
+    void reserve(std::size_t capacity, std::size_t preservedSamples);
+
+    /**
+     * Move some samples toward the beginning of the arrays.
+     * @param from index of the first moved sample;
+     * @param to destination index (it has to be lower than from);
+     * @param numberOfSamples number of moved samples.
+     */
+    void move(std::size_t from, std::size_t to, std::size_t numberOfSamples);
+
+    /**
+     * Fill [from, to) with the samples in from - 1.
+     * @param from index of the first sample;
+     * @param to index after the last sample.
+     */
+    void pad(std::size_t from, std::size_t to);
+
+    /**
+     * Copy some samples of other arrays.
+     * @param input samples;
+     * @param from index of the first copied sample of the input arrays;
+     * @param numberOfSamples number of copied samples;
+     * @param position index of the first copied sample.
+     */
+    void copy(const TrajectorySamples& input, std::size_t from, std::size_t numberOfSamples,
+              std::size_t position);
+
+    /**
+     * Get the number of allocated samples.
+     * @return the capacity of the arrays.
+     */
+    std::size_t capacity() const;
+};
+
+/**
+ * Trajectory evaluated by the planner. The samples are stored starting from the index begin so
+ * that the samples before the merge point can be added without moving the trajectory.
+ */
+struct PlannedTrajectory
+{
+    TrajectorySamples samples; /**< Samples of the trajectory. */
+    std::size_t begin{0}; /**< Index of the first sample. */
+    std::size_t size{0}; /**< Number of samples. */
+    std::vector<size_t> mergePoints; /**< Merge points (the first one is always equal to 0). */
+};
+
+/**
+ * TrajectoryBuffer stores all the desired trajectories of the walking controller in contiguous
+ * memory (structure of arrays) sharing a single head index. Advancing the time only moves the
+ * head, while merging a new trajectory swaps the memory of the buffer with the one of the planned
+ * trajectory. When the end of the stored trajectories is reached the last sample is assumed
+ * constant.
+ */
+class TrajectoryBuffer
+{
+    TrajectorySamples m_samples; /**< Samples of the trajectories. */
+
+    std::deque<std::size_t> m_mergePoints; /**< Merge points (absolute indices). */
+
+    std::size_t m_head{0}; /**< Absolute index of the current time instant (it can be greater than
+                              the index of the last stored sample). */
+    std::size_t m_end{0}; /**< Index after the last stored sample. */
+    std::size_t m_size{0}; /**< Size of the trajectories (set at each merge). */
+
+    /**
+     * Get the index of the current sample.
+     * @return the index of the current sample.
+     */
+    std::size_t current() const;
+
+    /**
+     * Copy the new trajectory inside the buffer. It is used when the planned trajectory has not
+     * enough room before its first sample.
+     * @param trajectory planned trajectory;
+     * @param mergePoint position (with respect to the current time instant) where the new
+     * trajectory is merged.
+     */
+    void copy(const PlannedTrajectory& trajectory, std::size_t mergePoint);
+
+    /**
+     * Swap the memory of the buffer with the one of the planned trajectory. Only the samples
+     * before the merge point are copied.
+     * @param trajectory planned trajectory (it will contain the old samples);
+     * @param mergePoint position (with respect to the current time instant) where the new
+     * trajectory is merged.
+     */
+    void adopt(PlannedTrajectory& trajectory, std::size_t mergePoint);
+
+public:
+
+    /**
+     * Allocate the memory.
+     * @param capacity maximum number of samples stored (it should be at least twice the size of a
+     * planned trajectory).
+     */
+    void reserve(std::size_t capacity);
+
+    /**
+     * Merge a new trajectory.
+     * @note After the call the planned trajectory contains the memory previously used by the
+     * buffer, it can be reused by the planner.
+     * @param trajectory planned trajectory;
+     * @param mergePoint position (with respect to the current time instant) where the new
+     * trajectory is merged.
+     * @return true/false in case of success/failure.
+     */
+    bool merge(PlannedTrajectory& trajectory, std::size_t mergePoint);
+
+    /**
+     * Advance the time instant. If the end of the trajectories is reached the last sample is
+     * repeated. The merge points that are reached are removed.
+     */
+    void advance();
+
+    /**
+     * Check if the buffer is empty.
+     * @return true if no trajectory is stored false otherwise.
+     */
+    bool empty() const;
+
+    /**
+     * Get the number of merge points that are not reached.
+     * @return the number of merge points.
+     */
+    std::size_t getNumberOfMergePoints() const;
+
+    /**
+     * Get a merge point
+     * @param index index of the merge point.
+     * @return the merge point expressed with respect to the current time instant.
+     */
+    std::size_t getMergePoint(std::size_t index) const;
+
+    /**
+     * Get the trajectories starting from the current time instant.
+     * @note The views are invalidated by merge()
+     * @return the view of the trajectory.
+     */
+    TrajectoryView<iDynTree::Transform> getLeftFootTrajectory() const;
+    TrajectoryView<iDynTree::Transform> getRightFootTrajectory() const;
+    TrajectoryView<iDynTree::Twist> getLeftFootTwistTrajectory() const;
+    TrajectoryView<iDynTree::Twist> getRightFootTwistTrajectory() const;
+    TrajectoryView<iDynTree::Vector2> getDCMPositionDesired() const;
+    TrajectoryView<iDynTree::Vector2> getDCMVelocityDesired() const;
+    TrajectoryView<bool> getLeftInContact() const;
+    TrajectoryView<bool> getRightInContact() const;
+    TrajectoryView<double> getCoMHeightTrajectory() const;
+    TrajectoryView<double> getCoMHeightVelocity() const;
+    TrajectoryView<bool> getIsLeftFixedFrame() const;
+};
+
+#include "TrajectoryBuffer.tpp"
+
+#endif
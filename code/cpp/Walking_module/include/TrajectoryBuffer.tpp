@@ -0,0 +1,75 @@
+/**
+ * @file TrajectoryBuffer.tpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <algorithm>
+
+template <typename T>
+void TrajectoryArray<T>::reserve(std::size_t capacity, std::size_t preservedSamples)
+{
+    if(capacity <= m_capacity)
+        return;
+
+    std::unique_ptr<T[]> data(new T[capacity]());
+    preservedSamples = std::min(preservedSamples, m_capacity);
+    std::move(m_data.get(), m_data.get() + preservedSamples, data.get());
+
+    m_data = std::move(data);
+    m_capacity = capacity;
+}
+
+template <typename T>
+void TrajectoryArray<T>::move(std::size_t from, std::size_t to, std::size_t numberOfSamples)
+{
+    std::move(m_data.get() + from, m_data.get() + from + numberOfSamples, m_data.get() + to);
+}
+
+template <typename T>
+void TrajectoryArray<T>::pad(std::size_t from, std::size_t to)
+{
+    std::fill(m_data.get() + from, m_data.get() + to, m_data[from - 1]);
+}
+
+template <typename T>
+void TrajectoryArray<T>::copy(const std::vector<T>& input, std::size_t position)
+{
+    std::copy(input.begin(), input.end(), m_data.get() + position);
+}
+
+template <typename T>
+void TrajectoryArray<T>::copy(const TrajectoryArray<T>& input, std::size_t from,
+                              std::size_t numberOfSamples, std::size_t position)
+{
+    std::copy(input.m_data.get() + from, input.m_data.get() + from + numberOfSamples,
+              m_data.get() + position);
+}
+
+template <typename T>
+TrajectoryView<T> TrajectoryArray<T>::view(std::size_t first, std::size_t end,
+                                           std::size_t size) const
+{
+    return TrajectoryView<T>(m_data.get() + first, end - first, size);
+}
+
+template <typename T>
+T& TrajectoryArray<T>::operator[](std::size_t index)
+{
+    return m_data[index];
+}
+
+template <typename T>
+const T& TrajectoryArray<T>::operator[](std::size_t index) const
+{
+    return m_data[index];
+}
+
+template <typename T>
+std::size_t TrajectoryArray<T>::capacity() const
+{
+    return m_capacity;
+}
@@ -10,8 +10,10 @@
 #define TRAJECTORY_GENERATOR_HPP
 
 // std
+#include <memory>
 #include <thread>
 #include <condition_variable>
+#include <vector>
 
 // YARP
 #include <yarp/os/Searchable.h>
@@ -21,11 +23,106 @@
 
 #include "UnicycleTrajectoryGenerator.h"
 
+#include "TrajectoryBuffer.hpp"
+
 /**
  * Enumerator useful to track the state of the trajectory generator
  */
 enum class GeneratorState {NotConfigured, Configured, FirstStep, Called, Returned, Closing};
 
+/**
+ * Boundary conditions shared by all the candidate trajectories evaluated by the speculative planners.
+ */
+struct SpeculativeRequest
+{
+    std::size_t id{0}; /**< Identifier of the request (incremented at each request). */
+    double initTime{-1.0}; /**< Init time of the candidate trajectories (time of the merge point). */
+    iDynTree::Vector2 DCMBoundaryConditionAtMergePointPosition; /**< DCM position at the merge point. */
+    iDynTree::Vector2 DCMBoundaryConditionAtMergePointVelocity; /**< DCM velocity at the merge point. */
+    bool correctLeft{true}; /**< The left foot has to be corrected. */
+    iDynTree::Transform measured; /**< Transformation between the stance foot and the world frame. */
+};
+
+/**
+ * Inputs of the planner expressed in the frame of the stance foot (only the x-y position and the
+ * yaw angle of the stance foot are considered).
+ */
+struct PlanCacheKey
+{
+    iDynTree::Vector2 desiredPoint; /**< Final desired point of the unicycle. */
+    iDynTree::Vector2 DCMPosition; /**< DCM position at the merge point. */
+    iDynTree::Vector2 DCMVelocity; /**< DCM velocity at the merge point. */
+    iDynTree::Vector2 otherFootPosition; /**< Position of the other foot at the merge point. */
+    double otherFootAngle{0}; /**< Yaw angle of the other foot at the merge point. */
+    bool correctLeft{true}; /**< True if the stance foot is the left. */
+    bool terminalStep{false}; /**< True if the terminal step is added. */
+};
+
+/**
+ * Trajectory stored in the plan cache (expressed in the frame of the stance foot).
+ */
+struct PlanCacheEntry
+{
+    PlanCacheKey key; /**< Inputs of the planner. */
+    std::unique_ptr<PlannedTrajectory> trajectory; /**< Planned trajectory. */
+    std::size_t lastUse{0}; /**< Used to replace the least recently used entry. */
+    bool isValid{false}; /**< True if the entry contains a trajectory. */
+};
+
+/**
+ * Inputs of the planner (world frame). The merged requests are used to realign the internal
+ * state of the unicycle planner.
+ */
+struct PlannerRequest
+{
+    double initTime{0}; /**< Init time of the trajectory. */
+    iDynTree::Vector2 desiredPoint; /**< Final desired point of the unicycle. */
+    iDynTree::Vector2 DCMPosition; /**< DCM position at the merge point. */
+    iDynTree::Vector2 DCMVelocity; /**< DCM velocity at the merge point. */
+    bool correctLeft{true}; /**< True if the stance foot is the left. */
+    iDynTree::Vector2 measuredPosition; /**< Position of the stance foot. */
+    double measuredAngle{0}; /**< Yaw angle of the stance foot. */
+    bool terminalStep{false}; /**< True if the terminal step is added. */
+};
+
+/**
+ * Merged requests taken into account by the internal state of a unicycle planner (the planner
+ * keeps the steps evaluated before the init time of the new trajectory).
+ */
+struct PlannerAlignment
+{
+    std::size_t mergedRequests{0}; /**< Number of merged requests evaluated by the planner. */
+    bool isStale{false}; /**< True if the planner evaluated a trajectory that is not merged yet. */
+    bool isDiverged{false}; /**< True if the planner cannot be aligned anymore (the requests that it
+                               has to evaluate again are not stored or it failed to evaluate them). */
+};
+
+/**
+ * Planner used to evaluate a candidate trajectory in a dedicated thread.
+ */
+struct SpeculativePlanner
+{
+    UnicycleTrajectoryGenerator generator; /**< UnicycleTrajectoryGenerator object. */
+    std::thread thread; /**< Thread of the planner. */
+    iDynTree::Vector2 desiredPosition; /**< Goal of the candidate trajectory (stance foot frame). */
+    bool isComputed{false}; /**< True if the trajectory is evaluated for the last request. */
+    std::unique_ptr<PlannedTrajectory> trajectory; /**< Candidate trajectory. */
+    PlannerRequest request; /**< Inputs of the candidate trajectory (world frame). */
+    PlannerAlignment alignment; /**< Merged requests evaluated by the planner. */
+    std::vector<PlannerRequest> replayedRequests; /**< Buffer of the requests replayed by the planner. */
+};
+
+/**
+ * Request of a trajectory evaluated by the TrajectoryGenerator.
+ */
+struct PlannedRequest
+{
+    PlannerRequest request; /**< Inputs of the planner. */
+    PlannerAlignment* planner{nullptr}; /**< Planner that evaluated the trajectory (nullptr if the
+                                           trajectory is taken from the plan cache). */
+    bool isValid{false}; /**< False if the trajectory is the first one. */
+};
+
 /**
  * TrajectoryGenerator class is used to handle the UnicycleTrajectoryGenerator library.
  */
@@ -56,6 +153,48 @@ class TrajectoryGenerator
 
     iDynTree::Vector2 m_DCMBoundaryConditionAtMergePointPosition; /**< DCM position at the merge point. */
     iDynTree::Vector2 m_DCMBoundaryConditionAtMergePointVelocity; /**< DCM velocity at the merge point. */
+    iDynTree::Transform m_otherFootTransform; /**< Transformation between the other foot and the world
+                                                 frame at the merge point. */
+    bool m_isTerminalStepAdded{false}; /**< True if the terminal step is added. */
+
+    bool m_isFirstTrajectoryOnTheFly{false}; /**< True if the first trajectory starts from the measured feet. */
+    iDynTree::Transform m_leftToRightTransform; /**< Transformation between the feet used by the first trajectory. */
+    bool m_isFirstTrajectoryTerminalStepAdded{false}; /**< True if the terminal step is added to the first trajectory. */
+
+    std::vector<PlanCacheEntry> m_planCache; /**< Plan cache (used only by the planner thread). */
+    std::size_t m_planCacheUses{0}; /**< Number of cache accesses (used to evaluate the last use). */
+    double m_planCachePositionTolerance; /**< Tolerance used to compare the positions [m]. */
+    double m_planCacheVelocityTolerance; /**< Tolerance used to compare the velocities [m/s]. */
+    double m_planCacheAngleTolerance; /**< Tolerance used to compare the angles [rad]. */
+
+    PlannerAlignment m_plannerAlignment; /**< Merged requests evaluated by m_trajectoryGenerator. */
+    std::vector<PlannerRequest> m_mergedRequests; /**< Last merged requests (circular buffer). */
+    std::size_t m_numberOfMergedRequests{0}; /**< Number of requests merged since the first trajectory. */
+    std::vector<PlannerRequest> m_replayedRequests; /**< Buffer of the requests replayed by the planner thread. */
+    PlannedRequest m_plannedRequest; /**< Request of the trajectory stored in the front buffer. */
+    PlannedRequest m_handedOutRequest; /**< Request of the last trajectory taken by the user. */
+
+    std::unique_ptr<PlannedTrajectory> m_plannedTrajectory; /**< Last published trajectory (front buffer). */
+    std::unique_ptr<PlannedTrajectory> m_plannedTrajectoryBackBuffer; /**< Trajectory filled after the evaluation
+                                                                         of the planner (back buffer). */
+    bool m_isPlannedTrajectoryAvailable{false}; /**< True if the front buffer contains a trajectory
+                                                   that is not taken yet. */
+    std::size_t m_plannedTrajectoryHeadroom; /**< Number of samples left free before the first sample of
+                                                the planned trajectory (they are filled when the
+                                                trajectory is merged). */
+
+    bool m_useSpeculativePlanning{false}; /**< True if the candidate trajectories are evaluated in background. */
+    double m_speculativeGoalPerturbation; /**< Distance between the goal and the perturbed goals. */
+    double m_speculativeGoalTolerance; /**< Maximum distance between the required goal and the one
+                                          of an adopted candidate. */
+    std::vector<std::unique_ptr<SpeculativePlanner>> m_speculativePlanners; /**< Speculative planners. */
+    SpeculativeRequest m_speculativeRequest; /**< Last request of the candidate trajectories. */
+    std::condition_variable m_speculativeConditionVariable; /**< Synchronizer of the speculative planners. */
+
+    std::vector<double> m_plannerLatencies; /**< Last computation times of the planner (circular buffer) [s]. */
+    std::vector<double> m_sortedPlannerLatencies; /**< Buffer used to evaluate the percentiles. */
+    std::size_t m_numberOfPlannerLatencies{0}; /**< Number of samples stored in m_plannerLatencies. */
+    std::size_t m_plannerLatencyIndex{0}; /**< Position of the next sample in m_plannerLatencies. */
 
     std::mutex m_mutex; /**< Mutex. */
 
@@ -64,6 +203,131 @@ class TrajectoryGenerator
      */
     void computeThread();
 
+    /**
+     * Speculative planner thread method.
+     * @param index index of the planner.
+     */
+    void speculativeThread(std::size_t index);
+
+    /**
+     * Set all the parameters of a unicycle planner.
+     * @param config yarp searchable object;
+     * @param generator unicycle planner.
+     * @return true/false in case of success/failure.
+     */
+    bool configureUnicyclePlanner(const yarp::os::Searchable& config, UnicycleTrajectoryGenerator& generator);
+
+    /**
+     * Evaluate the final desired point of the unicycle in the world frame.
+     * @param correctLeft true if the stance foot is the left;
+     * @param measured transformation between the stance foot and the world frame;
+     * @param desiredPosition final desired position of the projection of the CoM (stance foot frame).
+     * @return the desired point.
+     */
+    iDynTree::Vector2 evaluateDesiredPoint(bool correctLeft, const iDynTree::Transform& measured,
+                                           const iDynTree::Vector2& desiredPosition) const;
+
+    /**
+     * Copy the output of a planner in a buffer.
+     * @note Please call this method only when the planner is not running.
+     * @param generator unicycle planner;
+     * @param buffer trajectory buffer (it is allocated if it is empty).
+     * @return true/false in case of success/failure.
+     */
+    bool fillPlannedTrajectory(UnicycleTrajectoryGenerator& generator,
+                               std::unique_ptr<PlannedTrajectory>& buffer);
+
+    /**
+     * Evaluate the key of the plan cache.
+     * @param request inputs of the planner (world frame);
+     * @param otherFoot transformation between the other foot and the world frame.
+     * @return the key.
+     */
+    PlanCacheKey evaluatePlanCacheKey(const PlannerRequest& request,
+                                      const iDynTree::Transform& otherFoot) const;
+
+    /**
+     * Look for a trajectory in the plan cache.
+     * @param key inputs of the planner expressed in the frame of the stance foot.
+     * @return a pointer to the entry if it is found, nullptr otherwise.
+     */
+    PlanCacheEntry* findPlanCacheEntry(const PlanCacheKey& key);
+
+    /**
+     * Store a trajectory in the plan cache (the least recently used entry is replaced).
+     * @param key inputs of the planner expressed in the frame of the stance foot;
+     * @param trajectory planned trajectory (world frame);
+     * @param world_H_stance planar transformation between the stance foot and the world frame.
+     */
+    void storePlanCacheEntry(const PlanCacheKey& key, const PlannedTrajectory& trajectory,
+                             const iDynTree::Transform& world_H_stance);
+
+    /**
+     * Apply a rigid transformation to a planned trajectory.
+     * @param input trajectory;
+     * @param transform planar transformation applied to the trajectory;
+     * @param output transformed trajectory (the memory is allocated only if it is required).
+     */
+    static void transformPlannedTrajectory(const PlannedTrajectory& input,
+                                           const iDynTree::Transform& transform,
+                                           PlannedTrajectory& output);
+
+    /**
+     * Evaluate the first trajectory with a unicycle planner.
+     * @param generator unicycle planner.
+     * @return true/false in case of success/failure.
+     */
+    bool generateFirstTrajectories(UnicycleTrajectoryGenerator& generator);
+
+    /**
+     * Evaluate a trajectory with a unicycle planner.
+     * @param generator unicycle planner;
+     * @param request inputs of the planner.
+     * @return true/false in case of success/failure.
+     */
+    bool planTrajectory(UnicycleTrajectoryGenerator& generator, const PlannerRequest& request);
+
+    /**
+     * Evaluate again the merged requests not taken into account by the internal state of a planner.
+     * If the planner evaluated a trajectory that was discarded, the last merged one is evaluated
+     * again as well. If the requests are not stored anymore or the planner fails, the planner is
+     * marked as diverged and it is not used anymore.
+     * @note Please call this method only from the thread of the planner.
+     * @param generator unicycle planner;
+     * @param alignment merged requests evaluated by the planner;
+     * @param buffer buffer used to store the requests.
+     * @return true if the planner is aligned with the merged trajectories, false otherwise.
+     */
+    bool alignPlanner(UnicycleTrajectoryGenerator& generator, PlannerAlignment& alignment,
+                      std::vector<PlannerRequest>& buffer);
+
+    /**
+     * Check if a planner has to be aligned while it is idle, i.e. if it has to evaluate again more
+     * than half of the stored merged requests. The planners are aligned in background so the
+     * requests to evaluate again are never overwritten.
+     * @note Please call this method with m_mutex locked.
+     * @param alignment merged requests evaluated by the planner.
+     * @return true if the planner has to be aligned, false otherwise.
+     */
+    bool isAlignmentRequired(const PlannerAlignment& alignment) const;
+
+    /**
+     * Align a planner that is idle. The trajectories already evaluated by the planner are not
+     * associated to it anymore (they cannot be kept in its internal state).
+     * @note Please call this method only from the thread of the planner.
+     * @param generator unicycle planner;
+     * @param alignment merged requests evaluated by the planner;
+     * @param buffer buffer used to store the requests.
+     */
+    void alignIdlePlanner(UnicycleTrajectoryGenerator& generator, PlannerAlignment& alignment,
+                          std::vector<PlannerRequest>& buffer);
+
+    /**
+     * Swap the back buffer with the front buffer.
+     * @note Please call this method when the mutex is taken.
+     */
+    void publishPlannedTrajectory();
+
 public:
 
     /**
@@ -111,12 +375,15 @@ public:
      * @param DCMBoundaryConditionAtMergePointVelocity is the velocity of the DCM at the merge point;
      * @param correctLeft todo;
      * @param measured Measured transformation between the stance foot and the world frame. (w_H_{stancefoot});
-     * @param desiredPosition final desired position of the projection of the CoM.
+     * @param desiredPosition final desired position of the projection of the CoM;
+     * @param otherFoot transformation between the other foot and the world frame at the merge
+     * point (used only by the plan cache).
      * @return true/false in case of success/failure.
      */
     bool updateTrajectories(double initTime, const iDynTree::Vector2& DCMBoundaryConditionAtMergePointPosition,
                             const iDynTree::Vector2& DCMBoundaryConditionAtMergePointVelocity, bool correctLeft,
-                            const iDynTree::Transform& measured, const iDynTree::Vector2& desiredPosition);
+                            const iDynTree::Transform& measured, const iDynTree::Vector2& desiredPosition,
+                            const iDynTree::Transform& otherFoot);
 
     /**
      * Return if the trajectory was computed
@@ -137,74 +404,74 @@ public:
     bool isTrajectoryAsked();
 
     /**
-     * Get the desired 2D-DCM position trajectory
-     * @param DCMPositionTrajectory desired trajectory of the DCM.
-     * @return true/false in case of success/failure.
-     */
-    bool getDCMPositionTrajectory(std::vector<iDynTree::Vector2>& DCMPositionTrajectory);
-
-    /**
-     * Get the desired 2D-DCM velocity trajectory
-     * @param DCMVelocityTrajectory desired trajectory of the DCM.
+     * Get the last trajectory evaluated by the planner. The trajectory is not copied, the content
+     * of the pointers is swapped.
+     * @param trajectory pointer to the planned trajectory. The memory previously pointed by
+     * trajectory will be reused by the planner.
      * @return true/false in case of success/failure.
      */
-    bool getDCMVelocityTrajectory(std::vector<iDynTree::Vector2>& DCMVelocityTrajectory);
+    bool getPlannedTrajectory(std::unique_ptr<PlannedTrajectory>& trajectory);
 
     /**
-     * Get the feet trajectory
-     * @param lFootTrajectory vector containing the left foot trajectory;
-     * @param rFootTrajectory vector containing the right foot trajectory.
-     * @return true/false in case of success/failure.
+     * Inform the generator that the last trajectory taken with getPlannedTrajectory() or
+     * getSpeculativeTrajectory() has been merged. The merged trajectories evaluated by the planner thread are kept in its internal
+     * state, the others are evaluated again before the next request.
      */
-    bool getFeetTrajectories(std::vector<iDynTree::Transform>& lFootTrajectory,
-                             std::vector<iDynTree::Transform>& rFootTrajectory);
-
+    void setTrajectoryMerged();
 
     /**
-     * Get the feet twist
-     * @param lFootTwist vector containing the left foot twists;
-     * @param rFootTwist vector containing the right foot twists.
-     * @return true/false in case of success/failure.
-     */
-    bool getFeetTwist(std::vector<iDynTree::Twist>& lFootTwist,
-                      std::vector<iDynTree::Twist>& rFootTwist);
-    /**
-     * Get the when the main frame of the left foot is the fix frame.
-     * @param isLeftFixedFrame vector containing when the main frame of
-     * the left foot is the fix frame.
+     * Evaluate in background a set of candidate trajectories starting from the same merge point:
+     * one for the desired position and the others for a set of goals around it. The previous
+     * candidates are discarded.
+     * @param initTime is the initial time of the trajectories;
+     * @param DCMBoundaryConditionAtMergePointPosition is the position of the DCM at the merge point;
+     * @param DCMBoundaryConditionAtMergePointVelocity is the velocity of the DCM at the merge point;
+     * @param correctLeft true if the stance foot is the left;
+     * @param measured transformation between the stance foot and the world frame;
+     * @param desiredPosition final desired position of the projection of the CoM.
      * @return true/false in case of success/failure.
      */
-    bool getWhenUseLeftAsFixed(std::vector<bool>& isLeftFixedFrame);
+    bool updateSpeculativeTrajectories(double initTime,
+                                       const iDynTree::Vector2& DCMBoundaryConditionAtMergePointPosition,
+                                       const iDynTree::Vector2& DCMBoundaryConditionAtMergePointVelocity,
+                                       bool correctLeft, const iDynTree::Transform& measured,
+                                       const iDynTree::Vector2& desiredPosition);
 
     /**
-     * Get the feet phases
-     * @param lFootContacts vector containing the state of the left foot (true = in contact);
-     * @param rFootContacts vector containing the state of the right foot (true = in contact).
-     * @return true/false in case of success/failure.
+     * Get the candidate trajectory whose goal is the closest to the desired position. The
+     * trajectory is not copied, the content of the pointers is swapped.
+     * @param initTime initial time of the trajectory (time of the merge point);
+     * @param desiredPosition final desired position of the projection of the CoM;
+     * @param trajectory pointer to the planned trajectory.
+     * @return true if a candidate computed for the same merge point (and after the last merged
+     * trajectory) is closer to the desired position than speculativeGoalTolerance, false otherwise.
      */
-    bool getFeetStandingPeriods(std::vector<bool>& lFootContacts,
-                                std::vector<bool>& rFootContacts);
+    bool getSpeculativeTrajectory(double initTime, const iDynTree::Vector2& desiredPosition,
+                                  std::unique_ptr<PlannedTrajectory>& trajectory);
 
     /**
-     * Get the CoM height trajectory
-     * @param CoMHeightTrajectory vector containing trajectory of the COM on the z axis.
-     * @return true/false in case of success/failure.
+     * Return if the speculative planning is enabled.
+     * @return true if the candidate trajectories are evaluated in background.
      */
-    bool getCoMHeightTrajectory(std::vector<double>& CoMHeightTrajectory);
+    bool isSpeculativePlanningEnabled() const;
 
     /**
-     * Get the CoM height velocity
-     * @param CoMHeightVelocity vector containing the velocity of the COM on the z axis.
+     * Restrict the planner threads to a set of cores.
+     * @param cores list of the cores.
      * @return true/false in case of success/failure.
      */
-    bool getCoMHeightVelocity(std::vector<double>& CoMHeightVelocity);
+    bool setThreadsAffinity(const std::vector<int>& cores);
 
     /**
-     * Get the merge points along the trajectory
-     * @param mergePoints vector containing all the merge points of the trajectory.
-     * @return true/false in case of success/failure.
+     * Get a percentile of the last computation times of the planner (the window size is set by
+     * plannerLatencyWindow). The time spent to align the planner with the merged trajectories is
+     * included.
+     * @param percentile required percentile (between 0 and 1);
+     * @param latency percentile of the computation time [s].
+     * @return true if at least one trajectory has been evaluated by the planner thread,
+     * false otherwise.
      */
-    bool getMergePoints(std::vector<size_t>& mergePoints);
+    bool getPlannerLatency(double percentile, double& latency);
 };
 
 #endif
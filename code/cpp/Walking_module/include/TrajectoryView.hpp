@@ -0,0 +1,110 @@
+/**
+ * @file TrajectoryView.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef TRAJECTORY_VIEW_HPP
+#define TRAJECTORY_VIEW_HPP
+
+// std
+#include <algorithm>
+#include <cstddef>
+
+/**
+ * TrajectoryView is a read-only view of a trajectory stored in contiguous memory.
+ * The view has a (logical) size that can be greater than the number of contiguous samples:
+ * in that case the trajectory is assumed constant and equal to its last sample.
+ */
+template <typename T>
+class TrajectoryView
+{
+    const T* m_data{nullptr}; /**< Pointer to the first sample. */
+    std::size_t m_contiguousSize{0}; /**< Number of samples stored in contiguous memory. */
+    std::size_t m_size{0}; /**< Size of the trajectory. */
+
+public:
+
+    /**
+     * Constructor.
+     */
+    TrajectoryView() = default;
+
+    /**
+     * Constructor.
+     * @param data pointer to the first sample;
+     * @param contiguousSize number of samples stored in contiguous memory;
+     * @param size size of the trajectory (it has to be greater or equal than contiguousSize).
+     */
+    TrajectoryView(const T* data, std::size_t contiguousSize, std::size_t size)
+        : m_data(data), m_contiguousSize(contiguousSize), m_size(std::max(size, contiguousSize))
+    {}
+
+    /**
+     * Get a sample of the trajectory.
+     * @param index index of the sample.
+     * @return the sample (the last one if the index is greater than the contiguous size).
+     */
+    const T& operator[](std::size_t index) const
+    {
+        return m_data[std::min(index, m_contiguousSize - 1)];
+    }
+
+    /**
+     * Get the first sample of the trajectory.
+     * @return the first sample.
+     */
+    const T& front() const
+    {
+        return m_data[0];
+    }
+
+    /**
+     * Get the last sample of the trajectory.
+     * @return the last sample.
+     */
+    const T& back() const
+    {
+        return m_data[m_contiguousSize - 1];
+    }
+
+    /**
+     * Get the pointer to the first sample.
+     * @return the pointer to the contiguous samples.
+     */
+    const T* data() const
+    {
+        return m_data;
+    }
+
+    /**
+     * Get the number of samples stored in contiguous memory.
+     * @return the number of contiguous samples.
+     */
+    std::size_t contiguousSize() const
+    {
+        return m_contiguousSize;
+    }
+
+    /**
+     * Get the size of the trajectory.
+     * @return the size of the trajectory.
+     */
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    /**
+     * Check if the trajectory is empty.
+     * @return true if the trajectory is empty false otherwise.
+     */
+    bool empty() const
+    {
+        return m_contiguousSize == 0;
+    }
+};
+
+#endif
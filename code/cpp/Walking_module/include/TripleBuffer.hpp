@@ -0,0 +1,91 @@
+/**
+ * @file TripleBuffer.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+// std
+#include <array>
+#include <atomic>
+
+/**
+ * TripleBuffer is a single-producer single-consumer lock-free buffer that always gives the
+ * consumer the last sample published by the producer. The producer writes in the back buffer
+ * and publishes it exchanging it with the middle one, the consumer takes the middle buffer only
+ * if a new sample was published. Neither the producer nor the consumer ever wait.
+ */
+template <typename T>
+class TripleBuffer
+{
+    static constexpr unsigned s_indexMask{3}; /**< Mask of the index of the middle buffer. */
+    static constexpr unsigned s_newSampleFlag{4}; /**< Set when the middle buffer contains a new sample. */
+
+    std::array<T, 3> m_buffers; /**< Buffers. */
+
+    std::atomic<unsigned> m_middle{1}; /**< Index of the middle buffer and new sample flag. */
+    unsigned m_back{0}; /**< Index of the back buffer (used only by the producer). */
+    unsigned m_front{2}; /**< Index of the front buffer (used only by the consumer). */
+
+public:
+
+    /**
+     * Initialize all the buffers.
+     * @note Please do not call this method while the producer or the consumer are running.
+     * @param value initial value of the buffers.
+     */
+    void initialize(const T& value)
+    {
+        m_buffers.fill(value);
+        m_middle.store(1);
+        m_back = 0;
+        m_front = 2;
+    }
+
+    /**
+     * Get the back buffer (producer side).
+     * @return reference to the buffer that will be published.
+     */
+    T& back()
+    {
+        return m_buffers[m_back];
+    }
+
+    /**
+     * Publish the back buffer (producer side).
+     */
+    void publish()
+    {
+        unsigned middle = m_middle.exchange(m_back | s_newSampleFlag, std::memory_order_acq_rel);
+        m_back = middle & s_indexMask;
+    }
+
+    /**
+     * Take the last published sample if any (consumer side).
+     * @return true if the front buffer has been updated.
+     */
+    bool update()
+    {
+        if(!(m_middle.load(std::memory_order_relaxed) & s_newSampleFlag))
+            return false;
+
+        unsigned middle = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = middle & s_indexMask;
+        return true;
+    }
+
+    /**
+     * Get the front buffer (consumer side).
+     * @return reference to the last sample taken by update().
+     */
+    const T& front() const
+    {
+        return m_buffers[m_front];
+    }
+};
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @file WalkingBenchmark.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef WALKING_BENCHMARK_HPP
+#define WALKING_BENCHMARK_HPP
+
+// std
+#include <memory>
+#include <string>
+#include <vector>
+
+// YARP
+#include <yarp/os/Searchable.h>
+
+// iDynTree
+#include <iDynTree/Core/VectorFixSize.h>
+
+#include "WalkingModule.hpp"
+#include "TimeProfiler.hpp"
+#include "FootprintConstraints.hpp"
+
+/**
+ * Tracking performances of a benchmark run.
+ */
+struct BenchmarkMetrics
+{
+    double dcmErrorRMS{0}; /**< Root mean square of the DCM tracking error [m]. */
+    double dcmErrorMax{0}; /**< Maximum DCM tracking error [m]. */
+    double minimumZMPMargin{0}; /**< Minimum distance between the measured ZMP and the edges of the
+                                   support polygon (negative if the ZMP is outside) [m]. */
+};
+
+/**
+ * WalkingBenchmark runs the ticks of the WalkingModule (planner, DCM controller, ZMP controller,
+ * inverse and forward kinematics) in closed loop with a BenchmarkPlant instead of the robot. The
+ * latency of each stage and the throughput of the whole chain are reported.
+ */
+class WalkingBenchmark
+{
+    std::unique_ptr<WalkingModule> m_module; /**< Module that controls the plant. */
+
+    double m_duration; /**< Duration of the benchmark (simulated time) [s]. */
+    bool m_isRealTime; /**< True if each tick waits for the sampling time. */
+
+    iDynTree::Vector2 m_goal; /**< Goal sent to the planner. */
+    double m_goalPeriod; /**< The goal is sent to the planner every m_goalPeriod seconds. */
+
+    std::vector<std::string> m_stages; /**< Names of the profiled stages (in order of execution). */
+    Timer m_plannerTimer; /**< Time between the request of a trajectory and its evaluation. */
+    bool m_isPlannerTimerRunning{false}; /**< True if the planner is evaluating a trajectory. */
+    unsigned int m_numberOfPlans{0}; /**< Number of trajectories evaluated by the planner. */
+    unsigned int m_numberOfTicks{0}; /**< Number of ticks of the benchmark. */
+    double m_elapsedTime{0}; /**< Wall time spent in the control loop [s]. */
+
+    FootprintConstraints m_supportPolygon; /**< Support polygon used to evaluate the ZMP margin. */
+    double m_dcmSquaredErrorSum{0}; /**< Sum of the squared DCM tracking errors. */
+    BenchmarkMetrics m_metrics; /**< Tracking performances of the run. */
+
+    /**
+     * Evaluate the first trajectory and move the plant in the initial configuration as the
+     * prepareRobot and the startWalking rpc commands.
+     * @return true/false in case of success/failure.
+     */
+    bool prepare();
+
+    /**
+     * Measure the latency of the planner by polling its state. When the loop does not run in
+     * real time the planner may be slower than the controller, in this case the merge waits
+     * until the trajectory is available.
+     */
+    void updatePlannerTimer();
+
+    /**
+     * Update the tracking performances with the samples of the current tick. It has to be
+     * called before the trajectories are propagated.
+     * @return true/false in case of success/failure.
+     */
+    bool updateMetrics();
+
+public:
+
+    /**
+     * Configure the benchmark. The same configuration of the WalkingModule is used.
+     * @note The groups of the configuration are modified (the GENERAL options are appended).
+     * @param rf is the reference to a resource finder (or property) object.
+     * @return true/false in case of success/failure.
+     */
+    bool configure(const yarp::os::Searchable& rf);
+
+    /**
+     * Run the benchmark.
+     * @return true/false in case of success/failure.
+     */
+    bool run();
+
+    /**
+     * Get a human readable report of the benchmark.
+     * @return the report.
+     */
+    std::string getReport() const;
+
+    /**
+     * Get the tracking performances of the last run.
+     * @return the metrics.
+     */
+    const BenchmarkMetrics& getMetrics() const;
+
+    /**
+     * Get the names of the profiled stages (in order of execution).
+     * @return the vector containing the names.
+     */
+    const std::vector<std::string>& getStages() const;
+
+    /**
+     * Get the latency statistics of a stage over the whole run.
+     * @param stage name of the stage;
+     * @param statistics statistics of the stage [ms].
+     * @return true/false in case of success/failure.
+     */
+    bool getStageStatistics(const std::string& stage, TimerStatistics& statistics) const;
+};
+
+#endif
@@ -20,11 +20,24 @@
 // yarp
 #include <yarp/os/Value.h>
 
+#include <cstdint>
 #include <unordered_map>
-#include <deque>
+#include <map>
+#include <memory>
+#include <string>
 
 // solver
 #include "MPCSolver.hpp"
+#include "CondensedMPCSolver.hpp"
+#include "TrajectoryView.hpp"
+#include "FootprintConstraints.hpp"
+
+/**
+ * Formulation of the DCM MPC problem.
+ * - Sparse: states and inputs are optimization variables, the dynamics is an equality constraint;
+ * - Condensed: the state is removed using the dynamics, only the (blocked) inputs are optimized.
+ */
+enum class MPCFormulation {Sparse, Condensed};
 
 /**
  * WalkingController class contains the controller instances.
@@ -57,6 +70,20 @@ class WalkingController
      */
     iDynSparseMatrix m_stateWeightMatrix;
 
+    MPCFormulation m_formulation{MPCFormulation::Sparse}; /**< Formulation of the MPC problem. */
+
+    /**
+     * The hessian matrix of the condensed QP problem.
+     * \f$ T^T (\Gamma^T \tilde{Q} \Gamma + \Theta^T \tilde{R} \Theta) T \f$ where \f$ T \f$ is
+     * the move blocking matrix. It is used only by the condensed formulation.
+     */
+    iDynSparseMatrix m_condensedHessianMatrix;
+
+    Eigen::MatrixXd m_condensedStateGradientMatrix; /**< Condensed formulation: \f$ T^T \Gamma^T \tilde{Q} \Phi \f$. */
+    Eigen::MatrixXd m_condensedReferenceGradientMatrix; /**< Condensed formulation: \f$ T^T \Gamma^T \tilde{Q} \f$. */
+    Eigen::MatrixXd m_condensedInputGradientMatrix; /**< Condensed formulation: \f$ -T^T \Theta^T \tilde{R} e_1 \f$. */
+    int m_numberOfBlocks; /**< Number of input blocks (condensed formulation). */
+
     int m_stateSize; /**< Size of the state vector. It is equal to 2. */
     int m_inputSize;  /**< Size of the input vector. It is equal to 2. */
     int m_controllerHorizon; /**< Length of the controller horizon. */
@@ -66,16 +93,48 @@ class WalkingController
     std::pair<bool, bool> m_feetStatus; /**< Current status of the feet. Left and Right. True is used
                                            if the foot is in contact. */
 
-    iDynTree::ConvexHullProjectionConstraint m_convexHullComputer; /**<iDynTree convex hull helper. */
-    std::vector<iDynTree::Polygon> m_feetPolygons; /**<Vector containing the polygon of each foot (left and right). */
+    FootprintConstraints m_footprintConstraints; /**< Half-space representation of the support polygon. */
+
+    bool m_checkHorizonMargin{false}; /**< True if the ZMP is checked along the whole horizon. */
+    double m_horizonMargin{0}; /**< Minimum distance between the ZMP along the horizon and the edges of the convex hull. */
+    double m_zmpMargin{0}; /**< Distance between the output of the controller and the edges of the convex hull. */
+
+    /**
+     * Unconstrained fast path. The inequality constraints act only on the first input, if the
+     * unconstrained optimum satisfies them it is also the solution of the QP problem and the
+     * solver is not called. The unconstrained optimum is a linear function of the gradient and
+     * of the current state: the gains are evaluated in the initialize() method by factorizing the
+     * KKT system (sparse formulation) or the hessian matrix (condensed formulation).
+     */
+    bool m_useUnconstrainedFastPath{false};
+    Eigen::MatrixXd m_unconstrainedGradientGain; /**< Map from the gradient to the unconstrained inputs. */
+    Eigen::MatrixXd m_unconstrainedStateGain; /**< Map from the current state to the unconstrained inputs (sparse formulation). */
+    Eigen::VectorXd m_unconstrainedInputs; /**< Inputs of the unconstrained optimum (only the first one if the horizon is not checked). */
+    bool m_isSolutionUnconstrained{false}; /**< True if the last solution is given by the fast path. */
+
+    bool m_useGeneratedSolvers{true}; /**< True if the generated solvers are used (only with WALKING_USE_OSQP_CODEGEN). */
+
+    iDynTree::Vector2 m_currentState; /**< Current value of the state (set by setFeedback()). */
+
+    Eigen::VectorXd m_primalVariable; /**< Primal variable used to warm start the controllers. */
+    std::map<std::pair<bool, bool>, Eigen::VectorXd> m_dualVariables; /**< Dual variable of each controller
+                                                                         (used to warm start them). */
 
     bool m_isSolutionEvaluated{false}; /**< True if the solution is evaluated. */
 
+    /**
+     * Pool of MPC solvers, one for each contact configuration (left, right) indexed by the
+     * status of the feet. All the solvers are initialized in the initialize() method.
+     */
+    std::map<std::pair<bool, bool>, std::shared_ptr<MPCSolverInterface>> m_controllers;
+
     /**
      * Pointer to the current MPCSolver.
-     * A new MPC solver is initialized when a new phase occurs.
+     * The MPC solver is taken from the pool when a new phase occurs.
      */
-    std::shared_ptr<MPCSolver> m_currentController;
+    std::shared_ptr<MPCSolverInterface> m_currentController;
+
+    bool m_isControllerSwitched{false}; /**< True if the controller has been changed and the gradient has to be evaluated from scratch. */
 
     iDynTree::Vector2 m_output; /**< Vector containing the output of the controller. */
 
@@ -93,6 +152,76 @@ class WalkingController
      */
     bool initializeMatrices(const yarp::os::Searchable& config);
 
+    /**
+     * Instantiate and initialize the MPC solver of each contact configuration.
+     * Each solver is able to handle the biggest convex hull of its configuration.
+     * @return true/false in case of success/failure.
+     */
+    bool initializeControllers();
+
+    /**
+     * Evaluate the gains of the unconstrained fast path.
+     * @return true/false in case of success/failure.
+     */
+    bool initializeUnconstrainedSolution();
+
+    /**
+     * Load the constant matrices of the problem from the startup cache.
+     * @param fileName name of the cache file;
+     * @param key key of the configuration.
+     * @return false if the cache is not available (the matrices have to be evaluated).
+     */
+    bool loadMatrices(const std::string& fileName, std::uint64_t key);
+
+    /**
+     * Store the constant matrices of the problem in the startup cache.
+     * @param fileName name of the cache file;
+     * @param key key of the configuration.
+     * @return true/false in case of success/failure.
+     */
+    bool saveMatrices(const std::string& fileName, std::uint64_t key);
+
+    /**
+     * Evaluate the unconstrained optimum and check if its first input satisfies the inequality
+     * constraints. In this case the optimum is the solution of the QP problem.
+     * @return true if the unconstrained optimum is feasible.
+     */
+    bool solveUnconstrained();
+
+    /**
+     * Warm start a controller using the solution of another one.
+     * The primal variable is copied while only the dual variables associated to the equality
+     * constraints are copied (the inequality constraints change between the two controllers).
+     * @param previousController controller used as source;
+     * @param previousDualVariable buffer of the dual variable of the previous controller;
+     * @param nextController controller that will be warm started;
+     * @param nextDualVariable buffer of the dual variable of the next controller.
+     * @return true/false in case of success/failure.
+     */
+    bool warmStartController(const std::shared_ptr<MPCSolverInterface>& previousController,
+                             Eigen::VectorXd& previousDualVariable,
+                             const std::shared_ptr<MPCSolverInterface>& nextController,
+                             Eigen::VectorXd& nextDualVariable);
+
+    /**
+     * Initialize the matrices of the condensed formulation.
+     * The input trajectory is split in blocks: the first move_blocking_fine_samples blocks
+     * contain one sample, the others contain move_blocking_coarse_samples samples.
+     * @param config yarp searchable configuration variable;
+     * @param stateDynamics scalar state dynamics (the matrix is diagonal);
+     * @param inputDynamics scalar input dynamics (the matrix is diagonal);
+     * @param stateWeightStackedTriplets triplets of \f$ \tilde{Q} \f$;
+     * @param inputWeightStackedTriplets triplets of \f$ \tilde{R} \f$;
+     * @param thetaMatrix is the theta matrix \f$ \Theta \f$.
+     * @return true/false in case of success/failure.
+     */
+    bool initializeCondensedMatrices(const yarp::os::Searchable& config,
+                                     const double& stateDynamics,
+                                     const double& inputDynamics,
+                                     const iDynTree::Triplets& stateWeightStackedTriplets,
+                                     const iDynTree::Triplets& inputWeightStackedTriplets,
+                                     const iDynSparseMatrix& thetaMatrix);
+
     /**
      * Evaluate theta matrix. For further information please refers to the
      * [literature](https://github.com/loc2/element_capture-point-walking/issues/9)
@@ -168,22 +297,6 @@ class WalkingController
      */
     iDynTree::Triplets evaluateEqualConstraintsInputSubmatrix(const iDynTree::Triplets& inputDynamicsMatrix);
 
-    /**
-     * Build the convex hull for double support phase.
-     * @param leftFootTransform structure containing the homogeneous transformation of the left foot;
-     * @param leftFootTransform structure containing the homogeneous transformation of the right foot;
-     * @return true/false in case of success/failure.
-     */
-    bool buildConvexHull(const iDynTree::Transform& leftFootTransform,
-                         const iDynTree::Transform& rightFootTransform);
-
-    /**
-     * Build the convex hull for single support phase.
-     * @param footTransform structure containing the homogeneous transformation of the stance foot.
-     * @return true/false in case of success/failure.
-     */
-    bool buildConvexHull(const iDynTree::Transform& footTransformfoot);
-
 public:
 
     /**
@@ -194,22 +307,20 @@ public:
     bool initialize(const yarp::os::Searchable& config);
 
     /**
-     * If the phase (DS or SS) is changed the new convex hull is evaluated and a new MPCSolver
-     * is initialize.
-     * @param leftFoot deque containing the homogeneous transformation of the left foot during
-     * the trajectory;
-     * @param rightFoot deque containing the homogeneous transformation of the right foot during
-     * the trajectory;
-     * @param leftInContact deque containing information about the state of the left foot
+     * If the phase (DS or SS) is changed the new convex hull is evaluated and the MPCSolver
+     * associated to the new phase is warm started with the solution of the previous one.
+     * @param leftFoot trajectory of the homogeneous transformation of the left foot;
+     * @param rightFoot trajectory of the homogeneous transformation of the right foot;
+     * @param leftInContact trajectory containing information about the state of the left foot
      * (stance = true, swing = false);
-     * @param rightInContact deque containing information about the state of the left foot
+     * @param rightInContact trajectory containing information about the state of the left foot
      * (stance = true, swing = false).
      * @return true/false in case of success/failure.
      */
-    bool setConvexHullConstraint(const std::deque<iDynTree::Transform>& leftFoot,
-                                 const std::deque<iDynTree::Transform>& rightFoot,
-                                 const std::deque<bool>& leftInContact,
-                                 const std::deque<bool>& rightInContact);
+    bool setConvexHullConstraint(const TrajectoryView<iDynTree::Transform>& leftFoot,
+                                 const TrajectoryView<iDynTree::Transform>& rightFoot,
+                                 const TrajectoryView<bool>& leftInContact,
+                                 const TrajectoryView<bool>& rightInContact);
 
     /**
      * Set the feedback.
@@ -220,11 +331,11 @@ public:
 
     /**
      * Set the reference signal
-     * @param reference signal deque containing the reference signal.
+     * @param reference signal trajectory containing the reference signal.
      * @param resetTrajectory set equal to true if you do clear the old trajectory.
      * @return true/false in case of success/failure.
      */
-    bool setReferenceSignal(const std::deque<iDynTree::Vector2>& referenceSignal,
+    bool setReferenceSignal(const TrajectoryView<iDynTree::Vector2>& referenceSignal,
                             const bool& resetTrajectory);
 
     /**
@@ -233,12 +344,65 @@ public:
      */
     bool solve();
 
+    /**
+     * Solve the problem once on the expected initial state, so that the first iteration finds a
+     * hot solver. The QP solver is called even if the unconstrained optimum is feasible. The
+     * output of the controller is not changed and the next reference signal is evaluated from
+     * scratch.
+     * @param leftFoot trajectory of the homogeneous transformation of the left foot;
+     * @param rightFoot trajectory of the homogeneous transformation of the right foot;
+     * @param leftInContact trajectory containing information about the state of the left foot;
+     * @param rightInContact trajectory containing information about the state of the right foot;
+     * @param referenceSignal trajectory containing the reference signal (its first sample is
+     * used as initial state).
+     * @return true/false in case of success/failure.
+     */
+    bool warmUp(const TrajectoryView<iDynTree::Transform>& leftFoot,
+                const TrajectoryView<iDynTree::Transform>& rightFoot,
+                const TrajectoryView<bool>& leftInContact,
+                const TrajectoryView<bool>& rightInContact,
+                const TrajectoryView<iDynTree::Vector2>& referenceSignal);
+
     /**
      * Get the output of the controller.
      * @param controllerOutput is the vector containing the output the controller.
      * @return true/false in case of success/failure.
      */
     bool getControllerOutput(iDynTree::Vector2& controllerOutput);
+
+    /**
+     * Check if the ZMP is checked along the whole horizon (check_horizon_margin option).
+     * @return true if the horizon margin is evaluated by solve().
+     */
+    bool isHorizonMarginChecked() const;
+
+    /**
+     * Get the minimum distance between the ZMP along the horizon and the edges of the convex
+     * hull (negative if the ZMP is outside). It is evaluated only if isHorizonMarginChecked().
+     * @return the margin evaluated by the last call of solve().
+     */
+    double getHorizonMargin() const;
+
+    /**
+     * Check if the last solution is the unconstrained optimum (use_unconstrained_fast_path
+     * option), i.e. the QP solver was not called.
+     * @return true if the solver was skipped by the last call of solve().
+     */
+    bool isSolutionUnconstrained() const;
+
+    /**
+     * Get the distance between the output of the controller and the edges of the convex hull
+     * (negative if the ZMP is outside).
+     * @return the margin evaluated by the last call of solve().
+     */
+    double getZMPMargin() const;
+
+    /**
+     * Get the statistics of the QP solver in the last call of solve(). All the quantities are
+     * equal to zero if the solver was skipped by the unconstrained fast path.
+     * @param statistics statistics of the solver.
+     */
+    void getSolverStatistics(QPSolverStatistics& statistics);
 };
 
 #endif
@@ -18,11 +18,51 @@
 //iDynTree
 #include <iDynTree/KinDynComputations.h>
 
-// iCub-ctrl
-#include <iCub/ctrl/filters.h>
+#include "FilterBank.hpp"
+
+/**
+ * Robot state used to evaluate the kinematic quantities.
+ */
+enum class FKState {Measured, Desired};
+
 class WalkingFK
 {
-    iDynTree::KinDynComputations m_kinDyn; /**< KinDynComputations solver. */
+    /**
+     * Kinematic quantities related to a robot state. Each quantity is evaluated the first time
+     * it is requested and it is stored until the state (or the floating base) changes.
+     */
+    struct KinematicsCache
+    {
+        iDynTree::KinDynComputations kinDyn; /**< KinDynComputations solver. */
+
+        iDynTree::Transform leftFootToWorldTransform; /**< Left foot to world transformation. */
+        iDynTree::Transform rightFootToWorldTransform; /**< Right foot to world transformation. */
+        iDynTree::Transform rootLinkToWorldTransform; /**< Root link to world transformation. */
+        iDynTree::Rotation neckOrientation; /**< Neck to world rotation. */
+        iDynTree::Twist rootLinkVelocity; /**< Root link velocity (mixed representation). */
+        iDynTree::MatrixDynSize leftFootJacobian; /**< Left foot jacobian (mixed representation). */
+        iDynTree::MatrixDynSize rightFootJacobian; /**< Right foot jacobian (mixed representation). */
+        iDynTree::MatrixDynSize neckJacobian; /**< Neck jacobian (mixed representation). */
+        iDynTree::MatrixDynSize comJacobian; /**< CoM jacobian (mixed representation). */
+
+        bool isLeftFootTransformEvaluated{false}; /**< True if the left foot transform is stored. */
+        bool isRightFootTransformEvaluated{false}; /**< True if the right foot transform is stored. */
+        bool isRootLinkTransformEvaluated{false}; /**< True if the root link transform is stored. */
+        bool isNeckOrientationEvaluated{false}; /**< True if the neck orientation is stored. */
+        bool isRootLinkVelocityEvaluated{false}; /**< True if the root link velocity is stored. */
+        bool isLeftFootJacobianEvaluated{false}; /**< True if the left foot jacobian is stored. */
+        bool isRightFootJacobianEvaluated{false}; /**< True if the right foot jacobian is stored. */
+        bool isNeckJacobianEvaluated{false}; /**< True if the neck jacobian is stored. */
+        bool isCoMJacobianEvaluated{false}; /**< True if the CoM jacobian is stored. */
+
+        /**
+         * Invalidate all the stored quantities.
+         */
+        void invalidate();
+    };
+
+    KinematicsCache m_measured; /**< Quantities related to the measured robot state. */
+    KinematicsCache m_desired; /**< Quantities related to the desired robot state. */
 
     bool m_prevContactLeft; /**< Boolean is the previous contact foot the left one? */
     bool m_dcmEvaluated; /**< is the DCM evaluated? */
@@ -45,10 +85,11 @@ class WalkingFK
     iDynTree::Vector2 m_dcm; /**< DCM position. */
     double m_omega; /**< Inverted time constant of the 3D-LIPM. */
 
-    std::unique_ptr<iCub::ctrl::FirstOrderLowPassFilter> m_comPositionFilter; /**< CoM position low pass filter. */
-    std::unique_ptr<iCub::ctrl::FirstOrderLowPassFilter> m_comVelocityFilter; /**< CoM velocity low pass filter. */
-    yarp::sig::Vector m_comPositionFiltered; /**< Filtered position of the CoM. */
-    yarp::sig::Vector m_comVelocityFiltered; /**< Filtered velocity of the CoM. */
+    FilterBank m_comFilters; /**< CoM position and velocity low pass filters. */
+    int m_comPositionGroup; /**< Group of the CoM position in the filter bank. */
+    int m_comVelocityGroup; /**< Group of the CoM velocity in the filter bank. */
+    iDynTree::Position m_comPositionFiltered; /**< Filtered position of the CoM. */
+    iDynTree::Vector3 m_comVelocityFiltered; /**< Filtered velocity of the CoM. */
     bool m_useFilters; /**< If it is true the filters will be used. */
 
     bool m_firstStep; /**< True only during the first step. */
@@ -70,6 +111,31 @@ class WalkingFK
      */
     bool setBaseFrames(const std::string& lFootFrame, const std::string& rFootFrame);
 
+    /**
+     * Set the floating base of both the measured and the desired state.
+     * @param baseLink name of the link used as floating base.
+     * @return true/false in case of success/failure.
+     */
+    bool setFloatingBase(const std::string& baseLink);
+
+    /**
+     * Set the state of a KinDynComputations solver.
+     * @param cache cache containing the solver;
+     * @param jointPosition joint position expressed in radians;
+     * @param jointVelocity joint velocity expressed in radians per seconds.
+     * @return true/false in case of success/failure.
+     */
+    bool setRobotState(KinematicsCache& cache,
+                       const iDynTree::VectorDynSize& jointPosition,
+                       const iDynTree::VectorDynSize& jointVelocity);
+
+    /**
+     * Get the cache related to a robot state.
+     * @param state robot state.
+     * @return the cache.
+     */
+    KinematicsCache& getCache(const FKState& state);
+
 public:
 
     /**
@@ -127,6 +193,16 @@ public:
     bool setInternalRobotState(const iDynTree::VectorDynSize& positionFeedbackInRadians,
                                const iDynTree::VectorDynSize& velocityFeedbackInRadians);
 
+    /**
+     * Set the desired state of the robot (joint position and velocity).
+     * The quantities related to the measured state are not affected.
+     * @param desiredPositionInRadians desired joint position expressed in radians;
+     * @param desiredVelocityInRadians desired joint velocity expressed in radians per seconds.
+     * @return true/false in case of success/failure.
+     */
+    bool setDesiredRobotState(const iDynTree::VectorDynSize& desiredPositionInRadians,
+                              const iDynTree::VectorDynSize& desiredVelocityInRadians);
+
     /**
      * Evaluate the 2D-Divergent component of motion.
      * @return true/false in case of success/failure.
@@ -162,61 +238,70 @@ public:
 
     /**
      * Return the transformation between the left foot frame (l_sole) and the world reference frame.
+     * @param state robot state used to evaluate the transformation.
      * @return world_H_left_frame.
      */
-    iDynTree::Transform getLeftFootToWorldTransform();
+    const iDynTree::Transform& getLeftFootToWorldTransform(const FKState& state = FKState::Measured);
 
     /**
      * Return the transformation between the right foot frame (r_sole) and the world reference frame.
+     * @param state robot state used to evaluate the transformation.
      * @return world_H_right_frame.
      */
-    iDynTree::Transform getRightFootToWorldTransform();
+    const iDynTree::Transform& getRightFootToWorldTransform(const FKState& state = FKState::Measured);
 
     /**
      * Return the transformation between the root frame and the world reference frame.
+     * @param state robot state used to evaluate the transformation.
      * @return world_H_root_frame.
      */
-    iDynTree::Transform getRootLinkToWorldTransform();
+    const iDynTree::Transform& getRootLinkToWorldTransform(const FKState& state = FKState::Measured);
 
     /**
      * Return the root link velocity.
+     * @param state robot state used to evaluate the velocity.
      * @return the root link velocity expressed with the mixed representation.
      */
-    iDynTree::Twist getRootLinkVelocity();
+    const iDynTree::Twist& getRootLinkVelocity(const FKState& state = FKState::Measured);
 
     /**
      * Return the neck orientation.
+     * @param state robot state used to evaluate the orientation.
      * @return the rotation matrix between the neck and the reference frame.
      */
-    iDynTree::Rotation getNeckOrientation();
+    const iDynTree::Rotation& getNeckOrientation(const FKState& state = FKState::Measured);
 
     /**
      * Get the left foot jacobian.
      * @oaram jacobian is the left foot jacobian matrix
+     * @param state robot state used to evaluate the jacobian.
      * @return true/false in case of success/failure.
      */
-    bool getLeftFootJacobian(iDynTree::MatrixDynSize &jacobian);
+    bool getLeftFootJacobian(iDynTree::MatrixDynSize &jacobian, const FKState& state = FKState::Measured);
 
     /**
      * Get the right foot jacobian.
      * @oaram jacobian is the right foot jacobian matrix
+     * @param state robot state used to evaluate the jacobian.
      * @return true/false in case of success/failure.
      */
-    bool getRightFootJacobian(iDynTree::MatrixDynSize &jacobian);
+    bool getRightFootJacobian(iDynTree::MatrixDynSize &jacobian, const FKState& state = FKState::Measured);
 
     /**
      * Get the neck jacobian.
      * @oaram jacobian is the neck jacobian matrix
+     * @param state robot state used to evaluate the jacobian.
      * @return true/false in case of success/failure.
      */
-    bool getNeckJacobian(iDynTree::MatrixDynSize &jacobian);
+    bool getNeckJacobian(iDynTree::MatrixDynSize &jacobian, const FKState& state = FKState::Measured);
 
     /**
      * Get the CoM jacobian.
      * @oaram jacobian is the CoM jacobian matrix
+     * @param state robot state used to evaluate the jacobian.
      * @return true/false in case of success/failure.
      */
-    bool getCoMJacobian(iDynTree::MatrixDynSize &jacobian);
+    bool getCoMJacobian(iDynTree::MatrixDynSize &jacobian, const FKState& state = FKState::Measured);
 };
 
 #endif
@@ -60,6 +60,19 @@ class WalkingIK
 
     int solverVerbosity;
     double maxCpuTime;
+    int maxIterations;
+
+    // real-time mode
+    bool m_useRealTimeMode; /**< If true the solver budget is bounded when a warm start is available. */
+    double m_realTimeMaxCpuTime; /**< Maximum CPU time of the solver in the real-time mode (in seconds). */
+    int m_realTimeMaxIterations; /**< Maximum number of iterations in the real-time mode. */
+    int m_maxConsecutiveFallbacks; /**< Maximum number of consecutive ticks in which the last iterate
+                                      can be used when the budget is exhausted. */
+    int m_consecutiveFallbacks; /**< Number of consecutive ticks in which the last iterate has been used. */
+    double m_maxFallbackError; /**< Maximum CoM and foot position error of the last iterate that is used
+                                  when the budget is exhausted (in meters). */
+    bool m_isWarmStartAvailable; /**< True if the guess is the solution of the previous problem. */
+    double m_solverTime{0}; /**< Time spent by the solver in the last call of computeIK (in seconds). */
 
     bool m_prepared;
 
@@ -67,6 +80,19 @@ class WalkingIK
 
     bool prepareIK();
 
+    /**
+     * Check if the last iterate of a solve that is stopped by the budget can be used. A solve
+     * that fails for other reasons (e.g. infeasible problem or NaN) has an iterate far from the
+     * targets.
+     * @param baseTransform base transform of the last iterate;
+     * @param desiredRightTransform desired right foot transform (expressed in the left foot frame);
+     * @param desiredCoMPosition desired CoM position (expressed in the left foot frame).
+     * @return true if the last iterate (stored in m_qResult) can be used.
+     */
+    bool isLastIterateValid(const iDynTree::Transform& baseTransform,
+                            const iDynTree::Transform& desiredRightTransform,
+                            const iDynTree::Position& desiredCoMPosition);
+
 public:
 
     /**
@@ -143,6 +169,20 @@ public:
     bool setDesiredJointsWeight(double weight);
 
     double desiredJointWeight();
+
+    /**
+     * Get the time spent by the solver in the last call of computeIK.
+     * @note the number of IPOPT iterations is not exposed by iDynTree::InverseKinematics.
+     * @return the time (in seconds).
+     */
+    double getSolverTime() const;
+
+    /**
+     * Get the number of consecutive ticks in which the budget of the real-time mode is exhausted
+     * and the last iterate is used as solution.
+     * @return the number of consecutive fallbacks.
+     */
+    int getNumberOfConsecutiveFallbacks() const;
 };
 
 #endif // end of ICUB_WALKINGIK_H
@@ -9,19 +9,84 @@
 #ifndef WALKING_LOGGER_HPP
 #define WALKING_LOGGER_HPP
 
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 // YARP
 #include <yarp/os/Searchable.h>
 #include <yarp/os/BufferedPort.h>
 #include <yarp/os/RpcClient.h>
 #include <yarp/sig/Vector.h>
 
+#include "FrameRingBuffer.hpp"
+
 class WalkingLogger
 {
     yarp::os::BufferedPort<yarp::sig::Vector> m_dataPort; /**< Data logger port. */
     yarp::os::RpcClient m_rpcPort; /**< RPC data logger port. */
 
+    bool m_useRingBuffer{false}; /**< If true the data are stored in a ring buffer and sent in
+                                    batches by a dedicated thread. */
+    bool m_useSequenceNumbers{true}; /**< If true each frame contains the sequence number and the
+                                        time stamp (always true if the ring buffer is used). */
+    std::uint64_t m_sequenceNumber{0}; /**< Sequence number of the next frame. */
+    int m_ringBufferSize; /**< Number of frames stored in the ring buffer. */
+    double m_drainPeriod; /**< Period of the thread that sends the data (in seconds). */
+    std::size_t m_numberOfChannels{0}; /**< Number of channels declared in startRecord(). */
+
+    FrameRingBuffer m_ringBuffer; /**< Ring buffer containing the frames (sequence number + time +
+                                     channels). */
+    std::vector<double> m_batch; /**< Buffer used by the drain thread. */
+
+    std::thread m_drainThread; /**< Thread that sends the data stored in the ring buffer. */
+    std::mutex m_mutex; /**< Mutex. */
+    std::condition_variable m_conditionVariable; /**< Synchronizer. */
+    bool m_closing{false}; /**< True if the drain thread has to be stopped. */
+
+    /**
+     * Main method of the drain thread.
+     */
+    void drainThread();
+
+    /**
+     * Send all the frames stored in the ring buffer in a single message.
+     */
+    void drain();
+
+    /**
+     * Stop the drain thread. The remaining frames are sent.
+     */
+    void stopDrainThread();
+
+    /**
+     * Copy a vector inside the frame.
+     * @param frame pointer to the first free element of the frame;
+     * @param t vector.
+     * @return the pointer to the next free element of the frame.
+     */
+    template <typename T>
+    static double* copyToFrame(double* frame, const T& t);
+
+    template <typename T, typename... Args>
+    static double* copyToFrame(double* frame, const T& t, const Args&... args);
+
+    template <typename T>
+    static std::size_t numberOfElements(const T& t);
+
+    template <typename T, typename... Args>
+    static std::size_t numberOfElements(const T& t, const Args&... args);
+
 public:
 
+    /**
+     * Destructor.
+     */
+    ~WalkingLogger();
+
     /**
      * Configure
      * @param config yarp searchable configuration variable;
@@ -32,6 +97,8 @@ public:
 
     /**
      * Start record.
+     * The number of strings defines the layout of the frames. If the ring buffer is used the
+     * memory is allocated here.
      * @param strings head of the logger file
      * @return true/false in case of success/failure.
      */
@@ -44,6 +111,10 @@ public:
 
     /**
      * Send data to the logger.
+     * Each frame is sent as [sequence number, time stamp, data] so the logger can store the time
+     * at which the data are sent and it can detect the lost frames.
+     * If the ring buffer is used the data are only copied inside the buffer (if the buffer is
+     * full the frame is dropped, its sequence number is skipped).
      * @param args all the vector containing the data that will be sent.
      */
     template <typename... Args>
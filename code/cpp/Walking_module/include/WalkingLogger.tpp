@@ -6,10 +6,79 @@
  * @date 2018
  */
 
+// YARP
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Time.h>
+
 #include "Utils.hpp"
 
+template <typename T>
+double* WalkingLogger::copyToFrame(double* frame, const T& t)
+{
+    for(int i = 0; i < t.size(); i++)
+        frame[i] = t(i);
+
+    return frame + t.size();
+}
+
+template <typename T, typename... Args>
+double* WalkingLogger::copyToFrame(double* frame, const T& t, const Args&... args)
+{
+    return copyToFrame(copyToFrame(frame, t), args...);
+}
+
+template <typename T>
+std::size_t WalkingLogger::numberOfElements(const T& t)
+{
+    return t.size();
+}
+
+template <typename T, typename... Args>
+std::size_t WalkingLogger::numberOfElements(const T& t, const Args&... args)
+{
+    return t.size() + numberOfElements(args...);
+}
+
 template <typename... Args>
 void WalkingLogger::sendData(const Args&... args)
 {
-    YarpHelper::sendVariadicVector(m_dataPort, args...);
+    if(!m_useRingBuffer && !m_useSequenceNumbers)
+    {
+        YarpHelper::sendVariadicVector(m_dataPort, args...);
+        return;
+    }
+
+    if(numberOfElements(args...) != m_numberOfChannels)
+    {
+        yError() << "[sendData] The number of elements is different from the number of channels"
+                 << "declared in startRecord.";
+        return;
+    }
+
+    // the sequence number is increased also if the frame is dropped
+    double sequenceNumber = m_sequenceNumber++;
+
+    if(!m_useRingBuffer)
+    {
+        // prepare() does not return the buffer of a frame that is still being sent (another one
+        // is allocated), so no frame is overwritten. The logger sees a gap only if a frame is
+        // dropped by the connection
+        yarp::sig::Vector& frame = m_dataPort.prepare();
+        frame.resize(m_numberOfChannels + 2);
+        frame[0] = sequenceNumber;
+        frame[1] = yarp::os::Time::now();
+        copyToFrame(frame.data() + 2, args...);
+        m_dataPort.write();
+        return;
+    }
+
+    // the frame is dropped if the buffer is full
+    double* frame = m_ringBuffer.beginWrite();
+    if(frame == nullptr)
+        return;
+
+    frame[0] = sequenceNumber;
+    frame[1] = yarp::os::Time::now();
+    copyToFrame(frame + 2, args...);
+    m_ringBuffer.endWrite();
 }
@@ -0,0 +1,164 @@
+/**
+ * @file WalkingMicroBenchmark.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef WALKING_MICRO_BENCHMARK_HPP
+#define WALKING_MICRO_BENCHMARK_HPP
+
+// std
+#include <string>
+#include <vector>
+
+// YARP
+#include <yarp/os/ResourceFinder.h>
+
+// iDynTree
+#include <iDynTree/Core/MatrixDynSize.h>
+#include <iDynTree/Core/Transform.h>
+#include <iDynTree/Core/VectorDynSize.h>
+#include <iDynTree/Core/VectorFixSize.h>
+#include <iDynTree/ModelIO/ModelLoader.h>
+
+#include "WalkingForwardKinematics.hpp"
+#include "TimeProfiler.hpp"
+
+/**
+ * Result of a micro-benchmark.
+ */
+struct MicroBenchmarkResult
+{
+    std::string name; /**< Name of the benchmarked component. */
+    std::string parameter; /**< Parameter of the benchmark (e.g. the horizon of the MPC). */
+    unsigned int iterations; /**< Number of measured iterations. */
+    TimerStatistics statistics; /**< Statistics of the duration [ms]. */
+};
+
+/**
+ * WalkingMicroBenchmark measures the computational time of the single components of the
+ * controller (MPC, QP-IK, IK, FK and convex hull) on fixed inputs evaluated in the regularization
+ * configuration of the IK. The results are reported in CSV format.
+ */
+class WalkingMicroBenchmark
+{
+    unsigned int m_iterations; /**< Number of measured iterations of each benchmark. */
+    unsigned int m_warmUpIterations; /**< Number of iterations executed before the measure. */
+    std::string m_robot; /**< Name of the robot (YARP_ROBOT_NAME). */
+    std::string m_tag; /**< Tag of the results (e.g. the release). */
+    std::vector<std::string> m_suite; /**< Names of the components that are benchmarked. */
+
+    std::vector<std::string> m_axesList; /**< Vector containing the name of the controlled joints. */
+    int m_actuatedDOFs; /**< Number of the actuated DoFs. */
+    iDynTree::ModelLoader m_loader; /**< Model loader class. */
+    WalkingFK m_FKSolver; /**< Forward kinematics solver. */
+
+    iDynTree::VectorDynSize m_jointPosition; /**< Joint position used as input [rad]. */
+    iDynTree::VectorDynSize m_jointVelocity; /**< Joint velocity used as input [rad/s]. */
+    iDynTree::Transform m_leftFoot; /**< Transformation between the left foot and the world frame. */
+    iDynTree::Transform m_rightFoot; /**< Transformation between the right foot and the world frame. */
+    iDynTree::Rotation m_neckOrientation; /**< Orientation of the neck. */
+    iDynTree::Position m_com; /**< Position of the CoM. */
+    iDynTree::MatrixDynSize m_leftFootJacobian; /**< Jacobian of the left foot. */
+    iDynTree::MatrixDynSize m_rightFootJacobian; /**< Jacobian of the right foot. */
+    iDynTree::MatrixDynSize m_neckJacobian; /**< Jacobian of the neck. */
+    iDynTree::MatrixDynSize m_comJacobian; /**< Jacobian of the CoM. */
+
+    std::vector<MicroBenchmarkResult> m_results; /**< Results of the benchmarks. */
+
+    /**
+     * Set the list of the controlled joints and load the model.
+     * @param rf is the reference to a resource finder object.
+     * @return true/false in case of success/failure.
+     */
+    bool setRobotModel(const yarp::os::Searchable& rf);
+
+    /**
+     * Evaluate the inputs of the benchmarks (feet transforms, CoM and jacobians) in the
+     * regularization configuration of the IK.
+     * @param rf is the reference to a resource finder object.
+     * @return true/false in case of success/failure.
+     */
+    bool evaluateInputs(yarp::os::ResourceFinder& rf);
+
+    /**
+     * Get the deterministic perturbation applied to the references at a given iteration. It
+     * prevents the warm started solvers from solving exactly the same problem at every iteration.
+     * @param iteration index of the iteration.
+     * @return the perturbation [m].
+     */
+    iDynTree::Vector2 perturbation(unsigned int iteration) const;
+
+    /**
+     * Measure a component. The setup is executed at every iteration before the timed function.
+     * @param name name of the component;
+     * @param parameter parameter of the benchmark;
+     * @param setup function that prepares the inputs (it is not timed);
+     * @param function timed function.
+     * @return true/false in case of success/failure.
+     */
+    template <typename Setup, typename Function>
+    bool measure(const std::string& name, const std::string& parameter,
+                 Setup setup, Function function);
+
+    /**
+     * Benchmark the MPC controller (solve()) for the horizons listed in microbench_horizons.
+     * @param rf is the reference to a resource finder object.
+     * @return true/false in case of success/failure.
+     */
+    bool benchmarkMPC(yarp::os::ResourceFinder& rf);
+
+    /**
+     * Benchmark the QP-IK solvers (osqp and qpOASES) on the same inputs.
+     * @param rf is the reference to a resource finder object.
+     * @return true/false in case of success/failure.
+     */
+    bool benchmarkQPIK(yarp::os::ResourceFinder& rf);
+
+    /**
+     * Benchmark WalkingIK::computeIK().
+     * @param rf is the reference to a resource finder object.
+     * @return true/false in case of success/failure.
+     */
+    bool benchmarkIK(yarp::os::ResourceFinder& rf);
+
+    /**
+     * Benchmark WalkingFK::setInternalRobotState() and the jacobian getters.
+     * @return true/false in case of success/failure.
+     */
+    bool benchmarkFK();
+
+    /**
+     * Benchmark the evaluation of the convex hull. The feet status changes at every iteration
+     * so that the convex hull is always rebuilt.
+     * @param rf is the reference to a resource finder object.
+     * @return true/false in case of success/failure.
+     */
+    bool benchmarkConvexHull(yarp::os::ResourceFinder& rf);
+
+public:
+
+    /**
+     * Configure the benchmark. The same configuration of the WalkingModule is used.
+     * @param rf is the reference to a resource finder object.
+     * @return true/false in case of success/failure.
+     */
+    bool configure(yarp::os::ResourceFinder& rf);
+
+    /**
+     * Run the benchmarks.
+     * @param rf is the reference to a resource finder object.
+     * @return true/false in case of success/failure.
+     */
+    bool run(yarp::os::ResourceFinder& rf);
+
+    /**
+     * Get the results in CSV format (one row for each benchmark).
+     * @return the report.
+     */
+    std::string getReport() const;
+};
+
+#endif
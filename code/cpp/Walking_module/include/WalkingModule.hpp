@@ -10,8 +10,10 @@
 #define WALKING_MODULE_HPP
 
 // std
+#include <array>
+#include <atomic>
 #include <memory>
-#include <deque>
+#include <mutex>
 
 // YARP
 #include <yarp/os/RFModule.h>
@@ -23,9 +25,11 @@
 #include <yarp/dev/IPositionDirect.h>
 #include <yarp/dev/PolyDriver.h>
 #include <yarp/os/RpcClient.h>
+#include <yarp/os/BufferedPort.h>
 
 // iDynTree
 #include <iDynTree/Core/VectorFixSize.h>
+#include <iDynTree/Core/MatrixDynSize.h>
 #include <iDynTree/ModelIO/ModelLoader.h>
 
 #include "TrajectoryGenerator.hpp"
@@ -40,15 +44,37 @@
 #include "WalkingPIDHandler.hpp"
 #include "WalkingLogger.hpp"
 #include "TimeProfiler.hpp"
+#include "TrajectoryBuffer.hpp"
+#include "SensorAcquisition.hpp"
+#include "LookAheadIK.hpp"
+#include "RealTimeThread.hpp"
+#include "SPSCQueue.hpp"
+#include "DCMControllerSupervisor.hpp"
+#include "SolverStatisticsPublisher.hpp"
+#include "FilterBank.hpp"
+#include "QPIKRace.hpp"
+#include "StreamedGoal.hpp"
+#include "BenchmarkPlant.hpp"
 
 // iCub-ctrl
-#include <iCub/ctrl/filters.h>
 #include <iCub/ctrl/minJerkCtrl.h>
 
 #include "thrifts/WalkingCommands.h"
 
 enum class WalkingFSM {Idle, Configured, Prepared, Walking, OnTheFly, Stance};
 
+enum class WalkingCommandType {StartWalking, SetGoal};
+
+/**
+ * Command posted by the RPC handlers and applied by the control loop.
+ */
+struct WalkingCommand
+{
+    WalkingCommandType type{WalkingCommandType::SetGoal}; /**< Type of the command. */
+    double x{0}; /**< Desired x position (used only by SetGoal). */
+    double y{0}; /**< Desired y position (used only by SetGoal). */
+};
+
 /**
  * RFModule of the 2D-DCM dynamics model.
  */
@@ -56,30 +82,43 @@ class WalkingModule:
     public yarp::os::RFModule,
     public WalkingCommands
 {
+    // the benchmark runs the ticks of the controller with a plant
+    friend class WalkingBenchmark;
+
     double m_dT; /**< RFModule period. */
     double m_time; /**< Current time. */
     std::string m_robot; /**< Robot name. */
 
-    WalkingFSM m_robotState{WalkingFSM::Idle}; /**< State  of the WalkingFSM. */
+    std::atomic<WalkingFSM> m_robotState{WalkingFSM::Idle}; /**< State  of the WalkingFSM (it is read by
+                                                               the RPC handlers). */
 
     bool m_firstStep; /**< True if this is the first step. */
     bool m_useMPC; /**< True if the MPC controller is used. */
     bool m_useQPIK; /**< True if the QP-IK is used. */
     bool m_useOSQP; /**< True if osqp is used to QP-IK problem. */
-    bool m_dumpData; /**< True if data are saved. */
+    bool m_dumpData{false}; /**< True if data are saved. */
+    bool m_useSolversWarmUp; /**< True if the solvers are warmed up while the robot is prepared. */
+    bool m_compareMPCFormulations; /**< True if the other MPC formulation is evaluated alongside the used one (only for profiling). */
+    std::string m_comparisonTimerName; /**< Name of the timer associated to the comparison MPC controller. */
 
     std::unique_ptr<TrajectoryGenerator> m_trajectoryGenerator; /**< Pointer to the trajectory generator object. */
     std::unique_ptr<WalkingController> m_walkingController; /**< Pointer to the walking DCM MPC object. */
+    std::unique_ptr<WalkingController> m_walkingControllerComparison; /**< Pointer to the walking DCM MPC object used only to compare the formulations. */
     std::unique_ptr<WalkingDCMReactiveController> m_walkingDCMReactiveController; /**< Pointer to the walking DCM reactive controller object. */
+    std::unique_ptr<DCMControllerSupervisor> m_controllerSupervisor; /**< Fallback from the MPC to the reactive controller (nullptr if not used). */
+    bool m_isMPCReferenceResetPending{false}; /**< True if the MPC was not solved in a tick, the reference has to be set again in the next solve. */
     std::unique_ptr<WalkingZMPController> m_walkingZMPController; /**< Pointer to the walking ZMP controller object. */
     std::unique_ptr<WalkingIK> m_IKSolver; /**< Pointer to the inverse kinematics solver. */
     std::unique_ptr<WalkingQPIK_osqp> m_QPIKSolver_osqp; /**< Pointer to the inverse kinematics solver (osqp). */
     std::unique_ptr<WalkingQPIK_qpOASES> m_QPIKSolver_qpOASES; /**< Pointer to the inverse kinematics solver (qpOASES). */
     std::unique_ptr<WalkingFK> m_FKSolver; /**< Pointer to the forward kinematics solver. */
+    std::unique_ptr<WalkingFK> m_warmUpFKSolver; /**< Forward kinematics solver used only by the warm-up of the QP-IK (nullptr if not used). */
     std::unique_ptr<StableDCMModel> m_stableDCMModel; /**< Pointer to the stable DCM dynamics. */
     std::unique_ptr<WalkingPIDHandler> m_PIDHandler; /**< Pointer to the PID handler object. */
     std::unique_ptr<WalkingLogger> m_walkingLogger; /**< Pointer to the Walking Logger object. */
     std::unique_ptr<TimeProfiler> m_profiler; /**< Time profiler. */
+    std::unique_ptr<SolverStatisticsPublisher> m_solverStatisticsPublisher; /**< Publisher of the solver statistics (nullptr if not used). */
+    SolverStatistics m_solverStatistics; /**< Statistics of the solvers collected in the current tick. */
 
     // related to the onTheFly feature
     std::unique_ptr<iCub::ctrl::minJerkTrajGen> m_jointsSmoother; /**< Minimum jerk trajectory for the joint during the
@@ -98,23 +137,11 @@ class WalkingModule:
     double m_desiredJointsWeight; /**< Desired joint weight matrix. */
     yarp::sig::Vector m_desiredJointInRadYarp; /**< Desired joint position (regularization task). */
 
-    std::deque<iDynTree::Transform> m_leftTrajectory; /**< Deque containing the trajectory of the left foot. */
-    std::deque<iDynTree::Transform> m_rightTrajectory; /**< Deque containing the trajectory of the right foot. */
+    TrajectoryBuffer m_trajectory; /**< Desired trajectories (feet, DCM, CoM height, contacts and merge points). */
+    std::unique_ptr<PlannedTrajectory> m_plannedTrajectory; /**< Trajectory evaluated by the planner (it is merged into m_trajectory). */
 
-    std::deque<iDynTree::Twist> m_leftTwistTrajectory; /**< Deque containing the twist trajectory of the left foot. */
-    std::deque<iDynTree::Twist> m_rightTwistTrajectory; /**< Deque containing the twist trajectory of the right foot. */
-
-    std::deque<iDynTree::Vector2> m_DCMPositionDesired; /**< Deque containing the desired DCM position. */
-    std::deque<iDynTree::Vector2> m_DCMVelocityDesired; /**< Deque containing the desired DCM velocity. */
-    std::deque<bool> m_leftInContact; /**< Deque containing the left foot state. */
-    std::deque<bool> m_rightInContact; /**< Deque containing the right foot state. */
-    std::deque<double> m_comHeightTrajectory; /**< Deque containing the CoM height trajectory. */
-    std::deque<double> m_comHeightVelocity; /**< Deque containing the CoM height velocity. */
-    std::deque<size_t> m_mergePoints; /**< Deque containing the time position of the merge points. */
-
-    std::deque<bool> m_isLeftFixedFrame; /**< Deque containing when the main frame of the left foot is the fixed frame
-                                            In general a main frame of a foot is the fix frame only during the
-                                            stance and the switch out phases. */
+    std::unique_ptr<BenchmarkPlant> m_plant; /**< Plant controlled instead of the robot (nullptr if the
+                                                robot is controlled, see configureWithPlant()). */
 
     yarp::dev::PolyDriver m_robotDevice; /**< Main robot device. */
     std::vector<std::string> m_axesList; /**< Vector containing the name of the controlled joints. */
@@ -144,10 +171,25 @@ class WalkingModule:
     iDynTree::VectorDynSize m_minJointsLimit; /**< Vector containing the max negative limits [rad/s]. */
     iDynTree::VectorDynSize m_maxJointsLimit; /**< Vector containing the max positive limits [rad/s]. */
 
-    // yarp::sig::Vector m_positionFeedbackInDegreesFiltered;
-    yarp::sig::Vector m_velocityFeedbackInDegreesFiltered; /**< Vector containing the filtered joint velocity [deg/s]. */
-    std::unique_ptr<iCub::ctrl::FirstOrderLowPassFilter> m_positionFilter; /**< Joint position low pass filter .*/
-    std::unique_ptr<iCub::ctrl::FirstOrderLowPassFilter> m_velocityFilter; /**< Joint velocity low pass filter .*/
+    // buffers of the control loop. They are allocated in configure(), so the loop does not allocate
+    yarp::sig::Vector m_bufferVelocity; /**< Joint velocity integrated in the QP-IK branch [rad/s]. */
+    yarp::sig::Vector m_previousBufferVelocity; /**< Joint velocity integrated in the previous tick [rad/s]. The
+                                                   QP-IK output is integrated in m_qDesired with the trapezoidal
+                                                   rule (as iCub::ctrl::Integrator but in place). */
+    yarp::sig::Vector m_scalarBuffer; /**< One element vector used as input of the onTheFly smoothers. */
+    iDynTree::VectorDynSize m_desiredJointInRad; /**< Desired joint position during the onTheFly procedure [rad]. */
+    iDynTree::MatrixDynSize m_feetJacobianBuffer; /**< Jacobian of the feet and of the neck used by the QP-IK. */
+    iDynTree::MatrixDynSize m_comJacobianBuffer; /**< Jacobian of the CoM used by the QP-IK. */
+    iDynTree::VectorDynSize m_leftFootError; /**< Error of the left foot evaluated by the QP-IK. */
+    iDynTree::VectorDynSize m_rightFootError; /**< Error of the right foot evaluated by the QP-IK. */
+
+    FilterBank m_feedbackFilters; /**< Unit conversion and low pass filters of the joint and wrench feedbacks. */
+    int m_jointPositionGroup; /**< Group of the joint position in the filter bank [deg -> rad]. */
+    int m_jointVelocityGroup; /**< Group of the joint velocity in the filter bank [deg/s -> rad/s]. */
+    int m_leftForceGroup; /**< Group of the left foot force in the filter bank. */
+    int m_leftTorqueGroup; /**< Group of the left foot torque in the filter bank. */
+    int m_rightForceGroup; /**< Group of the right foot force in the filter bank. */
+    int m_rightTorqueGroup; /**< Group of the right foot torque in the filter bank. */
     bool m_useVelocityFilter; /**< True if the joint velocity filter is used. */
 
     iDynTree::Rotation m_inertial_R_worldFrame; /**< Rotation between the inertial and the world frame. */
@@ -156,25 +198,72 @@ class WalkingModule:
     yarp::os::BufferedPort<yarp::sig::Vector> m_rightWrenchPort; /**< Right foot wrench port. */
     yarp::sig::Vector m_leftWrenchInput; /**< YARP vector that contains left foot wrench. */
     yarp::sig::Vector m_rightWrenchInput; /**< YARP vector that contains right foot wrench. */
-    yarp::sig::Vector m_leftWrenchInputFiltered; /**< YARP vector that contains left foot filtered wrench. */
-    yarp::sig::Vector m_rightWrenchInputFiltered; /**< YARP vector that contains right foot filtered wrench. */
     iDynTree::Wrench m_leftWrench; /**< iDynTree vector that contains left foot wrench. */
     iDynTree::Wrench m_rightWrench; /**< iDynTree vector that contains right foot wrench. */
-    std::unique_ptr<iCub::ctrl::FirstOrderLowPassFilter> m_leftWrenchFilter; /**< Left wrench low pass filter.*/
-    std::unique_ptr<iCub::ctrl::FirstOrderLowPassFilter> m_rightWrenchFilter; /**< Right wrench low pass filter.*/
     bool m_useWrenchFilter; /**< True if the wrench filter is used. */
 
+    std::unique_ptr<SensorAcquisition> m_sensorAcquisition; /**< Sensor acquisition thread (if nullptr the
+                                                               sensors are read by the control loop). */
+    double m_maxFeedbackDelay; /**< Maximum age of the sensor readings [s]. */
+    double m_maxFeedbackMisalignment; /**< Maximum time difference between the encoders and the wrenches [s]. */
+    bool m_isFeedbackMisaligned{false}; /**< True if the last encoders and wrenches are misaligned. */
+    double m_maxFeedbackWaitTime; /**< Maximum time spent by the control loop waiting for the sensor readings [s]. */
+    int m_maxStaleFeedbacks; /**< Maximum number of consecutive ticks that use the last valid feedback. */
+    int m_staleFeedbacks{0}; /**< Number of consecutive ticks that used the last valid feedback. */
+    bool m_isFeedbackValid{false}; /**< True if a valid feedback was received at least once. */
+
+    std::unique_ptr<LookAheadIK> m_lookAheadIK; /**< Look-ahead IK thread (if nullptr the QP-IK is
+                                                   regularized with a constant posture). */
+    iDynTree::VectorDynSize m_lookAheadPosture; /**< Last posture evaluated by the look-ahead thread
+                                                   (it is held when a posture is not available). */
+    bool m_isLookAheadPostureValid{false}; /**< True if at least a posture was evaluated by the
+                                              look-ahead thread since the robot started walking. */
+    iDynTree::VectorDynSize m_QPIKRegularizationTerm; /**< Posture used before the first look-ahead
+                                                         one is available. */
+
+    /**
+     * QP-IK race. The problem is solved with osqp and qpOASES at the same time and the first
+     * solution found is used (see QPIKRace).
+     */
+    std::unique_ptr<QPIKRace> m_QPIKRace; /**< QP-IK race (nullptr if only one solver is used). */
+    std::array<bool, QPIKRace::NumberOfSolvers> m_isQPIKSolverIdle; /**< Solvers that can be used in the current tick. */
+    int m_QPIKRaceWinner{-1}; /**< Winner of the last race (-1 if there is no winner). */
+    int m_QPIKRaceMaxConsecutiveFallbacks; /**< Maximum number of consecutive races without winner. */
+    int m_QPIKRaceConsecutiveFallbacks{0}; /**< Number of consecutive races without winner. */
+    Eigen::VectorXd m_QPIKPrimalVariable; /**< Solution of the winner used to warm start the other solver. */
+
+    std::unique_ptr<RealTimeThread> m_realTimeThread; /**< Real-time thread of the control loop (if
+                                                         nullptr the loop is run by the RFModule). */
+
     yarp::os::Port m_rpcPort; /**< Remote Procedure Call port. */
+    bool m_useGoalPort{false}; /**< True if the goal streamed on m_goalPort is used. */
+    yarp::os::BufferedPort<yarp::sig::Vector> m_goalPort; /**< Port that receives the goal streamed by the joypad. */
+    StreamedGoal m_streamedGoal; /**< Latest streamed goal waiting to be applied. */
 
     bool m_newTrajectoryRequired; /**< if true a new trajectory will be merged soon. (after m_newTrajectoryMergeCounter - 2 cycles). */
     size_t m_newTrajectoryMergeCounter; /**< The new trajectory will be merged after m_newTrajectoryMergeCounter - 2 cycles. */
+    size_t m_newTrajectoryRequestCounter{20}; /**< The new trajectory is asked when m_newTrajectoryMergeCounter
+                                                 is lower or equal than this value. */
+    bool m_isNewTrajectoryAsked{false}; /**< True if the new trajectory is already asked to the planner. */
+    bool m_useAdaptiveMergeLead; /**< If true the request lead time depends on the planner latency. */
+    double m_plannerLatencyPercentile; /**< Percentile of the planner latency used to evaluate the lead time. */
+    size_t m_mergeLeadMargin; /**< Number of samples added to the planner latency. */
+    size_t m_minMergeLead; /**< Minimum number of samples between the request and the merge point. */
+    size_t m_maxMergeLead; /**< Maximum number of samples between the request and the merge point. */
+    bool m_isSpeculativeTrajectoryAdopted{false}; /**< True if the trajectory that will be merged is
+                                                     a candidate of the speculative planners (it is
+                                                     already stored in m_plannedTrajectory). */
+    double m_speculativeInitTime{-1.0}; /**< Time of the merge point of the last speculative request. */
 
     std::mutex m_mutex; /**< Mutex. */
 
-    iDynTree::Vector2 m_desiredPosition;
+    SPSCQueue<WalkingCommand, 16> m_commands; /**< Commands posted by the RPC handlers. */
+    std::mutex m_commandsMutex; /**< Serializes the RPC handlers that post a command (the control
+                                   loop never takes it). */
+    std::atomic<bool> m_isStartWalkingPending{false}; /**< True if the start walking command is posted
+                                                         but not applied yet. */
 
-    // debug
-    std::unique_ptr<iCub::ctrl::Integrator> m_velocityIntegral{nullptr};
+    iDynTree::Vector2 m_desiredPosition;
 
     /**
      * Configure the Force torque sensors. The FT ports are only opened please use yarpamanger
@@ -191,6 +280,79 @@ class WalkingModule:
      */
     bool configureRobot(const yarp::os::Searchable& config);
 
+    /**
+     * Configure the components of the controller (filters, planner, DCM and ZMP controllers,
+     * inverse and forward kinematics and profiler). The robot is not used, so the same
+     * components are configured when a plant is controlled.
+     * @param config is the reference to a resource finder object.
+     * @return true in case of success and false otherwise.
+     */
+    bool configureController(const yarp::os::Searchable& config);
+
+    /**
+     * Configure and start the real-time thread of the control loop. The worker threads are
+     * pinned to the cores listed in worker_cores.
+     * @param config is the reference to a resource finder object.
+     * @return true in case of success and false otherwise.
+     */
+    bool configureRealTimeThread(const yarp::os::Searchable& config);
+
+    /**
+     * Run one step of the control loop. It is called by updateModule or by the real-time thread.
+     * @return true in case of success and false otherwise.
+     */
+    bool updateController();
+
+    /**
+     * Evaluate the references of the current tick (planner, feedbacks, DCM and ZMP controllers
+     * and inverse kinematics) and send them to the robot (or to the plant). The time and the
+     * trajectories are not propagated, so the samples used by the tick can be read until
+     * propagate() is called.
+     * @return true in case of success and false otherwise.
+     */
+    bool tick();
+
+    /**
+     * Propagate the time and the trajectories at the end of the tick (the onTheFly procedure
+     * ends here).
+     * @return true in case of success and false otherwise.
+     */
+    bool propagate();
+
+    /**
+     * Post a command that will be applied at the beginning of the next tick.
+     * @param command command.
+     * @return false if too many commands are pending.
+     */
+    bool postCommand(const WalkingCommand& command);
+
+    /**
+     * Apply all the commands posted by the RPC handlers.
+     */
+    void processCommands();
+
+    /**
+     * Apply the last goal received on the goal port (if any). The port is not blocking and a
+     * deferred goal is retried at the next tick.
+     */
+    void processStreamedGoal();
+
+    /**
+     * Start walking (it is called by the control loop).
+     * @return true in case of success and false otherwise.
+     */
+    bool applyStartWalking();
+
+    /**
+     * Set the desired final position of the CoM (it is called by the control loop).
+     * @param x desired x position of the CoM;
+     * @param y desired y position of the CoM;
+     * @param isApplied false if the goal is deferred (e.g. the planner is evaluating the previous
+     * goal) true otherwise.
+     * @return true in case of success and false otherwise.
+     */
+    bool applyGoal(double x, double y, bool& isApplied);
+
     /**
      * Get the name of the controlled joints from the resource finder
      * and set its.
@@ -218,10 +380,30 @@ class WalkingModule:
     bool propagateReferenceSignals();
 
     /**
-     * Get all the feedback signal from the interfaces
+     * Get all the feedback signal from the interfaces. The readings that fail are retried
+     * every millisecond until maxWaitTime is elapsed.
+     * @param maxWaitTime maximum time spent waiting for the readings [s].
      * @return true in case of success and false otherwise.
      */
-    bool getFeedbacks(unsigned int maxAttempts = 1);
+    bool getFeedbacks(double maxWaitTime = 0);
+
+    /**
+     * Get the feedback in the control loop. The wait is bounded by the time budget of the
+     * tick, if the readings are not available the last valid feedback is used for at most
+     * max_stale_feedbacks consecutive ticks.
+     * @param tickInitTime time at which the current tick started.
+     * @return true in case of success and false otherwise.
+     */
+    bool getControlLoopFeedbacks(const std::chrono::steady_clock::time_point& tickInitTime);
+
+    /**
+     * Copy the last snapshot of the acquisition thread. The readings older than
+     * m_maxFeedbackDelay are discarded.
+     * @param okEncoders true if the position and the velocity of the joints are valid;
+     * @param okLeftWrench true if the left foot wrench is valid;
+     * @param okRightWrench true if the right foot wrench is valid.
+     */
+    void readSensorSnapshot(bool& okEncoders, bool& okLeftWrench, bool& okRightWrench);
 
     /**
      * Get the higher position error among all joints.
@@ -276,6 +458,41 @@ class WalkingModule:
      * @param solver is the pointer to the solver (osqp or qpOASES)
      * @param desiredCoMPosition desired CoM position;
      * @param desiredCoMVelocity desired CoM velocity;
+     * @param desiredNeckOrientation desired neck orientation (rotation matrix).
+     * @return true in case of success and false otherwise.
+     */
+    bool setQPIKProblem(auto& solver, const iDynTree::Position& desiredCoMPosition,
+                        const iDynTree::Vector3& desiredCoMVelocity,
+                        const iDynTree::Position& actualCoMPosition,
+                        const iDynTree::Rotation& desiredNeckOrientation);
+
+    /**
+     * Set the QP-IK problem using the state of a given kinematics instead of the one of the
+     * controller (m_FKSolver and m_positionFeedbackInRadians).
+     * @param solver is the pointer to the solver (osqp or qpOASES)
+     * @param kinematics forward kinematics solver containing the desired state of the robot;
+     * @param jointPositions joint positions used as state of the QP-IK [rad];
+     * @param feetJacobianBuffer buffer of the jacobians of the feet and of the neck;
+     * @param comJacobianBuffer buffer of the jacobian of the CoM;
+     * @param desiredCoMPosition desired CoM position;
+     * @param desiredCoMVelocity desired CoM velocity;
+     * @param desiredNeckOrientation desired neck orientation (rotation matrix).
+     * @return true in case of success and false otherwise.
+     */
+    bool setQPIKProblem(auto& solver, WalkingFK& kinematics,
+                        const iDynTree::VectorDynSize& jointPositions,
+                        iDynTree::MatrixDynSize& feetJacobianBuffer,
+                        iDynTree::MatrixDynSize& comJacobianBuffer,
+                        const iDynTree::Position& desiredCoMPosition,
+                        const iDynTree::Vector3& desiredCoMVelocity,
+                        const iDynTree::Position& actualCoMPosition,
+                        const iDynTree::Rotation& desiredNeckOrientation);
+
+    /**
+     * Set and solve the QP-IK problem.
+     * @param solver is the pointer to the solver (osqp or qpOASES)
+     * @param desiredCoMPosition desired CoM position;
+     * @param desiredCoMVelocity desired CoM velocity;
      * @param desiredNeckOrientation desired neck orientation (rotation matrix);
      * @param output is the output of the solver (i.e. the desired joint velocity)
      * @return true in case of success and false otherwise.
@@ -285,6 +502,40 @@ class WalkingModule:
                    const iDynTree::Position& actualCoMPosition,
                    const iDynTree::Rotation& desiredNeckOrientation,
                    iDynTree::VectorDynSize &output);
+
+    /**
+     * Solve the QP-IK problem with the race of osqp and qpOASES. The solution of the winner is
+     * stored in m_bufferVelocity and it is used to warm start the other solver. If there is no
+     * winner the previous joint velocity is kept.
+     * @param desiredCoMPosition desired CoM position;
+     * @param desiredCoMVelocity desired CoM velocity;
+     * @param desiredNeckOrientation desired neck orientation (rotation matrix).
+     * @return true in case of success and false otherwise.
+     */
+    bool solveQPIKRace(const iDynTree::Position& desiredCoMPosition,
+                       const iDynTree::Vector3& desiredCoMVelocity,
+                       const iDynTree::Position& actualCoMPosition,
+                       const iDynTree::Rotation& desiredNeckOrientation);
+
+    /**
+     * Configure the race of the QP-IK solvers.
+     * @param config yarp searchable configuration variable.
+     * @return true in case of success and false otherwise.
+     */
+    bool configureQPIKRace(const yarp::os::Searchable& config);
+
+    /**
+     * Solve the MPC and the QP-IK problems once on the expected initial state, i.e. the robot
+     * is in the initial posture (m_qDesired) and the DCM is on its desired trajectory. The
+     * solutions are discarded, only the solvers are affected (factorization and warm start).
+     * It runs alongside setPositionReferences, so the state of the QP-IK is evaluated with
+     * m_warmUpFKSolver and local buffers: the feedback and the kinematics of the controller are
+     * not used. The controllers and the QP-IK solvers are used only by this function until it
+     * returns.
+     * @param desiredCoMPosition CoM position in the initial posture.
+     * @return true in case of success and false otherwise.
+     */
+    bool warmUpSolvers(const iDynTree::Position& desiredCoMPosition);
     /**
      * Evaluate the position of CoM.
      * @param comPosition position of the center of mass;
@@ -300,6 +551,15 @@ class WalkingModule:
      */
     bool evaluateDCM(iDynTree::Vector2& dcm);
 
+    /**
+     * Evaluate the output of the MPC.
+     * @param measuredDCM measured DCM;
+     * @param resetTrajectory true if the reference trajectory is changed;
+     * @param desiredZMP output of the MPC.
+     * @return true/false in case of success/failure.
+     */
+    bool solveMPC(const iDynTree::Vector2& measuredDCM, bool resetTrajectory, iDynTree::Vector2& desiredZMP);
+
     /**
      * Evaluate the position of Zero momentum point.
      * @param zmp zero momentum point.
@@ -343,6 +603,27 @@ class WalkingModule:
      */
     bool updateTrajectories(const size_t& mergePoint);
 
+    /**
+     * Ask the speculative planners to evaluate the candidate trajectories for the next merge
+     * point. The request is sent only once for each merge point.
+     * @return true/false in case of success/failure.
+     */
+    bool askSpeculativeTrajectories();
+
+    /**
+     * Evaluate the number of samples between the request of a new trajectory and the merge point.
+     * If the adaptive lead time is used it depends on the last computation times of the planner,
+     * otherwise it is equal to 20.
+     * @return the number of samples.
+     */
+    size_t evaluateMergeLead();
+
+    /**
+     * Keep the current trajectory and attach the new one to the next merge point (the request is
+     * sent again).
+     */
+    void postponeNewTrajectory();
+
 public:
 
     /**
@@ -364,6 +645,15 @@ public:
      */
     bool configure(yarp::os::ResourceFinder& rf) override;
 
+    /**
+     * Configure the module to control a BenchmarkPlant instead of the robot. The robot device
+     * and the ports are not opened and the joint velocity limits are equal to
+     * benchmark_max_joint_velocity.
+     * @param rf is the reference to a resource finder (or property) object.
+     * @return true in case of success and false otherwise.
+     */
+    bool configureWithPlant(const yarp::os::Searchable& rf);
+
     /**
      * Close the RFModule.
      * @return true in case of success and false otherwise.
@@ -383,17 +673,24 @@ public:
     virtual bool prepareRobot(bool onTheFly = false);
 
     /**
-     * Start walking.
+     * Start walking. The command is applied by the control loop at the beginning of the next tick.
      * @return true in case of success and false otherwise.
      */
     virtual bool startWalking();
 
     /**
-     * set the desired final position of the CoM.
+     * set the desired final position of the CoM. The command is applied by the control loop at
+     * the beginning of the next tick.
      * @param x desired x position of the CoM;
      * @param y desired y position of the CoM.
      * @return true in case of success and false otherwise.
      */
     virtual bool setGoal(double x, double y);
+
+    /**
+     * Get the statistics of the timers evaluated over the last profiling window.
+     * @return the description of the statistics.
+     */
+    virtual std::string getProfilingInfo();
 };
 #endif
@@ -18,13 +18,15 @@
 #include <map>
 #include <string>
 #include <vector>
-#include <deque>
 #include <yarp/dev/ControlBoardPid.h>
 #include <yarp/os/Bottle.h>
 #include <mutex>
+#include <atomic>
 #include <thread>
 #include <condition_variable>
 
+#include "TrajectoryView.hpp"
+
 namespace yarp{
     namespace os{
         class Searchable;
@@ -51,6 +53,11 @@ enum class PIDPhase {
         Switch
         };
 
+struct PIDPhaseTransition {
+    size_t sample; //sample (with respect to the one in which the timeline is computed) where the phase starts
+    PIDPhase phase;
+};
+
 class PIDSchedulingObject {
     std::string m_name;
     PIDmap m_desiredPIDs;
@@ -69,7 +76,9 @@ public:
 
     const PIDmap& getDesiredGains();
 
-    bool computeInitTime(double time, const std::vector<PIDPhase> &phases, double currentPhaseInitTime);
+    const PIDPhase& activationPhase() const;
+
+    bool computeInitTime(double time, const PIDPhase &currentPhase, double currentPhaseInitTime, size_t samplesToActivation);
 
     double initTime();
 
@@ -79,18 +88,32 @@ public:
 
 };
 
+struct PIDControlBoard {
+    std::unique_ptr<yarp::dev::PolyDriver> driver; //remote_controlboard of a part of the robot
+    yarp::dev::IPidControl *pidInterface;
+    std::vector<std::vector<yarp::dev::Pid>> groupGains; //gains of all the axes of the board, the first element refers to the DEFAULT group
+    std::vector<std::vector<std::vector<int>>> changedAxes; //axes of the board whose gains change when passing from a group to another
+};
+
 class WalkingPIDHandler {
 
-    bool m_useGainScheduling;
+    std::atomic<bool> m_useGainScheduling;
     AxisMap m_axisMap;
     PIDmap m_originalPID;
     PIDmap m_defaultPID;
+    std::vector<std::vector<yarp::dev::Pid>> m_groupGains; //gains of all the axes, the first element refers to the DEFAULT group
+    std::vector<PIDControlBoard> m_controlBoards; //the gains are sent to each control board, so only the changed ones are set
     yarp::dev::IPidControl *m_pidInterface;
     yarp::dev::IAxisInfo *m_axisInfo;
     yarp::dev::IEncodersTimed *m_encodersInterface;
     yarp::dev::IRemoteVariables *m_remoteVariables;
     std::vector<PIDSchedulingObject> m_PIDs;
-    std::vector<PIDPhase> m_phases;
+    std::vector<PIDPhaseTransition> m_timeline; //computed only when the trajectory changes
+    std::vector<size_t> m_nextActivation; //for each PID group, index of the next transition to its activation phase
+    std::vector<size_t> m_activePIDs;
+    size_t m_timelineHorizon;
+    size_t m_timelineTick;
+    size_t m_timelineCursor;
     yarp::os::Bottle m_originalSmoothingTimesInMs;
     double m_phaseInitTime;
     PIDPhase m_previousPhase;
@@ -110,9 +133,11 @@ class WalkingPIDHandler {
 
     bool setPID(const PIDmap& pidMap);
 
-    bool setPID(const PIDmap &pidMap, const AxisMap &axisMap, double smoothingTime);
+    bool computeGroupTransitions();
+
+    bool openPIDControlBoards();
 
-    bool setAndRestorePIDs(const PIDmap &newPIDmap, const PIDmap &oldPIDmap, const PIDmap &defaultPIDmap, const AxisMap &axisMap, double smoothingTime);
+    bool setPIDTransition(int currentPIDIndex, int desiredPIDIndex);
 
     bool isPIDElement(const yarp::os::Value &groupElement);
 
@@ -126,7 +151,7 @@ class WalkingPIDHandler {
 
     bool fromStringToPIDPhase(const std::string &input, PIDPhase &output);
 
-    bool guessPhases(const std::deque<bool> &leftIsFixed, const std::deque<bool> &rightIsFixed);
+    bool guessPhase(bool leftIsFixed, bool rightIsFixed, PIDPhase &phase);
 
     void setPIDThread();
 
@@ -147,10 +172,14 @@ public:
 
     bool usingGainScheduling();
 
-    bool updatePhases(const std::deque<bool> &leftIsFixed, const std::deque<bool> &rightIsFixed, double time);
+    bool updateTimeline(const TrajectoryView<bool> &leftIsFixed, const TrajectoryView<bool> &rightIsFixed); //to be called only when the trajectory changes
+
+    bool updatePhases(double time); //to be called once per sample, after updateTimeline
 
     bool reset();
 
+    bool setThreadAffinity(const std::vector<int> &cores); //the thread exists only if the gain scheduling is used
+
 };
 
 #endif // ICUB_WALKINGPIDHANDLER_H
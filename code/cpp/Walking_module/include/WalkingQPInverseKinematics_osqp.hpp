@@ -15,13 +15,18 @@
 // YARP
 #include <yarp/os/Searchable.h>
 
+// eigen
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
 #include <OsqpEigen/OsqpEigen.h>
+#include "QPInverseKinematicsProblem.hpp"
+#include "SolverStatistics.hpp"
 #include "Utils.hpp"
 
 class WalkingQPIK_osqp
 {
     iDynTree::MatrixDynSize m_comJacobian; /**< CoM jacobian (mixed representation). */
-    iDynTree::MatrixDynSize m_neckJacobian; /**< Neck jacobian (mixed representation). */
     iDynTree::MatrixDynSize m_leftFootJacobian; /**< Left foot Jacobian (mixed representation). */
     iDynTree::MatrixDynSize m_rightFootJacobian; /**< Right foot Jacobian (mixed representation). */
 
@@ -46,25 +51,22 @@ class WalkingQPIK_osqp
     int m_numberOfConstraints; /**<Number of constraints in the QP problem (# of joints + 12) */
     std::unique_ptr<OsqpEigen::Solver> m_optimizerSolver; /**< Optimization solver. */
 
-    iDynSparseMatrix m_jointRegulatizationGains;  /**< Gain related to the joint regularization. */
     double m_kPosFoot; /**< Gain related to the desired foot position. */
     double m_kAttFoot; /**< Gain related to the desired foot attitude. */
     double m_kNeck; /**< Gain related to the desired neck attitude. */
     double m_kCom; /**< Gain related to the desired CoM position. */
-    iDynSparseMatrix m_comWeightMatrix; /**< CoM weight matrix. */
-    iDynSparseMatrix m_neckWeightMatrix; /**< Neck weight matrix. */
-    iDynSparseMatrix m_jointRegulatizationHessian; /**< Contains a constant matrix that can be useful
-                                                      in the hessian evaluation ($-\lambda H' H$). */
-    iDynSparseMatrix m_jointRegulatizationGradient; /**< Contains a constant matrix that can be useful
-                                                       in the gradient evaluation ($-\lambda H'$). */
+    std::unique_ptr<QPIKProblemInterface> m_problem; /**< Hessian and gradient of the problem. */
     iDynTree::Triplets m_jointRegularizationLinearConstraintTriplets; /**< Contains a set of triplets
                                                                        useful in during the evaluation
                                                                        of linear Constraint matrix */
     Eigen::VectorXd m_lowerBound; /**< Lower bound vector. */
     Eigen::VectorXd m_upperBound; /**< Upper bound vector. */
     Eigen::VectorXd m_gradient; /**< Gradient vector. */
-    Eigen::MatrixXd m_hessianEigenDense;
-    Eigen::MatrixXd m_constraintsMatrixEigenDense;
+    Eigen::SparseMatrix<double> m_hessianEigen; /**< Upper triangular part of the hessian matrix. Its
+                                                   sparsity pattern is fixed at initialization. */
+    Eigen::SparseMatrix<double> m_constraintsMatrix; /**< Linear constraints matrix. Its sparsity
+                                                        pattern is fixed at initialization. */
+    Eigen::VectorXd m_constrainedOutput; /**< Buffer used to check the constraints. */
 
     int m_actuatedDOFs; /**< Number of actuated actuated DoF. */
 
@@ -79,8 +81,14 @@ class WalkingQPIK_osqp
     bool initializeMatrices(const yarp::os::Searchable& config);
 
     /**
-     * Set the Hessian matrix.
-     * If the optimization problem was already initialized the hessian matrix is updated.
+     * Build the sparsity pattern of the hessian and of the linear constraints matrix.
+     * The pattern never changes so only the values are sent to the solver at each iteration.
+     */
+    void initializeSparsityPattern();
+
+    /**
+     * Evaluate the Hessian matrix.
+     * If the optimization problem is not initialized yet the hessian matrix is also set.
      * @return true/false in case of success/failure.
      */
     bool setHessianMatrix();
@@ -93,12 +101,20 @@ class WalkingQPIK_osqp
     bool setGradientVector();
 
     /**
-     * Set the Linear constraint matrix.
-     * If the optimization problem was already initialized the constraint matrix is updated.
+     * Evaluate the Linear constraint matrix.
+     * If the optimization problem is not initialized yet the constraint matrix is also set.
      * @return true/false in case of success/failure.
      */
     bool setLinearConstraintMatrix();
 
+    /**
+     * Update the values of the hessian and of the linear constraint matrix of an already
+     * initialized problem. The two matrices are updated together so that the KKT system is
+     * factorized only once.
+     * @return true/false in case of success/failure.
+     */
+    bool updateMatrices();
+
     /**
      * Set Lower and upper bounds
      * If the optimization problem was already initialized the bounds are updated.
@@ -226,6 +242,27 @@ public:
      */
     bool solve();
 
+    /**
+     * Get the statistics of the last solve (iterations, residuals and solve time).
+     * @param statistics statistics of the solver.
+     */
+    void getStatistics(QPSolverStatistics& statistics);
+
+    /**
+     * Get the primal variable of the last solution (base twist and joint velocities).
+     * @param primalVariable primal variable.
+     * @return true/false in case of success/failure.
+     */
+    bool getPrimalVariable(Eigen::VectorXd& primalVariable);
+
+    /**
+     * Set the primal variable used to warm start the next solve. It is ignored if the solver
+     * is not initialized yet.
+     * @param primalVariable primal variable (base twist and joint velocities).
+     * @return true/false in case of success/failure.
+     */
+    bool setPrimalVariable(const Eigen::VectorXd& primalVariable);
+
     /**
      * Get the solution of the optimization problem.
      * @param output joint velocity (in rad/s).
@@ -249,9 +286,9 @@ public:
      */
     bool getRightFootError(iDynTree::VectorDynSize& output);
 
-    const Eigen::MatrixXd& getHessianMatrix() const;
+    Eigen::Ref<const Eigen::MatrixXd> getHessianMatrix() const;
 
-    const Eigen::MatrixXd& getConstraintMatrix() const;
+    const Eigen::SparseMatrix<double>& getConstraintMatrix() const;
 
     const Eigen::VectorXd& getUpperBound() const;
 
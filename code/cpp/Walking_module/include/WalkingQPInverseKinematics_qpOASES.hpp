@@ -19,6 +19,8 @@
 #include <iDynTree/KinDynComputations.h>
 #include <qpOASES.hpp>
 
+#include "QPInverseKinematicsProblem.hpp"
+#include "SolverStatistics.hpp"
 #include "Utils.hpp"
 
 class WalkingQPIK_qpOASES
@@ -39,7 +41,6 @@ class WalkingQPIK_qpOASES
     bool m_isFirstTime;
 
     iDynTree::MatrixDynSize m_comJacobian; /**< CoM jacobian (mixed representation). */
-    iDynTree::MatrixDynSize m_neckJacobian; /**< Neck jacobian (mixed representation). */
     iDynTree::MatrixDynSize m_leftFootJacobian; /**< Left foot Jacobian (mixed representation). */
     iDynTree::MatrixDynSize m_rightFootJacobian; /**< Right foot Jacobian (mixed representation). */
 
@@ -64,18 +65,12 @@ class WalkingQPIK_qpOASES
     int m_numberOfVariables; /**<Number of variables in the QP problem (# of joints + 6) */
     int m_numberOfConstraints; /**<Number of constraints in the QP problem (# of joints + 12) */
 
-    iDynSparseMatrix m_jointRegulatizationGains;  /**< Gain related to the joint regularization. */
     double m_kPosFoot; /**< Gain related to the desired foot position. */
     double m_kAttFoot; /**< Gain related to the desired foot attitude. */
     double m_kNeck; /**< Gain related to the desired foot attitude. */
     double m_kCom; /**< Gain related to the desired foot attitude. */
 
-    iDynSparseMatrix m_comWeightMatrix; /**< CoM weight matrix. */
-    iDynSparseMatrix m_neckWeightMatrix; /**< Neck weight matrix. */
-    iDynSparseMatrix m_jointRegulatizationHessian; /**< Contains a constant matrix that can be useful
-                                                      in the hessian evaluation ($- H'\lambdaH$). */
-    iDynSparseMatrix m_jointRegulatizationGradient; /**< Contains a constant matrix that can be useful
-                                                       in the gradient evaluation ($-H' \lambda$). */
+    std::unique_ptr<QPIKProblemInterface> m_problem; /**< Hessian and gradient of the problem. */
 
     int m_actuatedDOFs; /**< Number of actuated actuated DoF. */
 
@@ -83,6 +78,18 @@ class WalkingQPIK_qpOASES
 
     bool m_useCoMAsConstraint; /**< True if the CoM is added as a constraint. */
 
+    int m_maxNumberOfWorkingSetRecalculations; /**< Maximum number of working set recalculations per tick. */
+    double m_maxSolverTime; /**< Time budget of the solver per tick (in seconds). If it is not positive
+                               only the working set recalculations are limited. */
+    int m_maxConsecutiveFallbacks; /**< Maximum number of consecutive ticks in which the last feasible
+                                      solution can be used instead of a new one. */
+    int m_consecutiveFallbacks{0}; /**< Number of consecutive ticks in which the last feasible solution
+                                      has been used. */
+    bool m_isFeasibleSolutionAvailable{false}; /**< True if a feasible solution has been found. */
+    std::vector<double> m_solution; /**< Last feasible solution of the QP problem. */
+    int m_numberOfWorkingSetRecalculations{0}; /**< Working set recalculations of the last tick. */
+    double m_solverTime{0}; /**< Time spent by the solver in the last tick (in seconds). */
+
     /**
      * Initialize all the constant matrix from the configuration file.
      * @return true/false in case of success/failure.
@@ -225,11 +232,51 @@ public:
     void setDesiredCoMVelocity(const iDynTree::Vector3& comVelocity);
 
     /**
-     * Solve the optimization problem.
+     * Solve the optimization problem. If the solver exceeds the time budget (or it fails) the last
+     * feasible solution is kept for at most max_consecutive_fallbacks ticks.
      * @return true/false in case of success/failure.
      */
     bool solve();
 
+    /**
+     * Get the number of working set recalculations performed by the solver in the last tick.
+     * @return the number of working set recalculations.
+     */
+    int getNumberOfWorkingSetRecalculations() const;
+
+    /**
+     * Get the time spent by the solver in the last tick.
+     * @return the time (in seconds).
+     */
+    double getSolverTime() const;
+
+    /**
+     * Get the statistics of the last solve (the iterations are the working set recalculations).
+     * @param statistics statistics of the solver.
+     */
+    void getStatistics(QPSolverStatistics& statistics) const;
+
+    /**
+     * Get the number of consecutive ticks in which the last feasible solution is used.
+     * @return the number of ticks (zero if the last solve found a new solution).
+     */
+    int getNumberOfConsecutiveFallbacks() const;
+
+    /**
+     * Get the primal variable of the last solution (base twist and joint velocities).
+     * @param primalVariable primal variable.
+     * @return true/false in case of success/failure.
+     */
+    bool getPrimalVariable(Eigen::VectorXd& primalVariable);
+
+    /**
+     * Set the primal variable found by another solver. The hotstart continues from the active
+     * set of the last solve, so the primal variable is used as last feasible solution.
+     * @param primalVariable primal variable (base twist and joint velocities).
+     * @return true/false in case of success/failure.
+     */
+    bool setPrimalVariable(const Eigen::VectorXd& primalVariable);
+
     /**
      * Get the solution of the optimization problem.
      * @param output joint velocity (in rad/s).
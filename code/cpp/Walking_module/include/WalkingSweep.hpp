@@ -0,0 +1,120 @@
+/**
+ * @file WalkingSweep.hpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#ifndef WALKING_SWEEP_HPP
+#define WALKING_SWEEP_HPP
+
+// std
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// YARP
+#include <yarp/os/Property.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/Value.h>
+
+#include "WalkingBenchmark.hpp"
+#include "TimeProfiler.hpp"
+
+/**
+ * WalkingSweep runs a WalkingBenchmark for each combination of the values of the swept
+ * parameters (e.g. the weights of the MPC or the gains of the ZMP controller). The runs are
+ * independent, each one has its own controller chain, planner and plant, and they are
+ * distributed on a pool of worker threads.
+ */
+class WalkingSweep
+{
+    /**
+     * Parameter of the configuration file that is swept.
+     */
+    struct Parameter
+    {
+        std::string name; /**< Name of the parameter (column of the results). */
+        std::string group; /**< Group of the configuration file (e.g. ZMP_CONTROLLER). */
+        std::string key; /**< Name of the option inside the group. */
+        std::vector<yarp::os::Value> values; /**< Values of the parameter. */
+    };
+
+    /**
+     * Result of a single run.
+     */
+    struct RunResult
+    {
+        bool isSucceeded{false}; /**< True if the controller chain never failed. */
+        BenchmarkMetrics metrics; /**< Tracking performances. */
+        std::vector<std::string> stages; /**< Names of the profiled stages. */
+        std::vector<TimerStatistics> stageStatistics; /**< Latency of each stage [ms]. */
+    };
+
+    yarp::os::Property m_baseConfiguration; /**< Configuration of the WalkingModule. */
+    std::vector<Parameter> m_parameters; /**< Swept parameters. */
+    std::size_t m_numberOfRuns{0}; /**< Number of combinations of the parameters. */
+    unsigned int m_numberOfThreads{1}; /**< Number of worker threads. */
+
+    std::vector<RunResult> m_results; /**< Results of the runs (indexed by run). */
+    std::atomic<std::size_t> m_nextRun{0}; /**< Index of the next run taken by a worker. */
+    std::mutex m_configurationMutex; /**< The benchmarks are configured one at a time. */
+    double m_elapsedTime{0}; /**< Wall time spent by the sweep [s]. */
+
+    /**
+     * Get the index of the value of each parameter used by a run (the last parameter
+     * changes faster).
+     * @param run index of the run;
+     * @param indices indices of the values.
+     */
+    void getValueIndices(std::size_t run, std::vector<std::size_t>& indices) const;
+
+    /**
+     * Set the value of a parameter in the configuration.
+     * @param configuration configuration of the run;
+     * @param parameter parameter;
+     * @param value value of the parameter.
+     * @return true/false in case of success/failure.
+     */
+    bool setParameter(yarp::os::Property& configuration, const Parameter& parameter,
+                      const yarp::os::Value& value) const;
+
+    /**
+     * Configure and execute a run. The result is stored in m_results.
+     * @param run index of the run.
+     */
+    void executeRun(std::size_t run);
+
+    /**
+     * Body of the worker threads: the runs are executed until all of them are taken.
+     */
+    void worker();
+
+public:
+
+    /**
+     * Configure the sweep. The swept parameters are read from the file sweep_config
+     * (default dcmWalkingSweep.ini), the configuration of the WalkingModule is used for all the
+     * other options.
+     * @param rf is the reference to a resource finder object.
+     * @return true/false in case of success/failure.
+     */
+    bool configure(yarp::os::ResourceFinder& rf);
+
+    /**
+     * Execute all the runs.
+     * @return true/false in case of success/failure. A failed run is not an error, it is
+     * reported in the results.
+     */
+    bool run();
+
+    /**
+     * Get the table of the results in CSV format (one row for each run).
+     * @return the table.
+     */
+    std::string getReport() const;
+};
+
+#endif
@@ -9,15 +9,9 @@
 #ifndef WALKING_ZMP_CONTROLLER_HPP
 #define WALKING_ZMP_CONTROLLER_HPP
 
-// std
-#include <memory>
-
 // YARP
 #include <yarp/os/Searchable.h>
 
-// iCub-ctrl
-#include <iCub/ctrl/pids.h>
-
 // iDynTree
 #include <iDynTree/Core/VectorFixSize.h>
 
@@ -43,11 +37,10 @@ class WalkingZMPController
     iDynTree::Vector2 m_controllerOutput; /**< Controller output. */
     iDynTree::Vector2 m_desiredCoMVelocity; /**< Controller output. */
 
-    /**
-     * Pointer containing an integrator object.
-     * It is useful to evaluate the desired CoM position from the CoM velocity.
-     */
-    std::unique_ptr<iCub::ctrl::Integrator> m_velocityIntegral{nullptr};
+    double m_samplingTime; /**< Sampling time of the integrator. */
+    bool m_isIntegratorInitialized{false}; /**< True if the integrator is initialized. */
+    iDynTree::Vector2 m_previousDesiredCoMVelocity; /**< Velocity used in the previous integration
+                                                       step (trapezoidal rule). */
 
 public:
 
@@ -0,0 +1,123 @@
+/**
+ * @file AllocationCounter.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.hpp"
+
+#ifdef WALKING_COUNT_ALLOCATIONS
+
+// Eigen calls malloc directly. The executables are linked with --wrap=malloc,calloc,realloc so
+// the calls made by the translation units of this project are redirected to the __wrap_ functions
+extern "C" void* __real_malloc(std::size_t size);
+extern "C" void* __real_calloc(std::size_t number, std::size_t size);
+extern "C" void* __real_realloc(void* pointer, std::size_t size);
+
+namespace
+{
+    // the counter is per thread so the allocations of the worker threads are not
+    // attributed to the control loop
+    thread_local std::size_t threadAllocations{0};
+
+    void* countedAllocation(std::size_t size)
+    {
+        threadAllocations++;
+
+        // malloc(0) may return a null pointer
+        void* pointer = __real_malloc(size == 0 ? 1 : size);
+        if(pointer == nullptr)
+            throw std::bad_alloc();
+        return pointer;
+    }
+}
+
+extern "C" void* __wrap_malloc(std::size_t size)
+{
+    threadAllocations++;
+    return __real_malloc(size);
+}
+
+extern "C" void* __wrap_calloc(std::size_t number, std::size_t size)
+{
+    threadAllocations++;
+    return __real_calloc(number, size);
+}
+
+extern "C" void* __wrap_realloc(void* pointer, std::size_t size)
+{
+    threadAllocations++;
+    return __real_realloc(pointer, size);
+}
+
+void* operator new(std::size_t size)
+{
+    return countedAllocation(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return countedAllocation(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    threadAllocations++;
+    return __real_malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    threadAllocations++;
+    return __real_malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+bool AllocationCounter::isEnabled()
+{
+    return true;
+}
+
+std::size_t AllocationCounter::getThreadAllocations()
+{
+    return threadAllocations;
+}
+
+#else
+
+bool AllocationCounter::isEnabled()
+{
+    return false;
+}
+
+std::size_t AllocationCounter::getThreadAllocations()
+{
+    return 0;
+}
+
+#endif
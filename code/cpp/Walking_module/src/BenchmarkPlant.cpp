@@ -0,0 +1,194 @@
+/**
+ * @file BenchmarkPlant.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+// YARP
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Value.h>
+
+// iDynTree
+#include <iDynTree/Core/Utils.h>
+
+#include "BenchmarkPlant.hpp"
+
+bool BenchmarkPlant::loadDataset(const std::string& fileName)
+{
+    std::ifstream dataset(fileName);
+    if(!dataset.is_open())
+    {
+        yError() << "[BenchmarkPlant::loadDataset] Unable to open" << fileName;
+        return false;
+    }
+
+    // the first line contains the name of the columns
+    std::string line;
+    std::getline(dataset, line);
+    std::istringstream head(line);
+    std::vector<std::string> columns{std::istream_iterator<std::string>(head),
+            std::istream_iterator<std::string>()};
+
+    auto zmpX = std::find(columns.begin(), columns.end(), "zmp_x");
+    auto zmpY = std::find(columns.begin(), columns.end(), "zmp_y");
+    if(zmpX == columns.end() || zmpY == columns.end())
+    {
+        yError() << "[BenchmarkPlant::loadDataset] The dataset does not contain the measured ZMP.";
+        return false;
+    }
+    std::size_t zmpXIndex = std::distance(columns.begin(), zmpX);
+    std::size_t zmpYIndex = std::distance(columns.begin(), zmpY);
+
+    m_recordedZMP.clear();
+    std::vector<double> row(columns.size());
+    while(std::getline(dataset, line))
+    {
+        std::istringstream values(line);
+        std::size_t i = 0;
+        while(i < row.size() && values >> row[i])
+            i++;
+
+        if(i != row.size())
+        {
+            yError() << "[BenchmarkPlant::loadDataset] Malformed row" << m_recordedZMP.size() + 1;
+            return false;
+        }
+
+        iDynTree::Vector2 zmp;
+        zmp(0) = row[zmpXIndex];
+        zmp(1) = row[zmpYIndex];
+        m_recordedZMP.push_back(zmp);
+    }
+
+    if(m_recordedZMP.empty())
+    {
+        yError() << "[BenchmarkPlant::loadDataset] The dataset is empty.";
+        return false;
+    }
+
+    yInfo() << "[BenchmarkPlant::loadDataset]" << m_recordedZMP.size() << "samples loaded from" << fileName;
+    return true;
+}
+
+bool BenchmarkPlant::initialize(const yarp::os::Searchable& config, const iDynTree::Model& model,
+                                double dT)
+{
+    m_dT = dT;
+
+    m_jointPosition.resize(model.getNrOfDOFs());
+    m_jointPosition.zero();
+    m_jointVelocity.resize(model.getNrOfDOFs());
+    m_jointVelocity.zero();
+    m_zmp.zero();
+
+    // the weight is shared among the feet in contact
+    double mass = 0;
+    for(std::size_t i = 0; i < model.getNrOfLinks(); i++)
+        mass += model.getLink(i)->getInertia().getMass();
+    m_weight = mass * 9.81;
+
+    std::string zmpSource = config.check("benchmark_zmp_source", yarp::os::Value("plant")).asString();
+    if(zmpSource == "dataset")
+    {
+        std::string fileName = config.check("benchmark_dataset", yarp::os::Value("")).asString();
+        if(!loadDataset(fileName))
+        {
+            yError() << "[BenchmarkPlant::initialize] Unable to load the dataset.";
+            return false;
+        }
+        m_useDataset = true;
+        m_recordedZMPIndex = 0;
+    }
+    else if(zmpSource != "plant")
+    {
+        yError() << "[BenchmarkPlant::initialize] The ZMP source has to be 'plant' or 'dataset'.";
+        return false;
+    }
+
+    return true;
+}
+
+void BenchmarkPlant::reset(const iDynTree::VectorDynSize& jointPosition, const iDynTree::Vector2& zmp)
+{
+    m_jointPosition = jointPosition;
+    m_jointVelocity.zero();
+    m_zmp = m_useDataset ? m_recordedZMP.front() : zmp;
+    m_recordedZMPIndex = 0;
+}
+
+bool BenchmarkPlant::setJointReferences(const iDynTree::VectorDynSize& jointPosition)
+{
+    if(jointPosition.size() != m_jointPosition.size())
+    {
+        yError() << "[BenchmarkPlant::setJointReferences] The size of the references is wrong.";
+        return false;
+    }
+
+    for(unsigned int i = 0; i < m_jointPosition.size(); i++)
+    {
+        m_jointVelocity(i) = (jointPosition(i) - m_jointPosition(i)) / m_dT;
+        m_jointPosition(i) = jointPosition(i);
+    }
+    return true;
+}
+
+void BenchmarkPlant::setZMPReference(const iDynTree::Vector2& zmp)
+{
+    if(!m_useDataset)
+        m_zmp = zmp;
+}
+
+void BenchmarkPlant::step()
+{
+    // the last sample of the dataset is kept
+    if(m_useDataset)
+    {
+        m_recordedZMPIndex = std::min(m_recordedZMPIndex + 1, m_recordedZMP.size() - 1);
+        m_zmp = m_recordedZMP[m_recordedZMPIndex];
+    }
+}
+
+void BenchmarkPlant::getEncoders(yarp::sig::Vector& positionInDegrees, yarp::sig::Vector& velocityInDegrees)
+{
+    for(unsigned int i = 0; i < m_jointPosition.size(); i++)
+    {
+        positionInDegrees(i) = iDynTree::rad2deg(m_jointPosition(i));
+        velocityInDegrees(i) = iDynTree::rad2deg(m_jointVelocity(i));
+    }
+}
+
+void BenchmarkPlant::evaluateFootWrench(const iDynTree::Transform& footTransform, double normalForce,
+                                        yarp::sig::Vector& wrench)
+{
+    // CoP of the foot (it is placed on the ZMP)
+    iDynTree::Position zmp(m_zmp(0), m_zmp(1), footTransform.getPosition()(2));
+    iDynTree::Position cop = footTransform.inverse() * zmp;
+
+    wrench.zero();
+    wrench(2) = normalForce;
+    wrench(3) = cop(1) * normalForce;
+    wrench(4) = -cop(0) * normalForce;
+}
+
+void BenchmarkPlant::getWrenches(const iDynTree::Transform& leftFootTransform,
+                                 const iDynTree::Transform& rightFootTransform,
+                                 bool leftInContact, bool rightInContact,
+                                 yarp::sig::Vector& leftWrench, yarp::sig::Vector& rightWrench)
+{
+    // if no foot is in contact (it should never happen) the weight is shared as in double support
+    if(!leftInContact && !rightInContact)
+        leftInContact = rightInContact = true;
+
+    double share = leftInContact && rightInContact ? 0.5 : 1.0;
+
+    evaluateFootWrench(leftFootTransform, leftInContact ? share * m_weight : 0.0, leftWrench);
+    evaluateFootWrench(rightFootTransform, rightInContact ? share * m_weight : 0.0, rightWrench);
+}
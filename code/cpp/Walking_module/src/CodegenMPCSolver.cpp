@@ -0,0 +1,256 @@
+/**
+ * @file CodegenMPCSolver.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <chrono>
+#include <iostream>
+
+// iDynTree
+#include <iDynTree/Core/EigenHelpers.h>
+#include <iDynTree/Core/EigenSparseHelpers.h>
+
+#include "CodegenMPCSolver.hpp"
+
+namespace
+{
+    /**
+     * Check if the sparsity pattern of a compressed matrix is equal to a generated one.
+     */
+    bool isPatternEqual(const Eigen::SparseMatrix<double>& matrix, int nonZeros,
+                        const int* columns, const int* rows)
+    {
+        if(!matrix.isCompressed() || matrix.nonZeros() != nonZeros)
+            return false;
+
+        for(int j = 0; j <= matrix.cols(); j++)
+            if(matrix.outerIndexPtr()[j] != columns[j])
+                return false;
+
+        for(int k = 0; k < nonZeros; k++)
+            if(matrix.innerIndexPtr()[k] != rows[k])
+                return false;
+
+        return true;
+    }
+
+    /**
+     * Evaluate the upper triangular part of the hessian matrix (osqp uses only this part).
+     */
+    Eigen::SparseMatrix<double> upperTriangularPart(const iDynSparseMatrix& hessian)
+    {
+        Eigen::SparseMatrix<double> hessianEigen = iDynTree::toEigen(hessian);
+        Eigen::SparseMatrix<double> upper = hessianEigen.triangularView<Eigen::Upper>();
+        upper.makeCompressed();
+        return upper;
+    }
+}
+
+const WalkingMPCCodegenSolver* CodegenMPCSolver::findGeneratedSolver(const std::string& name)
+{
+    for(int i = 0; walking_mpc_codegen_solvers[i] != nullptr; i++)
+        if(name == walking_mpc_codegen_solvers[i]->name)
+            return walking_mpc_codegen_solvers[i];
+
+    return nullptr;
+}
+
+CodegenMPCSolver::CodegenMPCSolver(const WalkingMPCCodegenSolver* generatedSolver,
+                                   const int& stateSize, const int& inputSize,
+                                   const int& controllerHorizon,
+                                   const int& numberOfInequalityConstraints,
+                                   const iDynTree::Triplets& equalConstraintsMatrix,
+                                   const iDynSparseMatrix& gradientSubmatrix,
+                                   const iDynSparseMatrix& stateWeightStackedMatrix)
+    : MPCSolver(stateSize, inputSize, controllerHorizon, numberOfInequalityConstraints,
+                equalConstraintsMatrix, gradientSubmatrix, stateWeightStackedMatrix),
+      m_generatedSolver(generatedSolver)
+{
+}
+
+bool CodegenMPCSolver::isCompatible(const iDynSparseMatrix& hessian) const
+{
+    if(m_generatedSolver == nullptr
+       || m_generatedSolver->numberOfVariables != m_gradient.size()
+       || m_generatedSolver->numberOfConstraints != m_lowerBound.size())
+        return false;
+
+    return isPatternEqual(upperTriangularPart(hessian), m_generatedSolver->hessianNonZeros,
+                          m_generatedSolver->hessianColumns, m_generatedSolver->hessianRows)
+        && isPatternEqual(m_constraintsMatrix, m_generatedSolver->constraintsNonZeros,
+                          m_generatedSolver->constraintsColumns, m_generatedSolver->constraintsRows);
+}
+
+bool CodegenMPCSolver::setHessianMatrix(const iDynSparseMatrix& hessian)
+{
+    if(m_isInitialized)
+    {
+        std::cerr << "[setHessianMatrix] Something goes wrong. "
+                  << "In this particular problem the hessian matrix is constant."
+                  << std::endl;
+        return false;
+    }
+
+    if(!isCompatible(hessian))
+    {
+        std::cerr << "[setHessianMatrix] The problem is different from the one of the generated solver."
+                  << std::endl;
+        return false;
+    }
+
+    m_hessianMatrix = upperTriangularPart(hessian);
+    return true;
+}
+
+bool CodegenMPCSolver::setConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityConstraintsMatrix)
+{
+    if(!evaluateConstraintsMatrix(inequalityConstraintsMatrix))
+        return false;
+
+    // the values are stored in the same order of the generated pattern
+    if(m_isInitialized && !m_generatedSolver->updateConstraintsMatrix(m_constraintsMatrix.valuePtr()))
+    {
+        std::cerr << "[setConstraintsMatrix] Unable to update the constraints matrix."
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CodegenMPCSolver::setBounds(const iDynTree::Vector2& currentState,
+                                 const iDynTree::VectorDynSize& inequalityConstraintsVector)
+{
+    if(!evaluateBounds(currentState, inequalityConstraintsVector))
+        return false;
+
+    if(m_isInitialized && !m_generatedSolver->updateBounds(m_lowerBound.data(), m_upperBound.data()))
+    {
+        std::cerr << "[setBounds] Unable to update the bounds." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CodegenMPCSolver::setGradient(const TrajectoryView<iDynTree::Vector2>& referenceSignal,
+                                   const iDynTree::Vector2& previousControllerOutput,
+                                   const bool& resetTrajectory)
+{
+    evaluateGradient(referenceSignal, previousControllerOutput, !m_isInitialized || resetTrajectory);
+
+    if(m_isInitialized && !m_generatedSolver->updateGradient(m_gradient.data()))
+    {
+        std::cerr << "[setGradient] Unable to update the gradient." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CodegenMPCSolver::getPrimalVariable(Eigen::VectorXd& primalVariable)
+{
+    if(!m_isInitialized)
+    {
+        std::cerr << "[getPrimalVariable] The solver is not initilialize." << std::endl;
+        return false;
+    }
+
+    primalVariable = Eigen::Map<const Eigen::VectorXd>(m_generatedSolver->getPrimalVariable(),
+                                                       m_generatedSolver->numberOfVariables);
+    return true;
+}
+
+bool CodegenMPCSolver::setPrimalVariable(const Eigen::VectorXd& primalVariable)
+{
+    if(!m_isInitialized || primalVariable.size() != m_generatedSolver->numberOfVariables)
+    {
+        std::cerr << "[setPrimalVariable] The solver is not initilialize or the size of the "
+                  << "primal variable is wrong." << std::endl;
+        return false;
+    }
+    return m_generatedSolver->warmStartPrimal(primalVariable.data());
+}
+
+bool CodegenMPCSolver::getDualVariable(Eigen::VectorXd& dualVariable)
+{
+    if(!m_isInitialized)
+    {
+        std::cerr << "[getDualVariable] The solver is not initilialize." << std::endl;
+        return false;
+    }
+
+    dualVariable = Eigen::Map<const Eigen::VectorXd>(m_generatedSolver->getDualVariable(),
+                                                     m_generatedSolver->numberOfConstraints);
+    return true;
+}
+
+bool CodegenMPCSolver::setDualVariable(const Eigen::VectorXd& dualVariable)
+{
+    if(!m_isInitialized || dualVariable.size() != m_generatedSolver->numberOfConstraints)
+    {
+        std::cerr << "[setDualVariable] The solver is not initilialize or the size of the "
+                  << "dual variable is wrong." << std::endl;
+        return false;
+    }
+    return m_generatedSolver->warmStartDual(dualVariable.data());
+}
+
+bool CodegenMPCSolver::isInitialized()
+{
+    return m_isInitialized;
+}
+
+bool CodegenMPCSolver::initialize()
+{
+    if(m_hessianMatrix.nonZeros() == 0)
+    {
+        std::cerr << "[initialize] The hessian matrix is not set." << std::endl;
+        return false;
+    }
+
+    if(!m_generatedSolver->updateMatrices(m_hessianMatrix.valuePtr(), m_constraintsMatrix.valuePtr())
+       || !m_generatedSolver->updateGradient(m_gradient.data())
+       || !m_generatedSolver->updateBounds(m_lowerBound.data(), m_upperBound.data()))
+    {
+        std::cerr << "[initialize] Unable to set the problem in the generated solver." << std::endl;
+        return false;
+    }
+
+    m_isInitialized = true;
+    return true;
+}
+
+bool CodegenMPCSolver::solve()
+{
+    if(!m_isInitialized)
+    {
+        std::cerr << "[solve] The solver is not initilialize." << std::endl;
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool isSolved = m_generatedSolver->solve();
+    m_solveTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return isSolved;
+}
+
+const iDynTree::VectorDynSize& CodegenMPCSolver::getSolution()
+{
+    iDynTree::toEigen(m_solution) = Eigen::Map<const Eigen::VectorXd>(m_generatedSolver->getPrimalVariable(),
+                                                                      m_generatedSolver->numberOfVariables);
+    return m_solution;
+}
+
+void CodegenMPCSolver::getStatistics(QPSolverStatistics& statistics)
+{
+    statistics = QPSolverStatistics();
+    if(!m_isInitialized)
+        return;
+
+    m_generatedSolver->getInfo(&statistics.iterations, &statistics.primalResidual,
+                               &statistics.dualResidual);
+    statistics.solveTime = m_solveTime;
+}
@@ -0,0 +1,313 @@
+/**
+ * @file CondensedMPCSolver.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// iDynTree
+#include <iDynTree/Core/EigenHelpers.h>
+#include <iDynTree/Core/EigenSparseHelpers.h>
+
+#include "CondensedMPCSolver.hpp"
+#include "Utils.hpp"
+
+CondensedMPCSolver::CondensedMPCSolver(const int& stateSize, const int& inputSize,
+                                       const int& controllerHorizon,
+                                       const int& numberOfBlocks,
+                                       const int& numberOfInequalityConstraints,
+                                       const Eigen::MatrixXd& stateGradientMatrix,
+                                       const Eigen::MatrixXd& referenceGradientMatrix,
+                                       const Eigen::MatrixXd& inputGradientMatrix)
+    :m_stateGradientMatrix(&stateGradientMatrix),
+     m_referenceGradientMatrix(&referenceGradientMatrix),
+     m_inputGradientMatrix(&inputGradientMatrix),
+     m_stateSize(stateSize),
+     m_inputSize(inputSize),
+     m_controllerHorizon(controllerHorizon),
+     m_numberOfBlocks(numberOfBlocks),
+     m_numberOfInequalityConstraints(numberOfInequalityConstraints)
+{
+    // instantiate the solver class
+    m_optimizerSolver = std::make_unique<OsqpEigen::Solver>();
+
+    // only the input blocks are optimization variables
+    int numberOfVariables = m_inputSize * m_numberOfBlocks;
+    m_optimizerSolver->data()->setNumberOfVariables(numberOfVariables);
+    m_optimizerSolver->data()->setNumberOfConstraints(m_numberOfInequalityConstraints);
+
+    // resize vectors
+    m_gradient = Eigen::VectorXd::Zero(numberOfVariables);
+    m_solution.resize(numberOfVariables);
+    m_referenceSignal = Eigen::VectorXd::Zero(m_stateSize * (m_controllerHorizon + 1));
+    m_currentState.setZero();
+    m_lowerBound = Eigen::VectorXd::Constant(m_numberOfInequalityConstraints, -OsqpEigen::INFTY);
+    m_upperBound = Eigen::VectorXd::Constant(m_numberOfInequalityConstraints, OsqpEigen::INFTY);
+
+    // the inequality constraints depend only on the first input block. Its elements are
+    // stored even if they are equal to zero so the sparsity pattern never changes
+    std::vector<Eigen::Triplet<double>> constraintsTriplets;
+    for(int i = 0; i < m_numberOfInequalityConstraints; i++)
+        for(int j = 0; j < m_inputSize; j++)
+            constraintsTriplets.push_back(Eigen::Triplet<double>(i, j, 0.0));
+
+    m_constraintsMatrix.resize(m_numberOfInequalityConstraints, numberOfVariables);
+    m_constraintsMatrix.setFromTriplets(constraintsTriplets.begin(), constraintsTriplets.end());
+    m_constraintsMatrix.makeCompressed();
+
+    m_optimizerSolver->settings()->setVerbosity(false);
+}
+
+bool CondensedMPCSolver::setHessianMatrix(const iDynSparseMatrix& hessian)
+{
+    Eigen::SparseMatrix<double> hessianEigen = iDynTree::toEigen(hessian);
+    if(m_optimizerSolver->isInitialized())
+    {
+        std::cerr << "[setHessianMatrix] Something goes wrong. "
+                  << "In this particular problem the hessian matrix is constant."
+                  << std::endl;
+        return false;
+    }
+
+    if(!m_optimizerSolver->data()->setHessianMatrix(hessianEigen))
+    {
+        std::cerr << "[setHessianMatrix] Unable to set first time the hessian matrix."
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CondensedMPCSolver::setConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityConstraintsMatrix)
+{
+    if(inequalityConstraintsMatrix.rows() > m_numberOfInequalityConstraints ||
+       inequalityConstraintsMatrix.cols() != m_inputSize)
+    {
+        std::cerr << "[setLinearConstraintsMatrix] The inequality constraints matrix can have at most "
+                  << m_numberOfInequalityConstraints << " rows and it must have "
+                  << m_inputSize << " columns." << std::endl;
+        return false;
+    }
+
+    for(int i = 0; i < m_numberOfInequalityConstraints; i++)
+        for(int j = 0; j < m_inputSize; j++)
+            m_constraintsMatrix.coeffRef(i, j) =
+                i < inequalityConstraintsMatrix.rows() ? inequalityConstraintsMatrix(i, j) : 0.0;
+
+    if(m_optimizerSolver->isInitialized())
+    {
+        if(!m_optimizerSolver->updateLinearConstraintsMatrix(m_constraintsMatrix))
+        {
+            std::cerr << "[setLinearConstraintsMatrix] Unable to update the constraints matrix."
+                      << std::endl;
+            return false;
+        }
+    }
+    else
+    {
+        if(!m_optimizerSolver->data()->setLinearConstraintsMatrix(m_constraintsMatrix))
+        {
+            std::cerr << "[setLinearConstraintsMatrix] Unable to set the constraints matrix."
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CondensedMPCSolver::setBounds(const iDynTree::Vector2& currentState,
+                                   const iDynTree::VectorDynSize& inequalityConstraintsVector)
+{
+    if(inequalityConstraintsVector.size() > m_numberOfInequalityConstraints)
+    {
+        std::cerr << "[setBounds] The size of the inequalityConstraintsVector has to be at most: "
+                  << m_numberOfInequalityConstraints << std::endl;
+        return false;
+    }
+
+    // the current state enters in the gradient
+    m_currentState = iDynTree::toEigen(currentState);
+
+    // the unused constraints are always satisfied
+    for(int i = 0; i< m_numberOfInequalityConstraints; i++)
+        m_upperBound(i) = i < inequalityConstraintsVector.size() ?
+            inequalityConstraintsVector(i) : OsqpEigen::INFTY;
+
+    if(m_optimizerSolver->isInitialized())
+    {
+        if(!m_optimizerSolver->updateUpperBound(m_upperBound))
+        {
+            std::cerr << "[setBounds] Unable to update the bounds."
+                      << std::endl;
+            return false;
+        }
+    }
+    else
+    {
+        if(!m_optimizerSolver->data()->setLowerBound(m_lowerBound))
+        {
+            std::cerr << "[setBounds] Unable to set the first time the lower bound."
+                      << std::endl;
+            return false;
+        }
+
+        if(!m_optimizerSolver->data()->setUpperBound(m_upperBound))
+        {
+            std::cerr << "[setBounds] Unable to set the first time the upper bound."
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CondensedMPCSolver::setGradient(const TrajectoryView<iDynTree::Vector2>& referenceSignal,
+                                     const iDynTree::Vector2& previousControllerOutput,
+                                     const bool& resetTrajectory)
+{
+    if(referenceSignal.empty())
+    {
+        std::cerr << "[setGradient] The reference signal is empty." << std::endl;
+        return false;
+    }
+
+    // if the reference signal is shorter than the controller horizon we assume it becomes
+    // constant
+    for(int i = 0; i < (m_controllerHorizon + 1); i++)
+    {
+        const iDynTree::Vector2& reference = i < referenceSignal.size() ?
+            referenceSignal[i] : referenceSignal.back();
+        m_referenceSignal.segment<2>(i * m_stateSize) = iDynTree::toEigen(reference);
+    }
+
+    // the products are evaluated in place (no temporaries are allocated)
+    m_gradient.noalias() = (*m_stateGradientMatrix) * m_currentState;
+    m_gradient.noalias() -= (*m_referenceGradientMatrix) * m_referenceSignal;
+    m_gradient.noalias() += (*m_inputGradientMatrix) * iDynTree::toEigen(previousControllerOutput);
+
+    if(m_optimizerSolver->isInitialized())
+    {
+        if(!m_optimizerSolver->updateGradient(m_gradient))
+        {
+            std::cerr << "[setGradient] Unable to update the gradient."
+                      << std::endl;
+            return false;
+        }
+    }
+    else
+    {
+        if(!m_optimizerSolver->data()->setGradient(m_gradient))
+        {
+            std::cerr << "[setGradient] Unable to set first time the gradient."
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CondensedMPCSolver::getPrimalVariable(Eigen::VectorXd& primalVariable)
+{
+    if(!m_optimizerSolver->isInitialized())
+    {
+        std::cerr << "[getPrimalVariable] The solver is not initilialize."
+                  << std::endl;
+        return false;
+    }
+    return m_optimizerSolver->getPrimalVariable(primalVariable);
+}
+
+bool CondensedMPCSolver::setPrimalVariable(const Eigen::VectorXd& primalVariable)
+{
+    if(!m_optimizerSolver->isInitialized())
+    {
+        std::cerr << "[setPrimalVariable] The solver is not initilialize."
+                  << std::endl;
+        return false;
+    }
+    return m_optimizerSolver->setPrimalVariable(primalVariable);
+}
+
+bool CondensedMPCSolver::getDualVariable(Eigen::VectorXd& dualVariable)
+{
+    if(!m_optimizerSolver->isInitialized())
+    {
+        std::cerr << "[getDualVariable] The solver is not initilialize."
+                  << std::endl;
+        return false;
+    }
+    return m_optimizerSolver->getDualVariable(dualVariable);
+}
+
+bool CondensedMPCSolver::setDualVariable(const Eigen::VectorXd& dualVariable)
+{
+    if(!m_optimizerSolver->isInitialized())
+    {
+        std::cerr << "[setDualVariable] The solver is not initilialize."
+                  << std::endl;
+        return false;
+    }
+    return m_optimizerSolver->setDualVariable(dualVariable);
+}
+
+int CondensedMPCSolver::getNumberOfConstraints() const
+{
+    return m_numberOfInequalityConstraints;
+}
+
+int CondensedMPCSolver::getNumberOfEqualityConstraints() const
+{
+    return 0;
+}
+
+int CondensedMPCSolver::getFirstInputIndex() const
+{
+    return 0;
+}
+
+bool CondensedMPCSolver::isInitialized()
+{
+    return m_optimizerSolver->isInitialized();
+}
+
+bool CondensedMPCSolver::initialize()
+{
+    return m_optimizerSolver->initSolver();
+}
+
+bool CondensedMPCSolver::solve()
+{
+    if(!m_optimizerSolver->isInitialized())
+    {
+        std::cerr << "[solve] The solver is not initilialize."
+                  << std::endl;
+        return false;
+    }
+
+    return m_optimizerSolver->solve();
+}
+
+const iDynTree::VectorDynSize& CondensedMPCSolver::getSolution()
+{
+    iDynTree::toEigen(m_solution) = m_optimizerSolver->getSolution();
+    return m_solution;
+}
+
+const Eigen::VectorXd& CondensedMPCSolver::getGradient() const
+{
+    return m_gradient;
+}
+
+void CondensedMPCSolver::getStatistics(QPSolverStatistics& statistics)
+{
+    statistics = QPSolverStatistics();
+    if(!m_optimizerSolver->isInitialized())
+        return;
+
+    const OSQPInfo* info = m_optimizerSolver->workspace()->info;
+    statistics.iterations = info->iter;
+    statistics.primalResidual = info->pri_res;
+    statistics.dualResidual = info->dua_res;
+    statistics.solveTime = info->solve_time;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file DCMControllerSupervisor.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cmath>
+
+// YARP
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Value.h>
+
+#include "DCMControllerSupervisor.hpp"
+
+bool DCMControllerSupervisor::initialize(const yarp::os::Searchable& config, double samplingTime)
+{
+    double deadlineRatio = config.check("mpc_deadline_ratio", yarp::os::Value(0.5)).asDouble();
+    if(deadlineRatio <= 0)
+    {
+        yError() << "[initialize] The mpc_deadline_ratio has to be positive.";
+        return false;
+    }
+    m_deadline = deadlineRatio * samplingTime;
+
+    m_recoveryTicks = config.check("mpc_recovery_ticks", yarp::os::Value(10)).asInt();
+    if(m_recoveryTicks < 1)
+    {
+        yError() << "[initialize] The mpc_recovery_ticks has to be at least 1.";
+        return false;
+    }
+
+    // in the fallback mode the MPC is probed at a lower rate
+    m_probePeriod = config.check("mpc_probe_period", yarp::os::Value(5)).asInt();
+    if(m_probePeriod < 1)
+    {
+        yError() << "[initialize] The mpc_probe_period has to be at least 1.";
+        return false;
+    }
+
+    // time constant of the bumpless transfer (if zero the output may be discontinuous)
+    double transitionTime = config.check("mpc_transition_time", yarp::os::Value(0.05)).asDouble();
+    if(transitionTime < 0)
+    {
+        yError() << "[initialize] The mpc_transition_time cannot be negative.";
+        return false;
+    }
+    m_offsetDecay = transitionTime > 0 ? std::exp(-samplingTime / transitionTime) : 0.0;
+
+    reset();
+    return true;
+}
+
+void DCMControllerSupervisor::reset()
+{
+    m_mode = DCMControllerMode::MPC;
+    m_isModeChanged = false;
+    m_healthyTicks = 0;
+    m_ticksSinceProbe = 0;
+    m_offset.zero();
+    m_isLastOutputValid = false;
+}
+
+bool DCMControllerSupervisor::isMPCSolveRequired() const
+{
+    return m_mode == DCMControllerMode::MPC || m_ticksSinceProbe + 1 >= m_probePeriod;
+}
+
+void DCMControllerSupervisor::setMPCSkipped()
+{
+    m_isModeChanged = false;
+    m_ticksSinceProbe++;
+}
+
+void DCMControllerSupervisor::setMPCStatus(bool isSolved, double solveTime)
+{
+    bool isHealthy = isSolved && solveTime <= m_deadline;
+
+    m_isModeChanged = false;
+    m_ticksSinceProbe = 0;
+    if(m_mode == DCMControllerMode::MPC)
+    {
+        if(!isHealthy)
+        {
+            yWarning() << "[setMPCStatus] The MPC" << (isSolved ? "is late." : "failed.")
+                       << "The reactive DCM controller is used.";
+            m_mode = DCMControllerMode::Reactive;
+            m_isModeChanged = true;
+            m_healthyTicks = 0;
+            m_numberOfSwitches++;
+        }
+        return;
+    }
+
+    m_healthyTicks = isHealthy ? m_healthyTicks + 1 : 0;
+    if(m_healthyTicks >= m_recoveryTicks)
+    {
+        yInfo() << "[setMPCStatus] The MPC is healthy again.";
+        m_mode = DCMControllerMode::MPC;
+        m_isModeChanged = true;
+        m_numberOfSwitches++;
+    }
+}
+
+DCMControllerMode DCMControllerSupervisor::getMode() const
+{
+    return m_mode;
+}
+
+void DCMControllerSupervisor::filterOutput(iDynTree::Vector2& output)
+{
+    // the new controller starts from the last applied output
+    if(m_isModeChanged && m_isLastOutputValid)
+    {
+        m_offset(0) = m_lastOutput(0) - output(0);
+        m_offset(1) = m_lastOutput(1) - output(1);
+    }
+    else
+    {
+        m_offset(0) *= m_offsetDecay;
+        m_offset(1) *= m_offsetDecay;
+    }
+    m_isModeChanged = false;
+
+    output(0) += m_offset(0);
+    output(1) += m_offset(1);
+
+    m_lastOutput = output;
+    m_isLastOutputValid = true;
+}
+
+unsigned int DCMControllerSupervisor::getNumberOfSwitches() const
+{
+    return m_numberOfSwitches;
+}
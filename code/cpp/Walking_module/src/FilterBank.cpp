@@ -0,0 +1,128 @@
+/**
+ * @file FilterBank.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cmath>
+
+// YARP
+#include <yarp/os/LogStream.h>
+
+#include "FilterBank.hpp"
+
+int FilterBank::addGroup(int size, double cutFrequency, double samplingTime, double scale)
+{
+    if(size <= 0)
+    {
+        yError() << "[addGroup] The size of the group has to be positive.";
+        return -1;
+    }
+
+    if(cutFrequency > 0 && samplingTime <= 0)
+    {
+        yError() << "[addGroup] The sampling time has to be positive.";
+        return -1;
+    }
+
+    Group group;
+    group.offset = m_output.size();
+    group.size = size;
+    group.scale = scale;
+    group.output = nullptr;
+
+    int bankSize = group.offset + size;
+    m_inputGain.conservativeResize(bankSize);
+    m_previousInputGain.conservativeResize(bankSize);
+    m_previousOutputGain.conservativeResize(bankSize);
+    m_input.conservativeResize(bankSize);
+    m_previousInput.conservativeResize(bankSize);
+    m_output.conservativeResize(bankSize);
+
+    if(cutFrequency > 0)
+    {
+        // y(k) = (b0 u(k) + b1 u(k-1) - a1 y(k-1)) / a0
+        double tau = 1.0 / (2.0 * M_PI * cutFrequency);
+        double b0 = samplingTime;
+        double b1 = samplingTime;
+        double a0 = 2.0 * tau + samplingTime;
+        double a1 = samplingTime - 2.0 * tau;
+
+        m_inputGain.segment(group.offset, size) = b0 / a0 * scale;
+        m_previousInputGain.segment(group.offset, size) = b1 / a0 * scale;
+        m_previousOutputGain.segment(group.offset, size) = a1 / a0;
+    }
+    else
+    {
+        m_inputGain.segment(group.offset, size) = scale;
+        m_previousInputGain.segment(group.offset, size) = 0;
+        m_previousOutputGain.segment(group.offset, size) = 0;
+    }
+
+    m_input.segment(group.offset, size) = 0;
+    m_previousInput.segment(group.offset, size) = 0;
+    m_output.segment(group.offset, size) = 0;
+
+    m_groups.push_back(group);
+    return m_groups.size() - 1;
+}
+
+bool FilterBank::setOutput(int group, double* output)
+{
+    if(group < 0 || group >= static_cast<int>(m_groups.size()))
+    {
+        yError() << "[setOutput] The group" << group << "does not exist.";
+        return false;
+    }
+
+    m_groups[group].output = output;
+    return true;
+}
+
+void FilterBank::setInput(int group, const double* input)
+{
+    const Group& channels = m_groups[group];
+    m_input.segment(channels.offset, channels.size) = Eigen::Map<const Eigen::ArrayXd>(input,
+                                                                                     channels.size);
+}
+
+void FilterBank::init(int group, const double* value)
+{
+    const Group& channels = m_groups[group];
+    Eigen::Map<const Eigen::ArrayXd> steadyState(value, channels.size);
+
+    // the DC gain of the filters is one
+    m_input.segment(channels.offset, channels.size) = steadyState;
+    m_previousInput.segment(channels.offset, channels.size) = steadyState;
+    m_output.segment(channels.offset, channels.size) = steadyState * channels.scale;
+
+    if(channels.output != nullptr)
+        Eigen::Map<Eigen::ArrayXd>(channels.output, channels.size)
+            = m_output.segment(channels.offset, channels.size);
+}
+
+void FilterBank::process()
+{
+    // all the channels are evaluated in one pass
+    m_output = m_inputGain * m_input + m_previousInputGain * m_previousInput
+        - m_previousOutputGain * m_output;
+    m_previousInput = m_input;
+
+    for(const auto& channels : m_groups)
+        if(channels.output != nullptr)
+            Eigen::Map<Eigen::ArrayXd>(channels.output, channels.size)
+                = m_output.segment(channels.offset, channels.size);
+}
+
+const double* FilterBank::getOutput(int group) const
+{
+    return m_output.data() + m_groups[group].offset;
+}
+
+int FilterBank::getNumberOfGroups() const
+{
+    return m_groups.size();
+}
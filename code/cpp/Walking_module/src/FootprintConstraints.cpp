@@ -0,0 +1,356 @@
+/**
+ * @file FootprintConstraints.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// YARP
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+
+#include "FootprintConstraints.hpp"
+
+constexpr std::size_t FootprintConstraints::MaxFootVertices;
+constexpr std::size_t FootprintConstraints::MaxConstraints;
+
+namespace
+{
+    /**
+     * Get the z component of the cross product between (a - origin) and (b - origin).
+     */
+    double cross(const Eigen::Vector2d& origin, const Eigen::Vector2d& a, const Eigen::Vector2d& b)
+    {
+        return (a(0) - origin(0)) * (b(1) - origin(1)) - (a(1) - origin(1)) * (b(0) - origin(0));
+    }
+
+    bool lexicographicLess(const Eigen::Vector2d& a, const Eigen::Vector2d& b)
+    {
+        return a(0) < b(0) || (a(0) == b(0) && a(1) < b(1));
+    }
+}
+
+FootprintConstraints::FootPose FootprintConstraints::getPose(const iDynTree::Transform& transform)
+{
+    FootPose pose;
+    const iDynTree::Position& position = transform.getPosition();
+    const iDynTree::Rotation& rotation = transform.getRotation();
+    pose.x = position(0);
+    pose.y = position(1);
+    pose.yaw = std::atan2(rotation(1, 0), rotation(0, 0));
+    return pose;
+}
+
+template <std::size_t N>
+std::size_t FootprintConstraints::computeConvexHull(std::array<Eigen::Vector2d, N>& points,
+                                                    std::size_t numberOfPoints,
+                                                    std::array<Eigen::Vector2d, 2 * N>& hull)
+{
+    if(numberOfPoints < 3)
+        return 0;
+
+    // insertion sort (the number of points is small and std::sort may allocate)
+    for(std::size_t i = 1; i < numberOfPoints; i++)
+    {
+        Eigen::Vector2d point = points[i];
+        std::size_t j = i;
+        for(; j > 0 && lexicographicLess(point, points[j - 1]); j--)
+            points[j] = points[j - 1];
+        points[j] = point;
+    }
+
+    // lower hull
+    std::size_t k = 0;
+    for(std::size_t i = 0; i < numberOfPoints; i++)
+    {
+        while(k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0)
+            k--;
+        hull[k++] = points[i];
+    }
+
+    // upper hull
+    for(std::size_t i = numberOfPoints - 1, lowerHullSize = k + 1; i > 0; i--)
+    {
+        while(k >= lowerHullSize && cross(hull[k - 2], hull[k - 1], points[i - 1]) <= 0)
+            k--;
+        hull[k++] = points[i - 1];
+    }
+
+    // the last point is equal to the first one
+    return k - 1;
+}
+
+template <std::size_t N>
+void FootprintConstraints::computeHalfSpaces(const std::array<Eigen::Vector2d, N>& vertices,
+                                             std::size_t numberOfVertices,
+                                             ConstraintsMatrix& A, ConstraintsVector& b)
+{
+    A.resize(numberOfVertices, 2);
+    b.resize(numberOfVertices);
+
+    // the vertices are counterclockwise so the outward normal of the edge is on the right
+    for(std::size_t i = 0; i < numberOfVertices; i++)
+    {
+        const Eigen::Vector2d& vertex = vertices[i];
+        Eigen::Vector2d edge = vertices[(i + 1) % numberOfVertices] - vertex;
+        Eigen::Vector2d normal(edge(1), -edge(0));
+        normal.normalize();
+
+        A.row(i) = normal.transpose();
+        b(i) = normal.dot(vertex);
+    }
+}
+
+bool FootprintConstraints::initialize(const yarp::os::Searchable& config)
+{
+    yarp::os::Value feetDimensions = config.find("foot_size");
+    if(feetDimensions.isNull() || !feetDimensions.isList())
+    {
+        yError() << "[initialize] Please set the foot_size in the configuration file.";
+        return false;
+    }
+
+    yarp::os::Bottle *feetDimensionsPointer = feetDimensions.asList();
+    if(!feetDimensionsPointer || feetDimensionsPointer->size() != 2)
+    {
+        yError() << "[initialize] Error while reading the feet dimensions. Wrong number of elements.";
+        return false;
+    }
+
+    yarp::os::Value& xLimits = feetDimensionsPointer->get(0);
+    if(xLimits.isNull() || !xLimits.isList())
+    {
+        yError() << "[initialize] Error while reading the X limits.";
+        return false;
+    }
+
+    yarp::os::Bottle *xLimitsPtr = xLimits.asList();
+    if(!xLimitsPtr || xLimitsPtr->size() != 2)
+    {
+        yError() << "[initialize] Error while reading the X limits. Wrong dimensions.";
+        return false;
+    }
+
+    double xlimit1 = xLimitsPtr->get(0).asDouble();
+    double xlimit2 = xLimitsPtr->get(1).asDouble();
+
+    yarp::os::Value& yLimits = feetDimensionsPointer->get(1);
+    if(yLimits.isNull() || !yLimits.isList())
+    {
+        yError() << "[initialize] Error while reading the Y limits.";
+        return false;
+    }
+
+    yarp::os::Bottle *yLimitsPtr = yLimits.asList();
+    if(!yLimitsPtr || yLimitsPtr->size() != 2)
+    {
+        yError() << "[initialize] Error while reading the Y limits. Wrong dimensions.";
+        return false;
+    }
+
+    double ylimit1 = yLimitsPtr->get(0).asDouble();
+    double ylimit2 = yLimitsPtr->get(1).asDouble();
+
+    // evaluate the foot polygon
+    iDynTree::Polygon foot;
+    foot = iDynTree::Polygon::XYRectangleFromOffsets(std::abs(std::max(xlimit1, xlimit2)),
+                                                     std::abs(std::min(xlimit1, xlimit2)),
+                                                     std::abs(std::max(ylimit1, ylimit2)),
+                                                     std::abs(std::min(ylimit1, ylimit2)));
+
+    return setFeetPolygons(foot, foot);
+}
+
+bool FootprintConstraints::setFeetPolygons(const iDynTree::Polygon& leftFoot,
+                                           const iDynTree::Polygon& rightFoot)
+{
+    const iDynTree::Polygon* polygons[2] = {&leftFoot, &rightFoot};
+    for(std::size_t foot = 0; foot < 2; foot++)
+    {
+        std::size_t numberOfVertices = polygons[foot]->getNrOfVertices();
+        if(numberOfVertices < 3 || numberOfVertices > MaxFootVertices)
+        {
+            yError() << "[setFeetPolygons] The polygon of a foot must have between 3 and "
+                     << MaxFootVertices << " vertices.";
+            return false;
+        }
+
+        // the vertices are sorted counterclockwise and the collinear ones are removed
+        std::array<Eigen::Vector2d, MaxFootVertices> points;
+        for(std::size_t i = 0; i < numberOfVertices; i++)
+            points[i] << polygons[foot]->m_vertices[i](0), polygons[foot]->m_vertices[i](1);
+
+        std::array<Eigen::Vector2d, 2 * MaxFootVertices> hull;
+        std::size_t hullSize = computeConvexHull(points, numberOfVertices, hull);
+        if(hullSize < 3)
+        {
+            yError() << "[setFeetPolygons] The polygon of a foot is degenerate.";
+            return false;
+        }
+
+        Footprint& footprint = m_footprints[foot];
+        std::copy(hull.begin(), hull.begin() + hullSize, footprint.vertices.begin());
+        computeHalfSpaces(hull, hullSize, footprint.A, footprint.b);
+    }
+
+    for(auto& constraints : m_cache)
+        constraints.isValid = false;
+    m_current = nullptr;
+
+    m_AiDynTree.resize(MaxConstraints, 2);
+    m_biDynTree.resize(MaxConstraints);
+
+    return true;
+}
+
+int FootprintConstraints::getNumberOfFootVertices(std::size_t footIndex) const
+{
+    return m_footprints[footIndex].A.rows();
+}
+
+void FootprintConstraints::evaluateSingleSupport(std::size_t footIndex, const FootPose& pose,
+                                                 CachedConstraints& constraints) const
+{
+    // n' = R n and d' = d + n'^T t
+    const Footprint& footprint = m_footprints[footIndex];
+    Eigen::Matrix2d rotation;
+    rotation << std::cos(pose.yaw), -std::sin(pose.yaw),
+                std::sin(pose.yaw), std::cos(pose.yaw);
+    Eigen::Vector2d translation(pose.x, pose.y);
+
+    constraints.A.resize(footprint.A.rows(), 2);
+    constraints.A.noalias() = footprint.A * rotation.transpose();
+    constraints.b = footprint.b;
+    constraints.b.noalias() += constraints.A * translation;
+}
+
+void FootprintConstraints::evaluateDoubleSupport(CachedConstraints& constraints) const
+{
+    const FootPose* poses[2] = {&constraints.leftPose, &constraints.rightPose};
+
+    std::array<Eigen::Vector2d, MaxConstraints> points;
+    std::size_t numberOfPoints = 0;
+    for(std::size_t foot = 0; foot < 2; foot++)
+    {
+        const Footprint& footprint = m_footprints[foot];
+        Eigen::Matrix2d rotation;
+        rotation << std::cos(poses[foot]->yaw), -std::sin(poses[foot]->yaw),
+                    std::sin(poses[foot]->yaw), std::cos(poses[foot]->yaw);
+        Eigen::Vector2d translation(poses[foot]->x, poses[foot]->y);
+
+        for(std::size_t i = 0; i < static_cast<std::size_t>(footprint.A.rows()); i++)
+            points[numberOfPoints++] = rotation * footprint.vertices[i] + translation;
+    }
+
+    std::array<Eigen::Vector2d, 2 * MaxConstraints> hull;
+    std::size_t hullSize = computeConvexHull(points, numberOfPoints, hull);
+    computeHalfSpaces(hull, hullSize, constraints.A, constraints.b);
+}
+
+bool FootprintConstraints::evaluate(const iDynTree::Transform* leftFoot,
+                                    const iDynTree::Transform* rightFoot)
+{
+    if(leftFoot == nullptr && rightFoot == nullptr)
+    {
+        yError() << "[evaluate] At least a foot has to be in contact.";
+        return false;
+    }
+
+    if(m_footprints[0].A.rows() == 0)
+    {
+        yError() << "[evaluate] The feet polygons are not set. Please call setFeetPolygons().";
+        return false;
+    }
+
+    FootPose leftPose = leftFoot != nullptr ? getPose(*leftFoot) : FootPose();
+    FootPose rightPose = rightFoot != nullptr ? getPose(*rightFoot) : FootPose();
+
+    // 0: double support, 1: left support, 2: right support
+    std::size_t configuration = leftFoot == nullptr ? 2 : (rightFoot == nullptr ? 1 : 0);
+    CachedConstraints& constraints = m_cache[configuration];
+
+    // the constraints are evaluated only if the feet are moved
+    if(!constraints.isValid || !(constraints.leftPose == leftPose)
+       || !(constraints.rightPose == rightPose))
+    {
+        constraints.leftPose = leftPose;
+        constraints.rightPose = rightPose;
+
+        if(configuration == 0)
+            evaluateDoubleSupport(constraints);
+        else if(configuration == 1)
+            evaluateSingleSupport(0, leftPose, constraints);
+        else
+            evaluateSingleSupport(1, rightPose, constraints);
+
+        if(constraints.A.rows() == 0)
+        {
+            yError() << "[evaluate] The support polygon is degenerate.";
+            constraints.isValid = false;
+            m_current = nullptr;
+            return false;
+        }
+
+        constraints.isValid = true;
+    }
+
+    m_current = &constraints;
+
+    // the iDynTree buffers are allocated with the maximum size in setFeetPolygons()
+    int numberOfConstraints = constraints.A.rows();
+    m_AiDynTree.resize(numberOfConstraints, 2);
+    m_biDynTree.resize(numberOfConstraints);
+    for(int i = 0; i < numberOfConstraints; i++)
+    {
+        m_AiDynTree(i, 0) = constraints.A(i, 0);
+        m_AiDynTree(i, 1) = constraints.A(i, 1);
+        m_biDynTree(i) = constraints.b(i);
+    }
+
+    return true;
+}
+
+const iDynTree::MatrixDynSize& FootprintConstraints::getConstraintsMatrix() const
+{
+    return m_AiDynTree;
+}
+
+const iDynTree::VectorDynSize& FootprintConstraints::getConstraintsVector() const
+{
+    return m_biDynTree;
+}
+
+double FootprintConstraints::computeMargin(const iDynTree::Vector2& point) const
+{
+    return computeMinimumMargin(point.data(), 1);
+}
+
+double FootprintConstraints::computeMinimumMargin(const double* points, std::size_t numberOfPoints) const
+{
+    if(m_current == nullptr)
+    {
+        yError() << "[computeMinimumMargin] The constraints are not evaluated.";
+        return -std::numeric_limits<double>::infinity();
+    }
+
+    const ConstraintsMatrix& A = m_current->A;
+    const ConstraintsVector& b = m_current->b;
+
+    // the columns of A are contiguous so each point is checked against all the
+    // half-spaces with packed operations
+    double margin = std::numeric_limits<double>::infinity();
+    for(std::size_t i = 0; i < numberOfPoints; i++)
+    {
+        double x = points[2 * i];
+        double y = points[2 * i + 1];
+        margin = std::min(margin, (b - A.col(0) * x - A.col(1) * y).minCoeff());
+    }
+
+    return margin;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file FrameRingBuffer.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <algorithm>
+
+#include "FrameRingBuffer.hpp"
+
+void FrameRingBuffer::resize(std::size_t frameSize, std::size_t numberOfFrames)
+{
+    m_frameSize = frameSize;
+    m_numberOfFrames = numberOfFrames;
+    m_buffer.assign(m_frameSize * m_numberOfFrames, 0.0);
+
+    m_head.store(0);
+    m_tail.store(0);
+    m_droppedFrames.store(0);
+}
+
+double* FrameRingBuffer::beginWrite()
+{
+    // only the producer modifies the head
+    std::size_t head = m_head.load(std::memory_order_relaxed);
+    if(head - m_tail.load(std::memory_order_acquire) >= m_numberOfFrames)
+    {
+        m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    return m_buffer.data() + (head % m_numberOfFrames) * m_frameSize;
+}
+
+void FrameRingBuffer::endWrite()
+{
+    m_head.fetch_add(1, std::memory_order_release);
+}
+
+std::size_t FrameRingBuffer::read(double* output, std::size_t maxFrames)
+{
+    // only the consumer modifies the tail
+    std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    std::size_t availableFrames = m_head.load(std::memory_order_acquire) - tail;
+    std::size_t numberOfFrames = std::min(availableFrames, maxFrames);
+
+    for(std::size_t i = 0; i < numberOfFrames; i++)
+    {
+        const double* frame = m_buffer.data() + ((tail + i) % m_numberOfFrames) * m_frameSize;
+        std::copy(frame, frame + m_frameSize, output + i * m_frameSize);
+    }
+
+    m_tail.store(tail + numberOfFrames, std::memory_order_release);
+    return numberOfFrames;
+}
+
+std::size_t FrameRingBuffer::getFrameSize() const
+{
+    return m_frameSize;
+}
+
+std::size_t FrameRingBuffer::getNumberOfFrames() const
+{
+    return m_numberOfFrames;
+}
+
+std::size_t FrameRingBuffer::getDroppedFrames() const
+{
+    return m_droppedFrames.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,253 @@
+/**
+ * @file LookAheadIK.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cmath>
+
+// YARP
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Value.h>
+
+// iDynTree
+#include <iDynTree/Core/Rotation.h>
+
+#include "LookAheadIK.hpp"
+#include "RealTimeThread.hpp"
+
+LookAheadIK::~LookAheadIK()
+{
+    stop();
+}
+
+bool LookAheadIK::initialize(const yarp::os::Searchable& config,
+                             yarp::os::Searchable& inverseKinematicsOptions,
+                             const yarp::os::Searchable& generalOptions,
+                             const iDynTree::Model& model,
+                             const std::vector<std::string>& jointList)
+{
+    if(m_lookAheadThread.joinable())
+    {
+        yError() << "[LookAheadIK::initialize] The look-ahead thread is already running.";
+        return false;
+    }
+
+    int lookAheadSamples = config.check("look_ahead_samples", yarp::os::Value(5)).asInt();
+    if(lookAheadSamples <= 0)
+    {
+        yError() << "[LookAheadIK::initialize] The number of look-ahead samples has to be positive.";
+        return false;
+    }
+    m_lookAheadSamples = lookAheadSamples;
+
+    if(!m_IKSolver.initialize(inverseKinematicsOptions, model, jointList))
+    {
+        yError() << "[LookAheadIK::initialize] Unable to initialize the inverse kinematics solver.";
+        return false;
+    }
+
+    if(!m_stableDCMModel.initialize(generalOptions))
+    {
+        yError() << "[LookAheadIK::initialize] Unable to initialize the stable DCM model.";
+        return false;
+    }
+
+    // all the buffers are allocated here
+    std::size_t actuatedDOFs = jointList.size();
+    for(LookAheadIKRequest* request : {&m_request, &m_solverRequest})
+    {
+        request->dcmPosition.resize(m_lookAheadSamples);
+        request->jointPosition.resize(actuatedDOFs);
+    }
+    m_solution.resize(actuatedDOFs);
+    m_predictedCoMPosition.resize(m_lookAheadSamples);
+
+    // one more slot is required since the posture of the current tick is read after the request
+    // of the last one
+    m_results.resize(m_lookAheadSamples + 1);
+    for(auto& result : m_results)
+        result.jointPosition.resize(actuatedDOFs);
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_isClosing = false;
+        m_isRequestAvailable = false;
+    }
+    m_tick = 0;
+    m_generation = 0;
+    m_lookAheadThread = std::thread(&LookAheadIK::lookAheadThread, this);
+
+    return true;
+}
+
+void LookAheadIK::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_isClosing = true;
+        m_conditionVariable.notify_one();
+    }
+
+    if(m_lookAheadThread.joinable())
+    {
+        m_lookAheadThread.join();
+        m_lookAheadThread = std::thread();
+    }
+}
+
+void LookAheadIK::reset()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    // the postures that are evaluated with the old trajectory will be discarded
+    m_generation++;
+    m_isRequestAvailable = false;
+    for(auto& result : m_results)
+        result.isValid = false;
+}
+
+bool LookAheadIK::setRequest(const TrajectoryBuffer& trajectory,
+                             const iDynTree::Vector2& comPosition,
+                             const iDynTree::Rotation& inertial_R_worldFrame,
+                             const iDynTree::VectorDynSize& jointPosition)
+{
+    if(trajectory.empty())
+    {
+        yError() << "[LookAheadIK::setRequest] The trajectory is empty.";
+        return false;
+    }
+
+    if(jointPosition.size() != m_request.jointPosition.size())
+    {
+        yError() << "[LookAheadIK::setRequest] The size of the joint position is not coherent with "
+                 << "the number of the actuated joints.";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    // if the trajectory is shorter than the horizon the last sample is used
+    // (see TrajectoryView::operator[])
+    m_request.tick = m_tick + m_lookAheadSamples;
+    m_request.generation = m_generation;
+    m_request.leftFootTransform = trajectory.getLeftFootTrajectory()[m_lookAheadSamples];
+    m_request.rightFootTransform = trajectory.getRightFootTrajectory()[m_lookAheadSamples];
+    m_request.comHeight = trajectory.getCoMHeightTrajectory()[m_lookAheadSamples];
+    m_request.comPosition = comPosition;
+    for(std::size_t i = 0; i < m_lookAheadSamples; i++)
+        m_request.dcmPosition[i] = trajectory.getDCMPositionDesired()[i + 1];
+    m_request.inertial_R_worldFrame = inertial_R_worldFrame;
+    m_request.jointPosition = jointPosition;
+
+    m_isRequestAvailable = true;
+    m_conditionVariable.notify_one();
+
+    return true;
+}
+
+bool LookAheadIK::getPosture(iDynTree::VectorDynSize& jointPosition)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    LookAheadIKResult& result = m_results[m_tick % m_results.size()];
+    bool isAvailable = result.isValid && result.tick == m_tick && result.generation == m_generation;
+    if(isAvailable)
+        jointPosition = result.jointPosition;
+
+    result.isValid = false;
+    m_tick++;
+
+    return isAvailable;
+}
+
+std::size_t LookAheadIK::getLookAheadSamples() const
+{
+    return m_lookAheadSamples;
+}
+
+bool LookAheadIK::solve()
+{
+    // predict the CoM position with the stable DCM model (in one pass over the window)
+    if(!m_stableDCMModel.reset(m_solverRequest.comPosition))
+        return false;
+
+    const auto& dcmPosition = m_solverRequest.dcmPosition;
+    if(!m_stableDCMModel.predictCoMPosition(TrajectoryView<iDynTree::Vector2>(dcmPosition.data(),
+                                                                              dcmPosition.size(),
+                                                                              dcmPosition.size()),
+                                            m_predictedCoMPosition))
+        return false;
+
+    const iDynTree::Vector2& comPositionXY = m_predictedCoMPosition.back();
+
+    iDynTree::Position comPosition;
+    comPosition(0) = comPositionXY(0);
+    comPosition(1) = comPositionXY(1);
+    comPosition(2) = m_solverRequest.comHeight;
+
+    // the additional rotation follows the mean yaw of the feet (as in the control thread)
+    if(m_IKSolver.usingAdditionalRotationTarget())
+    {
+        double yawLeft = m_solverRequest.leftFootTransform.getRotation().asRPY()(2);
+        double yawRight = m_solverRequest.rightFootTransform.getRotation().asRPY()(2);
+        double meanYaw = std::atan2(std::sin(yawLeft) + std::sin(yawRight),
+                                    std::cos(yawLeft) + std::cos(yawRight));
+
+        iDynTree::Rotation modifiedInertial = iDynTree::Rotation::RotZ(meanYaw).inverse()
+            * m_solverRequest.inertial_R_worldFrame;
+        if(!m_IKSolver.updateIntertiaToWorldFrameRotation(modifiedInertial))
+            return false;
+    }
+
+    if(!m_IKSolver.setFullModelFeedBack(m_solverRequest.jointPosition))
+        return false;
+
+    return m_IKSolver.computeIK(m_solverRequest.leftFootTransform,
+                                m_solverRequest.rightFootTransform,
+                                comPosition, m_solution);
+}
+
+void LookAheadIK::lookAheadThread()
+{
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_conditionVariable.wait(lock, [&]{return m_isClosing || m_isRequestAvailable;});
+            if(m_isClosing)
+                break;
+
+            // only the last request is processed
+            std::swap(m_solverRequest, m_request);
+            m_isRequestAvailable = false;
+        }
+
+        if(!solve())
+        {
+            yWarning() << "[LookAheadIK::lookAheadThread] Unable to evaluate the posture of the tick"
+                       << m_solverRequest.tick;
+            continue;
+        }
+
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        // the posture is stored only if it is still useful
+        if(m_solverRequest.generation != m_generation || m_solverRequest.tick < m_tick)
+            continue;
+
+        LookAheadIKResult& result = m_results[m_solverRequest.tick % m_results.size()];
+        result.tick = m_solverRequest.tick;
+        result.generation = m_solverRequest.generation;
+        result.jointPosition = m_solution;
+        result.isValid = true;
+    }
+}
+
+bool LookAheadIK::setThreadAffinity(const std::vector<int>& cores)
+{
+    return RealTimeHelper::setThreadAffinity(m_lookAheadThread, cores);
+}
@@ -42,11 +42,36 @@ MPCSolver::MPCSolver(const int& stateSize, const int& inputSize,
 
     // resize vectors
     m_gradient = Eigen::VectorXd::Zero(numberOfVariables);
+    m_solution.resize(numberOfVariables);
     m_lowerBound = Eigen::VectorXd::Zero(numberOfConstraints);
     m_upperBound = Eigen::VectorXd::Zero(numberOfConstraints);
 
     for(int i = m_stateSize * (m_controllerHorizon + 1); i < numberOfConstraints; i++)
+    {
         m_lowerBound(i) = - OsqpEigen::INFTY;
+        m_upperBound(i) = OsqpEigen::INFTY;
+    }
+
+    // build the sparsity pattern of the constraints matrix.
+    // The inequality constraints depend only on the first input, its block is stored
+    // even if some elements are equal to zero. In this way the pattern never changes and
+    // the osqp solver is not reinitialized when the constraints are updated
+    std::vector<Eigen::Triplet<double>> constraintsTriplets;
+    for(auto triplet : *m_equalConstraintsMatrix)
+        constraintsTriplets.push_back(Eigen::Triplet<double>(triplet.row, triplet.column,
+                                                             triplet.value));
+
+    int inequalityConstraintsMatrixRowPos = m_stateSize * (m_controllerHorizon + 1);
+    int inequalityConstraintsMatrixColumnPos = m_stateSize * (m_controllerHorizon + 1);
+    for(int i = 0; i < m_numberOfInequalityConstraints; i++)
+        for(int j = 0; j < m_inputSize; j++)
+            constraintsTriplets.push_back(Eigen::Triplet<double>(inequalityConstraintsMatrixRowPos + i,
+                                                                 inequalityConstraintsMatrixColumnPos + j,
+                                                                 0.0));
+
+    m_constraintsMatrix.resize(numberOfConstraints, numberOfVariables);
+    m_constraintsMatrix.setFromTriplets(constraintsTriplets.begin(), constraintsTriplets.end());
+    m_constraintsMatrix.makeCompressed();
 
     m_optimizerSolver->settings()->setVerbosity(false);
 }
@@ -73,36 +98,38 @@ bool MPCSolver::setHessianMatrix(const iDynSparseMatrix& hessian)
     return true;
 }
 
-bool MPCSolver::setConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityConstraintsMatrix)
+bool MPCSolver::evaluateConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityConstraintsMatrix)
 {
-    // set the linear constraints matrix triplets
-    iDynTree::Triplets constraintsTriplets;
-    iDynTreeHelper::Triplets::pushTriplets(*m_equalConstraintsMatrix, constraintsTriplets);
+    if(inequalityConstraintsMatrix.rows() > m_numberOfInequalityConstraints ||
+       inequalityConstraintsMatrix.cols() != m_inputSize)
+    {
+        std::cerr << "[setLinearConstraintsMatrix] The inequality constraints matrix can have at most "
+                  << m_numberOfInequalityConstraints << " rows and it must have "
+                  << m_inputSize << " columns." << std::endl;
+        return false;
+    }
 
+    // update only the values of the inequality block. The element already exist
+    // in the matrix so coeffRef does not change the sparsity pattern
     int inequalityConstraintsMatrixRowPos = m_stateSize * (m_controllerHorizon + 1);
     int inequalityConstraintsMatrixColumnPos = m_stateSize * (m_controllerHorizon + 1);
-    constraintsTriplets.addSubMatrix(inequalityConstraintsMatrixRowPos,
-                                     inequalityConstraintsMatrixColumnPos,
-                                     inequalityConstraintsMatrix);
-
-    // convert triplets into a sparse matrix
-    int constraintsMatrixRows = m_stateSize * (m_controllerHorizon + 1) +
-        m_numberOfInequalityConstraints;
-    int constraintsMatrixCols = m_stateSize * (m_controllerHorizon + 1) +
-        m_inputSize * m_controllerHorizon;
-    iDynSparseMatrix constraintsMatrix(constraintsMatrixRows,
-                                       constraintsMatrixCols);
+    for(int i = 0; i < m_numberOfInequalityConstraints; i++)
+        for(int j = 0; j < m_inputSize; j++)
+            m_constraintsMatrix.coeffRef(inequalityConstraintsMatrixRowPos + i,
+                                         inequalityConstraintsMatrixColumnPos + j) =
+                i < inequalityConstraintsMatrix.rows() ? inequalityConstraintsMatrix(i, j) : 0.0;
 
-    constraintsMatrix.setFromConstTriplets(constraintsTriplets);
+    return true;
+}
 
-    // convert iDynTree sparse matrix in eigen sparse matrix
-    // it is required by the osqp library
-    Eigen::SparseMatrix<double> constraintsMatrixEigen =
-        iDynTree::toEigen(constraintsMatrix);
+bool MPCSolver::setConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityConstraintsMatrix)
+{
+    if(!evaluateConstraintsMatrix(inequalityConstraintsMatrix))
+        return false;
 
     if(m_optimizerSolver->isInitialized())
     {
-        if(!m_optimizerSolver->updateLinearConstraintsMatrix(constraintsMatrixEigen))
+        if(!m_optimizerSolver->updateLinearConstraintsMatrix(m_constraintsMatrix))
         {
             std::cerr << "[setLinearConstraintsMatrix] Unable to update the constraints matrix."
                       << std::endl;
@@ -111,7 +138,7 @@ bool MPCSolver::setConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityCo
     }
     else
     {
-        if(!m_optimizerSolver->data()->setLinearConstraintsMatrix(constraintsMatrixEigen))
+        if(!m_optimizerSolver->data()->setLinearConstraintsMatrix(m_constraintsMatrix))
         {
             std::cerr << "[setLinearConstraintsMatrix] Unable to set the constraints matrix."
                       << std::endl;
@@ -122,8 +149,8 @@ bool MPCSolver::setConstraintsMatrix(const iDynTree::MatrixDynSize& inequalityCo
     return true;
 }
 
-bool MPCSolver::setBounds(const iDynTree::Vector2& currentState,
-                          const iDynTree::VectorDynSize& inequalityConstraintsVector)
+bool MPCSolver::evaluateBounds(const iDynTree::Vector2& currentState,
+                               const iDynTree::VectorDynSize& inequalityConstraintsVector)
 {
     if(currentState.size() != m_stateSize)
     {
@@ -132,9 +159,9 @@ bool MPCSolver::setBounds(const iDynTree::Vector2& currentState,
         return false;
     }
 
-    if(inequalityConstraintsVector.size() != m_numberOfInequalityConstraints)
+    if(inequalityConstraintsVector.size() > m_numberOfInequalityConstraints)
     {
-        std::cerr << "[setBounds] The size of the inequalityConstraintsVector has to equal: "
+        std::cerr << "[setBounds] The size of the inequalityConstraintsVector has to be at most: "
                   << m_numberOfInequalityConstraints << std::endl;
         return false;
     }
@@ -149,8 +176,19 @@ bool MPCSolver::setBounds(const iDynTree::Vector2& currentState,
     // note: it should be removed from here. It is not necessary to update the inequality constraint
     // vector every iteration. It should be updated only when a change of phase
     // (SS->DS or vice versa) occurs
+    // the unused constraints are always satisfied
     for(int i = 0; i< m_numberOfInequalityConstraints; i++)
-        m_upperBound(m_stateSize * (m_controllerHorizon + 1) + i) = inequalityConstraintsVector(i);
+        m_upperBound(m_stateSize * (m_controllerHorizon + 1) + i) =
+            i < inequalityConstraintsVector.size() ? inequalityConstraintsVector(i) : OsqpEigen::INFTY;
+
+    return true;
+}
+
+bool MPCSolver::setBounds(const iDynTree::Vector2& currentState,
+                          const iDynTree::VectorDynSize& inequalityConstraintsVector)
+{
+    if(!evaluateBounds(currentState, inequalityConstraintsVector))
+        return false;
 
     if(m_optimizerSolver->isInitialized())
     {
@@ -180,12 +218,11 @@ bool MPCSolver::setBounds(const iDynTree::Vector2& currentState,
     return true;
 }
 
-bool MPCSolver::setGradient(const std::deque<iDynTree::Vector2>& referenceSignal,
-                            const iDynTree::Vector2& previousControllerOutput,
-                            const bool& resetTrajectory)
+void MPCSolver::evaluateGradient(const TrajectoryView<iDynTree::Vector2>& referenceSignal,
+                                 const iDynTree::Vector2& previousControllerOutput,
+                                 bool resetTrajectory)
 {
-    // the solver is not initialized or the trajectory was reset.
-    if(!m_optimizerSolver->isInitialized() || resetTrajectory)
+    if(resetTrajectory)
     {
         // check if the size of the controller horizon is lower than the size of the reference signal
         if(referenceSignal.size() >= m_controllerHorizon + 1)
@@ -243,6 +280,15 @@ bool MPCSolver::setGradient(const std::deque<iDynTree::Vector2>& referenceSignal
 
     m_gradient.block(gradientStateSize, 0, gradientInputSize, 1) =
         iDynTree::toEigen(*m_gradientSubmatrix) * iDynTree::toEigen(previousControllerOutput);
+}
+
+bool MPCSolver::setGradient(const TrajectoryView<iDynTree::Vector2>& referenceSignal,
+                            const iDynTree::Vector2& previousControllerOutput,
+                            const bool& resetTrajectory)
+{
+    // the solver is not initialized or the trajectory was reset.
+    evaluateGradient(referenceSignal, previousControllerOutput,
+                     !m_optimizerSolver->isInitialized() || resetTrajectory);
 
     if(m_optimizerSolver->isInitialized())
     {
@@ -287,6 +333,43 @@ bool MPCSolver::setPrimalVariable(const Eigen::VectorXd& primalVariable)
     return m_optimizerSolver->setPrimalVariable(primalVariable);
 }
 
+bool MPCSolver::getDualVariable(Eigen::VectorXd& dualVariable)
+{
+    if(!m_optimizerSolver->isInitialized())
+    {
+        std::cerr << "[getDualVariable] The solver is not initilialize."
+                  << std::endl;
+        return false;
+    }
+    return m_optimizerSolver->getDualVariable(dualVariable);
+}
+
+bool MPCSolver::setDualVariable(const Eigen::VectorXd& dualVariable)
+{
+    if(!m_optimizerSolver->isInitialized())
+    {
+        std::cerr << "[setDualVariable] The solver is not initilialize."
+                  << std::endl;
+        return false;
+    }
+    return m_optimizerSolver->setDualVariable(dualVariable);
+}
+
+int MPCSolver::getNumberOfConstraints() const
+{
+    return m_stateSize * (m_controllerHorizon + 1) + m_numberOfInequalityConstraints;
+}
+
+int MPCSolver::getNumberOfEqualityConstraints() const
+{
+    return m_stateSize * (m_controllerHorizon + 1);
+}
+
+int MPCSolver::getFirstInputIndex() const
+{
+    return m_stateSize * (m_controllerHorizon + 1);
+}
+
 bool MPCSolver::isInitialized()
 {
     return m_optimizerSolver->isInitialized();
@@ -309,14 +392,26 @@ bool MPCSolver::solve()
     return m_optimizerSolver->solve();
 }
 
-iDynTree::VectorDynSize MPCSolver::getSolution()
+const iDynTree::VectorDynSize& MPCSolver::getSolution()
 {
-    Eigen::VectorXd solutionEigen = m_optimizerSolver->getSolution();
+    iDynTree::toEigen(m_solution) = m_optimizerSolver->getSolution();
+    return m_solution;
+}
 
-    int solutionSize = m_stateSize * (m_controllerHorizon + 1) +
-        m_inputSize * m_controllerHorizon;
-    iDynTree::VectorDynSize solution(solutionSize);
-    iDynTree::toEigen(solution) = solutionEigen;
+const Eigen::VectorXd& MPCSolver::getGradient() const
+{
+    return m_gradient;
+}
+
+void MPCSolver::getStatistics(QPSolverStatistics& statistics)
+{
+    statistics = QPSolverStatistics();
+    if(!m_optimizerSolver->isInitialized())
+        return;
 
-    return solution;
+    const OSQPInfo* info = m_optimizerSolver->workspace()->info;
+    statistics.iterations = info->iter;
+    statistics.primalResidual = info->pri_res;
+    statistics.dualResidual = info->dua_res;
+    statistics.solveTime = info->solve_time;
 }
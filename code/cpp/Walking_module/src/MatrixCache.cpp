@@ -0,0 +1,283 @@
+/**
+ * @file MatrixCache.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// iDynTree
+#include <iDynTree/Core/EigenSparseHelpers.h>
+
+#include "MatrixCache.hpp"
+
+namespace
+{
+    const char Magic[8] = {'W', 'M', 'P', 'C', 'C', 'A', 'C', 'H'};
+    const std::uint32_t Version = 1;
+
+    /**
+     * Header of the file.
+     */
+    struct FileHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t numberOfEntries;
+        std::uint64_t key;
+    };
+
+    /**
+     * Element of the table of entries.
+     */
+    struct EntryHeader
+    {
+        char name[MatrixCache::MaxNameLength + 1];
+        std::uint32_t isSparse;
+        std::uint32_t padding;
+        std::uint64_t rows;
+        std::uint64_t cols;
+        std::uint64_t size; /**< Number of values. */
+        std::uint64_t offset; /**< Position of the data from the beginning of the file. */
+    };
+
+    /**
+     * Size of the data of an entry (multiple of 8 bytes).
+     */
+    std::uint64_t getDataSize(bool isSparse, std::uint64_t size)
+    {
+        std::uint64_t dataSize = size * sizeof(double);
+        if(isSparse)
+            dataSize += 2 * size * sizeof(std::int32_t);
+        return (dataSize + 7) / 8 * 8;
+    }
+}
+
+std::uint64_t MatrixCache::computeKey(const std::string& text)
+{
+    std::uint64_t hash = 14695981039346656037ULL;
+    for(unsigned char character : text)
+    {
+        hash ^= character;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void MatrixCache::clear()
+{
+    m_entries.clear();
+}
+
+void MatrixCache::addMatrix(const std::string& name, const Eigen::MatrixXd& matrix)
+{
+    Entry& entry = m_entries[name];
+    entry = Entry();
+    entry.rows = matrix.rows();
+    entry.cols = matrix.cols();
+    entry.values.assign(matrix.data(), matrix.data() + matrix.size());
+}
+
+void MatrixCache::addTriplets(const std::string& name, const iDynTree::Triplets& triplets,
+                              std::size_t rows, std::size_t cols)
+{
+    Entry& entry = m_entries[name];
+    entry = Entry();
+    entry.isSparse = true;
+    entry.rows = rows;
+    entry.cols = cols;
+    for(const auto& triplet : triplets)
+    {
+        entry.values.push_back(triplet.value);
+        entry.rowIndices.push_back(triplet.row);
+        entry.columnIndices.push_back(triplet.column);
+    }
+}
+
+void MatrixCache::addSparseMatrix(const std::string& name, const iDynSparseMatrix& matrix)
+{
+    Eigen::SparseMatrix<double> eigenMatrix = iDynTree::toEigen(matrix);
+
+    Entry& entry = m_entries[name];
+    entry = Entry();
+    entry.isSparse = true;
+    entry.rows = eigenMatrix.rows();
+    entry.cols = eigenMatrix.cols();
+    for(int k = 0; k < eigenMatrix.outerSize(); k++)
+    {
+        for(Eigen::SparseMatrix<double>::InnerIterator it(eigenMatrix, k); it; ++it)
+        {
+            entry.values.push_back(it.value());
+            entry.rowIndices.push_back(it.row());
+            entry.columnIndices.push_back(it.col());
+        }
+    }
+}
+
+bool MatrixCache::getMatrix(const std::string& name, Eigen::MatrixXd& matrix) const
+{
+    auto entry = m_entries.find(name);
+    if(entry == m_entries.end() || entry->second.isSparse)
+        return false;
+
+    matrix = Eigen::Map<const Eigen::MatrixXd>(entry->second.values.data(),
+                                               entry->second.rows, entry->second.cols);
+    return true;
+}
+
+bool MatrixCache::getTriplets(const std::string& name, iDynTree::Triplets& triplets) const
+{
+    auto entry = m_entries.find(name);
+    if(entry == m_entries.end() || !entry->second.isSparse)
+        return false;
+
+    triplets.clear();
+    triplets.reserve(entry->second.values.size());
+    for(std::size_t i = 0; i < entry->second.values.size(); i++)
+        triplets.pushTriplet(iDynTree::Triplet(entry->second.rowIndices[i],
+                                               entry->second.columnIndices[i],
+                                               entry->second.values[i]));
+    return true;
+}
+
+bool MatrixCache::getSparseMatrix(const std::string& name, iDynSparseMatrix& matrix) const
+{
+    iDynTree::Triplets triplets;
+    if(!getTriplets(name, triplets))
+        return false;
+
+    const Entry& entry = m_entries.at(name);
+    matrix.resize(entry.rows, entry.cols);
+    matrix.setFromConstTriplets(triplets);
+    return true;
+}
+
+bool MatrixCache::write(const std::string& fileName, std::uint64_t key) const
+{
+    FileHeader header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.numberOfEntries = m_entries.size();
+    header.key = key;
+
+    // evaluate the position of the data of each entry
+    std::vector<EntryHeader> table;
+    std::uint64_t offset = sizeof(FileHeader) + m_entries.size() * sizeof(EntryHeader);
+    for(const auto& entry : m_entries)
+    {
+        if(entry.first.size() > MaxNameLength)
+            return false;
+
+        EntryHeader entryHeader;
+        std::memset(&entryHeader, 0, sizeof(EntryHeader));
+        std::strncpy(entryHeader.name, entry.first.c_str(), MaxNameLength);
+        entryHeader.isSparse = entry.second.isSparse;
+        entryHeader.rows = entry.second.rows;
+        entryHeader.cols = entry.second.cols;
+        entryHeader.size = entry.second.values.size();
+        entryHeader.offset = offset;
+        offset += getDataSize(entry.second.isSparse, entryHeader.size);
+        table.push_back(entryHeader);
+    }
+
+    // the file is renamed only when it is complete
+    std::string temporaryFileName = fileName + ".tmp";
+    {
+        std::ofstream stream(temporaryFileName.c_str(), std::ios::binary | std::ios::trunc);
+        if(!stream.is_open())
+            return false;
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+        stream.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(EntryHeader));
+
+        const char padding[8] = {0};
+        for(const auto& entry : m_entries)
+        {
+            const Entry& data = entry.second;
+            std::uint64_t writtenSize = data.values.size() * sizeof(double);
+            stream.write(reinterpret_cast<const char*>(data.values.data()), writtenSize);
+            if(data.isSparse)
+            {
+                stream.write(reinterpret_cast<const char*>(data.rowIndices.data()),
+                             data.rowIndices.size() * sizeof(std::int32_t));
+                stream.write(reinterpret_cast<const char*>(data.columnIndices.data()),
+                             data.columnIndices.size() * sizeof(std::int32_t));
+                writtenSize += 2 * data.values.size() * sizeof(std::int32_t);
+            }
+            stream.write(padding, getDataSize(data.isSparse, data.values.size()) - writtenSize);
+        }
+
+        if(!stream.good())
+            return false;
+    }
+
+    return std::rename(temporaryFileName.c_str(), fileName.c_str()) == 0;
+}
+
+bool MatrixCache::read(const std::string& fileName, std::uint64_t key)
+{
+    m_entries.clear();
+
+    std::ifstream stream(fileName.c_str(), std::ios::binary | std::ios::ate);
+    if(!stream.is_open())
+        return false;
+
+    std::uint64_t fileSize = stream.tellg();
+    if(fileSize < sizeof(FileHeader))
+        return false;
+
+    // the buffer is aligned to 8 bytes as the data in the file
+    std::vector<std::uint64_t> buffer((fileSize + 7) / 8);
+    const char* file = reinterpret_cast<const char*>(buffer.data());
+    stream.seekg(0);
+    if(!stream.read(reinterpret_cast<char*>(buffer.data()), fileSize))
+        return false;
+
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(file);
+    if(std::memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != Version
+       || header->key != key)
+        return false;
+
+    std::uint64_t tableEnd = sizeof(FileHeader) + header->numberOfEntries * sizeof(EntryHeader);
+    if(tableEnd > fileSize)
+        return false;
+
+    const EntryHeader* table = reinterpret_cast<const EntryHeader*>(file + sizeof(FileHeader));
+    for(std::uint32_t i = 0; i < header->numberOfEntries; i++)
+    {
+        const EntryHeader& entryHeader = table[i];
+        bool isSparse = entryHeader.isSparse != 0;
+        if(entryHeader.offset < tableEnd || entryHeader.offset % 8 != 0
+           || entryHeader.offset + getDataSize(isSparse, entryHeader.size) > fileSize
+           || (!isSparse && entryHeader.rows * entryHeader.cols != entryHeader.size))
+        {
+            m_entries.clear();
+            return false;
+        }
+
+        Entry entry;
+        entry.isSparse = isSparse;
+        entry.rows = entryHeader.rows;
+        entry.cols = entryHeader.cols;
+
+        const double* values = reinterpret_cast<const double*>(file + entryHeader.offset);
+        entry.values.assign(values, values + entryHeader.size);
+        if(isSparse)
+        {
+            const std::int32_t* rowIndices = reinterpret_cast<const std::int32_t*>(values + entryHeader.size);
+            const std::int32_t* columnIndices = rowIndices + entryHeader.size;
+            entry.rowIndices.assign(rowIndices, rowIndices + entryHeader.size);
+            entry.columnIndices.assign(columnIndices, columnIndices + entryHeader.size);
+        }
+
+        std::string name(entryHeader.name, strnlen(entryHeader.name, MaxNameLength + 1));
+        m_entries[name] = std::move(entry);
+    }
+
+    return true;
+}
@@ -0,0 +1,196 @@
+/**
+ * @file QPIKRace.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <chrono>
+
+// YARP
+#include <yarp/os/LogStream.h>
+
+#include "QPIKRace.hpp"
+#include "RealTimeThread.hpp"
+
+constexpr std::size_t QPIKRace::NumberOfSolvers;
+
+QPIKRace::~QPIKRace()
+{
+    stop();
+}
+
+bool QPIKRace::initialize(const std::array<std::function<bool()>, NumberOfSolvers>& solvers,
+                          double budget, const std::vector<int>& cores)
+{
+    if(!cores.empty() && cores.size() != NumberOfSolvers)
+    {
+        yError() << "[QPIKRace::initialize] A core for each solver is required.";
+        return false;
+    }
+
+    for(const auto& worker : m_workers)
+    {
+        if(worker.thread.joinable())
+        {
+            yError() << "[QPIKRace::initialize] The worker threads are already running.";
+            return false;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_isClosing = false;
+        m_budget = budget;
+        m_round = 0;
+        m_winner = -1;
+        m_finishedSolvers = 0;
+        m_racesWithoutWinner = 0;
+        for(std::size_t i = 0; i < NumberOfSolvers; i++)
+        {
+            m_workers[i].solve = solvers[i];
+            m_workers[i].isBusy = false;
+            m_workers[i].hasTask = false;
+            m_workers[i].wins = 0;
+        }
+    }
+
+    for(std::size_t i = 0; i < NumberOfSolvers; i++)
+    {
+        m_workers[i].thread = std::thread(&QPIKRace::workerThread, this, i);
+
+        // each solver has its own core, so the two solvers do not share the cache
+        if(!cores.empty()
+           && !RealTimeHelper::setThreadAffinity(m_workers[i].thread, std::vector<int>(1, cores[i])))
+        {
+            yError() << "[QPIKRace::initialize] Unable to pin the worker thread" << i;
+            stop();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void QPIKRace::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_isClosing = true;
+        m_workerConditionVariable.notify_all();
+    }
+
+    for(auto& worker : m_workers)
+    {
+        if(worker.thread.joinable())
+        {
+            worker.thread.join();
+            worker.thread = std::thread();
+        }
+    }
+}
+
+void QPIKRace::workerThread(std::size_t index)
+{
+    Worker& worker = m_workers[index];
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true)
+    {
+        m_workerConditionVariable.wait(lock, [&]{return m_isClosing || worker.hasTask;});
+        if(m_isClosing)
+            return;
+
+        worker.hasTask = false;
+        std::size_t round = worker.round;
+
+        lock.unlock();
+        bool isSolved = worker.solve();
+        lock.lock();
+
+        worker.isBusy = false;
+
+        // the result of a race that is already finished is ignored
+        if(round != m_round)
+            continue;
+
+        m_finishedSolvers++;
+        if(isSolved && m_winner < 0)
+            m_winner = index;
+
+        m_raceConditionVariable.notify_one();
+    }
+}
+
+bool QPIKRace::isIdle(std::size_t solver)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return !m_workers[solver].isBusy;
+}
+
+int QPIKRace::race(const std::array<bool, NumberOfSolvers>& isProblemSet)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_round++;
+    m_winner = -1;
+    m_finishedSolvers = 0;
+
+    std::size_t startedSolvers = 0;
+    for(std::size_t i = 0; i < NumberOfSolvers; i++)
+    {
+        if(!isProblemSet[i])
+            continue;
+
+        if(m_workers[i].isBusy)
+        {
+            yError() << "[QPIKRace::race] The solver" << i << "is still running.";
+            continue;
+        }
+
+        m_workers[i].isBusy = true;
+        m_workers[i].hasTask = true;
+        m_workers[i].round = m_round;
+        startedSolvers++;
+    }
+
+    if(startedSolvers == 0)
+    {
+        m_racesWithoutWinner++;
+        return -1;
+    }
+
+    m_workerConditionVariable.notify_all();
+
+    auto isFinished = [&]{return m_winner >= 0 || m_finishedSolvers == startedSolvers;};
+    if(m_budget > 0)
+        m_raceConditionVariable.wait_for(lock, std::chrono::duration<double>(m_budget), isFinished);
+    else
+        m_raceConditionVariable.wait(lock, isFinished);
+
+    int winner = m_winner;
+
+    // the solvers that are still running do not change the result of this race
+    m_round++;
+
+    if(winner >= 0)
+        m_workers[winner].wins++;
+    else
+        m_racesWithoutWinner++;
+
+    return winner;
+}
+
+unsigned long int QPIKRace::getNumberOfWins(std::size_t solver)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_workers[solver].wins;
+}
+
+unsigned long int QPIKRace::getNumberOfRacesWithoutWinner()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_racesWithoutWinner;
+}
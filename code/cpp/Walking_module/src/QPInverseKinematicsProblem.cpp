@@ -0,0 +1,20 @@
+/**
+ * @file QPInverseKinematicsProblem.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#include "QPInverseKinematicsProblem.hpp"
+
+std::unique_ptr<QPIKProblemInterface> makeQPIKProblem(int actuatedDOFs)
+{
+    // number of joints controlled by all the configurations stored in app/robots
+    if(actuatedDOFs == 23)
+        return std::make_unique<QPIKProblem<23>>();
+
+    yInfo() << "[makeQPIKProblem] A fixed size QP-IK problem is not available for" << actuatedDOFs
+            << "DoFs. The size will be set at runtime.";
+    return std::make_unique<QPIKProblem<Eigen::Dynamic>>();
+}
@@ -0,0 +1,291 @@
+/**
+ * @file RealTimeThread.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+// POSIX
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+// YARP
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Value.h>
+
+#include "RealTimeThread.hpp"
+
+namespace
+{
+    bool setAffinity(pthread_t thread, const std::vector<int>& cores)
+    {
+        if(cores.empty())
+            return true;
+
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for(int core : cores)
+        {
+            if(core < 0 || core >= CPU_SETSIZE)
+            {
+                yError() << "[setAffinity] Invalid core" << core;
+                return false;
+            }
+            CPU_SET(core, &cpuSet);
+        }
+
+        int error = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuSet);
+        if(error != 0)
+        {
+            yError() << "[setAffinity] Unable to set the affinity:" << std::strerror(error);
+            return false;
+        }
+        return true;
+    }
+}
+
+bool RealTimeHelper::setThreadAffinity(std::thread& thread, const std::vector<int>& cores)
+{
+    if(!thread.joinable())
+    {
+        yError() << "[setThreadAffinity] The thread is not running.";
+        return false;
+    }
+    return setAffinity(thread.native_handle(), cores);
+}
+
+bool RealTimeHelper::setCurrentThreadAffinity(const std::vector<int>& cores)
+{
+    return setAffinity(pthread_self(), cores);
+}
+
+bool RealTimeHelper::getCoresFromSearchable(const yarp::os::Searchable& config, const std::string& key,
+                                            std::vector<int>& cores)
+{
+    cores.clear();
+
+    yarp::os::Value* value;
+    if(!config.check(key, value))
+        return true;
+
+    // a single core can be also written without the parenthesis
+    if(value->isInt())
+    {
+        cores.push_back(value->asInt());
+        return true;
+    }
+
+    yarp::os::Bottle* list = value->asList();
+    if(list == nullptr)
+    {
+        yError() << "[getCoresFromSearchable] The field" << key << "is not a list.";
+        return false;
+    }
+
+    for(int i = 0; i < list->size(); i++)
+    {
+        if(!list->get(i).isInt())
+        {
+            yError() << "[getCoresFromSearchable] The elements of" << key << "have to be integers.";
+            return false;
+        }
+        cores.push_back(list->get(i).asInt());
+    }
+    return true;
+}
+
+RealTimeThread::~RealTimeThread()
+{
+    stop();
+}
+
+bool RealTimeThread::configure(const yarp::os::Searchable& config, double period)
+{
+    if(m_thread.joinable())
+    {
+        yError() << "[RealTimeThread::configure] The thread is already running.";
+        return false;
+    }
+
+    if(period <= 0)
+    {
+        yError() << "[RealTimeThread::configure] The period has to be positive.";
+        return false;
+    }
+    m_period = period;
+
+    m_priority = config.check("real_time_priority", yarp::os::Value(80)).asInt();
+    if(m_priority > sched_get_priority_max(SCHED_FIFO))
+    {
+        yError() << "[RealTimeThread::configure] The maximum SCHED_FIFO priority is"
+                 << sched_get_priority_max(SCHED_FIFO);
+        return false;
+    }
+
+    m_core = config.check("real_time_core", yarp::os::Value(-1)).asInt();
+    m_lockMemory = config.check("real_time_lock_memory", yarp::os::Value(true)).asBool();
+
+    int stackPrefaultSize = config.check("real_time_stack_prefault", yarp::os::Value(512 * 1024)).asInt();
+    if(stackPrefaultSize < 0)
+    {
+        yError() << "[RealTimeThread::configure] The size of the prefaulted stack cannot be negative.";
+        return false;
+    }
+    m_stackPrefaultSize = stackPrefaultSize;
+
+    return true;
+}
+
+bool RealTimeThread::start(const std::function<bool()>& step)
+{
+    if(m_thread.joinable())
+    {
+        yError() << "[RealTimeThread::start] The thread is already running.";
+        return false;
+    }
+
+    // the memory allocated from now on is locked as well
+    if(m_lockMemory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        yError() << "[RealTimeThread::start] Unable to lock the memory:" << std::strerror(errno);
+        return false;
+    }
+
+    m_step = step;
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_isClosing = false;
+        m_isConfigured = false;
+        m_isConfigurationSuccessful = false;
+    }
+    m_isRunning = true;
+    m_thread = std::thread(&RealTimeThread::periodicThread, this);
+
+    bool isConfigurationSuccessful;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_conditionVariable.wait(lock, [&]{return m_isConfigured;});
+        isConfigurationSuccessful = m_isConfigurationSuccessful;
+    }
+
+    if(!isConfigurationSuccessful)
+    {
+        yError() << "[RealTimeThread::start] Unable to apply the real-time settings.";
+        stop();
+        return false;
+    }
+
+    return true;
+}
+
+void RealTimeThread::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_isClosing = true;
+        m_conditionVariable.notify_all();
+    }
+
+    if(m_thread.joinable())
+    {
+        m_thread.join();
+        m_thread = std::thread();
+    }
+    m_isRunning = false;
+}
+
+bool RealTimeThread::isRunning() const
+{
+    return m_isRunning;
+}
+
+double RealTimeThread::getLastPeriod() const
+{
+    return m_lastPeriod;
+}
+
+bool RealTimeThread::configureCurrentThread()
+{
+    if(m_core >= 0 && !RealTimeHelper::setCurrentThreadAffinity({m_core}))
+        return false;
+
+    if(m_priority > 0)
+    {
+        sched_param parameters;
+        parameters.sched_priority = m_priority;
+        int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters);
+        if(error != 0)
+        {
+            yError() << "[RealTimeThread::configureCurrentThread] Unable to set the SCHED_FIFO policy:"
+                     << std::strerror(error);
+            return false;
+        }
+    }
+
+    // touch the stack that will be used by the loop, the pages stay locked
+    if(m_stackPrefaultSize > 0)
+    {
+        volatile unsigned char* stack = static_cast<unsigned char*>(alloca(m_stackPrefaultSize));
+        for(std::size_t i = 0; i < m_stackPrefaultSize; i += 4096)
+            stack[i] = 0;
+    }
+
+    return true;
+}
+
+void RealTimeThread::periodicThread()
+{
+    bool isConfigurationSuccessful = configureCurrentThread();
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_isConfigured = true;
+        m_isConfigurationSuccessful = isConfigurationSuccessful;
+        m_conditionVariable.notify_all();
+    }
+
+    if(!isConfigurationSuccessful)
+    {
+        m_isRunning = false;
+        return;
+    }
+
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>
+        (std::chrono::duration<double>(m_period));
+    auto deadline = std::chrono::steady_clock::now();
+    // the first period is considered nominal
+    auto previousWakeUp = deadline - period;
+
+    while(true)
+    {
+        auto wakeUp = std::chrono::steady_clock::now();
+        m_lastPeriod = std::chrono::duration<double>(wakeUp - previousWakeUp).count();
+        previousWakeUp = wakeUp;
+
+        if(!m_step())
+        {
+            yError() << "[RealTimeThread::periodicThread] The step function failed. The thread is stopped.";
+            break;
+        }
+
+        // the deadlines are kept on the same grid, the missed periods are skipped
+        deadline += period;
+        auto now = std::chrono::steady_clock::now();
+        if(deadline < now)
+            deadline += ((now - deadline) / period + 1) * period;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if(m_conditionVariable.wait_until(lock, deadline, [&]{return m_isClosing;}))
+            break;
+    }
+
+    m_isRunning = false;
+}
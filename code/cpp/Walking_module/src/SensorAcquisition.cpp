@@ -0,0 +1,159 @@
+/**
+ * @file SensorAcquisition.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <algorithm>
+#include <chrono>
+
+// YARP
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Time.h>
+#include <yarp/os/Value.h>
+
+#include "SensorAcquisition.hpp"
+
+SensorAcquisition::~SensorAcquisition()
+{
+    stop();
+}
+
+bool SensorAcquisition::initialize(const yarp::os::Searchable& config,
+                                   yarp::dev::IEncodersTimed* encodersInterface, int actuatedDOFs,
+                                   yarp::os::BufferedPort<yarp::sig::Vector>* leftWrenchPort,
+                                   yarp::os::BufferedPort<yarp::sig::Vector>* rightWrenchPort)
+{
+    if(m_acquisitionThread.joinable())
+    {
+        yError() << "[SensorAcquisition::initialize] The acquisition thread is already running.";
+        return false;
+    }
+
+    if(encodersInterface == nullptr || leftWrenchPort == nullptr || rightWrenchPort == nullptr)
+    {
+        yError() << "[SensorAcquisition::initialize] The interfaces are not ready.";
+        return false;
+    }
+
+    m_period = config.check("sensor_acquisition_period", yarp::os::Value(0.002)).asDouble();
+    if(m_period <= 0)
+    {
+        yError() << "[SensorAcquisition::initialize] The period of the acquisition thread has to be positive.";
+        return false;
+    }
+
+    m_encodersInterface = encodersInterface;
+    m_leftWrenchPort = leftWrenchPort;
+    m_rightWrenchPort = rightWrenchPort;
+
+    // all the buffers are allocated here
+    m_encodersTimeStamps.resize(actuatedDOFs, 0.0);
+    m_positionBuffer.resize(actuatedDOFs, 0.0);
+    m_velocityBuffer.resize(actuatedDOFs, 0.0);
+
+    m_sample.positionInDegrees.resize(actuatedDOFs, 0.0);
+    m_sample.velocityInDegrees.resize(actuatedDOFs, 0.0);
+    m_sample.leftWrench.resize(6, 0.0);
+    m_sample.rightWrench.resize(6, 0.0);
+    m_sample.encodersTimeStamp = -1;
+    m_sample.leftWrenchTimeStamp = -1;
+    m_sample.rightWrenchTimeStamp = -1;
+    m_sample.sequenceNumber = 0;
+    m_snapshots.initialize(m_sample);
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_isClosing = false;
+    }
+    m_acquisitionThread = std::thread(&SensorAcquisition::acquisitionThread, this);
+
+    return true;
+}
+
+void SensorAcquisition::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_isClosing = true;
+        m_conditionVariable.notify_one();
+    }
+
+    if(m_acquisitionThread.joinable())
+    {
+        m_acquisitionThread.join();
+        m_acquisitionThread = std::thread();
+    }
+}
+
+bool SensorAcquisition::readSensors()
+{
+    bool isUpdated = false;
+    double now = yarp::os::Time::now();
+
+    // the sample is updated only if both the position and the velocity are read
+    if(m_encodersInterface->getEncodersTimed(m_positionBuffer.data(), m_encodersTimeStamps.data())
+       && m_encodersInterface->getEncoderSpeeds(m_velocityBuffer.data()))
+    {
+        m_sample.positionInDegrees = m_positionBuffer;
+        m_sample.velocityInDegrees = m_velocityBuffer;
+
+        // some devices do not provide the time stamps, in that case the time of the reading is used
+        double timeStamp = 0;
+        for(std::size_t i = 0; i < m_encodersTimeStamps.size(); i++)
+            timeStamp = std::max(timeStamp, m_encodersTimeStamps[i]);
+        m_sample.encodersTimeStamp = timeStamp > 0 ? timeStamp : now;
+        isUpdated = true;
+    }
+
+    yarp::sig::Vector* leftWrench = m_leftWrenchPort->read(false);
+    if(leftWrench != nullptr)
+    {
+        m_sample.leftWrench = *leftWrench;
+        m_sample.leftWrenchTimeStamp = now;
+        isUpdated = true;
+    }
+
+    yarp::sig::Vector* rightWrench = m_rightWrenchPort->read(false);
+    if(rightWrench != nullptr)
+    {
+        m_sample.rightWrench = *rightWrench;
+        m_sample.rightWrenchTimeStamp = now;
+        isUpdated = true;
+    }
+
+    return isUpdated;
+}
+
+void SensorAcquisition::acquisitionThread()
+{
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>
+        (std::chrono::duration<double>(m_period));
+    auto deadline = std::chrono::steady_clock::now();
+
+    while(true)
+    {
+        if(readSensors())
+        {
+            m_snapshots.back() = m_sample;
+            m_snapshots.publish();
+            m_sample.sequenceNumber++;
+        }
+
+        // if the thread is late the readings are not accumulated
+        deadline = std::max(deadline + period, std::chrono::steady_clock::now());
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if(m_conditionVariable.wait_until(lock, deadline, [&]{return m_isClosing;}))
+            break;
+    }
+}
+
+const SensorSnapshot& SensorAcquisition::getLatestSnapshot()
+{
+    m_snapshots.update();
+    return m_snapshots.front();
+}
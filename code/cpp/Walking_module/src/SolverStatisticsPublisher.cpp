@@ -0,0 +1,92 @@
+/**
+ * @file SolverStatisticsPublisher.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// YARP
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/Value.h>
+
+#include "SolverStatisticsPublisher.hpp"
+
+SolverStatisticsPublisher::~SolverStatisticsPublisher()
+{
+    close();
+}
+
+bool SolverStatisticsPublisher::configure(const yarp::os::Searchable& config,
+                                          const std::string& portPrefix)
+{
+    m_decimation = config.check("solver_statistics_decimation", yarp::os::Value(10)).asInt();
+    if(m_decimation < 1)
+    {
+        yError() << "[configure] The solver_statistics_decimation has to be at least 1.";
+        return false;
+    }
+    m_counter = 0;
+
+    std::string portName = portPrefix + "/solverStatistics:o";
+    if(!m_port.open(portName))
+    {
+        yError() << "[configure] Could not open" << portName << "port.";
+        return false;
+    }
+    m_isOpen = true;
+
+    // the connection is optional, the port can be connected later (e.g. yarp connect)
+    std::string remote = config.check("solver_statistics_remote", yarp::os::Value("")).asString();
+    if(!remote.empty())
+    {
+        std::string carrier = config.check("solver_statistics_carrier",
+                                           yarp::os::Value("shmem")).asString();
+        if(!yarp::os::Network::connect(portName, remote, carrier))
+            yWarning() << "[configure] Unable to connect" << portName << "to" << remote
+                       << "using the" << carrier << "carrier.";
+    }
+
+    return true;
+}
+
+void SolverStatisticsPublisher::publish(const SolverStatistics& statistics)
+{
+    if(!m_isOpen || ++m_counter < m_decimation)
+        return;
+    m_counter = 0;
+
+    // the size is constant so the buffer is allocated only the first time
+    yarp::sig::Vector& message = m_port.prepare();
+    message.resize(MessageSize);
+
+    message(0) = statistics.time;
+    message(1) = statistics.tickDuration;
+    message(2) = statistics.isMPCSolved;
+    message(3) = statistics.isMPCUnconstrained;
+    message(4) = statistics.isReactiveControllerUsed;
+    message(5) = statistics.mpc.iterations;
+    message(6) = statistics.mpc.primalResidual;
+    message(7) = statistics.mpc.dualResidual;
+    message(8) = statistics.mpc.solveTime;
+    message(9) = statistics.zmpMargin;
+    message(10) = statistics.zmpHorizonMargin;
+    message(11) = statistics.qpIK.iterations;
+    message(12) = statistics.qpIK.primalResidual;
+    message(13) = statistics.qpIK.dualResidual;
+    message(14) = statistics.qpIK.solveTime;
+    message(15) = statistics.ikSolveTime;
+    message(16) = statistics.ikConsecutiveFallbacks;
+
+    m_port.write();
+}
+
+void SolverStatisticsPublisher::close()
+{
+    if(!m_isOpen)
+        return;
+
+    m_port.close();
+    m_isOpen = false;
+}
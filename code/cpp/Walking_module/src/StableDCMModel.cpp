@@ -6,16 +6,14 @@
  * @date 2018
  */
 
-#include <math.h>
+#include <cmath>
+#include <string>
 
 // YARP
-#include <yarp/sig/Vector.h>
 #include <yarp/os/LogStream.h>
 
 //iDynTree
 #include "iDynTree/Core/EigenHelpers.h"
-#include <iDynTree/yarp/YARPConversions.h>
-#include <iDynTree/yarp/YARPEigenConversions.h>
 
 #include "StableDCMModel.hpp"
 #include "Utils.hpp"
@@ -36,7 +34,7 @@ bool StableDCMModel::initialize(const yarp::os::Searchable& config)
     }
     double gravityAcceleration = config.check("gravity_acceleration", yarp::os::Value(9.81)).asDouble();
 
-    m_omega = sqrt(gravityAcceleration / comHeight);
+    m_omega = std::sqrt(gravityAcceleration / comHeight);
 
     // set the sampling time
     double samplingTime;
@@ -45,12 +43,27 @@ bool StableDCMModel::initialize(const yarp::os::Searchable& config)
         yError() << "[initialize] Unable to get a double from a searchable.";
         return false;
     }
+    m_samplingTime = samplingTime;
+
+    std::string discretization = config.check("lipm_discretization", yarp::os::Value("trapezoidal")).asString();
+    if(discretization == "trapezoidal")
+        m_discretization = LIPMDiscretization::Trapezoidal;
+    else if(discretization == "exact")
+        m_discretization = LIPMDiscretization::Exact;
+    else
+    {
+        yError() << "[initialize] Unknown discretization: " << discretization
+                 << ". Please use 'trapezoidal' or 'exact'.";
+        return false;
+    }
+    m_stateCoefficient = std::exp(-m_omega * m_samplingTime);
 
-    yarp::sig::Vector buffer;
-    buffer.resize(2, 0.0);
-
-    // instantiate Integrator object
-    m_comIntegrator = std::make_unique<iCub::ctrl::Integrator>(samplingTime, buffer);
+    // the state is integrated in place (as the iCub::ctrl::Integrator does but without
+    // allocating memory in each step)
+    m_comPosition.zero();
+    m_comVelocity.zero();
+    m_previousCoMVelocity.zero();
+    m_isInitialized = true;
 
     return true;
 }
@@ -60,29 +73,41 @@ void StableDCMModel::setInput(const iDynTree::Vector2& input)
     m_dcmPosition = input;
 }
 
+void StableDCMModel::propagate(const iDynTree::Vector2& dcmPosition, iDynTree::Vector2& comPosition,
+                               iDynTree::Vector2& comVelocity, iDynTree::Vector2& previousCoMVelocity) const
+{
+    if(m_discretization == LIPMDiscretization::Exact)
+    {
+        // x(k+1) = dcm + e^{-omega dT} (x(k) - dcm), the velocity is the one of the new state
+        iDynTree::toEigen(comPosition) = iDynTree::toEigen(dcmPosition) + m_stateCoefficient *
+            (iDynTree::toEigen(comPosition) - iDynTree::toEigen(dcmPosition));
+        iDynTree::toEigen(comVelocity) = -m_omega * (iDynTree::toEigen(comPosition) -
+                                                     iDynTree::toEigen(dcmPosition));
+        return;
+    }
+
+    // evaluate the velocity of the CoM
+    iDynTree::toEigen(comVelocity) = -m_omega * (iDynTree::toEigen(comPosition) -
+                                                 iDynTree::toEigen(dcmPosition));
+
+    // integrate velocities (trapezoidal rule)
+    iDynTree::toEigen(comPosition) += m_samplingTime / 2.0 * (iDynTree::toEigen(comVelocity) +
+                                                              iDynTree::toEigen(previousCoMVelocity));
+    previousCoMVelocity = comVelocity;
+}
+
 bool StableDCMModel::integrateModel()
 {
     m_isModelPropagated = false;
 
-    if(m_comIntegrator == nullptr)
+    if(!m_isInitialized)
     {
         yError() << "[integrateModel] The dcm integrator object is not ready. "
                  << "Please call initialize method.";
         return false;
     }
 
-    // evaluate the velocity of the CoM
-    yarp::sig::Vector comVelocityYarp(2);
-    iDynTree::toEigen(comVelocityYarp) = -m_omega * (iDynTree::toEigen(m_comPosition) -
-                                                     iDynTree::toEigen(m_dcmPosition));
-
-    // integrate velocities
-    yarp::sig::Vector comPositionYarp(2);
-    comPositionYarp = m_comIntegrator->integrate(comVelocityYarp);
-
-    // convert YARP vector into iDynTree vector
-    iDynTree::toiDynTree(comVelocityYarp, m_comVelocity);
-    iDynTree::toiDynTree(comPositionYarp, m_comPosition);
+    propagate(m_dcmPosition, m_comPosition, m_comVelocity, m_previousCoMVelocity);
 
     m_isModelPropagated = true;
 
@@ -113,18 +138,45 @@ bool StableDCMModel::getCoMVelocity(iDynTree::Vector2& comVelocity)
     return true;
 }
 
+bool StableDCMModel::predictCoMPosition(const TrajectoryView<iDynTree::Vector2>& dcmReference,
+                                        std::vector<iDynTree::Vector2>& comPosition) const
+{
+    if(!m_isInitialized)
+    {
+        yError() << "[predictCoMPosition] The dcm integrator object is not ready. "
+                 << "Please call initialize method.";
+        return false;
+    }
+
+    if(dcmReference.empty())
+    {
+        yError() << "[predictCoMPosition] The DCM reference is empty.";
+        return false;
+    }
+
+    // the state is copied so the model is not changed. x and y are advanced together
+    iDynTree::Vector2 position = m_comPosition;
+    iDynTree::Vector2 velocity = m_comVelocity;
+    iDynTree::Vector2 previousVelocity = m_previousCoMVelocity;
+    for(std::size_t i = 0; i < comPosition.size(); i++)
+    {
+        propagate(dcmReference[i], position, velocity, previousVelocity);
+        comPosition[i] = position;
+    }
+
+    return true;
+}
+
 bool StableDCMModel::reset(const iDynTree::Vector2& initialValue)
 {
-    if(m_comIntegrator == nullptr)
+    if(!m_isInitialized)
     {
         yError() << "[reset] The dcm integrator object is not ready. "
                  << "Please call initialize method.";
         return false;
     }
 
-    yarp::sig::Vector buffer;
-    iDynTree::toYarp(initialValue, buffer);
-
-    m_comIntegrator->reset(buffer);
+    m_comPosition = initialValue;
+    m_previousCoMVelocity.zero();
     return true;
 }
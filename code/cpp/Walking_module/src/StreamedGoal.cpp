@@ -0,0 +1,31 @@
+/**
+ * @file StreamedGoal.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+#include "StreamedGoal.hpp"
+
+void StreamedGoal::set(double x, double y)
+{
+    m_goal(0) = x;
+    m_goal(1) = y;
+    m_isPending = true;
+}
+
+void StreamedGoal::clear()
+{
+    m_isPending = false;
+}
+
+bool StreamedGoal::isPending() const
+{
+    return m_isPending;
+}
+
+const iDynTree::Vector2& StreamedGoal::get() const
+{
+    return m_goal;
+}
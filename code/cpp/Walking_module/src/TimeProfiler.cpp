@@ -6,40 +6,140 @@
  * @date 2018
  */
 
+// std
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
 // YARP
 #include <yarp/os/LogStream.h>
 
 #include "TimeProfiler.hpp"
 
-const double& Timer::getAverageDuration() const
+void Timer::setWindowSize(std::size_t windowSize)
 {
-    return m_averageDuration;
+    m_samples.resize(windowSize);
+    m_sortedSamples.resize(windowSize);
+    m_numberOfSamples = 0;
+    m_nextSample = 0;
 }
 
-void Timer::resetAverageDuration()
+void Timer::setDeadline(double deadline)
 {
-    m_averageDuration = 0;
+    m_deadline = deadline;
 }
 
 void Timer::setInitTime()
 {
-    m_initTime = clock();
+    m_initTime = std::chrono::steady_clock::now();
 }
 
 void Timer::setEndTime()
 {
-    m_endTime = clock();
+    m_endTime = std::chrono::steady_clock::now();
+}
+
+void Timer::setValue(double value)
+{
+    m_value = value;
+    m_isValueSet = true;
+}
+
+void Timer::setUnit(const std::string& unit)
+{
+    m_unit = unit;
+}
+
+const std::string& Timer::getUnit() const
+{
+    return m_unit;
 }
 
 void Timer::evaluateDuration()
 {
-    clock_t duration = m_endTime - m_initTime;
-    m_averageDuration += static_cast<double>(duration) / CLOCKS_PER_SEC * 1000.0;
+    double duration = m_isValueSet ? m_value :
+        std::chrono::duration<double, std::milli>(m_endTime - m_initTime).count();
+    m_isValueSet = false;
+
+    if(m_deadline > 0 && duration > m_deadline)
+        m_totalDeadlineMisses++;
+
+    if(m_samples.empty())
+        return;
+
+    // the oldest sample is replaced when the window is full
+    m_samples[m_nextSample] = duration;
+    m_nextSample = (m_nextSample + 1) % m_samples.size();
+    m_numberOfSamples = std::min(m_numberOfSamples + 1, m_samples.size());
+}
+
+void Timer::evaluateStatistics()
+{
+    if(m_numberOfSamples == 0)
+        return;
+
+    // the samples of a window that is not full are stored at the beginning of the buffer
+    auto begin = m_sortedSamples.begin();
+    auto end = begin + m_numberOfSamples;
+    std::copy(m_samples.begin(), m_samples.begin() + m_numberOfSamples, begin);
+
+    // nth_element partially sorts the buffer so the percentiles can be evaluated without any
+    // additional memory
+    auto percentile = [&](double p)
+        {
+            auto nth = begin + static_cast<std::size_t>(std::ceil(p * m_numberOfSamples)) - 1;
+            std::nth_element(begin, nth, end);
+            return *nth;
+        };
+
+    m_statistics.p50 = percentile(0.5);
+    m_statistics.p99 = percentile(0.99);
+    auto minMax = std::minmax_element(begin, end);
+    m_statistics.min = *minMax.first;
+    m_statistics.max = *minMax.second;
+    m_statistics.average = std::accumulate(begin, end, 0.0) / m_numberOfSamples;
+    m_statistics.deadlineMisses = m_deadline > 0 ?
+        static_cast<unsigned int>(std::count_if(begin, end, [this](double duration)
+                                                {return duration > m_deadline;})) : 0;
+    m_statistics.totalDeadlineMisses = m_totalDeadlineMisses;
+}
+
+const TimerStatistics& Timer::getStatistics() const
+{
+    return m_statistics;
 }
 
 void TimeProfiler::setPeriod(int maxCounter)
 {
     m_maxCounter = maxCounter;
+    m_counter = 0;
+
+    if(m_windowSize <= 0)
+        for(auto& timer : m_timers)
+            timer.second->setWindowSize(m_maxCounter);
+}
+
+void TimeProfiler::setWindowSize(int windowSize)
+{
+    m_windowSize = windowSize;
+
+    for(auto& timer : m_timers)
+        timer.second->setWindowSize(m_windowSize > 0 ? m_windowSize : m_maxCounter);
+}
+
+void TimeProfiler::setDeadline(double deadline)
+{
+    m_deadline = deadline * 1000.0;
+
+    for(auto& timer : m_timers)
+        timer.second->setDeadline(m_deadline);
+}
+
+void TimeProfiler::setVerbose(bool verbose)
+{
+    m_verbose = verbose;
 }
 
 bool TimeProfiler::addTimer(const std::string& key)
@@ -51,7 +151,37 @@ bool TimeProfiler::addTimer(const std::string& key)
         return false;
     }
 
-    m_timers.insert(std::make_pair(key, std::make_unique<Timer>()));
+    std::unique_ptr<Timer> newTimer = std::make_unique<Timer>();
+    newTimer->setWindowSize(m_windowSize > 0 ? m_windowSize : m_maxCounter);
+    newTimer->setDeadline(m_deadline);
+
+    m_timers.insert(std::make_pair(key, std::move(newTimer)));
+    return true;
+}
+
+bool TimeProfiler::addCounter(const std::string& key, const std::string& unit)
+{
+    if(!addTimer(key))
+    {
+        yError() << "[addCounter] Unable to add the counter.";
+        return false;
+    }
+
+    m_timers[key]->setDeadline(0);
+    m_timers[key]->setUnit(unit);
+    return true;
+}
+
+bool TimeProfiler::setValue(const std::string& key, double value)
+{
+    auto timer = m_timers.find(key);
+    if(timer == m_timers.end())
+    {
+        yError() << "[setValue] Unable to find the timer.";
+        return false;
+    }
+
+    timer->second->setValue(value);
     return true;
 }
 
@@ -81,24 +211,81 @@ bool TimeProfiler::setEndTime(const std::string& key)
     return true;
 }
 
-void TimeProfiler::profiling()
+bool TimeProfiler::getStatistics(const std::string& key, TimerStatistics& statistics) const
 {
-    std::string infoStream;
-    m_counter++;
-    for(auto timer = m_timers.begin(); timer != m_timers.end(); timer++)
+    auto timer = m_timers.find(key);
+    if(timer == m_timers.end())
     {
-        timer->second->evaluateDuration();
-        if(m_counter == m_maxCounter)
-        {
-            infoStream += timer->first + ": "
-                + std::to_string((timer->second->getAverageDuration())/m_counter)
-                + " ms ";
-            timer->second->resetAverageDuration();
-        }
+        yError() << "[getStatistics] Unable to find the timer.";
+        return false;
     }
+
+    statistics = timer->second->getStatistics();
+    return true;
+}
+
+std::string TimeProfiler::describe(const std::vector<TimerStatistics>& statistics) const
+{
+    std::ostringstream description;
+    description << std::fixed << std::setprecision(3);
+    std::size_t index = 0;
+    for(const auto& timer : m_timers)
+    {
+        if(index >= statistics.size())
+            break;
+
+        const TimerStatistics& timerStatistics = statistics[index++];
+        const std::string& unit = timer.second->getUnit();
+        description << timer.first << ": avg " << timerStatistics.average
+                    << " " << unit << " min " << timerStatistics.min
+                    << " " << unit << " max " << timerStatistics.max
+                    << " " << unit << " p50 " << timerStatistics.p50
+                    << " " << unit << " p99 " << timerStatistics.p99
+                    << " " << unit << " deadline misses " << timerStatistics.deadlineMisses
+                    << " (total " << timerStatistics.totalDeadlineMisses << ") ";
+    }
+    return description.str();
+}
+
+std::string TimeProfiler::getStatisticsDescription() const
+{
+    std::vector<TimerStatistics> statistics;
+    statistics.reserve(m_timers.size());
+    for(const auto& timer : m_timers)
+        statistics.push_back(timer.second->getStatistics());
+
+    return describe(statistics);
+}
+
+std::string TimeProfiler::getPublishedStatisticsDescription()
+{
+    std::lock_guard<std::mutex> guard(m_readerMutex);
+
+    m_publishedStatistics.update();
+    return describe(m_publishedStatistics.front());
+}
+
+void TimeProfiler::profiling()
+{
+    m_counter++;
+    for(auto& timer : m_timers)
+        timer.second->evaluateDuration();
+
     if(m_counter == m_maxCounter)
     {
         m_counter = 0;
-        yInfo() << infoStream;
+        // the vectors are allocated only the first time each buffer is published
+        std::vector<TimerStatistics>& published = m_publishedStatistics.back();
+        published.resize(m_timers.size());
+        std::size_t index = 0;
+        for(auto& timer : m_timers)
+        {
+            timer.second->evaluateStatistics();
+            published[index++] = timer.second->getStatistics();
+        }
+        m_publishedStatistics.publish();
+
+        if(m_verbose)
+            yInfo() << getStatisticsDescription();
     }
 }
@@ -0,0 +1,247 @@
+/**
+ * @file TrajectoryBuffer.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+#include "TrajectoryBuffer.hpp"
+
+void TrajectorySamples::reserve(std::size_t capacity, std::size_t preservedSamples)
+{
+    leftTrajectory.reserve(capacity, preservedSamples);
+    rightTrajectory.reserve(capacity, preservedSamples);
+    leftTwistTrajectory.reserve(capacity, preservedSamples);
+    rightTwistTrajectory.reserve(capacity, preservedSamples);
+    DCMPositionDesired.reserve(capacity, preservedSamples);
+    DCMVelocityDesired.reserve(capacity, preservedSamples);
+    leftInContact.reserve(capacity, preservedSamples);
+    rightInContact.reserve(capacity, preservedSamples);
+    comHeightTrajectory.reserve(capacity, preservedSamples);
+    comHeightVelocity.reserve(capacity, preservedSamples);
+    isLeftFixedFrame.reserve(capacity, preservedSamples);
+}
+
+void TrajectorySamples::move(std::size_t from, std::size_t to, std::size_t numberOfSamples)
+{
+    leftTrajectory.move(from, to, numberOfSamples);
+    rightTrajectory.move(from, to, numberOfSamples);
+    leftTwistTrajectory.move(from, to, numberOfSamples);
+    rightTwistTrajectory.move(from, to, numberOfSamples);
+    DCMPositionDesired.move(from, to, numberOfSamples);
+    DCMVelocityDesired.move(from, to, numberOfSamples);
+    leftInContact.move(from, to, numberOfSamples);
+    rightInContact.move(from, to, numberOfSamples);
+    comHeightTrajectory.move(from, to, numberOfSamples);
+    comHeightVelocity.move(from, to, numberOfSamples);
+    isLeftFixedFrame.move(from, to, numberOfSamples);
+}
+
+void TrajectorySamples::pad(std::size_t from, std::size_t to)
+{
+    leftTrajectory.pad(from, to);
+    rightTrajectory.pad(from, to);
+    leftTwistTrajectory.pad(from, to);
+    rightTwistTrajectory.pad(from, to);
+    DCMPositionDesired.pad(from, to);
+    DCMVelocityDesired.pad(from, to);
+    leftInContact.pad(from, to);
+    rightInContact.pad(from, to);
+    comHeightTrajectory.pad(from, to);
+    comHeightVelocity.pad(from, to);
+    isLeftFixedFrame.pad(from, to);
+}
+
+void TrajectorySamples::copy(const TrajectorySamples& input, std::size_t from,
+                             std::size_t numberOfSamples, std::size_t position)
+{
+    leftTrajectory.copy(input.leftTrajectory, from, numberOfSamples, position);
+    rightTrajectory.copy(input.rightTrajectory, from, numberOfSamples, position);
+    leftTwistTrajectory.copy(input.leftTwistTrajectory, from, numberOfSamples, position);
+    rightTwistTrajectory.copy(input.rightTwistTrajectory, from, numberOfSamples, position);
+    DCMPositionDesired.copy(input.DCMPositionDesired, from, numberOfSamples, position);
+    DCMVelocityDesired.copy(input.DCMVelocityDesired, from, numberOfSamples, position);
+    leftInContact.copy(input.leftInContact, from, numberOfSamples, position);
+    rightInContact.copy(input.rightInContact, from, numberOfSamples, position);
+    comHeightTrajectory.copy(input.comHeightTrajectory, from, numberOfSamples, position);
+    comHeightVelocity.copy(input.comHeightVelocity, from, numberOfSamples, position);
+    isLeftFixedFrame.copy(input.isLeftFixedFrame, from, numberOfSamples, position);
+}
+
+std::size_t TrajectorySamples::capacity() const
+{
+    // all the arrays are reserved together
+    return DCMPositionDesired.capacity();
+}
+
+std::size_t TrajectoryBuffer::current() const
+{
+    return std::min(m_head, m_end - 1);
+}
+
+void TrajectoryBuffer::reserve(std::size_t capacity)
+{
+    m_samples.reserve(capacity, m_end);
+}
+
+void TrajectoryBuffer::copy(const PlannedTrajectory& trajectory, std::size_t mergePoint)
+{
+    // the samples before the current one are no longer required, the stored trajectories are moved
+    // at the beginning of the arrays
+    std::size_t offset = current();
+    std::size_t numberOfSamples = m_end - offset;
+    if(offset != 0)
+        m_samples.move(offset, 0, numberOfSamples);
+    m_head -= offset;
+    m_end = numberOfSamples;
+
+    std::size_t position = m_head + mergePoint;
+
+    // the memory is allocated only if the buffer was not reserved enough
+    if(position + trajectory.size > m_samples.capacity())
+        m_samples.reserve(2 * (position + trajectory.size), m_end);
+
+    // the trajectories are constant after the last stored sample
+    if(m_end < position)
+        m_samples.pad(m_end, position);
+
+    m_samples.copy(trajectory.samples, trajectory.begin, trajectory.size, position);
+    m_end = position + trajectory.size;
+}
+
+void TrajectoryBuffer::adopt(PlannedTrajectory& trajectory, std::size_t mergePoint)
+{
+    std::size_t head = trajectory.begin - mergePoint;
+
+    // copy the samples of the current trajectory until the merge point
+    if(mergePoint != 0)
+    {
+        std::size_t numberOfSamples = std::min(mergePoint, m_end - current());
+        trajectory.samples.copy(m_samples, current(), numberOfSamples, head);
+
+        // the trajectories are constant after the last stored sample
+        trajectory.samples.pad(head + numberOfSamples, trajectory.begin);
+    }
+
+    std::swap(m_samples, trajectory.samples);
+    m_head = head;
+    m_end = trajectory.begin + trajectory.size;
+}
+
+bool TrajectoryBuffer::merge(PlannedTrajectory& trajectory, std::size_t mergePoint)
+{
+    if(trajectory.size == 0 || trajectory.samples.capacity() < trajectory.begin + trajectory.size)
+    {
+        std::cerr << "[TrajectoryBuffer::merge] The planned trajectory is empty or not allocated." << std::endl;
+        return false;
+    }
+
+    if((m_end == 0 && mergePoint != 0) || (m_end != 0 && mergePoint > m_size))
+    {
+        std::cerr << "[TrajectoryBuffer::merge] The merge point has to be less or equal to the size of the trajectory."
+                  << std::endl;
+        return false;
+    }
+
+    // when there is enough room before the planned trajectory the memory is swapped,
+    // otherwise the trajectory is copied
+    if(mergePoint <= trajectory.begin)
+        adopt(trajectory, mergePoint);
+    else
+        copy(trajectory, mergePoint);
+
+    m_size = mergePoint + trajectory.size;
+
+    // the merge points are expressed with respect to the current time instant.
+    // The first merge point is always equal to 0
+    m_mergePoints.clear();
+    for(std::size_t i = 1; i < trajectory.mergePoints.size(); i++)
+        m_mergePoints.push_back(m_head + trajectory.mergePoints[i]);
+
+    return true;
+}
+
+void TrajectoryBuffer::advance()
+{
+    m_head++;
+
+    // the merge points that are reached are dropped
+    while(!m_mergePoints.empty() && m_mergePoints.front() <= m_head)
+        m_mergePoints.pop_front();
+}
+
+bool TrajectoryBuffer::empty() const
+{
+    return m_end == 0;
+}
+
+std::size_t TrajectoryBuffer::getNumberOfMergePoints() const
+{
+    return m_mergePoints.size();
+}
+
+std::size_t TrajectoryBuffer::getMergePoint(std::size_t index) const
+{
+    return m_mergePoints[index] - m_head;
+}
+
+TrajectoryView<iDynTree::Transform> TrajectoryBuffer::getLeftFootTrajectory() const
+{
+    return m_samples.leftTrajectory.view(current(), m_end, m_size);
+}
+
+TrajectoryView<iDynTree::Transform> TrajectoryBuffer::getRightFootTrajectory() const
+{
+    return m_samples.rightTrajectory.view(current(), m_end, m_size);
+}
+
+TrajectoryView<iDynTree::Twist> TrajectoryBuffer::getLeftFootTwistTrajectory() const
+{
+    return m_samples.leftTwistTrajectory.view(current(), m_end, m_size);
+}
+
+TrajectoryView<iDynTree::Twist> TrajectoryBuffer::getRightFootTwistTrajectory() const
+{
+    return m_samples.rightTwistTrajectory.view(current(), m_end, m_size);
+}
+
+TrajectoryView<iDynTree::Vector2> TrajectoryBuffer::getDCMPositionDesired() const
+{
+    return m_samples.DCMPositionDesired.view(current(), m_end, m_size);
+}
+
+TrajectoryView<iDynTree::Vector2> TrajectoryBuffer::getDCMVelocityDesired() const
+{
+    return m_samples.DCMVelocityDesired.view(current(), m_end, m_size);
+}
+
+TrajectoryView<bool> TrajectoryBuffer::getLeftInContact() const
+{
+    return m_samples.leftInContact.view(current(), m_end, m_size);
+}
+
+TrajectoryView<bool> TrajectoryBuffer::getRightInContact() const
+{
+    return m_samples.rightInContact.view(current(), m_end, m_size);
+}
+
+TrajectoryView<double> TrajectoryBuffer::getCoMHeightTrajectory() const
+{
+    return m_samples.comHeightTrajectory.view(current(), m_end, m_size);
+}
+
+TrajectoryView<double> TrajectoryBuffer::getCoMHeightVelocity() const
+{
+    return m_samples.comHeightVelocity.view(current(), m_end, m_size);
+}
+
+TrajectoryView<bool> TrajectoryBuffer::getIsLeftFixedFrame() const
+{
+    return m_samples.isLeftFixedFrame.view(current(), m_end, m_size);
+}
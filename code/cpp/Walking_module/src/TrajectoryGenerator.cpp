@@ -6,15 +6,25 @@
  * @date 2018
  */
 
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
 // YARP
 #include <yarp/os/LogStream.h>
 #include <yarp/os/Value.h>
 
+// Eigen
+#include <Eigen/Geometry>
+
 // iDynTree
 #include <iDynTree/Core/EigenHelpers.h>
 
 #include "TrajectoryGenerator.hpp"
 #include "Utils.hpp"
+#include "RealTimeThread.hpp"
 
 TrajectoryGenerator::~TrajectoryGenerator()
 {
@@ -22,6 +32,7 @@ TrajectoryGenerator::~TrajectoryGenerator()
         std::lock_guard<std::mutex> guard(m_mutex);
         m_generatorState = GeneratorState::Closing;
         m_conditionVariable.notify_one();
+        m_speculativeConditionVariable.notify_all();
     }
 
     if(m_generatorThread.joinable())
@@ -29,6 +40,15 @@ TrajectoryGenerator::~TrajectoryGenerator()
         m_generatorThread.join();
         m_generatorThread = std::thread();
     }
+
+    for(auto& planner : m_speculativePlanners)
+    {
+        if(planner->thread.joinable())
+        {
+            planner->thread.join();
+            planner->thread = std::thread();
+        }
+    }
 }
 
 bool TrajectoryGenerator::initialize(const yarp::os::Searchable& config)
@@ -49,25 +69,128 @@ bool TrajectoryGenerator::configurePlanner(const yarp::os::Searchable& config)
         return false;
     }
 
-    yarp::os::Value tempValue;
-
     m_dT = config.check("sampling_time", yarp::os::Value(0.016)).asDouble();
     m_plannerHorizon = config.check("plannerHorizon", yarp::os::Value(20.0)).asDouble();
-    double unicycleGain = config.check("unicycleGain", yarp::os::Value(10.0)).asDouble();
 
-    tempValue = config.find("referencePosition");
+    yarp::os::Value tempValue = config.find("referencePosition");
     if(!YarpHelper::yarpListToiDynTreeVectorFixSize(tempValue, m_referencePointDistance))
     {
         yError() << "[configurePlanner] Initialization failed while reading referencePosition vector.";
         return false;
     }
 
+    m_plannedTrajectoryHeadroom = config.check("plannedTrajectoryHeadroom",
+                                               yarp::os::Value(10)).asInt();
+
+    m_nominalWidth = config.check("nominalWidth", yarp::os::Value(0.04)).asDouble();
+
+    m_swingLeft = config.check("swingLeft", yarp::os::Value(true)).asBool();
+
+    int plannerLatencyWindow = config.check("plannerLatencyWindow", yarp::os::Value(20)).asInt();
+    if(plannerLatencyWindow <= 0)
+    {
+        yError() << "[configurePlanner] The size of the planner latency window has to be positive.";
+        return false;
+    }
+    m_plannerLatencies.resize(plannerLatencyWindow);
+    m_sortedPlannerLatencies.resize(plannerLatencyWindow);
+
+    // the trajectories evaluated for the same inputs (expressed in the stance foot frame) are reused
+    int planCacheSize = config.check("planCacheSize", yarp::os::Value(0)).asInt();
+    if(planCacheSize < 0)
+    {
+        yError() << "[configurePlanner] The size of the plan cache cannot be negative.";
+        return false;
+    }
+    m_planCache.resize(planCacheSize);
+    for(auto& entry : m_planCache)
+        entry.trajectory = std::make_unique<PlannedTrajectory>();
+    m_planCachePositionTolerance = config.check("planCachePositionTolerance",
+                                                yarp::os::Value(0.001)).asDouble();
+    m_planCacheVelocityTolerance = config.check("planCacheVelocityTolerance",
+                                                yarp::os::Value(0.001)).asDouble();
+    m_planCacheAngleTolerance = iDynTree::deg2rad(config.check("planCacheAngleTolerance",
+                                                               yarp::os::Value(0.5)).asDouble());
+
+    // the merged requests are evaluated again by the planners whose internal state is not aligned
+    int plannerHistorySize = config.check("plannerHistorySize", yarp::os::Value(10)).asInt();
+    if(plannerHistorySize <= 0)
+    {
+        yError() << "[configurePlanner] The size of the planner history has to be positive.";
+        return false;
+    }
+    m_mergedRequests.resize(plannerHistorySize);
+    m_replayedRequests.reserve(plannerHistorySize);
+
+    // try to configure the planner
+    if(!configureUnicyclePlanner(config, m_trajectoryGenerator))
+    {
+        yError() << "[configurePlanner] Unable to configure the unicycle planner.";
+        return false;
+    }
+
+    m_correctLeft = true;
+
+    // the speculative planners evaluate the candidate trajectories in background
+    m_useSpeculativePlanning = config.check("useSpeculativePlanning", yarp::os::Value(false)).asBool();
+    if(m_useSpeculativePlanning)
+    {
+        int numberOfPlanners = config.check("speculativePlanners", yarp::os::Value(5)).asInt();
+        if(numberOfPlanners <= 0)
+        {
+            yError() << "[configurePlanner] The number of speculative planners has to be positive.";
+            return false;
+        }
+
+        m_speculativeGoalPerturbation = config.check("speculativeGoalPerturbation",
+                                                     yarp::os::Value(0.05)).asDouble();
+        m_speculativeGoalTolerance = config.check("speculativeGoalTolerance",
+                                                  yarp::os::Value(m_speculativeGoalPerturbation)).asDouble();
+
+        for(int i = 0; i < numberOfPlanners; i++)
+        {
+            auto planner = std::make_unique<SpeculativePlanner>();
+            if(!configureUnicyclePlanner(config, planner->generator))
+            {
+                yError() << "[configurePlanner] Unable to configure the speculative planner" << i;
+                return false;
+            }
+
+            // the internal state of the planner is aligned with the merged trajectories (starting
+            // from the first one) before the first candidate
+            planner->alignment.isStale = true;
+            planner->replayedRequests.reserve(m_mergedRequests.size());
+            m_speculativePlanners.push_back(std::move(planner));
+        }
+    }
+
+    // the mutex is automatically released when lock_guard goes out of its scope
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    // change the state of the generator
+    m_generatorState = GeneratorState::FirstStep;
+
+    // start the threads
+    m_generatorThread = std::thread(&TrajectoryGenerator::computeThread, this);
+    for(std::size_t i = 0; i < m_speculativePlanners.size(); i++)
+        m_speculativePlanners[i]->thread = std::thread(&TrajectoryGenerator::speculativeThread, this, i);
+
+    return true;
+}
+
+bool TrajectoryGenerator::configureUnicyclePlanner(const yarp::os::Searchable& config,
+                                                   UnicycleTrajectoryGenerator& generator)
+{
+    yarp::os::Value tempValue;
+
+    double unicycleGain = config.check("unicycleGain", yarp::os::Value(10.0)).asDouble();
+
     // get left and right ZMP delta
     iDynTree::Vector2 leftZMPDelta;
     tempValue = config.find("leftZMPDelta");
     if (!YarpHelper::yarpListToiDynTreeVectorFixSize(tempValue, leftZMPDelta))
     {
-        yError() << "[configurePlanner] Initialization failed while reading rStancePosition vector.";
+        yError() << "[configureUnicyclePlanner] Initialization failed while reading rStancePosition vector.";
         return false;
     }
 
@@ -75,7 +198,7 @@ bool TrajectoryGenerator::configurePlanner(const yarp::os::Searchable& config)
     tempValue = config.find("rightZMPDelta");
     if (!YarpHelper::yarpListToiDynTreeVectorFixSize(tempValue, rightZMPDelta))
     {
-        yError() << "[configurePlanner] Initialization failed while reading rStancePosition vector.";
+        yError() << "[configureUnicyclePlanner] Initialization failed while reading rStancePosition vector.";
         return false;
     }
 
@@ -102,127 +225,167 @@ bool TrajectoryGenerator::configurePlanner(const yarp::os::Searchable& config)
                                                yarp::os::Value(0.4)).asDouble();
     double mergePointRatio = config.check("mergePointRatio", yarp::os::Value(0.5)).asDouble();
 
-    m_nominalWidth = config.check("nominalWidth", yarp::os::Value(0.04)).asDouble();
-
-    m_swingLeft = config.check("swingLeft", yarp::os::Value(true)).asBool();
     bool startWithSameFoot = config.check("startAlwaysSameFoot", yarp::os::Value(false)).asBool();
     bool useMinimumJerkFootTrajectory = config.check("useMinimumJerkFootTrajectory",
                                                      yarp::os::Value(false)).asBool();
     double pitchDelta = config.check("pitchDelta", yarp::os::Value(0.0)).asDouble();
 
-    // try to configure the planner
     bool ok = true;
-    ok = ok && m_trajectoryGenerator.setDesiredPersonDistance(m_referencePointDistance(0),
-                                                              m_referencePointDistance(1));
-    ok = ok && m_trajectoryGenerator.setControllerGain(unicycleGain);
-    ok = ok && m_trajectoryGenerator.setMaximumIntegratorStepSize(m_dT);
-    ok = ok && m_trajectoryGenerator.setMaxStepLength(maxStepLength);
-    ok = ok && m_trajectoryGenerator.setWidthSetting(minWidth, m_nominalWidth);
-    ok = ok && m_trajectoryGenerator.setMaxAngleVariation(maxAngleVariation);
-    ok = ok && m_trajectoryGenerator.setCostWeights(positionWeight, timeWeight);
-    ok = ok && m_trajectoryGenerator.setStepTimings(minStepDuration,
-                                                    maxStepDuration, nominalDuration);
-    ok = ok && m_trajectoryGenerator.setPlannerPeriod(m_dT);
-    ok = ok && m_trajectoryGenerator.setMinimumAngleForNewSteps(minAngleVariation);
-    ok = ok && m_trajectoryGenerator.setMinimumStepLength(minStepLength);
-    ok = ok && m_trajectoryGenerator.setSwitchOverSwingRatio(switchOverSwingRatio);
-    ok = ok && m_trajectoryGenerator.setTerminalHalfSwitchTime(lastStepSwitchTime);
-    ok = ok && m_trajectoryGenerator.setStepHeight(stepHeight);
-    ok = ok && m_trajectoryGenerator.setFootLandingVelocity(landingVelocity);
-    ok = ok && m_trajectoryGenerator.setFootApexTime(apexTime);
-    ok = ok && m_trajectoryGenerator.setPauseConditions(maxStepDuration, nominalDuration);
-    ok = ok && m_trajectoryGenerator.setCoMHeightSettings(comHeight, comHeightDelta);
-    ok = ok && m_trajectoryGenerator.setSlowWhenTurnGain(slowWhenTurningGain);
-    ok = ok && m_trajectoryGenerator.setMergePointRatio(mergePointRatio);
-    ok = ok && m_trajectoryGenerator.setPitchDelta(pitchDelta);
-    
-    m_trajectoryGenerator.setStanceZMPDelta(leftZMPDelta, rightZMPDelta);
-    m_trajectoryGenerator.addTerminalStep(false);
-    m_trajectoryGenerator.startWithLeft(m_swingLeft);
-    m_trajectoryGenerator.resetTimingsIfStill(startWithSameFoot);
-
-    
-    
-    m_trajectoryGenerator.useMinimumJerkFootTrajectory(useMinimumJerkFootTrajectory);
-
-    m_correctLeft = true;
-
-    if(ok)
-    {
-        // the mutex is automatically released when lock_guard goes out of its scope
-        std::lock_guard<std::mutex> guard(m_mutex);
-
-        // change the state of the generator
-        m_generatorState = GeneratorState::FirstStep;
-
-        // start the thread
-        m_generatorThread = std::thread(&TrajectoryGenerator::computeThread, this);
-    }
+    ok = ok && generator.setDesiredPersonDistance(m_referencePointDistance(0),
+                                                  m_referencePointDistance(1));
+    ok = ok && generator.setControllerGain(unicycleGain);
+    ok = ok && generator.setMaximumIntegratorStepSize(m_dT);
+    ok = ok && generator.setMaxStepLength(maxStepLength);
+    ok = ok && generator.setWidthSetting(minWidth, m_nominalWidth);
+    ok = ok && generator.setMaxAngleVariation(maxAngleVariation);
+    ok = ok && generator.setCostWeights(positionWeight, timeWeight);
+    ok = ok && generator.setStepTimings(minStepDuration,
+                                        maxStepDuration, nominalDuration);
+    ok = ok && generator.setPlannerPeriod(m_dT);
+    ok = ok && generator.setMinimumAngleForNewSteps(minAngleVariation);
+    ok = ok && generator.setMinimumStepLength(minStepLength);
+    ok = ok && generator.setSwitchOverSwingRatio(switchOverSwingRatio);
+    ok = ok && generator.setTerminalHalfSwitchTime(lastStepSwitchTime);
+    ok = ok && generator.setStepHeight(stepHeight);
+    ok = ok && generator.setFootLandingVelocity(landingVelocity);
+    ok = ok && generator.setFootApexTime(apexTime);
+    ok = ok && generator.setPauseConditions(maxStepDuration, nominalDuration);
+    ok = ok && generator.setCoMHeightSettings(comHeight, comHeightDelta);
+    ok = ok && generator.setSlowWhenTurnGain(slowWhenTurningGain);
+    ok = ok && generator.setMergePointRatio(mergePointRatio);
+    ok = ok && generator.setPitchDelta(pitchDelta);
+
+    generator.setStanceZMPDelta(leftZMPDelta, rightZMPDelta);
+    generator.addTerminalStep(false);
+    generator.startWithLeft(m_swingLeft);
+    generator.resetTimingsIfStill(startWithSameFoot);
+    generator.useMinimumJerkFootTrajectory(useMinimumJerkFootTrajectory);
 
     return ok;
 }
 
 void TrajectoryGenerator::addTerminalStep(bool terminalStep)
 {
-    m_trajectoryGenerator.addTerminalStep(terminalStep);
+    // the planner is used by its thread also while it is aligned in background, the option is
+    // applied when the trajectory is evaluated
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_isTerminalStepAdded = terminalStep;
 }
 
 void TrajectoryGenerator::computeThread()
 {
     while (true)
     {
-        double initTime;
         double endTime;
         double dT;
 
-        bool correctLeft;
-
-        iDynTree::Vector2 desiredPoint;
-        iDynTree::Vector2 measuredPositionLeft, measuredPositionRight;
-        double measuredAngleLeft, measuredAngleRight;
-
-        iDynTree::Vector2 DCMBoundaryConditionAtMergePointPosition;
-        iDynTree::Vector2 DCMBoundaryConditionAtMergePointVelocity;
+        PlannerRequest request;
+        iDynTree::Transform otherFoot;
 
-        // wait until a new trajectory has to be evaluated.
+        // wait until a new trajectory has to be evaluated or the planner has to be aligned.
         {
             std::unique_lock<std::mutex> lock(m_mutex);
             m_conditionVariable.wait(lock, [&]{return ((m_generatorState == GeneratorState::Called)
-                                                       || (m_generatorState == GeneratorState::Closing));});
+                                                       || (m_generatorState == GeneratorState::Closing)
+                                                       || isAlignmentRequired(m_plannerAlignment));});
 
             if(m_generatorState == GeneratorState::Closing)
                 break;
 
+            if(m_generatorState != GeneratorState::Called)
+            {
+                lock.unlock();
+                alignIdlePlanner(m_trajectoryGenerator, m_plannerAlignment, m_replayedRequests);
+                continue;
+            }
+
             // set timings
             dT = m_dT ;
-            initTime = m_initTime;
-            endTime = initTime + m_plannerHorizon;
+            request.initTime = m_initTime;
+            endTime = request.initTime + m_plannerHorizon;
 
             // set desired point
-            desiredPoint = m_desiredPoint;
+            request.desiredPoint = m_desiredPoint;
 
             // dcm boundary conditions
-            DCMBoundaryConditionAtMergePointPosition = m_DCMBoundaryConditionAtMergePointPosition;
-            DCMBoundaryConditionAtMergePointVelocity = m_DCMBoundaryConditionAtMergePointVelocity;
+            request.DCMPosition = m_DCMBoundaryConditionAtMergePointPosition;
+            request.DCMVelocity = m_DCMBoundaryConditionAtMergePointVelocity;
+
+            // stance foot
+            request.correctLeft = m_correctLeft;
+            const iDynTree::Transform& measuredTransform = m_correctLeft ? m_measuredTransformLeft
+                : m_measuredTransformRight;
+            request.measuredPosition(0) = measuredTransform.getPosition()(0);
+            request.measuredPosition(1) = measuredTransform.getPosition()(1);
+            request.measuredAngle = measuredTransform.getRotation().asRPY()(2);
+
+            request.terminalStep = m_isTerminalStepAdded;
+            otherFoot = m_otherFootTransform;
+        }
+
+        // planar transformation between the stance foot and the world frame
+        iDynTree::Transform world_H_stance(iDynTree::Rotation::RotZ(request.measuredAngle),
+                                           iDynTree::Position(request.measuredPosition(0),
+                                                              request.measuredPosition(1), 0.0));
 
-            // left foot
-            measuredPositionLeft(0) = m_measuredTransformLeft.getPosition()(0);
-            measuredPositionLeft(1) = m_measuredTransformLeft.getPosition()(1);
-            measuredAngleLeft = m_measuredTransformLeft.getRotation().asRPY()(2);
+        // if the same inputs were already planned the stored trajectory is moved in the world frame
+        PlanCacheKey key;
+        if(!m_planCache.empty())
+        {
+            key = evaluatePlanCacheKey(request, otherFoot);
+            PlanCacheEntry* entry = findPlanCacheEntry(key);
+            if(entry != nullptr)
+            {
+                if(m_plannedTrajectoryBackBuffer == nullptr)
+                    m_plannedTrajectoryBackBuffer = std::make_unique<PlannedTrajectory>();
+                transformPlannedTrajectory(*entry->trajectory, world_H_stance,
+                                           *m_plannedTrajectoryBackBuffer);
+
+                // the planner does not evaluate the trajectory, so its internal state is
+                // updated only if the trajectory is merged
+                std::lock_guard<std::mutex> guard(m_mutex);
+                m_plannedRequest.request = request;
+                m_plannedRequest.planner = nullptr;
+                m_plannedRequest.isValid = true;
+                publishPlannedTrajectory();
+                m_generatorState = GeneratorState::Returned;
+                continue;
+            }
+        }
 
-            // right foot
-            measuredPositionRight(0) = m_measuredTransformRight.getPosition()(0);
-            measuredPositionRight(1) = m_measuredTransformRight.getPosition()(1);
-            measuredAngleRight = m_measuredTransformRight.getRotation().asRPY()(2);
+        // the latency of the planner is measured from here: the alignment is on the path
+        // between the request and the trajectory
+        auto startTime = std::chrono::steady_clock::now();
 
-            correctLeft = m_correctLeft;
+        // the planner keeps the steps evaluated before the init time, so its internal state is
+        // realigned with the merged trajectories (the ones served by the cache are evaluated again
+        // in the same order and a discarded trajectory is removed)
+        if(!alignPlanner(m_trajectoryGenerator, m_plannerAlignment, m_replayedRequests))
+        {
+            // a trajectory evaluated from a different state would not be continuous with the
+            // merged ones
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_generatorState = GeneratorState::Configured;
+            yError() << "[TrajectoryGenerator_Thread] The planner is not aligned with the merged "
+                     << "trajectories. The trajectory is not evaluated.";
+            continue;
+        }
+        m_trajectoryGenerator.addTerminalStep(request.terminalStep);
+
+        // the internal state of the planner is aligned again if the new trajectory is
+        // not merged
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_plannerAlignment.isStale = true;
+            if(m_handedOutRequest.planner == &m_plannerAlignment)
+                m_handedOutRequest.planner = nullptr;
         }
 
         // clear the old trajectory
         m_trajectoryGenerator.clearDesiredTrajectory();
 
         // add new point
-        if(!m_trajectoryGenerator.addDesiredTrajectoryPoint(endTime, desiredPoint))
+        if(!m_trajectoryGenerator.addDesiredTrajectoryPoint(endTime, request.desiredPoint))
         {
             // something goes wrong
             std::lock_guard<std::mutex> guard(m_mutex);
@@ -231,18 +394,32 @@ void TrajectoryGenerator::computeThread()
             break;
         }
 
-        iDynTree::Vector2 measuredPosition;
-        double measuredAngle;
-        measuredPosition = correctLeft ? measuredPositionLeft : measuredPositionRight;
-        measuredAngle = correctLeft ? measuredAngleLeft : measuredAngleRight;
-
-        if(m_trajectoryGenerator.reGenerateDCM(initTime, dT, endTime,
-                                               DCMBoundaryConditionAtMergePointPosition,
-                                               DCMBoundaryConditionAtMergePointVelocity,
-                                               correctLeft, measuredPosition, measuredAngle))
+        // the back buffer is filled outside the critical section, only the pointers are swapped
+        // when the trajectory is published
+        if(m_trajectoryGenerator.reGenerateDCM(request.initTime, dT, endTime,
+                                               request.DCMPosition, request.DCMVelocity,
+                                               request.correctLeft, request.measuredPosition,
+                                               request.measuredAngle)
+           && fillPlannedTrajectory(m_trajectoryGenerator, m_plannedTrajectoryBackBuffer))
         {
+            double latency = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                           - startTime).count();
+
+            if(!m_planCache.empty())
+                storePlanCacheEntry(key, *m_plannedTrajectoryBackBuffer, world_H_stance);
+
             std::lock_guard<std::mutex> guard(m_mutex);
+            m_plannedRequest.request = request;
+            m_plannedRequest.planner = &m_plannerAlignment;
+            m_plannedRequest.isValid = true;
+            publishPlannedTrajectory();
             m_generatorState = GeneratorState::Returned;
+
+            // the trajectories taken from the cache are not considered
+            m_plannerLatencies[m_plannerLatencyIndex] = latency;
+            m_plannerLatencyIndex = (m_plannerLatencyIndex + 1) % m_plannerLatencies.size();
+            m_numberOfPlannerLatencies = std::min(m_numberOfPlannerLatencies + 1,
+                                                  m_plannerLatencies.size());
             continue;
         }
         else
@@ -265,40 +442,26 @@ bool TrajectoryGenerator::generateFirstTrajectories()
             yError() << "[generateFirstTrajectories] This is not the first step! How can I generate the first step?";
             return false;
         }
+        m_isFirstTrajectoryOnTheFly = false;
+        m_isFirstTrajectoryTerminalStepAdded = m_isTerminalStepAdded;
     }
 
-    // clear the all trajectory
-    m_trajectoryGenerator.clearDesiredTrajectory();
-
-    // set initial and final times
-    double initTime = 0;
-    double endTime = initTime + m_plannerHorizon;
-
     // at the beginning iCub has to stop
     m_desiredPoint(0) = m_referencePointDistance(0);
     m_desiredPoint(1) = m_referencePointDistance(1);
 
-    // add the initial point
-    if(!m_trajectoryGenerator.addDesiredTrajectoryPoint(initTime, m_referencePointDistance))
-    {
-        yError() << "[generateFirstTrajectories] Error while setting the first reference.";
-        return false;
-    }
-
-    // add the final point
-    if(!m_trajectoryGenerator.addDesiredTrajectoryPoint(endTime, m_desiredPoint))
-    {
-        yError() << "[generateFirstTrajectories] Error while setting the new reference.";
+    if(!generateFirstTrajectories(m_trajectoryGenerator))
         return false;
-    }
 
-    // generate the first trajectories
-    if(!m_trajectoryGenerator.generateAndInterpolateDCM(initTime, m_dT, endTime))
+    if(!fillPlannedTrajectory(m_trajectoryGenerator, m_plannedTrajectoryBackBuffer))
     {
-        yError() << "[generateFirstTrajectories] Error while computing the first trajectories.";
+        yError() << "[generateFirstTrajectories] Error while storing the first trajectories.";
         return false;
     }
 
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_plannedRequest = PlannedRequest();
+    publishPlannedTrajectory();
     m_generatorState = GeneratorState::Returned;
     return true;
 }
@@ -314,33 +477,67 @@ bool TrajectoryGenerator::generateFirstTrajectories(const iDynTree::Transform &l
             yError() << "[generateFirstTrajectories] This is not the first step! How can I generate the first step?";
             return false;
         }
+        m_isFirstTrajectoryOnTheFly = true;
+        m_leftToRightTransform = leftToRightTransform;
+        m_isFirstTrajectoryTerminalStepAdded = m_isTerminalStepAdded;
+    }
+
+    // at the beginning iCub has to stop
+    m_desiredPoint(0) = m_referencePointDistance(0);
+    m_desiredPoint(1) = m_referencePointDistance(1);
+
+    if(!generateFirstTrajectories(m_trajectoryGenerator))
+        return false;
+
+    if(!fillPlannedTrajectory(m_trajectoryGenerator, m_plannedTrajectoryBackBuffer))
+    {
+        yError() << "[generateFirstTrajectories] Error while storing the first trajectories.";
+        return false;
     }
 
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_plannedRequest = PlannedRequest();
+    publishPlannedTrajectory();
+    m_generatorState = GeneratorState::Returned;
+    return true;
+}
+
+bool TrajectoryGenerator::generateFirstTrajectories(UnicycleTrajectoryGenerator& generator)
+{
+    generator.addTerminalStep(m_isFirstTrajectoryTerminalStepAdded);
+
     // clear the all trajectory
-    m_trajectoryGenerator.clearDesiredTrajectory();
+    generator.clearDesiredTrajectory();
 
     // set initial and final times
     double initTime = 0;
     double endTime = initTime + m_plannerHorizon;
 
-    // at the beginning iCub has to stop
-    m_desiredPoint(0) = m_referencePointDistance(0);
-    m_desiredPoint(1) = m_referencePointDistance(1);
-
     // add the initial point
-    if(!m_trajectoryGenerator.addDesiredTrajectoryPoint(initTime, m_referencePointDistance))
+    if(!generator.addDesiredTrajectoryPoint(initTime, m_referencePointDistance))
     {
         yError() << "[generateFirstTrajectories] Error while setting the first reference.";
         return false;
     }
 
-    // add the final point
-    if(!m_trajectoryGenerator.addDesiredTrajectoryPoint(endTime, m_desiredPoint))
+    // add the final point (at the beginning iCub has to stop)
+    if(!generator.addDesiredTrajectoryPoint(endTime, m_referencePointDistance))
     {
         yError() << "[generateFirstTrajectories] Error while setting the new reference.";
         return false;
     }
 
+    if(!m_isFirstTrajectoryOnTheFly)
+    {
+        // generate the first trajectories
+        if(!generator.generateAndInterpolateDCM(initTime, m_dT, endTime))
+        {
+            yError() << "[generateFirstTrajectories] Error while computing the first trajectories.";
+            return false;
+        }
+        return true;
+    }
+
     // add real position of the feet
     std::shared_ptr<FootPrint> left, right;
 
@@ -357,25 +554,25 @@ bool TrajectoryGenerator::generateFirstTrajectories(const iDynTree::Transform &l
     if(m_swingLeft)
     {
         rightPosition(0) = 0.0;
-        rightPosition(1) = -leftToRightTransform.inverse().getPosition()(1)/2;
+        rightPosition(1) = -m_leftToRightTransform.inverse().getPosition()(1)/2;
         rightAngle = 0;
         right->addStep(rightPosition, rightAngle, 0.0);
 
-        leftPosition(0) = leftToRightTransform.inverse().getPosition()(0);
-        leftPosition(1) = leftToRightTransform.inverse().getPosition()(1)/2;
-        leftAngle = leftToRightTransform.inverse().getRotation().asRPY()(2);
+        leftPosition(0) = m_leftToRightTransform.inverse().getPosition()(0);
+        leftPosition(1) = m_leftToRightTransform.inverse().getPosition()(1)/2;
+        leftAngle = m_leftToRightTransform.inverse().getRotation().asRPY()(2);
         left->addStep(leftPosition, leftAngle, 0.0);
     }
     else
     {
         leftPosition(0) = 0.0;
-        leftPosition(1) = -leftToRightTransform.getPosition()(1)/2;
+        leftPosition(1) = -m_leftToRightTransform.getPosition()(1)/2;
         leftAngle = 0;
         left->addStep(leftPosition, leftAngle, 0.0);
 
-        rightPosition(0) = leftToRightTransform.getPosition()(0);
-        rightPosition(1) = leftToRightTransform.getPosition()(1)/2;
-        rightAngle = leftToRightTransform.getRotation().asRPY()(2);
+        rightPosition(0) = m_leftToRightTransform.getPosition()(0);
+        rightPosition(1) = m_leftToRightTransform.getPosition()(1)/2;
+        rightAngle = m_leftToRightTransform.getRotation().asRPY()(2);
         right->addStep(rightPosition, rightAngle, 0.0);
     }
 
@@ -384,19 +581,19 @@ bool TrajectoryGenerator::generateFirstTrajectories(const iDynTree::Transform &l
     // initialCOMPositionXY(1) = initialCOMPosition(1);
 
     // generate the first trajectories
-    if(!m_trajectoryGenerator.generateAndInterpolateDCM(left, right, initTime, m_dT, endTime))
+    if(!generator.generateAndInterpolateDCM(left, right, initTime, m_dT, endTime))
     {
         yError() << "[generateFirstTrajectories] Error while computing the first trajectories.";
         return false;
     }
 
-    m_generatorState = GeneratorState::Returned;
     return true;
 }
 
 bool TrajectoryGenerator::updateTrajectories(double initTime, const iDynTree::Vector2& DCMBoundaryConditionAtMergePointPosition,
                                              const iDynTree::Vector2& DCMBoundaryConditionAtMergePointVelocity, bool correctLeft,
-                                             const iDynTree::Transform& measured, const iDynTree::Vector2& desiredPosition)
+                                             const iDynTree::Transform& measured, const iDynTree::Vector2& desiredPosition,
+                                             const iDynTree::Transform& otherFoot)
 {
     {
         std::lock_guard<std::mutex> guard(m_mutex);
@@ -415,31 +612,12 @@ bool TrajectoryGenerator::updateTrajectories(double initTime, const iDynTree::Ve
             return false;
         }
     }
-    // if correctLeft is true the stance foot is the true.
-    // The vector (expressed in the unicycle reference frame from the left foot to the center of the
-    // unicycle is [0, width/2]')
-    iDynTree::Vector2 unicyclePositionFromStanceFoot;
-    unicyclePositionFromStanceFoot(0) = 0.0;
-    unicyclePositionFromStanceFoot(1) = correctLeft ? -m_nominalWidth/2 : m_nominalWidth/2;
-
-    iDynTree::Vector2 desredPositionFromStanceFoot;
-    iDynTree::toEigen(desredPositionFromStanceFoot) = iDynTree::toEigen(unicyclePositionFromStanceFoot)
-        + iDynTree::toEigen(m_referencePointDistance) + iDynTree::toEigen(desiredPosition);
-
-    // prepare the rotation matrix w_R_{unicycle}
-    double theta = measured.getRotation().asRPY()(2);
-    double s_theta = std::sin(theta);
-    double c_theta = std::cos(theta);
 
     // save the data
     {
         std::lock_guard<std::mutex> guard(m_mutex);
 
-        // apply the homogeneous transformation w_H_{unicycle}
-        m_desiredPoint(0) = c_theta * desredPositionFromStanceFoot(0)
-            - s_theta * desredPositionFromStanceFoot(1) + measured.getPosition()(0);
-        m_desiredPoint(1) = s_theta * desredPositionFromStanceFoot(0)
-            + c_theta * desredPositionFromStanceFoot(1) + measured.getPosition()(1);
+        m_desiredPoint = evaluateDesiredPoint(correctLeft, measured, desiredPosition);
 
         m_initTime = initTime;
 
@@ -453,6 +631,7 @@ bool TrajectoryGenerator::updateTrajectories(double initTime, const iDynTree::Ve
             m_measuredTransformLeft = measured;
         else
             m_measuredTransformRight = measured;
+        m_otherFootTransform = otherFoot;
 
         m_generatorState = GeneratorState::Called;
     }
@@ -462,126 +641,566 @@ bool TrajectoryGenerator::updateTrajectories(double initTime, const iDynTree::Ve
     return true;
 }
 
-bool TrajectoryGenerator::isTrajectoryComputed()
+bool TrajectoryGenerator::updateSpeculativeTrajectories(double initTime,
+                                                        const iDynTree::Vector2& DCMBoundaryConditionAtMergePointPosition,
+                                                        const iDynTree::Vector2& DCMBoundaryConditionAtMergePointVelocity,
+                                                        bool correctLeft, const iDynTree::Transform& measured,
+                                                        const iDynTree::Vector2& desiredPosition)
 {
-    std::lock_guard<std::mutex> guard(m_mutex);
-    return m_generatorState == GeneratorState::Returned;
+    if(!m_useSpeculativePlanning)
+    {
+        yError() << "[updateSpeculativeTrajectories] The speculative planning is not enabled.";
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        // the trajectories that are still evaluated for the previous request will be discarded
+        m_speculativeRequest.id++;
+        m_speculativeRequest.initTime = initTime;
+        m_speculativeRequest.DCMBoundaryConditionAtMergePointPosition = DCMBoundaryConditionAtMergePointPosition;
+        m_speculativeRequest.DCMBoundaryConditionAtMergePointVelocity = DCMBoundaryConditionAtMergePointVelocity;
+        m_speculativeRequest.correctLeft = correctLeft;
+        m_speculativeRequest.measured = measured;
+
+        // the first planner evaluates the required goal the others a set of goals evenly
+        // distributed on a circle around it
+        std::size_t numberOfPerturbations = m_speculativePlanners.size() - 1;
+        for(std::size_t i = 0; i < m_speculativePlanners.size(); i++)
+        {
+            SpeculativePlanner& planner = *m_speculativePlanners[i];
+            planner.desiredPosition = desiredPosition;
+            planner.isComputed = false;
+
+            if(i == 0)
+                continue;
+
+            double angle = 2 * M_PI * (i - 1) / numberOfPerturbations;
+            planner.desiredPosition(0) += m_speculativeGoalPerturbation * std::cos(angle);
+            planner.desiredPosition(1) += m_speculativeGoalPerturbation * std::sin(angle);
+        }
+    }
+
+    m_speculativeConditionVariable.notify_all();
+
+    return true;
 }
 
-bool TrajectoryGenerator::isTrajectoryAsked()
+bool TrajectoryGenerator::getSpeculativeTrajectory(double initTime, const iDynTree::Vector2& desiredPosition,
+                                                   std::unique_ptr<PlannedTrajectory>& trajectory)
 {
     std::lock_guard<std::mutex> guard(m_mutex);
-    return m_generatorState == GeneratorState::Called;
+
+    // the candidates are evaluated for a different merge point
+    if(!m_useSpeculativePlanning || std::abs(m_speculativeRequest.initTime - initTime) > m_dT / 2)
+        return false;
+
+    // look for the closest candidate
+    SpeculativePlanner* closestPlanner = nullptr;
+    double closestDistance = m_speculativeGoalTolerance;
+    for(auto& planner : m_speculativePlanners)
+    {
+        // the candidates evaluated before the last merged trajectory start from different steps
+        if(!planner->isComputed || planner->alignment.mergedRequests != m_numberOfMergedRequests)
+            continue;
+
+        double distance = (iDynTree::toEigen(planner->desiredPosition)
+                           - iDynTree::toEigen(desiredPosition)).norm();
+        if(distance <= closestDistance)
+        {
+            closestDistance = distance;
+            closestPlanner = planner.get();
+        }
+    }
+
+    if(closestPlanner == nullptr)
+        return false;
+
+    // the memory previously pointed by trajectory will be reused by the planner
+    std::swap(closestPlanner->trajectory, trajectory);
+    closestPlanner->isComputed = false;
+
+    // once the candidate is merged the planner thread aligns the internal state of the
+    // main planner
+    m_handedOutRequest.request = closestPlanner->request;
+    m_handedOutRequest.planner = &closestPlanner->alignment;
+    m_handedOutRequest.isValid = true;
+    return true;
 }
 
-bool TrajectoryGenerator::getDCMPositionTrajectory(std::vector<iDynTree::Vector2>& DCMPositionTrajectory)
+bool TrajectoryGenerator::getPlannerLatency(double percentile, double& latency)
 {
-    if(!isTrajectoryComputed())
-    {
-        yError() << "[getDCMPositionTrajectory] No trajectories are available";
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    if(m_numberOfPlannerLatencies == 0)
         return false;
-    }
 
-    DCMPositionTrajectory = m_trajectoryGenerator.getDCMPosition();
+    // nth_element partially sorts the buffer so the percentile is evaluated without any
+    // additional memory
+    auto begin = m_sortedPlannerLatencies.begin();
+    auto end = begin + m_numberOfPlannerLatencies;
+    std::copy(m_plannerLatencies.begin(), m_plannerLatencies.begin() + m_numberOfPlannerLatencies, begin);
+
+    percentile = std::min(std::max(percentile, 0.0), 1.0);
+    std::size_t index = static_cast<std::size_t>(std::ceil(percentile * m_numberOfPlannerLatencies));
+    auto nth = begin + std::max(index, static_cast<std::size_t>(1)) - 1;
+    std::nth_element(begin, nth, end);
+
+    latency = *nth;
     return true;
 }
 
-bool TrajectoryGenerator::getDCMVelocityTrajectory(std::vector<iDynTree::Vector2>& DCMVelocityTrajectory)
+bool TrajectoryGenerator::isSpeculativePlanningEnabled() const
+{
+    return m_useSpeculativePlanning;
+}
+
+void TrajectoryGenerator::speculativeThread(std::size_t index)
 {
-    if(!isTrajectoryComputed())
+    SpeculativePlanner& planner = *m_speculativePlanners[index];
+    std::size_t lastRequest = 0;
+
+    while (true)
     {
-        yError() << "[getDCMVelocityTrajectory] No trajectories are available";
-        return false;
+        SpeculativeRequest request;
+        iDynTree::Vector2 desiredPosition;
+
+        // wait until a new set of candidates has to be evaluated
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_speculativeConditionVariable.wait(lock, [&]{return ((m_speculativeRequest.id != lastRequest)
+                                                                  || (m_generatorState == GeneratorState::Closing)
+                                                                  || isAlignmentRequired(planner.alignment));});
+
+            if(m_generatorState == GeneratorState::Closing)
+                break;
+
+            if(m_speculativeRequest.id == lastRequest)
+            {
+                lock.unlock();
+                alignIdlePlanner(planner.generator, planner.alignment, planner.replayedRequests);
+                continue;
+            }
+
+            // the first trajectory is required to align the planner
+            lastRequest = m_speculativeRequest.id;
+            if(m_generatorState == GeneratorState::FirstStep)
+                continue;
+
+            request = m_speculativeRequest;
+            desiredPosition = planner.desiredPosition;
+        }
+
+        // the planner keeps the steps evaluated before the init time, so its internal state is
+        // aligned with the merged trajectories (the ones evaluated by the other planners are
+        // evaluated again)
+        // the candidates of a diverged planner are not continuous with the merged trajectories
+        if(!alignPlanner(planner.generator, planner.alignment, planner.replayedRequests))
+            continue;
+
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            planner.alignment.isStale = true;
+            if(m_handedOutRequest.planner == &planner.alignment)
+                m_handedOutRequest.planner = nullptr;
+        }
+
+        PlannerRequest candidate;
+        candidate.initTime = request.initTime;
+        candidate.desiredPoint = evaluateDesiredPoint(request.correctLeft, request.measured, desiredPosition);
+        candidate.DCMPosition = request.DCMBoundaryConditionAtMergePointPosition;
+        candidate.DCMVelocity = request.DCMBoundaryConditionAtMergePointVelocity;
+        candidate.correctLeft = request.correctLeft;
+        candidate.measuredPosition(0) = request.measured.getPosition()(0);
+        candidate.measuredPosition(1) = request.measured.getPosition()(1);
+        candidate.measuredAngle = request.measured.getRotation().asRPY()(2);
+
+        // the terminal step is added only if the robot has to walk (see WalkingModule::setGoal)
+        candidate.terminalStep = desiredPosition(0) != 0 || desiredPosition(1) != 0;
+
+        // the trajectory is not accessed by the other threads until isComputed is false
+        if(!planTrajectory(planner.generator, candidate)
+           || !fillPlannedTrajectory(planner.generator, planner.trajectory))
+        {
+            yWarning() << "[TrajectoryGenerator_SpeculativeThread] Failed in computing a candidate trajectory.";
+            continue;
+        }
+
+        std::lock_guard<std::mutex> guard(m_mutex);
+        planner.request = candidate;
+        if(m_speculativeRequest.id == request.id)
+            planner.isComputed = true;
     }
+}
 
-    DCMVelocityTrajectory = m_trajectoryGenerator.getDCMVelocity();
-    return true;
+iDynTree::Vector2 TrajectoryGenerator::evaluateDesiredPoint(bool correctLeft,
+                                                            const iDynTree::Transform& measured,
+                                                            const iDynTree::Vector2& desiredPosition) const
+{
+    // if correctLeft is true the stance foot is the true.
+    // The vector (expressed in the unicycle reference frame from the left foot to the center of the
+    // unicycle is [0, width/2]')
+    iDynTree::Vector2 unicyclePositionFromStanceFoot;
+    unicyclePositionFromStanceFoot(0) = 0.0;
+    unicyclePositionFromStanceFoot(1) = correctLeft ? -m_nominalWidth/2 : m_nominalWidth/2;
+
+    iDynTree::Vector2 desredPositionFromStanceFoot;
+    iDynTree::toEigen(desredPositionFromStanceFoot) = iDynTree::toEigen(unicyclePositionFromStanceFoot)
+        + iDynTree::toEigen(m_referencePointDistance) + iDynTree::toEigen(desiredPosition);
+
+    // prepare the rotation matrix w_R_{unicycle}
+    double theta = measured.getRotation().asRPY()(2);
+    double s_theta = std::sin(theta);
+    double c_theta = std::cos(theta);
+
+    // apply the homogeneous transformation w_H_{unicycle}
+    iDynTree::Vector2 desiredPoint;
+    desiredPoint(0) = c_theta * desredPositionFromStanceFoot(0)
+        - s_theta * desredPositionFromStanceFoot(1) + measured.getPosition()(0);
+    desiredPoint(1) = s_theta * desredPositionFromStanceFoot(0)
+        + c_theta * desredPositionFromStanceFoot(1) + measured.getPosition()(1);
+
+    return desiredPoint;
+}
+
+PlanCacheKey TrajectoryGenerator::evaluatePlanCacheKey(const PlannerRequest& request,
+                                                       const iDynTree::Transform& otherFoot) const
+{
+    // only the x-y position and the yaw angle of the stance foot are used by the planner
+    Eigen::Rotation2Dd stance_R_world(-request.measuredAngle);
+    Eigen::Vector2d stancePosition = iDynTree::toEigen(request.measuredPosition);
+
+    PlanCacheKey key;
+    iDynTree::toEigen(key.desiredPoint) = stance_R_world * (iDynTree::toEigen(request.desiredPoint)
+                                                            - stancePosition);
+    iDynTree::toEigen(key.DCMPosition) = stance_R_world * (iDynTree::toEigen(request.DCMPosition)
+                                                           - stancePosition);
+    iDynTree::toEigen(key.DCMVelocity) = stance_R_world * iDynTree::toEigen(request.DCMVelocity);
+
+    Eigen::Vector2d otherFootPosition(otherFoot.getPosition()(0), otherFoot.getPosition()(1));
+    iDynTree::toEigen(key.otherFootPosition) = stance_R_world * (otherFootPosition - stancePosition);
+    double angle = otherFoot.getRotation().asRPY()(2) - request.measuredAngle;
+    key.otherFootAngle = std::atan2(std::sin(angle), std::cos(angle));
+
+    key.correctLeft = request.correctLeft;
+    key.terminalStep = request.terminalStep;
+
+    return key;
 }
 
-bool TrajectoryGenerator::getFeetTrajectories(std::vector<iDynTree::Transform>& lFootTrajectory,
-                                              std::vector<iDynTree::Transform>& rFootTrajectory)
+PlanCacheEntry* TrajectoryGenerator::findPlanCacheEntry(const PlanCacheKey& key)
 {
-    if(!isTrajectoryComputed())
+    auto isEqual = [](const iDynTree::Vector2& a, const iDynTree::Vector2& b, double tolerance)
+        {
+            return std::abs(a(0) - b(0)) <= tolerance && std::abs(a(1) - b(1)) <= tolerance;
+        };
+
+    for(auto& entry : m_planCache)
     {
-        yError() << "[getFeetTrajectories] No trajectories are available";
-        return false;
+        if(entry.isValid
+           && entry.key.correctLeft == key.correctLeft
+           && entry.key.terminalStep == key.terminalStep
+           && isEqual(entry.key.desiredPoint, key.desiredPoint, m_planCachePositionTolerance)
+           && isEqual(entry.key.DCMPosition, key.DCMPosition, m_planCachePositionTolerance)
+           && isEqual(entry.key.DCMVelocity, key.DCMVelocity, m_planCacheVelocityTolerance)
+           && isEqual(entry.key.otherFootPosition, key.otherFootPosition, m_planCachePositionTolerance)
+           && std::abs(entry.key.otherFootAngle - key.otherFootAngle) <= m_planCacheAngleTolerance)
+        {
+            entry.lastUse = ++m_planCacheUses;
+            return &entry;
+        }
     }
 
-    m_trajectoryGenerator.getFeetTrajectories(lFootTrajectory, rFootTrajectory);
-    return true;
+    return nullptr;
 }
 
-bool TrajectoryGenerator::getFeetTwist(std::vector<iDynTree::Twist>& lFootTwist,
-                                       std::vector<iDynTree::Twist>& rFootTwist)
+void TrajectoryGenerator::storePlanCacheEntry(const PlanCacheKey& key, const PlannedTrajectory& trajectory,
+                                              const iDynTree::Transform& world_H_stance)
 {
-    if(!isTrajectoryComputed())
+    auto entry = std::min_element(m_planCache.begin(), m_planCache.end(),
+                                  [](const PlanCacheEntry& a, const PlanCacheEntry& b)
+                                  {return a.lastUse < b.lastUse;});
+
+    entry->key = key;
+    transformPlannedTrajectory(trajectory, world_H_stance.inverse(), *entry->trajectory);
+    entry->lastUse = ++m_planCacheUses;
+    entry->isValid = true;
+}
+
+void TrajectoryGenerator::transformPlannedTrajectory(const PlannedTrajectory& input,
+                                                     const iDynTree::Transform& transform,
+                                                     PlannedTrajectory& output)
+{
+    output.begin = input.begin;
+    output.size = input.size;
+    output.mergePoints = input.mergePoints;
+
+    std::size_t end = input.begin + input.size;
+    output.samples.reserve(end, 0);
+    output.samples.copy(input.samples, input.begin, input.size, input.begin);
+
+    // the transformation is planar so the DCM is transformed with the x-y components only
+    const iDynTree::Rotation& rotation = transform.getRotation();
+    Eigen::Matrix2d rotation2D = iDynTree::toEigen(rotation).topLeftCorner<2, 2>();
+    Eigen::Vector2d position2D(transform.getPosition()(0), transform.getPosition()(1));
+
+    TrajectorySamples& samples = output.samples;
+    for(std::size_t i = input.begin; i < end; i++)
     {
-        yError() << "[getFeetTwist] No trajectories are available";
-        return false;
+        samples.leftTrajectory[i] = transform * samples.leftTrajectory[i];
+        samples.rightTrajectory[i] = transform * samples.rightTrajectory[i];
+        samples.leftTwistTrajectory[i] = rotation * samples.leftTwistTrajectory[i];
+        samples.rightTwistTrajectory[i] = rotation * samples.rightTwistTrajectory[i];
+        iDynTree::toEigen(samples.DCMPositionDesired[i]) = rotation2D
+            * iDynTree::toEigen(samples.DCMPositionDesired[i]) + position2D;
+        iDynTree::toEigen(samples.DCMVelocityDesired[i]) = rotation2D
+            * iDynTree::toEigen(samples.DCMVelocityDesired[i]);
     }
+}
 
-    m_trajectoryGenerator.getFeetTwist(lFootTwist, rFootTwist);
-    return true;
+bool TrajectoryGenerator::isTrajectoryComputed()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_generatorState == GeneratorState::Returned;
+}
+
+bool TrajectoryGenerator::isTrajectoryAsked()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_generatorState == GeneratorState::Called;
 }
 
-bool TrajectoryGenerator::getWhenUseLeftAsFixed(std::vector<bool>& isLeftFixedFrame)
+bool TrajectoryGenerator::fillPlannedTrajectory(UnicycleTrajectoryGenerator& generator,
+                                                std::unique_ptr<PlannedTrajectory>& buffer)
 {
-    if(!isTrajectoryComputed())
+    if(buffer == nullptr)
+        buffer = std::make_unique<PlannedTrajectory>();
+
+    PlannedTrajectory& trajectory = *buffer;
+
+    std::vector<iDynTree::Transform> leftTrajectory, rightTrajectory;
+    std::vector<iDynTree::Twist> leftTwistTrajectory, rightTwistTrajectory;
+    std::vector<bool> leftInContact, rightInContact, isLeftFixedFrame;
+    std::vector<double> comHeightTrajectory, comHeightVelocity;
+
+    const auto& DCMPositionDesired = generator.getDCMPosition();
+    const auto& DCMVelocityDesired = generator.getDCMVelocity();
+    generator.getFeetTrajectories(leftTrajectory, rightTrajectory);
+    generator.getFeetTwist(leftTwistTrajectory, rightTwistTrajectory);
+    generator.getFeetStandingPeriods(leftInContact, rightInContact);
+    generator.getWhenUseLeftAsFixed(isLeftFixedFrame);
+    generator.getCoMHeightTrajectory(comHeightTrajectory);
+    generator.getCoMHeightVelocity(comHeightVelocity);
+    generator.getMergePoints(trajectory.mergePoints);
+
+    std::size_t size = DCMPositionDesired.size();
+    if(size == 0
+       || DCMVelocityDesired.size() != size
+       || leftTrajectory.size() != size || rightTrajectory.size() != size
+       || leftTwistTrajectory.size() != size || rightTwistTrajectory.size() != size
+       || leftInContact.size() != size || rightInContact.size() != size
+       || isLeftFixedFrame.size() != size
+       || comHeightTrajectory.size() != size || comHeightVelocity.size() != size)
     {
-        yError() << "[getWhenUseLeftAsFixed] No trajectories are available";
+        yError() << "[fillPlannedTrajectory] The trajectories evaluated by the planner are empty or have different sizes.";
         return false;
     }
 
-    m_trajectoryGenerator.getWhenUseLeftAsFixed(isLeftFixedFrame);
+    // the memory is allocated only if the trajectory is longer than the previous ones
+    trajectory.begin = m_plannedTrajectoryHeadroom;
+    trajectory.size = size;
+    trajectory.samples.reserve(trajectory.begin + trajectory.size, 0);
+
+    trajectory.samples.leftTrajectory.copy(leftTrajectory, trajectory.begin);
+    trajectory.samples.rightTrajectory.copy(rightTrajectory, trajectory.begin);
+    trajectory.samples.leftTwistTrajectory.copy(leftTwistTrajectory, trajectory.begin);
+    trajectory.samples.rightTwistTrajectory.copy(rightTwistTrajectory, trajectory.begin);
+    trajectory.samples.DCMPositionDesired.copy(DCMPositionDesired, trajectory.begin);
+    trajectory.samples.DCMVelocityDesired.copy(DCMVelocityDesired, trajectory.begin);
+    trajectory.samples.leftInContact.copy(leftInContact, trajectory.begin);
+    trajectory.samples.rightInContact.copy(rightInContact, trajectory.begin);
+    trajectory.samples.isLeftFixedFrame.copy(isLeftFixedFrame, trajectory.begin);
+    trajectory.samples.comHeightTrajectory.copy(comHeightTrajectory, trajectory.begin);
+    trajectory.samples.comHeightVelocity.copy(comHeightVelocity, trajectory.begin);
+
     return true;
 }
 
+void TrajectoryGenerator::publishPlannedTrajectory()
+{
+    std::swap(m_plannedTrajectory, m_plannedTrajectoryBackBuffer);
+    m_isPlannedTrajectoryAvailable = true;
+}
 
-bool TrajectoryGenerator::getFeetStandingPeriods(std::vector<bool>& lFootContacts,
-                                                 std::vector<bool>& rFootContacts)
+bool TrajectoryGenerator::getPlannedTrajectory(std::unique_ptr<PlannedTrajectory>& trajectory)
 {
-    if(!isTrajectoryComputed())
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    if(m_generatorState != GeneratorState::Returned || !m_isPlannedTrajectoryAvailable)
     {
-        yError() << "[getFeetStandingPeriods] No trajectories are available";
+        yError() << "[getPlannedTrajectory] No trajectories are available";
         return false;
     }
 
-    m_trajectoryGenerator.getFeetStandingPeriods(lFootContacts, rFootContacts);
+    std::swap(m_plannedTrajectory, trajectory);
+    m_isPlannedTrajectoryAvailable = false;
+    m_handedOutRequest = m_plannedRequest;
     return true;
 }
 
-bool TrajectoryGenerator::getCoMHeightTrajectory(std::vector<double>& CoMHeightTrajectory)
+void TrajectoryGenerator::setTrajectoryMerged()
 {
-    if(!isTrajectoryComputed())
     {
-        yError() << "[getCoMHeightTrajectory] No trajectories are available";
-        return false;
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        // the first trajectory is not evaluated again
+        if(!m_handedOutRequest.isValid)
+            return;
+
+        // the internal state of the planner that evaluated the trajectory is aligned only if the
+        // trajectory was evaluated after all the previous merged requests
+        PlannerAlignment* planner = m_handedOutRequest.planner;
+        if(planner != nullptr && planner->mergedRequests == m_numberOfMergedRequests)
+        {
+            planner->mergedRequests++;
+            planner->isStale = false;
+        }
+
+        m_mergedRequests[m_numberOfMergedRequests % m_mergedRequests.size()] = m_handedOutRequest.request;
+        m_numberOfMergedRequests++;
+        m_handedOutRequest.isValid = false;
     }
 
-    m_trajectoryGenerator.getCoMHeightTrajectory(CoMHeightTrajectory);
-    return true;
+    // the planners that are too far behind are aligned in background
+    m_conditionVariable.notify_one();
+    m_speculativeConditionVariable.notify_all();
 }
 
-bool TrajectoryGenerator::getCoMHeightVelocity(std::vector<double>& CoMHeightVelocity)
+bool TrajectoryGenerator::planTrajectory(UnicycleTrajectoryGenerator& generator,
+                                         const PlannerRequest& request)
 {
-    if(!isTrajectoryComputed())
+    double endTime = request.initTime + m_plannerHorizon;
+
+    generator.addTerminalStep(request.terminalStep);
+    generator.clearDesiredTrajectory();
+    return generator.addDesiredTrajectoryPoint(endTime, request.desiredPoint)
+        && generator.reGenerateDCM(request.initTime, m_dT, endTime,
+                                   request.DCMPosition, request.DCMVelocity,
+                                   request.correctLeft, request.measuredPosition,
+                                   request.measuredAngle);
+}
+
+bool TrajectoryGenerator::alignPlanner(UnicycleTrajectoryGenerator& generator, PlannerAlignment& alignment,
+                                       std::vector<PlannerRequest>& buffer)
+{
+    // the requests are copied so the planner is evaluated outside the critical section
+    std::size_t numberOfMergedRequests;
+    bool isFirstTrajectoryRequired = false;
+    buffer.clear();
     {
-        yError() << "[getCoMHeightVelocity] No trajectories are available";
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        if(alignment.isDiverged)
+            return false;
+
+        numberOfMergedRequests = m_numberOfMergedRequests;
+        std::size_t first = alignment.mergedRequests;
+
+        // the planner evaluated a trajectory that was not merged (e.g. the planner was late), so
+        // the steps evaluated after the last merged trajectory are removed by evaluating it again
+        if(alignment.isStale)
+        {
+            if(first == 0)
+                isFirstTrajectoryRequired = true;
+            else
+                first--;
+        }
+
+        // the internal state cannot be evaluated from a part of the requests
+        std::size_t historySize = m_mergedRequests.size();
+        if(numberOfMergedRequests - first > historySize)
+        {
+            yError() << "[alignPlanner] The planner has to evaluate again"
+                     << numberOfMergedRequests - first << "merged requests but only the last"
+                     << historySize << "are stored. The planner is not used anymore.";
+            alignment.isDiverged = true;
+            return false;
+        }
+
+        for(std::size_t i = first; i < numberOfMergedRequests; i++)
+            buffer.push_back(m_mergedRequests[i % historySize]);
+    }
+
+    bool ok = true;
+    if(isFirstTrajectoryRequired)
+        ok = generateFirstTrajectories(generator);
+
+    for(const auto& request : buffer)
+        ok = ok && planTrajectory(generator, request);
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if(!ok)
+    {
+        yError() << "[alignPlanner] Unable to evaluate again the merged requests. The planner is "
+                 << "not used anymore.";
+        alignment.isDiverged = true;
         return false;
     }
 
-    m_trajectoryGenerator.getCoMHeightVelocity(CoMHeightVelocity);
+    alignment.mergedRequests = numberOfMergedRequests;
+    alignment.isStale = false;
     return true;
 }
 
-bool TrajectoryGenerator::getMergePoints(std::vector<size_t>& mergePoints)
+bool TrajectoryGenerator::isAlignmentRequired(const PlannerAlignment& alignment) const
+{
+    // the first trajectory is required to align the planner
+    if(alignment.isDiverged || m_generatorState == GeneratorState::FirstStep
+       || m_generatorState == GeneratorState::Closing)
+        return false;
+
+    std::size_t numberOfRequests = m_numberOfMergedRequests - alignment.mergedRequests;
+    if(alignment.isStale && alignment.mergedRequests > 0)
+        numberOfRequests++;
+
+    return numberOfRequests > m_mergedRequests.size() / 2;
+}
+
+void TrajectoryGenerator::alignIdlePlanner(UnicycleTrajectoryGenerator& generator, PlannerAlignment& alignment,
+                                           std::vector<PlannerRequest>& buffer)
 {
-    if(!isTrajectoryComputed())
+    // the trajectories evaluated before the alignment are no longer consistent with the
+    // internal state of the planner
     {
-        yError() << "[getMergePoints] No trajectories are available";
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if(m_plannedRequest.planner == &alignment)
+            m_plannedRequest.planner = nullptr;
+        if(m_handedOutRequest.planner == &alignment)
+            m_handedOutRequest.planner = nullptr;
+        for(auto& planner : m_speculativePlanners)
+            if(&planner->alignment == &alignment)
+                planner->isComputed = false;
+    }
+
+    alignPlanner(generator, alignment, buffer);
+}
+
+bool TrajectoryGenerator::setThreadsAffinity(const std::vector<int>& cores)
+{
+    if(!RealTimeHelper::setThreadAffinity(m_generatorThread, cores))
+    {
+        yError() << "[setThreadsAffinity] Unable to set the affinity of the planner thread.";
         return false;
     }
 
-    m_trajectoryGenerator.getMergePoints(mergePoints);
+    for(auto& planner : m_speculativePlanners)
+    {
+        if(!RealTimeHelper::setThreadAffinity(planner->thread, cores))
+        {
+            yError() << "[setThreadsAffinity] Unable to set the affinity of a speculative planner.";
+            return false;
+        }
+    }
     return true;
 }
@@ -0,0 +1,269 @@
+/**
+ * @file WalkingBenchmark.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+// YARP
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Value.h>
+
+// iDynTree
+#include <iDynTree/Core/EigenHelpers.h>
+
+#include "WalkingBenchmark.hpp"
+#include "Utils.hpp"
+
+bool WalkingBenchmark::configure(const yarp::os::Searchable& rf)
+{
+    // options of the benchmark (they can be passed from command line)
+    m_duration = rf.check("benchmark_duration", yarp::os::Value(20.0)).asDouble();
+    m_isRealTime = rf.check("benchmark_real_time", yarp::os::Value(false)).asBool();
+    m_goalPeriod = rf.check("benchmark_goal_period", yarp::os::Value(1.0)).asDouble();
+    m_goal.zero();
+    m_goal(0) = 0.5;
+    yarp::os::Value* goalYarp;
+    if(rf.check("benchmark_goal", goalYarp)
+       && !YarpHelper::yarpListToiDynTreeVectorFixSize(*goalYarp, m_goal))
+    {
+        yError() << "[configure] Unable to read the goal of the benchmark.";
+        return false;
+    }
+
+    // the controller of the WalkingModule is used, only the robot is replaced by the plant
+    m_module = std::make_unique<WalkingModule>();
+    if(!m_module->configureWithPlant(rf))
+    {
+        yError() << "[configure] Unable to configure the walking module.";
+        return false;
+    }
+
+    if(m_duration < m_module->m_dT)
+    {
+        yError() << "[configure] The duration of the benchmark is shorter than the sampling time.";
+        return false;
+    }
+    m_numberOfTicks = static_cast<unsigned int>(std::round(m_duration / m_module->m_dT));
+
+    // the feet dimensions are the ones used by the MPC
+    if(!m_supportPolygon.initialize(rf.findGroup("DCM_MPC_CONTROLLER")))
+    {
+        yError() << "[configure] Failed to configure the support polygon.";
+        return false;
+    }
+
+    // the stages are the timers of the module. All the samples of the benchmark are stored
+    // in a single window
+    m_stages = {"Feedbacks"};
+    if(m_module->m_useMPC)
+        m_stages.push_back("MPC");
+    m_stages.push_back("IK");
+    m_stages.push_back("Total");
+
+    m_module->m_profiler->setPeriod(m_numberOfTicks);
+    m_module->m_profiler->setWindowSize(m_numberOfTicks);
+    m_module->m_profiler->setVerbose(false);
+
+    m_plannerTimer.setWindowSize(m_numberOfTicks);
+
+    return true;
+}
+
+bool WalkingBenchmark::prepare()
+{
+    if(!m_module->prepareRobot())
+    {
+        yError() << "[prepare] Unable to prepare the robot.";
+        return false;
+    }
+
+    if(!m_module->applyStartWalking())
+    {
+        yError() << "[prepare] Unable to start walking.";
+        return false;
+    }
+
+    m_dcmSquaredErrorSum = 0;
+    m_metrics = BenchmarkMetrics();
+    m_metrics.minimumZMPMargin = std::numeric_limits<double>::infinity();
+
+    return true;
+}
+
+void WalkingBenchmark::updatePlannerTimer()
+{
+    const std::unique_ptr<TrajectoryGenerator>& trajectoryGenerator = m_module->m_trajectoryGenerator;
+
+    // when the loop does not run in real time the merge waits for the planner, otherwise the
+    // module would keep the current trajectory and the run would depend on the load of the machine
+    if(!m_isRealTime && m_module->m_newTrajectoryRequired && m_module->m_isNewTrajectoryAsked
+       && m_module->m_newTrajectoryMergeCounter == 2)
+        while(!trajectoryGenerator->isTrajectoryComputed())
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+    if(m_isPlannerTimerRunning && trajectoryGenerator->isTrajectoryComputed())
+    {
+        m_plannerTimer.setEndTime();
+        m_plannerTimer.evaluateDuration();
+        m_isPlannerTimerRunning = false;
+        m_numberOfPlans++;
+    }
+}
+
+bool WalkingBenchmark::updateMetrics()
+{
+    // the DCM and the wrenches are the ones evaluated by the last tick
+    iDynTree::Vector2 measuredDCM, measuredZMP;
+    if(!m_module->m_FKSolver->getDCM(measuredDCM) || !m_module->evaluateZMP(measuredZMP))
+    {
+        yError() << "[updateMetrics] Unable to get the measured DCM and ZMP.";
+        return false;
+    }
+
+    const TrajectoryBuffer& trajectory = m_module->m_trajectory;
+    double dcmError = (iDynTree::toEigen(measuredDCM)
+                       - iDynTree::toEigen(trajectory.getDCMPositionDesired().front())).norm();
+    m_dcmSquaredErrorSum += dcmError * dcmError;
+    m_metrics.dcmErrorMax = std::max(m_metrics.dcmErrorMax, dcmError);
+
+    // the constraints are evaluated again only when the feet in contact move
+    bool leftInContact = trajectory.getLeftInContact().front();
+    bool rightInContact = trajectory.getRightInContact().front();
+    if(!m_supportPolygon.evaluate(leftInContact ? &trajectory.getLeftFootTrajectory().front() : nullptr,
+                                  rightInContact ? &trajectory.getRightFootTrajectory().front() : nullptr))
+    {
+        yError() << "[updateMetrics] Unable to evaluate the support polygon.";
+        return false;
+    }
+    m_metrics.minimumZMPMargin = std::min(m_metrics.minimumZMPMargin,
+                                          m_supportPolygon.computeMargin(measuredZMP));
+    return true;
+}
+
+bool WalkingBenchmark::run()
+{
+    if(!prepare())
+    {
+        yError() << "[run] Unable to prepare the benchmark.";
+        return false;
+    }
+
+    double dT = m_module->m_dT;
+    double lastGoalTime = -m_goalPeriod;
+    auto initTime = std::chrono::steady_clock::now();
+    auto deadline = initTime;
+    for(unsigned int i = 0; i < m_numberOfTicks; i++)
+    {
+        double time = i * dT;
+
+        // the goal is sent periodically as the joypad does
+        if((m_goalPeriod > 0 && time - lastGoalTime >= m_goalPeriod) || i == 0)
+        {
+            bool isApplied;
+            if(!m_module->applyGoal(m_goal(0), m_goal(1), isApplied))
+            {
+                yError() << "[run] Unable to set the goal.";
+                return false;
+            }
+            lastGoalTime = time;
+        }
+
+        // the latency of the planner is measured from the beginning of the tick that asks
+        // the trajectory
+        updatePlannerTimer();
+        bool isTrajectoryAsked = m_module->m_isNewTrajectoryAsked;
+        if(!m_isPlannerTimerRunning)
+            m_plannerTimer.setInitTime();
+
+        // same tick of the WalkingModule, the metrics are evaluated before the propagation
+        if(!m_module->tick() || !updateMetrics() || !m_module->propagate())
+        {
+            yError() << "[run] The controller failed at time" << time;
+            return false;
+        }
+
+        if(!isTrajectoryAsked && m_module->m_isNewTrajectoryAsked)
+            m_isPlannerTimerRunning = true;
+
+        if(m_isRealTime)
+        {
+            deadline += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(dT));
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+    m_elapsedTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - initTime).count();
+
+    m_plannerTimer.evaluateStatistics();
+    m_metrics.dcmErrorRMS = std::sqrt(m_dcmSquaredErrorSum / m_numberOfTicks);
+
+    return true;
+}
+
+std::string WalkingBenchmark::getReport() const
+{
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(3);
+
+    double simulatedTime = m_numberOfTicks * m_module->m_dT;
+    report << "Ticks: " << m_numberOfTicks << " (simulated time " << simulatedTime
+           << " s, wall time " << m_elapsedTime << " s)\n";
+    report << "Throughput: " << m_numberOfTicks / m_elapsedTime << " ticks/s (real time factor "
+           << simulatedTime / m_elapsedTime << ")\n";
+
+    auto addRow = [&report](const std::string& name, const TimerStatistics& statistics)
+        {
+            report << std::left << std::setw(16) << name << std::right
+                   << std::setw(10) << statistics.average
+                   << std::setw(10) << statistics.p50
+                   << std::setw(10) << statistics.p99
+                   << std::setw(10) << statistics.min
+                   << std::setw(10) << statistics.max
+                   << std::setw(10) << statistics.totalDeadlineMisses << "\n";
+        };
+
+    report << std::left << std::setw(16) << "stage [ms]" << std::right
+           << std::setw(10) << "avg" << std::setw(10) << "p50" << std::setw(10) << "p99"
+           << std::setw(10) << "min" << std::setw(10) << "max" << std::setw(10) << "misses" << "\n";
+
+    TimerStatistics statistics;
+    for(const auto& stage : m_stages)
+        if(m_module->m_profiler->getStatistics(stage, statistics))
+            addRow(stage, statistics);
+
+    if(m_numberOfPlans > 0)
+        addRow("Planner", m_plannerTimer.getStatistics());
+
+    report << "Number of planned trajectories: " << m_numberOfPlans << "\n";
+    report << "DCM tracking error [mm]: rms " << m_metrics.dcmErrorRMS * 1000.0
+           << ", max " << m_metrics.dcmErrorMax * 1000.0 << "\n";
+    report << "Minimum ZMP margin [mm]: " << m_metrics.minimumZMPMargin * 1000.0 << "\n";
+
+    return report.str();
+}
+
+const BenchmarkMetrics& WalkingBenchmark::getMetrics() const
+{
+    return m_metrics;
+}
+
+const std::vector<std::string>& WalkingBenchmark::getStages() const
+{
+    return m_stages;
+}
+
+bool WalkingBenchmark::getStageStatistics(const std::string& stage, TimerStatistics& statistics) const
+{
+    return m_module->m_profiler->getStatistics(stage, statistics);
+}
@@ -0,0 +1,48 @@
+/**
+ * @file WalkingBenchmarkMain.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cstdlib>
+#include <iostream>
+
+// YARP
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/ResourceFinder.h>
+
+#include "WalkingBenchmark.hpp"
+
+int main(int argc, char * argv[])
+{
+    // initialise yarp. The benchmark does not open any port so the yarp server is not required
+    yarp::os::Network yarp;
+
+    // prepare and configure the resource finder (the configuration of the WalkingModule is used)
+    yarp::os::ResourceFinder& rf = yarp::os::ResourceFinder::getResourceFinderSingleton();
+
+    rf.setDefaultConfigFile("dcmWalkingCoordinator.ini");
+
+    rf.configure(argc, argv);
+
+    WalkingBenchmark benchmark;
+    if(!benchmark.configure(rf))
+    {
+        yError() << "[main] Unable to configure the benchmark.";
+        return EXIT_FAILURE;
+    }
+
+    if(!benchmark.run())
+    {
+        yError() << "[main] The benchmark failed.";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << benchmark.getReport();
+
+    return EXIT_SUCCESS;
+}
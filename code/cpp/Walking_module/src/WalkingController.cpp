@@ -6,14 +6,29 @@
  * @date 2018
  */
 
+// std
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+// eigen
+#include <Eigen/Dense>
+#include <Eigen/SparseLU>
+
 // yarp
 #include <yarp/os/LogStream.h>
 
 // iDynTree
+#include <iDynTree/Core/EigenHelpers.h>
 #include <iDynTree/Core/EigenSparseHelpers.h>
 #include <iDynTree/Core/Direction.h>
 
 #include "WalkingController.hpp"
+#ifdef WALKING_USE_OSQP_CODEGEN
+#include "CodegenMPCSolver.hpp"
+#endif
+#include "MatrixCache.hpp"
 #include "Utils.hpp"
 
 iDynSparseMatrix WalkingController::evaluateThetaMatrix()
@@ -235,72 +250,122 @@ bool WalkingController::initializeMatrices(const yarp::os::Searchable& config)
     // evaluate equal constraints matrix
     m_equalConstraintsMatrixTriplets = evaluateEqualConstraintsMatrix(stateDynamicsTriplets,
                                                                       inputDynamicsTriplets);
+
+    if(m_formulation == MPCFormulation::Condensed)
+    {
+        if(!initializeCondensedMatrices(config, exp(omega * dT), 1 - exp(omega * dT),
+                                        stateWeightStackedMatrix, inputWeightStackedMatrix,
+                                        thetaMatrix))
+        {
+            yError() << "[initialize] Unable to initialize the condensed matrices.";
+            return false;
+        }
+    }
     return true;
 }
 
-bool WalkingController::initializeConstraints(const yarp::os::Searchable& config)
+bool WalkingController::initializeCondensedMatrices(const yarp::os::Searchable& config,
+                                                    const double& stateDynamics,
+                                                    const double& inputDynamics,
+                                                    const iDynTree::Triplets& stateWeightStackedTriplets,
+                                                    const iDynTree::Triplets& inputWeightStackedTriplets,
+                                                    const iDynSparseMatrix& thetaMatrix)
 {
-    yarp::os::Value feetDimensions = config.find("foot_size");
-    if(feetDimensions.isNull() || !feetDimensions.isList())
+    // get the move blocking parameters. By default each block contains only one sample
+    int fineSamples = config.check("move_blocking_fine_samples",
+                                   yarp::os::Value(m_controllerHorizon)).asInt();
+    int coarseSamples = config.check("move_blocking_coarse_samples",
+                                     yarp::os::Value(1)).asInt();
+    if(fineSamples < 1 || coarseSamples < 1)
     {
-        yError() << "Please set the foot_size in the configuration file.";
+        yError() << "[initializeCondensedMatrices] The number of samples of each block has to be "
+                 << "a positive number.";
         return false;
     }
 
-    yarp::os::Bottle *feetDimensionsPointer = feetDimensions.asList();
-    if(!feetDimensionsPointer || feetDimensionsPointer->size() != 2)
+    // evaluate the length of each block
+    std::vector<int> blocksLength;
+    int coveredSamples = 0;
+    while(coveredSamples < m_controllerHorizon)
     {
-        yError() << "Error while reading the feet dimensions. Wrong number of elements.";
-        return false;
+        int length = (int)blocksLength.size() < fineSamples ? 1 : coarseSamples;
+        length = std::min(length, m_controllerHorizon - coveredSamples);
+        blocksLength.push_back(length);
+        coveredSamples += length;
     }
-
-    yarp::os::Value& xLimits = feetDimensionsPointer->get(0);
-    if(xLimits.isNull() || !xLimits.isList())
+    m_numberOfBlocks = blocksLength.size();
+
+    int stateVariables = m_stateSize * (m_controllerHorizon + 1);
+    int inputVariables = m_inputSize * m_controllerHorizon;
+
+    // move blocking matrix U = T V
+    Eigen::MatrixXd blockingMatrix = Eigen::MatrixXd::Zero(inputVariables,
+                                                           m_inputSize * m_numberOfBlocks);
+    int sample = 0;
+    for(int block = 0; block < m_numberOfBlocks; block++)
+        for(int i = 0; i < blocksLength[block]; i++, sample++)
+            blockingMatrix.block(sample * m_inputSize, block * m_inputSize,
+                                 m_inputSize, m_inputSize).setIdentity();
+
+    // dynamics propagation X = Phi x_0 + Gamma U
+    Eigen::MatrixXd phiMatrix = Eigen::MatrixXd::Zero(stateVariables, m_stateSize);
+    Eigen::MatrixXd gammaMatrix = Eigen::MatrixXd::Zero(stateVariables, inputVariables);
+    for(int k = 0; k < (m_controllerHorizon + 1); k++)
     {
-        yError() << "Error while reading the X limits.";
-        return false;
-    }
+        phiMatrix.block(k * m_stateSize, 0, m_stateSize, m_stateSize) =
+            std::pow(stateDynamics, k) * Eigen::MatrixXd::Identity(m_stateSize, m_stateSize);
 
-    yarp::os::Bottle *xLimitsPtr = xLimits.asList();
-    if(!xLimitsPtr || xLimitsPtr->size() != 2)
-    {
-        yError() << "Error while reading the X limits. Wrong dimensions.";
-        return false;
+        for(int j = 0; j < k; j++)
+            gammaMatrix.block(k * m_stateSize, j * m_inputSize, m_stateSize, m_inputSize) =
+                std::pow(stateDynamics, k - 1 - j) * inputDynamics
+                * Eigen::MatrixXd::Identity(m_stateSize, m_inputSize);
     }
 
-    double xlimit1 = xLimitsPtr->get(0).asDouble();
-    double xlimit2 = xLimitsPtr->get(1).asDouble();
+    // weight matrices
+    iDynSparseMatrix stateWeightStackedMatrix(stateVariables, stateVariables);
+    stateWeightStackedMatrix.setFromConstTriplets(stateWeightStackedTriplets);
+    Eigen::MatrixXd stateWeight = Eigen::MatrixXd(iDynTree::toEigen(stateWeightStackedMatrix));
 
-    yarp::os::Value& yLimits = feetDimensionsPointer->get(1);
-    if(yLimits.isNull() || !yLimits.isList())
-    {
-        yError() << "Error while reading the Y limits.";
-        return false;
-    }
+    iDynSparseMatrix inputWeightStackedMatrix(inputVariables, inputVariables);
+    inputWeightStackedMatrix.setFromConstTriplets(inputWeightStackedTriplets);
+    Eigen::MatrixXd inputWeight = Eigen::MatrixXd(iDynTree::toEigen(inputWeightStackedMatrix));
+
+    Eigen::MatrixXd theta = Eigen::MatrixXd(iDynTree::toEigen(thetaMatrix));
+
+    // evaluate the hessian matrix
+    Eigen::MatrixXd gammaTransposeStateWeight = gammaMatrix.transpose() * stateWeight;
+    Eigen::MatrixXd hessianInput = gammaTransposeStateWeight * gammaMatrix
+        + theta.transpose() * inputWeight * theta;
+    Eigen::MatrixXd hessian = blockingMatrix.transpose() * hessianInput * blockingMatrix;
+    m_condensedHessianMatrix = iDynTreeHelper::SparseMatrix::fromEigen(Eigen::SparseMatrix<double>(hessian.sparseView()));
+
+    // evaluate the gradient submatrices
+    m_condensedReferenceGradientMatrix = blockingMatrix.transpose() * gammaTransposeStateWeight;
+    m_condensedStateGradientMatrix = m_condensedReferenceGradientMatrix * phiMatrix;
+    m_condensedInputGradientMatrix = blockingMatrix.transpose()
+        * Eigen::MatrixXd(iDynTree::toEigen(m_gradientSubmatrix));
 
-    yarp::os::Bottle *yLimitsPtr = yLimits.asList();
-    if(!yLimitsPtr || yLimitsPtr->size() != 2)
+    yInfo() << "[initializeCondensedMatrices] Condensed MPC with" << m_numberOfBlocks
+            << "input blocks (" << m_inputSize * m_numberOfBlocks << "variables).";
+
+    return true;
+}
+
+bool WalkingController::initializeConstraints(const yarp::os::Searchable& config)
+{
+    // the half-spaces of the feet are evaluated once in the foot frame
+    if(!m_footprintConstraints.initialize(config))
     {
-        yError() << "Error while reading the Y limits. Wrong dimensions.";
+        yError() << "[initializeConstraints] Unable to initialize the feet polygons.";
         return false;
     }
 
-    double ylimit1 = yLimitsPtr->get(0).asDouble();
-    double ylimit2 = yLimitsPtr->get(1).asDouble();
-
-    // evaluate the foot polygon
-    iDynTree::Polygon foot;
-    foot = iDynTree::Polygon::XYRectangleFromOffsets(std::abs(std::max(xlimit1, xlimit2)),
-                                                     std::abs(std::min(xlimit1, xlimit2)),
-                                                     std::abs(std::max(ylimit1, ylimit2)),
-                                                     std::abs(std::min(ylimit1, ylimit2)));
-    m_feetPolygons.resize(2);
-    m_feetPolygons[0] = foot;
-    m_feetPolygons[1] = foot;
-
     // set the tolerance of the convex hull
     m_convexHullTolerance = config.check("convex_hull_tolerance", yarp::os::Value(0.01)).asDouble();
 
+    // check the ZMP along the whole horizon (diagnostic)
+    m_checkHorizonMargin = config.check("check_horizon_margin", yarp::os::Value(false)).asBool();
+
     return true;
 }
 
@@ -342,151 +407,474 @@ bool WalkingController::initialize(const yarp::os::Searchable& config)
     // used to indicate the first step.
     m_feetStatus = std::make_pair<bool, bool>(false, false);
 
-    if(!initializeMatrices(config))
+    // get the formulation of the problem
+    std::string formulation = config.check("mpc_formulation", yarp::os::Value("sparse")).asString();
+    if(formulation == "sparse")
+        m_formulation = MPCFormulation::Sparse;
+    else if(formulation == "condensed")
+        m_formulation = MPCFormulation::Condensed;
+    else
     {
-        yError() << "[initialize] Error while the matrices are initialized";
+        yError() << "[initialize] Unknown MPC formulation: " << formulation
+                 << ". Please use 'sparse' or 'condensed'.";
         return false;
     }
 
+    // skip the QP solver when the unconstrained optimum satisfies the constraints
+    m_useUnconstrainedFastPath = config.check("use_unconstrained_fast_path",
+                                              yarp::os::Value(false)).asBool();
+
+    // use the solvers generated at build time if they were generated for this configuration
+    m_useGeneratedSolvers = config.check("use_generated_mpc_solvers", yarp::os::Value(true)).asBool();
+
+    // the matrices evaluated with the same configuration are loaded from the cache
+    std::string cacheDirectory = config.check("startup_cache_directory", yarp::os::Value("")).asString();
+    std::uint64_t cacheKey = MatrixCache::computeKey(config.toString());
+    std::string cacheFile;
+    bool isCacheLoaded = false;
+    if(!cacheDirectory.empty())
+    {
+        std::ostringstream cacheFileName;
+        cacheFileName << cacheDirectory << "/dcmWalkingMPC_" << std::hex << cacheKey << ".cache";
+        cacheFile = cacheFileName.str();
+        isCacheLoaded = loadMatrices(cacheFile, cacheKey);
+    }
+
+    if(!isCacheLoaded)
+    {
+        if(!initializeMatrices(config))
+        {
+            yError() << "[initialize] Error while the matrices are initialized";
+            return false;
+        }
+    }
+
     if(!initializeConstraints(config))
     {
         yError() << "[initialize] Error while the constraints are initialized";
         return false;
     }
 
+    if(!initializeControllers())
+    {
+        yError() << "[initialize] Error while the controllers are initialized";
+        return false;
+    }
+
+    if(m_useUnconstrainedFastPath && !isCacheLoaded)
+    {
+        if(!initializeUnconstrainedSolution())
+        {
+            yError() << "[initialize] Error while the unconstrained solution is initialized";
+            return false;
+        }
+    }
+
+    // the controller can be used even if the cache cannot be written
+    if(!cacheFile.empty() && !isCacheLoaded)
+    {
+        if(!saveMatrices(cacheFile, cacheKey))
+            yWarning() << "[initialize] Unable to write the cache" << cacheFile;
+    }
+
     return true;
 }
 
-bool WalkingController::setConvexHullConstraint(const std::deque<iDynTree::Transform>& leftFoot,
-                                                const std::deque<iDynTree::Transform>& rightFoot,
-                                                const std::deque<bool>& leftInContact,
-                                                const std::deque<bool>& rightInContact)
+bool WalkingController::loadMatrices(const std::string& fileName, std::uint64_t key)
 {
-    auto feetStatus = std::make_pair<bool, bool>((bool)leftInContact.front(), (bool)rightInContact.front());
+    MatrixCache cache;
+    if(!cache.read(fileName, key))
+        return false;
 
-    // the status of the feet is the same of the previous iteration
-    // the convexHull is already evaluated: do nothing
-    if(m_feetStatus == feetStatus)
-        return true;
+    Eigen::MatrixXd dimensions;
+    if(!cache.getMatrix("dimensions", dimensions) || dimensions.size() != 2)
+        return false;
+    m_controllerHorizon = dimensions(0);
+    m_numberOfBlocks = dimensions(1);
 
-    m_feetStatus = feetStatus;
+    if(!cache.getSparseMatrix("hessian", m_hessianMatrix)
+       || !cache.getSparseMatrix("gradient_submatrix", m_gradientSubmatrix)
+       || !cache.getSparseMatrix("state_weight", m_stateWeightMatrix)
+       || !cache.getTriplets("equal_constraints", m_equalConstraintsMatrixTriplets))
+        return false;
 
-    // evaluate the convex hull
-    if(feetStatus == std::make_pair<bool, bool>(true, true))
+    if(m_formulation == MPCFormulation::Condensed)
+    {
+        if(!cache.getSparseMatrix("condensed_hessian", m_condensedHessianMatrix)
+           || !cache.getMatrix("condensed_state_gradient", m_condensedStateGradientMatrix)
+           || !cache.getMatrix("condensed_reference_gradient", m_condensedReferenceGradientMatrix)
+           || !cache.getMatrix("condensed_input_gradient", m_condensedInputGradientMatrix))
+            return false;
+    }
+
+    if(m_useUnconstrainedFastPath)
+    {
+        if(!cache.getMatrix("unconstrained_gradient_gain", m_unconstrainedGradientGain)
+           || !cache.getMatrix("unconstrained_state_gain", m_unconstrainedStateGain))
+            return false;
+        m_unconstrainedInputs = Eigen::VectorXd::Zero(m_unconstrainedGradientGain.rows());
+    }
+
+    yInfo() << "[loadMatrices] The MPC matrices are loaded from" << fileName;
+    return true;
+}
+
+bool WalkingController::saveMatrices(const std::string& fileName, std::uint64_t key)
+{
+    MatrixCache cache;
+
+    Eigen::MatrixXd dimensions(2, 1);
+    dimensions(0) = m_controllerHorizon;
+    dimensions(1) = m_formulation == MPCFormulation::Condensed ? m_numberOfBlocks : 0;
+    cache.addMatrix("dimensions", dimensions);
+
+    cache.addSparseMatrix("hessian", m_hessianMatrix);
+    cache.addSparseMatrix("gradient_submatrix", m_gradientSubmatrix);
+    cache.addSparseMatrix("state_weight", m_stateWeightMatrix);
+    cache.addTriplets("equal_constraints", m_equalConstraintsMatrixTriplets,
+                      m_stateSize * (m_controllerHorizon + 1),
+                      m_stateSize * (m_controllerHorizon + 1) + m_inputSize * m_controllerHorizon);
+
+    if(m_formulation == MPCFormulation::Condensed)
+    {
+        cache.addSparseMatrix("condensed_hessian", m_condensedHessianMatrix);
+        cache.addMatrix("condensed_state_gradient", m_condensedStateGradientMatrix);
+        cache.addMatrix("condensed_reference_gradient", m_condensedReferenceGradientMatrix);
+        cache.addMatrix("condensed_input_gradient", m_condensedInputGradientMatrix);
+    }
+
+    if(m_useUnconstrainedFastPath)
     {
-        if(!buildConvexHull(leftFoot.front(), rightFoot.front()))
+        cache.addMatrix("unconstrained_gradient_gain", m_unconstrainedGradientGain);
+        cache.addMatrix("unconstrained_state_gain", m_unconstrainedStateGain);
+    }
+
+    return cache.write(fileName, key);
+}
+
+bool WalkingController::initializeControllers()
+{
+    // the convex hull of the a set of polygons has at most a number of edges equal to
+    // the number of vertices
+    int singleSupportConstraints = std::max(m_footprintConstraints.getNumberOfFootVertices(0),
+                                            m_footprintConstraints.getNumberOfFootVertices(1));
+    int doubleSupportConstraints = m_footprintConstraints.getNumberOfFootVertices(0) +
+        m_footprintConstraints.getNumberOfFootVertices(1);
+
+    std::vector<std::pair<std::pair<bool, bool>, int>> configurations;
+    configurations.push_back(std::make_pair(std::make_pair(true, true), doubleSupportConstraints));
+    configurations.push_back(std::make_pair(std::make_pair(true, false), singleSupportConstraints));
+    configurations.push_back(std::make_pair(std::make_pair(false, true), singleSupportConstraints));
+
+#ifdef WALKING_USE_OSQP_CODEGEN
+    // names of the generated solvers (see codegen/generate_mpc_solvers.py)
+    const char* generatedSolverNames[] = {"double_support", "left_support", "right_support"};
+#endif
+
+    // dummy quantities used only to initialize the solvers
+    iDynTree::Vector2 dummyState;
+    dummyState.zero();
+    TrajectoryView<iDynTree::Vector2> dummyReference(&dummyState, 1, 1);
+
+    m_controllers.clear();
+    m_dualVariables.clear();
+    for(std::size_t i = 0; i < configurations.size(); i++)
+    {
+        const auto& configuration = configurations[i];
+        std::shared_ptr<MPCSolverInterface> controller;
+
+#ifdef WALKING_USE_OSQP_CODEGEN
+        if(m_formulation == MPCFormulation::Sparse && m_useGeneratedSolvers)
         {
-            yError() << "[setConvexHullConstraint] Error while the contraints are evaluated.";
+            const WalkingMPCCodegenSolver* generatedSolver = CodegenMPCSolver::findGeneratedSolver(generatedSolverNames[i]);
+            if(generatedSolver != nullptr)
+            {
+                auto codegenController = std::make_shared<CodegenMPCSolver>(generatedSolver,
+                                                                            m_stateSize, m_inputSize,
+                                                                            m_controllerHorizon,
+                                                                            configuration.second,
+                                                                            m_equalConstraintsMatrixTriplets,
+                                                                            m_gradientSubmatrix,
+                                                                            m_stateWeightMatrix);
+                if(codegenController->isCompatible(m_hessianMatrix))
+                    controller = codegenController;
+            }
+
+            if(controller == nullptr)
+                yWarning() << "[initializeControllers] The generated solver" << generatedSolverNames[i]
+                           << "does not match the configuration. The generic solver is used.";
+        }
+#endif
+
+        // generic solvers
+        if(controller == nullptr && m_formulation == MPCFormulation::Sparse)
+            controller = std::make_shared<MPCSolver>(m_stateSize, m_inputSize,
+                                                     m_controllerHorizon,
+                                                     configuration.second,
+                                                     m_equalConstraintsMatrixTriplets,
+                                                     m_gradientSubmatrix,
+                                                     m_stateWeightMatrix);
+        else if(controller == nullptr)
+            controller = std::make_shared<CondensedMPCSolver>(m_stateSize, m_inputSize,
+                                                              m_controllerHorizon,
+                                                              m_numberOfBlocks,
+                                                              configuration.second,
+                                                              m_condensedStateGradientMatrix,
+                                                              m_condensedReferenceGradientMatrix,
+                                                              m_condensedInputGradientMatrix);
+
+        // the hessian matrix is set only once
+        const iDynSparseMatrix& hessian = m_formulation == MPCFormulation::Sparse ?
+            m_hessianMatrix : m_condensedHessianMatrix;
+        if(!controller->setHessianMatrix(hessian))
+        {
+            yError() << "[initializeControllers] Unable to set the hessian matrix.";
             return false;
         }
+
+        // all the inequality constraints are disabled until the first convex hull is set
+        if(!controller->setConstraintsMatrix(iDynTree::MatrixDynSize(0, m_inputSize)))
+        {
+            yError() << "[initializeControllers] Unable to set the constraints matrix.";
+            return false;
+        }
+
+        if(!controller->setBounds(dummyState, iDynTree::VectorDynSize(0)))
+        {
+            yError() << "[initializeControllers] Unable to set the bounds.";
+            return false;
+        }
+
+        if(!controller->setGradient(dummyReference, m_output, true))
+        {
+            yError() << "[initializeControllers] Unable to set the gradient.";
+            return false;
+        }
+
+        if(!controller->initialize())
+        {
+            yError() << "[initializeControllers] Unable to initialize the solver.";
+            return false;
+        }
+
+        m_controllers.insert(std::make_pair(configuration.first, controller));
+        m_dualVariables.insert(std::make_pair(configuration.first,
+                                              Eigen::VectorXd::Zero(controller->getNumberOfConstraints())));
+    }
+
+    // the number of variables is the same for all the controllers
+    if(!m_controllers.begin()->second->getPrimalVariable(m_primalVariable))
+    {
+        yError() << "[initializeControllers] Unable to allocate the primal variable.";
+        return false;
     }
 
-    if(feetStatus == std::make_pair<bool, bool>(true, false))
+    m_currentController = nullptr;
+    return true;
+}
+
+bool WalkingController::initializeUnconstrainedSolution()
+{
+    // only the inputs that are checked are evaluated
+    int numberOfInputs = 1;
+    if(m_checkHorizonMargin)
+        numberOfInputs = m_formulation == MPCFormulation::Sparse ? m_controllerHorizon
+            : m_numberOfBlocks;
+    int numberOfRows = m_inputSize * numberOfInputs;
+
+    // the matrices are symmetric so the rows of their inverse associated to the inputs are
+    // obtained solving the linear system with the unit vectors as right hand side
+    if(m_formulation == MPCFormulation::Sparse)
     {
-        if(!buildConvexHull(leftFoot.front()))
+        int numberOfVariables = m_stateSize * (m_controllerHorizon + 1) +
+            m_inputSize * m_controllerHorizon;
+        int numberOfEqualityConstraints = m_stateSize * (m_controllerHorizon + 1);
+        int firstInputIndex = m_stateSize * (m_controllerHorizon + 1);
+        int kktSize = numberOfVariables + numberOfEqualityConstraints;
+
+        // KKT = [H A_eq'; A_eq 0]
+        std::vector<Eigen::Triplet<double>> kktTriplets;
+        Eigen::SparseMatrix<double> hessian = iDynTree::toEigen(m_hessianMatrix);
+        for(int k = 0; k < hessian.outerSize(); k++)
+            for(Eigen::SparseMatrix<double>::InnerIterator it(hessian, k); it; ++it)
+                kktTriplets.push_back(Eigen::Triplet<double>(it.row(), it.col(), it.value()));
+
+        for(auto triplet : m_equalConstraintsMatrixTriplets)
         {
-            yError() << "[setConvexHullConstraint] Error while the contraints are evaluated.";
+            kktTriplets.push_back(Eigen::Triplet<double>(numberOfVariables + triplet.row,
+                                                         triplet.column, triplet.value));
+            kktTriplets.push_back(Eigen::Triplet<double>(triplet.column,
+                                                         numberOfVariables + triplet.row,
+                                                         triplet.value));
+        }
+
+        Eigen::SparseMatrix<double> kktMatrix(kktSize, kktSize);
+        kktMatrix.setFromTriplets(kktTriplets.begin(), kktTriplets.end());
+        kktMatrix.makeCompressed();
+
+        Eigen::SparseLU<Eigen::SparseMatrix<double>> kktSolver;
+        kktSolver.compute(kktMatrix);
+        if(kktSolver.info() != Eigen::Success)
+        {
+            yError() << "[initializeUnconstrainedSolution] Unable to factorize the KKT matrix.";
             return false;
         }
-    }
 
-    if(feetStatus == std::make_pair<bool, bool>(false, true))
+        Eigen::MatrixXd unitVectors = Eigen::MatrixXd::Zero(kktSize, numberOfRows);
+        unitVectors.block(firstInputIndex, 0, numberOfRows, numberOfRows).setIdentity();
+        Eigen::MatrixXd inverseRows = Eigen::MatrixXd(kktSolver.solve(unitVectors)).transpose();
+
+        // [z; lambda] = KKT^-1 [-g; b_eq] where b_eq = [-x_0; 0; ...; 0]
+        m_unconstrainedGradientGain = -inverseRows.leftCols(numberOfVariables);
+        m_unconstrainedStateGain = -inverseRows.block(0, numberOfVariables, numberOfRows, m_stateSize);
+    }
+    else
     {
-        if(!buildConvexHull(rightFoot.front()))
+        // the hessian is positive definite and the current state is already in the gradient
+        Eigen::MatrixXd hessian = Eigen::MatrixXd(iDynTree::toEigen(m_condensedHessianMatrix));
+        Eigen::LLT<Eigen::MatrixXd> hessianSolver(hessian);
+        if(hessianSolver.info() != Eigen::Success)
         {
-            yError() << "[setConvexHullConstraint] Error while the contraints are evaluated.";
+            yError() << "[initializeUnconstrainedSolution] Unable to factorize the hessian matrix.";
             return false;
         }
+
+        // the first input is the first optimization variable
+        Eigen::MatrixXd unitVectors = Eigen::MatrixXd::Identity(hessian.rows(), numberOfRows);
+        m_unconstrainedGradientGain = -Eigen::MatrixXd(hessianSolver.solve(unitVectors)).transpose();
+        m_unconstrainedStateGain = Eigen::MatrixXd::Zero(numberOfRows, m_stateSize);
+    }
+
+    m_unconstrainedInputs = Eigen::VectorXd::Zero(numberOfRows);
+
+    return true;
+}
+
+bool WalkingController::solveUnconstrained()
+{
+    // the products are evaluated in place (no temporaries are allocated)
+    m_unconstrainedInputs.noalias() = m_unconstrainedGradientGain * m_currentController->getGradient();
+    m_unconstrainedInputs.noalias() += m_unconstrainedStateGain * iDynTree::toEigen(m_currentState);
+
+    // the inequality constraints act only on the first input
+    m_zmpMargin = m_footprintConstraints.computeMinimumMargin(m_unconstrainedInputs.data(), 1);
+    return m_zmpMargin >= 0;
+}
+
+bool WalkingController::warmStartController(const std::shared_ptr<MPCSolverInterface>& previousController,
+                                            Eigen::VectorXd& previousDualVariable,
+                                            const std::shared_ptr<MPCSolverInterface>& nextController,
+                                            Eigen::VectorXd& nextDualVariable)
+{
+    // the buffers have already the right size so they are not reallocated
+    if(!previousController->getPrimalVariable(m_primalVariable))
+    {
+        yError() << "[warmStartController] Unable to get the primal variable.";
+        return false;
     }
 
+    if(!previousController->getDualVariable(previousDualVariable))
+    {
+        yError() << "[warmStartController] Unable to get the dual variable.";
+        return false;
+    }
+
+    // the equality constraints are the same for all the controllers
+    int numberOfEqualityConstraints = nextController->getNumberOfEqualityConstraints();
+    nextDualVariable.setZero();
+    nextDualVariable.head(numberOfEqualityConstraints) = previousDualVariable.head(numberOfEqualityConstraints);
+
+    if(!nextController->setPrimalVariable(m_primalVariable))
+    {
+        yError() << "[warmStartController] Unable to set the primal variable.";
+        return false;
+    }
+
+    if(!nextController->setDualVariable(nextDualVariable))
+    {
+        yError() << "[warmStartController] Unable to set the dual variable.";
+        return false;
+    }
+
+    return true;
+}
+
+bool WalkingController::setConvexHullConstraint(const TrajectoryView<iDynTree::Transform>& leftFoot,
+                                                const TrajectoryView<iDynTree::Transform>& rightFoot,
+                                                const TrajectoryView<bool>& leftInContact,
+                                                const TrajectoryView<bool>& rightInContact)
+{
+    auto feetStatus = std::make_pair<bool, bool>((bool)leftInContact.front(), (bool)rightInContact.front());
+
+    // the status of the feet is the same of the previous iteration
+    // the convexHull is already evaluated: do nothing
+    if(m_feetStatus == feetStatus)
+        return true;
+
+    std::pair<bool, bool> previousFeetStatus = m_feetStatus;
+    m_feetStatus = feetStatus;
+
     if(feetStatus == std::make_pair<bool, bool>(false, false))
     {
         yError() << "[setConvexHullConstraint] None foot is in contact How is it possible?.";
         return false;
     }
 
-    int numberOfConstraints = m_convexHullComputer.A.rows();
+    // evaluate the convex hull
+    if(!m_footprintConstraints.evaluate(feetStatus.first ? &leftFoot.front() : nullptr,
+                                        feetStatus.second ? &rightFoot.front() : nullptr))
+    {
+        yError() << "[setConvexHullConstraint] Error while the contraints are evaluated.";
+        return false;
+    }
 
-    // is it possible to reuse the old solver??
-    m_currentController = std::make_shared<MPCSolver>(m_stateSize, m_inputSize,
-                                                      m_controllerHorizon,
-                                                      numberOfConstraints,
-                                                      m_equalConstraintsMatrixTriplets,
-                                                      m_gradientSubmatrix,
-                                                      m_stateWeightMatrix);
-    // the hessian matrix is set only once
-    if(!m_currentController->setHessianMatrix(m_hessianMatrix))
+    auto controller = m_controllers.find(feetStatus);
+    if(controller == m_controllers.end())
     {
-        yError() << "[addNewController] Unable to set the hessian matrix.";
+        yError() << "[setConvexHullConstraint] The controllers are not initialized.";
         return false;
     }
 
-    if(!m_currentController->setConstraintsMatrix(m_convexHullComputer.A))
+    // only the values of the constraints matrix are updated, the solver is not reinitialized
+    if(!controller->second->setConstraintsMatrix(m_footprintConstraints.getConstraintsMatrix()))
     {
         yError() << "[setConvexHullConstraint] Unable to add set constraints Matrix.";
         return false;
     }
 
+    if(m_currentController != nullptr)
+    {
+        if(!warmStartController(m_currentController, m_dualVariables.at(previousFeetStatus),
+                                controller->second, m_dualVariables.at(feetStatus)))
+            yWarning() << "[setConvexHullConstraint] Unable to warm start the controller.";
+    }
+
+    m_currentController = controller->second;
+
+    // the gradient stored in the controller is related to an old trajectory
+    m_isControllerSwitched = true;
+
     return true;
 }
 
 bool WalkingController::setFeedback(const iDynTree::Vector2& currentState)
 {
-    return m_currentController->setBounds(currentState, m_convexHullComputer.b);
+    m_currentState = currentState;
+    return m_currentController->setBounds(currentState, m_footprintConstraints.getConstraintsVector());
 }
 
-bool WalkingController::setReferenceSignal(const std::deque<iDynTree::Vector2>& referenceSignal,
+bool WalkingController::setReferenceSignal(const TrajectoryView<iDynTree::Vector2>& referenceSignal,
                                            const bool& resetTrajectory)
 {
-    return m_currentController->setGradient(referenceSignal, m_output, resetTrajectory);
-}
-
-bool WalkingController::buildConvexHull(const iDynTree::Transform& leftFootTransform,
-                                        const iDynTree::Transform& rightFootTransform)
-{
-    // initilialize axes direction
-    iDynTree::Direction xAxis, yAxis;
-    xAxis.zero();
-    xAxis(0) = 1;
-    yAxis.zero();
-    yAxis(1) = 1;
-
-    // initilize plane origin
-    iDynTree::Position planeOrigin;
-    planeOrigin.zero();
-
-    std::vector<iDynTree::Transform> feetTransforms;
-    feetTransforms.push_back(leftFootTransform);
-    feetTransforms.push_back(rightFootTransform);
-
-    return m_convexHullComputer.buildConvexHull(xAxis, yAxis, planeOrigin,
-                                                m_feetPolygons, feetTransforms);
-}
-
-bool WalkingController::buildConvexHull(const iDynTree::Transform& footTransform)
-{
-    // initilialize axes direction
-    iDynTree::Direction xAxis, yAxis;
-    xAxis.zero();
-    xAxis(0) = 1;
-    yAxis.zero();
-    yAxis(1) = 1;
-
-    // initilize plane origin
-    iDynTree::Position planeOrigin;
-    planeOrigin.zero();
-
-    std::vector<iDynTree::Transform> feetTransforms;
-    feetTransforms.push_back(footTransform);
-
-    return m_convexHullComputer.buildConvexHull(xAxis, yAxis, planeOrigin,
-                                                std::vector<iDynTree::Polygon>(1, m_feetPolygons[0]),
-                                                feetTransforms);
+    bool reset = resetTrajectory || m_isControllerSwitched;
+    m_isControllerSwitched = false;
+    return m_currentController->setGradient(referenceSignal, m_output, reset);
 }
 
 bool WalkingController::solve()
 {
     m_isSolutionEvaluated = false;
+    m_isSolutionUnconstrained = false;
     if(!m_currentController->isInitialized())
     {
         if(!m_currentController->initialize())
@@ -496,26 +884,89 @@ bool WalkingController::solve()
         }
     }
 
+    // the unconstrained optimum is feasible, it is the solution of the QP problem
+    if(m_useUnconstrainedFastPath && solveUnconstrained())
+    {
+        m_output(0) = m_unconstrainedInputs(0);
+        m_output(1) = m_unconstrainedInputs(1);
+
+        if(m_checkHorizonMargin)
+            m_horizonMargin = m_footprintConstraints.computeMinimumMargin(m_unconstrainedInputs.data(),
+                                                                          m_unconstrainedInputs.size() / m_inputSize);
+
+        m_isSolutionUnconstrained = true;
+        m_isSolutionEvaluated = true;
+        return true;
+    }
+
     if(!m_currentController->solve())
     {
         yError() << "[solve] Unable to solve the problem.";
         return false;
     }
 
-    iDynTree::VectorDynSize solution = m_currentController->getSolution();
-    m_output(0) = solution(m_stateSize * (m_controllerHorizon + 1));
-    m_output(1) = solution(m_stateSize * (m_controllerHorizon + 1) + 1);
+    const iDynTree::VectorDynSize& solution = m_currentController->getSolution();
+    int firstInputIndex = m_currentController->getFirstInputIndex();
+    m_output(0) = solution(firstInputIndex);
+    m_output(1) = solution(firstInputIndex + 1);
 
-    if(m_convexHullComputer.computeMargin(m_output) < -m_convexHullTolerance)
+    m_zmpMargin = m_footprintConstraints.computeMargin(m_output);
+    if(m_zmpMargin < -m_convexHullTolerance)
     {
         yError() << "[solve] The evaluated ZMP is outside the convexHull.";
         return false;
     }
 
+    // the inputs are stored contiguously in the solution vector
+    if(m_checkHorizonMargin)
+    {
+        int numberOfInputs = m_formulation == MPCFormulation::Sparse ? m_controllerHorizon
+            : m_numberOfBlocks;
+        m_horizonMargin = m_footprintConstraints.computeMinimumMargin(solution.data() + firstInputIndex,
+                                                                      numberOfInputs);
+    }
+
     m_isSolutionEvaluated = true;
     return true;
 }
 
+bool WalkingController::warmUp(const TrajectoryView<iDynTree::Transform>& leftFoot,
+                               const TrajectoryView<iDynTree::Transform>& rightFoot,
+                               const TrajectoryView<bool>& leftInContact,
+                               const TrajectoryView<bool>& rightInContact,
+                               const TrajectoryView<iDynTree::Vector2>& referenceSignal)
+{
+    iDynTree::Vector2 output = m_output;
+
+    bool isSolved = setConvexHullConstraint(leftFoot, rightFoot, leftInContact, rightInContact)
+        && setFeedback(referenceSignal.front())
+        && setReferenceSignal(referenceSignal, true)
+        && (m_currentController->isInitialized() || m_currentController->initialize());
+
+    // both the fast path and the solver are evaluated, the solution of the solver is used to
+    // warm start the first iteration
+    if(isSolved)
+    {
+        if(m_useUnconstrainedFastPath)
+            solveUnconstrained();
+        isSolved = m_currentController->solve();
+    }
+
+    // the dry run does not affect the first iteration
+    m_output = output;
+    m_isSolutionEvaluated = false;
+    m_isSolutionUnconstrained = false;
+    m_isControllerSwitched = true;
+
+    if(!isSolved)
+    {
+        yError() << "[warmUp] Unable to solve the problem.";
+        return false;
+    }
+
+    return true;
+}
+
 bool WalkingController::getControllerOutput(iDynTree::Vector2& controllerOutput)
 {
     if(!m_isSolutionEvaluated)
@@ -529,3 +980,35 @@ bool WalkingController::getControllerOutput(iDynTree::Vector2& controllerOutput)
     controllerOutput = m_output;
     return true;
 }
+
+bool WalkingController::isHorizonMarginChecked() const
+{
+    return m_checkHorizonMargin;
+}
+
+double WalkingController::getHorizonMargin() const
+{
+    return m_horizonMargin;
+}
+
+bool WalkingController::isSolutionUnconstrained() const
+{
+    return m_isSolutionUnconstrained;
+}
+
+double WalkingController::getZMPMargin() const
+{
+    return m_zmpMargin;
+}
+
+void WalkingController::getSolverStatistics(QPSolverStatistics& statistics)
+{
+    // the solver is not called by the unconstrained fast path
+    if(m_currentController == nullptr || m_isSolutionUnconstrained)
+    {
+        statistics = QPSolverStatistics();
+        return;
+    }
+
+    m_currentController->getStatistics(statistics);
+}
@@ -22,15 +22,39 @@
 #include "WalkingForwardKinematics.hpp"
 #include "Utils.hpp"
 
+void WalkingFK::KinematicsCache::invalidate()
+{
+    isLeftFootTransformEvaluated = false;
+    isRightFootTransformEvaluated = false;
+    isRootLinkTransformEvaluated = false;
+    isNeckOrientationEvaluated = false;
+    isRootLinkVelocityEvaluated = false;
+    isLeftFootJacobianEvaluated = false;
+    isRightFootJacobianEvaluated = false;
+    isNeckJacobianEvaluated = false;
+    isCoMJacobianEvaluated = false;
+}
+
 bool WalkingFK::setRobotModel(const iDynTree::Model& model)
 {
-    if(!m_kinDyn.loadRobotModel(model))
+    for(KinematicsCache* cache : {&m_measured, &m_desired})
     {
-        yError() << "[setRobotModel] Error while loading into KinDynComputations object.";
-        return false;
-    }
+        if(!cache->kinDyn.loadRobotModel(model))
+        {
+            yError() << "[setRobotModel] Error while loading into KinDynComputations object.";
+            return false;
+        }
 
-    m_kinDyn.setFrameVelocityRepresentation(iDynTree::MIXED_REPRESENTATION);
+        cache->kinDyn.setFrameVelocityRepresentation(iDynTree::MIXED_REPRESENTATION);
+
+        // the jacobians are stored in preallocated matrices
+        int numberOfDoFs = model.getNrOfDOFs() + 6;
+        cache->leftFootJacobian.resize(6, numberOfDoFs);
+        cache->rightFootJacobian.resize(6, numberOfDoFs);
+        cache->neckJacobian.resize(6, numberOfDoFs);
+        cache->comJacobian.resize(3, numberOfDoFs);
+        cache->invalidate();
+    }
 
     // initialize some quantities needed for the first step
     m_prevContactLeft = false;
@@ -40,7 +64,7 @@ bool WalkingFK::setRobotModel(const iDynTree::Model& model)
 
 bool WalkingFK::setBaseFrames(const std::string& lFootFrame, const std::string& rFootFrame)
 {
-    if(!m_kinDyn.isValid())
+    if(!m_measured.kinDyn.isValid())
     {
         yError() << "[setBaseFrames] Please set the Robot model before calling this method.";
         return false;
@@ -50,29 +74,47 @@ bool WalkingFK::setBaseFrames(const std::string& lFootFrame, const std::string&
     // note: in the following the base frames will be:
     // - left_foot when the left foot is the stance foot;
     // - right_foot when the right foot is the stance foot.
-    m_frameLeftIndex = m_kinDyn.model().getFrameIndex(lFootFrame);
+    m_frameLeftIndex = m_measured.kinDyn.model().getFrameIndex(lFootFrame);
     if(m_frameLeftIndex == iDynTree::FRAME_INVALID_INDEX)
     {
         yError() << "[setBaseFrames] Unable to find the frame named: " << lFootFrame;
         return false;
     }
-    iDynTree::LinkIndex linkLeftIndex = m_kinDyn.model().getFrameLink(m_frameLeftIndex);
-    m_baseFrameLeft = m_kinDyn.model().getLinkName(linkLeftIndex);
-    m_frameHlinkLeft = m_kinDyn.getRelativeTransform(m_frameLeftIndex, linkLeftIndex);
+    iDynTree::LinkIndex linkLeftIndex = m_measured.kinDyn.model().getFrameLink(m_frameLeftIndex);
+    m_baseFrameLeft = m_measured.kinDyn.model().getLinkName(linkLeftIndex);
+    m_frameHlinkLeft = m_measured.kinDyn.getRelativeTransform(m_frameLeftIndex, linkLeftIndex);
 
-    m_frameRightIndex = m_kinDyn.model().getFrameIndex(rFootFrame);
+    m_frameRightIndex = m_measured.kinDyn.model().getFrameIndex(rFootFrame);
     if(m_frameRightIndex == iDynTree::FRAME_INVALID_INDEX)
     {
         yError() << "[setBaseFrames] Unable to find the frame named: " << rFootFrame;
         return false;
     }
-    iDynTree::LinkIndex linkRightIndex = m_kinDyn.model().getFrameLink(m_frameRightIndex);
-    m_baseFrameRight = m_kinDyn.model().getLinkName(linkRightIndex);
-    m_frameHlinkRight = m_kinDyn.getRelativeTransform(m_frameRightIndex, linkRightIndex);
+    iDynTree::LinkIndex linkRightIndex = m_measured.kinDyn.model().getFrameLink(m_frameRightIndex);
+    m_baseFrameRight = m_measured.kinDyn.model().getLinkName(linkRightIndex);
+    m_frameHlinkRight = m_measured.kinDyn.getRelativeTransform(m_frameRightIndex, linkRightIndex);
 
     return true;
 }
 
+bool WalkingFK::setFloatingBase(const std::string& baseLink)
+{
+    // the base is shared by the measured and the desired state
+    for(KinematicsCache* cache : {&m_measured, &m_desired})
+    {
+        if(!cache->kinDyn.setFloatingBase(baseLink))
+            return false;
+
+        cache->invalidate();
+    }
+    return true;
+}
+
+WalkingFK::KinematicsCache& WalkingFK::getCache(const FKState& state)
+{
+    return state == FKState::Desired ? m_desired : m_measured;
+}
+
 bool WalkingFK::initialize(const yarp::os::Searchable& config,
                            const iDynTree::Model& model)
 {
@@ -112,14 +154,14 @@ bool WalkingFK::initialize(const yarp::os::Searchable& config,
         return false;
     }
 
-    m_frameRootIndex = m_kinDyn.model().getFrameIndex("root_link");
+    m_frameRootIndex = m_measured.kinDyn.model().getFrameIndex("root_link");
     if(m_frameRootIndex == iDynTree::FRAME_INVALID_INDEX)
     {
         yError() << "[initialize] Unable to find the frame named: root_link";
         return false;
     }
 
-    m_frameNeckIndex = m_kinDyn.model().getFrameIndex("neck_2");
+    m_frameNeckIndex = m_measured.kinDyn.model().getFrameIndex("neck_2");
     if(m_frameNeckIndex == iDynTree::FRAME_INVALID_INDEX)
     {
         yError() << "[initialize] Unable to find the frame named: root_link";
@@ -150,14 +192,23 @@ bool WalkingFK::initialize(const yarp::os::Searchable& config,
         return false;
     }
 
-    m_comPositionFiltered.resize(3,0);
-    m_comPositionFiltered(2) = comHeight;
-    m_comVelocityFiltered.resize(3,0);
+    m_comPositionGroup = m_comFilters.addGroup(3, cutFrequency, samplingTime);
+    m_comVelocityGroup = m_comFilters.addGroup(3, cutFrequency, samplingTime);
+    if(m_comPositionGroup < 0 || m_comVelocityGroup < 0)
+    {
+        yError() << "[initialize] Unable to set the CoM filters.";
+        return false;
+    }
+
+    // the filtered quantities are written directly by the filter bank
+    m_comFilters.setOutput(m_comPositionGroup, m_comPositionFiltered.data());
+    m_comFilters.setOutput(m_comVelocityGroup, m_comVelocityFiltered.data());
 
-    m_comPositionFilter = std::make_unique<iCub::ctrl::FirstOrderLowPassFilter>(cutFrequency, samplingTime);
-    m_comVelocityFilter = std::make_unique<iCub::ctrl::FirstOrderLowPassFilter>(cutFrequency, samplingTime);
-    m_comPositionFilter->init(m_comPositionFiltered);
-    m_comVelocityFilter->init(m_comVelocityFiltered);
+    iDynTree::Position initialCoMPosition(0, 0, comHeight);
+    iDynTree::Vector3 initialCoMVelocity;
+    initialCoMVelocity.zero();
+    m_comFilters.init(m_comPositionGroup, initialCoMPosition.data());
+    m_comFilters.init(m_comVelocityGroup, initialCoMVelocity.data());
 
     m_useFilters = config.check("use_filters", yarp::os::Value(false)).asBool();
 
@@ -167,7 +218,7 @@ bool WalkingFK::initialize(const yarp::os::Searchable& config,
 bool WalkingFK::evaluateFirstWorldToBaseTransformation(const iDynTree::Transform& leftFootTransform)
 {
     m_worldToBaseTransform = leftFootTransform * m_frameHlinkLeft;
-    if(!m_kinDyn.setFloatingBase(m_baseFrameLeft))
+    if(!setFloatingBase(m_baseFrameLeft))
     {
         yError() << "[evaluateWorldToBaseTransformation] Error while setting the floating "
                  << "base on link " << m_baseFrameLeft;
@@ -186,7 +237,7 @@ bool WalkingFK::evaluateWorldToBaseTransformation(const bool& isLeftFixedFrame)
         if(!m_prevContactLeft)
         {
             m_worldToBaseTransform =  this->getLeftFootToWorldTransform() * m_frameHlinkLeft;
-            if(!m_kinDyn.setFloatingBase(m_baseFrameLeft))
+            if(!setFloatingBase(m_baseFrameLeft))
             {
                 yError() << "[evaluateWorldToBaseTransformation] Error while setting the floating "
                          << "base on link " << m_baseFrameLeft;
@@ -202,7 +253,7 @@ bool WalkingFK::evaluateWorldToBaseTransformation(const bool& isLeftFixedFrame)
         if(m_prevContactLeft)
         {
             m_worldToBaseTransform = this->getRightFootToWorldTransform() * m_frameHlinkRight;
-            if(!m_kinDyn.setFloatingBase(m_baseFrameRight))
+            if(!setFloatingBase(m_baseFrameRight))
             {
                 yError() << "[evaluateWorldToBaseTransformation] Error while setting the floating "
                          << "base on link " << m_baseFrameRight;
@@ -225,7 +276,7 @@ bool WalkingFK::evaluateWorldToBaseTransformation(const iDynTree::Transform& lef
         if(!m_prevContactLeft || m_firstStep)
         {
             m_worldToBaseTransform = leftFootTransform * m_frameHlinkLeft;
-            if(!m_kinDyn.setFloatingBase(m_baseFrameLeft))
+            if(!setFloatingBase(m_baseFrameLeft))
             {
                 yError() << "[evaluateWorldToBaseTransformation] Error while setting the floating "
                          << "base on link " << m_baseFrameLeft;
@@ -241,7 +292,7 @@ bool WalkingFK::evaluateWorldToBaseTransformation(const iDynTree::Transform& lef
         if(m_prevContactLeft || m_firstStep)
         {
             m_worldToBaseTransform = rightFootTransform * m_frameHlinkRight;
-            if(!m_kinDyn.setFloatingBase(m_baseFrameRight))
+            if(!setFloatingBase(m_baseFrameRight))
             {
                 yError() << "[evaluateWorldToBaseTransformation] Error while setting the floating "
                          << "base on link " << m_baseFrameRight;
@@ -255,16 +306,18 @@ bool WalkingFK::evaluateWorldToBaseTransformation(const iDynTree::Transform& lef
     return true;
 }
 
-bool WalkingFK::setInternalRobotState(const iDynTree::VectorDynSize& positionFeedbackInRadians,
-                                      const iDynTree::VectorDynSize& velocityFeedbackInRadians)
+bool WalkingFK::setRobotState(KinematicsCache& cache,
+                              const iDynTree::VectorDynSize& jointPosition,
+                              const iDynTree::VectorDynSize& jointVelocity)
 {
     iDynTree::Vector3 gravity;
     gravity.zero();
     gravity(2) = -9.81;
 
-    if(!m_kinDyn.setRobotState(m_worldToBaseTransform, positionFeedbackInRadians,
-                               iDynTree::Twist::Zero(), velocityFeedbackInRadians,
-                               gravity))
+    cache.invalidate();
+    if(!cache.kinDyn.setRobotState(m_worldToBaseTransform, jointPosition,
+                                   iDynTree::Twist::Zero(), jointVelocity,
+                                   gravity))
     {
         yError() << "[setRobotState] Error while updating the state.";
         return false;
@@ -275,34 +328,33 @@ bool WalkingFK::setInternalRobotState(const iDynTree::VectorDynSize& positionFee
     return true;
 }
 
+bool WalkingFK::setInternalRobotState(const iDynTree::VectorDynSize& positionFeedbackInRadians,
+                                      const iDynTree::VectorDynSize& velocityFeedbackInRadians)
+{
+    return setRobotState(m_measured, positionFeedbackInRadians, velocityFeedbackInRadians);
+}
+
+bool WalkingFK::setDesiredRobotState(const iDynTree::VectorDynSize& desiredPositionInRadians,
+                                     const iDynTree::VectorDynSize& desiredVelocityInRadians)
+{
+    return setRobotState(m_desired, desiredPositionInRadians, desiredVelocityInRadians);
+}
+
 bool WalkingFK::evaluateCoM()
 {
     m_comEvaluated = false;
-    if(!m_kinDyn.isValid())
+    if(!m_measured.kinDyn.isValid())
     {
         yError() << "[evaluateCoM] The KinDynComputations solver is not initialized.";
         return false;
     }
 
-    m_comPosition = m_kinDyn.getCenterOfMassPosition();
-    m_comVelocity = m_kinDyn.getCenterOfMassVelocity();
+    m_comPosition = m_measured.kinDyn.getCenterOfMassPosition();
+    m_comVelocity = m_measured.kinDyn.getCenterOfMassVelocity();
 
-    yarp::sig::Vector temp;
-    temp.resize(3);
-
-    if(!iDynTree::toYarp(m_comPosition, temp))
-    {
-        yError() << "[evaluateCoM] Unable to convert an iDynTree::Position to a yarp vector";
-        return false;
-    }
-    m_comPositionFiltered = m_comPositionFilter->filt(temp);
-
-    if(!iDynTree::toYarp(m_comVelocity, temp))
-    {
-        yError() << "[evaluateCoM] Unable to convert an iDynTree::Vector to a yarp vector";
-        return false;
-    }
-    m_comVelocityFiltered = m_comVelocityFilter->filt(temp);
+    m_comFilters.setInput(m_comPositionGroup, m_comPosition.data());
+    m_comFilters.setInput(m_comVelocityGroup, m_comVelocity.data());
+    m_comFilters.process();
 
     m_comEvaluated = true;
 
@@ -360,13 +412,7 @@ bool WalkingFK::getCoMPosition(iDynTree::Position& comPosition)
     }
 
     if(m_useFilters)
-    {
-        if(!iDynTree::toiDynTree(m_comPositionFiltered, comPosition))
-        {
-            yError() << "[getCoMPosition] Unable to convert a yarp vector to an iDynTree position";
-            return false;
-        }
-    }
+        comPosition = m_comPositionFiltered;
     else
         comPosition = m_comPosition;
 
@@ -382,13 +428,7 @@ bool WalkingFK::getCoMVelocity(iDynTree::Vector3& comVelocity)
     }
 
     if(m_useFilters)
-    {
-        if(!iDynTree::toiDynTree(m_comVelocityFiltered, comVelocity))
-        {
-            yError() << "[getCoMVelocity] Unable to convert a yarp vector to an iDynTree vector";
-            return false;
-        }
-    }
+        comVelocity = m_comVelocityFiltered;
     else
         comVelocity = m_comVelocity;
 
@@ -398,7 +438,7 @@ bool WalkingFK::getCoMVelocity(iDynTree::Vector3& comVelocity)
 bool WalkingFK::setBaseOnTheFly()
 {
     m_worldToBaseTransform = m_frameHlinkLeft;
-    if(!m_kinDyn.setFloatingBase(m_baseFrameLeft))
+    if(!setFloatingBase(m_baseFrameLeft))
     {
         yError() << "[setBaseOnTheFly] Error while setting the floating base on link "
                  << m_baseFrameLeft;
@@ -408,47 +448,109 @@ bool WalkingFK::setBaseOnTheFly()
     return true;
 }
 
-iDynTree::Transform WalkingFK::getLeftFootToWorldTransform()
+const iDynTree::Transform& WalkingFK::getLeftFootToWorldTransform(const FKState& state)
 {
-    return m_kinDyn.getWorldTransform(m_frameLeftIndex);
+    KinematicsCache& cache = getCache(state);
+    if(!cache.isLeftFootTransformEvaluated)
+    {
+        cache.leftFootToWorldTransform = cache.kinDyn.getWorldTransform(m_frameLeftIndex);
+        cache.isLeftFootTransformEvaluated = true;
+    }
+    return cache.leftFootToWorldTransform;
 }
 
-iDynTree::Transform WalkingFK::getRightFootToWorldTransform()
+const iDynTree::Transform& WalkingFK::getRightFootToWorldTransform(const FKState& state)
 {
-    return m_kinDyn.getWorldTransform(m_frameRightIndex);
+    KinematicsCache& cache = getCache(state);
+    if(!cache.isRightFootTransformEvaluated)
+    {
+        cache.rightFootToWorldTransform = cache.kinDyn.getWorldTransform(m_frameRightIndex);
+        cache.isRightFootTransformEvaluated = true;
+    }
+    return cache.rightFootToWorldTransform;
 }
 
-iDynTree::Transform WalkingFK::getRootLinkToWorldTransform()
+const iDynTree::Transform& WalkingFK::getRootLinkToWorldTransform(const FKState& state)
 {
-    return m_kinDyn.getWorldTransform(m_frameRootIndex);
+    KinematicsCache& cache = getCache(state);
+    if(!cache.isRootLinkTransformEvaluated)
+    {
+        cache.rootLinkToWorldTransform = cache.kinDyn.getWorldTransform(m_frameRootIndex);
+        cache.isRootLinkTransformEvaluated = true;
+    }
+    return cache.rootLinkToWorldTransform;
 }
 
-iDynTree::Twist WalkingFK::getRootLinkVelocity()
+const iDynTree::Twist& WalkingFK::getRootLinkVelocity(const FKState& state)
 {
-    return m_kinDyn.getFrameVel(m_frameRootIndex);
+    KinematicsCache& cache = getCache(state);
+    if(!cache.isRootLinkVelocityEvaluated)
+    {
+        cache.rootLinkVelocity = cache.kinDyn.getFrameVel(m_frameRootIndex);
+        cache.isRootLinkVelocityEvaluated = true;
+    }
+    return cache.rootLinkVelocity;
 }
 
-iDynTree::Rotation WalkingFK::getNeckOrientation()
+const iDynTree::Rotation& WalkingFK::getNeckOrientation(const FKState& state)
 {
-    return m_kinDyn.getWorldTransform(m_frameNeckIndex).getRotation();
+    KinematicsCache& cache = getCache(state);
+    if(!cache.isNeckOrientationEvaluated)
+    {
+        cache.neckOrientation = cache.kinDyn.getWorldTransform(m_frameNeckIndex).getRotation();
+        cache.isNeckOrientationEvaluated = true;
+    }
+    return cache.neckOrientation;
 }
 
-bool WalkingFK::getLeftFootJacobian(iDynTree::MatrixDynSize &jacobian)
+bool WalkingFK::getLeftFootJacobian(iDynTree::MatrixDynSize &jacobian, const FKState& state)
 {
-    return m_kinDyn.getFrameFreeFloatingJacobian(m_frameLeftIndex, jacobian);
+    KinematicsCache& cache = getCache(state);
+    if(!cache.isLeftFootJacobianEvaluated)
+    {
+        if(!cache.kinDyn.getFrameFreeFloatingJacobian(m_frameLeftIndex, cache.leftFootJacobian))
+            return false;
+        cache.isLeftFootJacobianEvaluated = true;
+    }
+    jacobian = cache.leftFootJacobian;
+    return true;
 }
 
-bool WalkingFK::getRightFootJacobian(iDynTree::MatrixDynSize &jacobian)
+bool WalkingFK::getRightFootJacobian(iDynTree::MatrixDynSize &jacobian, const FKState& state)
 {
-    return m_kinDyn.getFrameFreeFloatingJacobian(m_frameRightIndex, jacobian);
+    KinematicsCache& cache = getCache(state);
+    if(!cache.isRightFootJacobianEvaluated)
+    {
+        if(!cache.kinDyn.getFrameFreeFloatingJacobian(m_frameRightIndex, cache.rightFootJacobian))
+            return false;
+        cache.isRightFootJacobianEvaluated = true;
+    }
+    jacobian = cache.rightFootJacobian;
+    return true;
 }
 
-bool WalkingFK::getNeckJacobian(iDynTree::MatrixDynSize &jacobian)
+bool WalkingFK::getNeckJacobian(iDynTree::MatrixDynSize &jacobian, const FKState& state)
 {
-    return m_kinDyn.getFrameFreeFloatingJacobian(m_frameNeckIndex, jacobian);
+    KinematicsCache& cache = getCache(state);
+    if(!cache.isNeckJacobianEvaluated)
+    {
+        if(!cache.kinDyn.getFrameFreeFloatingJacobian(m_frameNeckIndex, cache.neckJacobian))
+            return false;
+        cache.isNeckJacobianEvaluated = true;
+    }
+    jacobian = cache.neckJacobian;
+    return true;
 }
 
-bool WalkingFK::getCoMJacobian(iDynTree::MatrixDynSize &jacobian)
+bool WalkingFK::getCoMJacobian(iDynTree::MatrixDynSize &jacobian, const FKState& state)
 {
-    return m_kinDyn.getCenterOfMassJacobian(jacobian);
+    KinematicsCache& cache = getCache(state);
+    if(!cache.isCoMJacobianEvaluated)
+    {
+        if(!cache.kinDyn.getCenterOfMassJacobian(cache.comJacobian))
+            return false;
+        cache.isCoMJacobianEvaluated = true;
+    }
+    jacobian = cache.comJacobian;
+    return true;
 }
@@ -7,6 +7,9 @@
  * @date 2018
  */
 
+// std
+#include <chrono>
+
 // YARP
 #include <yarp/os/all.h>
 #include <yarp/dev/all.h>
@@ -33,6 +36,9 @@ WalkingIK::WalkingIK()
     , m_lFootFrame("l_sole")
     , m_rFootFrame("r_sole")
     , m_inertial_R_world(iDynTree::Rotation::Identity())
+    , m_useRealTimeMode(false)
+    , m_consecutiveFallbacks(0)
+    , m_isWarmStartAvailable(false)
     , m_prepared(false)
     , m_additionalRotationWeight(1.0)
     , m_jointRegularizationWeight(0.5)
@@ -48,6 +54,12 @@ bool WalkingIK::initialize(yarp::os::Searchable& ikOption, const iDynTree::Model
 {
     solverVerbosity = ikOption.check("solver-verbosity",yarp::os::Value(0)).asInt();
     maxCpuTime = ikOption.check("max-cpu-time",yarp::os::Value(0.2)).asDouble();
+    maxIterations = ikOption.check("max-iterations",yarp::os::Value(3000)).asInt();
+    m_useRealTimeMode = ikOption.check("use_real_time_mode", yarp::os::Value(false)).asBool();
+    m_realTimeMaxCpuTime = ikOption.check("real_time_max_cpu_time", yarp::os::Value(0.008)).asDouble();
+    m_realTimeMaxIterations = ikOption.check("real_time_max_iterations", yarp::os::Value(20)).asInt();
+    m_maxConsecutiveFallbacks = ikOption.check("max_consecutive_fallbacks", yarp::os::Value(5)).asInt();
+    m_maxFallbackError = ikOption.check("max_fallback_error", yarp::os::Value(0.01)).asDouble();
     m_jointRegularizationWeight = ikOption.check("joint_regularization_weight", yarp::os::Value(0.5)).asDouble();
     std::string lFootFrame = ikOption.check("left_foot_frame", yarp::os::Value("l_sole")).asString();
     std::string rFootFrame = ikOption.check("right_foot_frame", yarp::os::Value("r_sole")).asString();
@@ -162,6 +174,9 @@ bool WalkingIK::initialize(yarp::os::Searchable& ikOption, const iDynTree::Model
     {
         yInfo() << "Solver verbosity: " << solverVerbosity;
         yInfo() << "Max CPU time: " << maxCpuTime;
+        if(m_useRealTimeMode)
+            yInfo() << "Real-time mode. Max CPU time: " << m_realTimeMaxCpuTime
+                    << " Max iterations: " << m_realTimeMaxIterations;
         yInfo() << "Joint Regularization (RAD): " << m_jointRegularization.toString();
     }
 
@@ -249,6 +264,9 @@ bool WalkingIK::prepareIK()
     m_ik.setMaxCPUTime(maxCpuTime);
     m_ik.setVerbosity(solverVerbosity);
 
+    m_isWarmStartAvailable = false;
+    m_consecutiveFallbacks = 0;
+
     m_ik.setRotationParametrization(iDynTree::InverseKinematicsRotationParametrizationRollPitchYaw);
     m_ik.setDefaultTargetResolutionMode(iDynTree::InverseKinematicsTreatTargetAsConstraintFull);
 
@@ -398,31 +416,87 @@ bool WalkingIK::computeIK(const iDynTree::Transform& leftTransform, const iDynTr
         return false;
     }
 
-    ok = m_ik.solve();
-
-    if(!ok){
-        yError() << "WalkingIK: Failed in finding a solution.";
-        return false;
+    // in the real-time mode the budget is bounded only if the solver is warm started from the
+    // previous solution, otherwise (e.g. the first time) the problem is solved until convergence
+    bool useRealTimeBudget = m_useRealTimeMode && m_isWarmStartAvailable;
+    if(m_useRealTimeMode)
+    {
+        m_ik.setMaxCPUTime(useRealTimeBudget ? m_realTimeMaxCpuTime : maxCpuTime);
+        m_ik.setMaxIterations(useRealTimeBudget ? m_realTimeMaxIterations : maxIterations);
     }
 
+    auto solverInitTime = std::chrono::steady_clock::now();
+    ok = m_ik.solve();
+    m_solverTime = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                 - solverInitTime).count();
+
     m_ik.getReducedSolution(baseTransform, m_qResult);
 
-    lchecker.setRobotState(m_baseTransform, m_qResult, dummyBaseVel, dummyVel,dummygrav);
+    if(!ok){
+        // the solver does not report why it stopped. The failure is due to the budget only if
+        // the last iterate is close to the targets, otherwise the error is propagated
+        if(!useRealTimeBudget
+           || !isLastIterateValid(baseTransform, desiredRightTransform, desiredCoMPosition))
+        {
+            yError() << "WalkingIK: Failed in finding a solution.";
+            m_isWarmStartAvailable = false;
+            return false;
+        }
 
-    iDynTree::Position comError = desiredCoMPosition - lchecker.getCenterOfMassPosition();
-    iDynTree::Position footError = desiredRightTransform.getPosition() - lchecker.getRelativeTransform(m_lFootFrame, m_rFootFrame).getPosition();
+        if(m_consecutiveFallbacks >= m_maxConsecutiveFallbacks)
+        {
+            yError() << "WalkingIK: The budget is exhausted for" << m_consecutiveFallbacks + 1
+                     << "consecutive times.";
+            m_isWarmStartAvailable = false;
+            return false;
+        }
 
+        // the budget is exhausted. The last iterate is used as solution and as guess for the
+        // next problem
+        m_consecutiveFallbacks++;
+        if (m_verbose)
+            yWarning() << "WalkingIK: The budget is exhausted, the last iterate is used as solution.";
+    }
+    else
+        m_consecutiveFallbacks = 0;
+
+    // the errors are used only for debugging purposes
     if (m_verbose) {
+        lchecker.setRobotState(m_baseTransform, m_qResult, dummyBaseVel, dummyVel,dummygrav);
+
+        iDynTree::Position comError = desiredCoMPosition - lchecker.getCenterOfMassPosition();
+        iDynTree::Position footError = desiredRightTransform.getPosition() - lchecker.getRelativeTransform(m_lFootFrame, m_rFootFrame).getPosition();
+
         yInfo() << "CoM error position: "<< comError.toString();
         yInfo() << "Foot position error: "<<footError.toString();
     }
 
     result = m_qResult;
     m_guess = m_qResult;
+    m_isWarmStartAvailable = true;
 
     return true;
 }
 
+bool WalkingIK::isLastIterateValid(const iDynTree::Transform& baseTransform,
+                                   const iDynTree::Transform& desiredRightTransform,
+                                   const iDynTree::Position& desiredCoMPosition)
+{
+    if(!iDynTree::toEigen(m_qResult).allFinite()
+       || !iDynTree::toEigen(baseTransform.getPosition()).allFinite())
+        return false;
+
+    if(!lchecker.setRobotState(baseTransform, m_qResult, dummyBaseVel, dummyVel, dummygrav))
+        return false;
+
+    iDynTree::Position comError = desiredCoMPosition - lchecker.getCenterOfMassPosition();
+    iDynTree::Position footError = desiredRightTransform.getPosition()
+        - lchecker.getRelativeTransform(m_lFootFrame, m_rFootFrame).getPosition();
+
+    return iDynTree::toEigen(comError).norm() <= m_maxFallbackError
+        && iDynTree::toEigen(footError).norm() <= m_maxFallbackError;
+}
+
 const std::string WalkingIK::getLeftFootFrame() const
 {
     return m_lFootFrame;
@@ -472,3 +546,13 @@ double WalkingIK::desiredJointWeight()
 {
     return m_jointRegularizationWeight;
 }
+
+double WalkingIK::getSolverTime() const
+{
+    return m_solverTime;
+}
+
+int WalkingIK::getNumberOfConsecutiveFallbacks() const
+{
+    return m_consecutiveFallbacks;
+}
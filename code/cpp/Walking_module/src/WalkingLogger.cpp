@@ -6,6 +6,10 @@
  * @date 2018
  */
 
+// std
+#include <algorithm>
+#include <chrono>
+
 // YARP
 #include <yarp/os/LogStream.h>
 
@@ -58,9 +62,75 @@ bool WalkingLogger::configure(const yarp::os::Searchable& config, const std::str
         yError() << "Unable to connect to port " << "/" + name + portOutput;
         return false;
     }
+
+    m_useSequenceNumbers = config.check("use_sequence_numbers", yarp::os::Value(true)).asBool();
+    m_useRingBuffer = config.check("use_ring_buffer", yarp::os::Value(false)).asBool();
+    m_ringBufferSize = config.check("ring_buffer_size", yarp::os::Value(1000)).asInt();
+    m_drainPeriod = config.check("ring_buffer_drain_period", yarp::os::Value(0.05)).asDouble();
+    if(m_useRingBuffer && (m_ringBufferSize <= 0 || m_drainPeriod <= 0))
+    {
+        yError() << "[configureLogger] The size of the ring buffer and the drain period have to be "
+                 << "positive numbers.";
+        return false;
+    }
     return true;
 }
 
+WalkingLogger::~WalkingLogger()
+{
+    stopDrainThread();
+}
+
+void WalkingLogger::drainThread()
+{
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_conditionVariable.wait_for(lock, std::chrono::duration<double>(m_drainPeriod),
+                                         [&]{return m_closing;});
+            if(m_closing)
+                break;
+        }
+        drain();
+    }
+
+    // send the remaining frames
+    drain();
+}
+
+void WalkingLogger::drain()
+{
+    std::size_t numberOfFrames = m_ringBuffer.read(m_batch.data(), m_ringBuffer.getNumberOfFrames());
+    if(numberOfFrames == 0)
+        return;
+
+    // each frame contains the sequence number and the time stamp followed by the channels
+    yarp::sig::Vector& batch = m_dataPort.prepare();
+    batch.resize(numberOfFrames * m_ringBuffer.getFrameSize());
+    std::copy(m_batch.begin(), m_batch.begin() + batch.size(), batch.data());
+    m_dataPort.writeStrict();
+}
+
+void WalkingLogger::stopDrainThread()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_closing = true;
+        m_conditionVariable.notify_one();
+    }
+
+    if(m_drainThread.joinable())
+    {
+        m_drainThread.join();
+        m_drainThread = std::thread();
+
+        if(m_ringBuffer.getDroppedFrames() != 0)
+            yWarning() << "[stopDrainThread]" << m_ringBuffer.getDroppedFrames()
+                       << "frames were dropped because the ring buffer was full.";
+    }
+}
+
 bool WalkingLogger::startRecord(const std::initializer_list<std::string>& strings)
 {
     yarp::os::Bottle cmd, outcome;
@@ -73,17 +143,37 @@ bool WalkingLogger::startRecord(const std::initializer_list<std::string>& string
         yError() << "[startWalking] Unable to store data";
         return false;
     }
+
+    // the first string is the command
+    m_numberOfChannels = strings.size() - 1;
+    m_sequenceNumber = 0;
+
+    if(m_useRingBuffer)
+    {
+        stopDrainThread();
+        m_ringBuffer.resize(m_numberOfChannels + 2, m_ringBufferSize);
+        m_batch.resize(m_ringBuffer.getFrameSize() * m_ringBuffer.getNumberOfFrames());
+
+        m_closing = false;
+        m_drainThread = std::thread(&WalkingLogger::drainThread, this);
+    }
     return true;
 }
 
 void WalkingLogger::quit()
 {
+    // send the data stored in the ring buffer
+    stopDrainThread();
+
     // stop recording
     yarp::os::Bottle cmd, outcome;
     cmd.addString("quit");
     m_rpcPort.write(cmd, outcome);
     if(outcome.get(0).asInt() != 1)
         yInfo() << "[close] Unable to close the stream.";
+    else if(outcome.size() > 1 && outcome.get(1).asInt() != 0)
+        yWarning() << "[close] The logger did not receive" << outcome.get(1).asInt()
+                   << "of the" << static_cast<int>(m_sequenceNumber) << "frames sent.";
 
     // close ports
     m_dataPort.close();
@@ -0,0 +1,539 @@
+/**
+ * @file WalkingMicroBenchmark.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+// YARP
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Value.h>
+
+// iDynTree
+#include <iDynTree/Core/Utils.h>
+#include <iDynTree/Core/Twist.h>
+
+#include "WalkingMicroBenchmark.hpp"
+#include "WalkingController.hpp"
+#include "WalkingInverseKinematics.hpp"
+#include "WalkingQPInverseKinematics_osqp.hpp"
+#include "WalkingQPInverseKinematics_qpOASES.hpp"
+#include "TrajectoryView.hpp"
+#include "Utils.hpp"
+
+bool WalkingMicroBenchmark::setRobotModel(const yarp::os::Searchable& rf)
+{
+    // get joints list from resource finder
+    yarp::os::Value *axesListYarp;
+    if(!rf.check("joints_list", axesListYarp))
+    {
+        yError() << "[setRobotModel] Unable to find joints_list into config file.";
+        return false;
+    }
+    if(!YarpHelper::yarpListToStringVector(axesListYarp, m_axesList))
+    {
+        yError() << "[setRobotModel] Unable to convert yarp list into a vector of strings.";
+        return false;
+    }
+    m_actuatedDOFs = m_axesList.size();
+
+    // load the model in iDynTree::KinDynComputations
+    std::string model = rf.check("model",yarp::os::Value("model.urdf")).asString();
+    std::string pathToModel = yarp::os::ResourceFinder::getResourceFinderSingleton().findFileByName(model);
+
+    yInfo() << "The model is found in: " << pathToModel;
+
+    // only the controlled joints are extracted from the URDF file
+    if(!m_loader.loadReducedModelFromFile(pathToModel, m_axesList))
+    {
+        yError() << "[setRobotModel] Error while loading the model from " << pathToModel;
+        return false;
+    }
+    return true;
+}
+
+bool WalkingMicroBenchmark::evaluateInputs(yarp::os::ResourceFinder& rf)
+{
+    // the regularization configuration of the IK is used as joint position
+    WalkingIK IKSolver;
+    yarp::os::Bottle inverseKinematicsSolverOptions = rf.findGroup("INVERSE_KINEMATICS_SOLVER");
+    if(!IKSolver.initialize(inverseKinematicsSolverOptions, m_loader.model(), m_axesList))
+    {
+        yError() << "[evaluateInputs] Failed to configure the ik solver";
+        return false;
+    }
+    m_jointPosition = IKSolver.desiredJointConfiguration();
+    m_jointVelocity.resize(m_actuatedDOFs);
+    m_jointVelocity.zero();
+
+    yarp::os::Bottle forwardKinematicsSolverOptions = rf.findGroup("FORWARD_KINEMATICS_SOLVER");
+    forwardKinematicsSolverOptions.append(rf.findGroup("GENERAL"));
+    if(!m_FKSolver.initialize(forwardKinematicsSolverOptions, m_loader.model()))
+    {
+        yError() << "[evaluateInputs] Failed to configure the fk solver";
+        return false;
+    }
+
+    // the left foot is placed in the origin of the world frame
+    if(!m_FKSolver.evaluateFirstWorldToBaseTransformation(iDynTree::Transform::Identity())
+       || !m_FKSolver.setInternalRobotState(m_jointPosition, m_jointVelocity))
+    {
+        yError() << "[evaluateInputs] Unable to set the state of the fk solver.";
+        return false;
+    }
+
+    if(!m_FKSolver.evaluateCoM() || !m_FKSolver.getCoMPosition(m_com))
+    {
+        yError() << "[evaluateInputs] Unable to evaluate the CoM.";
+        return false;
+    }
+
+    m_leftFoot = m_FKSolver.getLeftFootToWorldTransform();
+    m_rightFoot = m_FKSolver.getRightFootToWorldTransform();
+    m_neckOrientation = m_FKSolver.getNeckOrientation();
+
+    m_leftFootJacobian.resize(6, m_actuatedDOFs + 6);
+    m_rightFootJacobian.resize(6, m_actuatedDOFs + 6);
+    m_neckJacobian.resize(6, m_actuatedDOFs + 6);
+    m_comJacobian.resize(3, m_actuatedDOFs + 6);
+    if(!m_FKSolver.getLeftFootJacobian(m_leftFootJacobian)
+       || !m_FKSolver.getRightFootJacobian(m_rightFootJacobian)
+       || !m_FKSolver.getNeckJacobian(m_neckJacobian)
+       || !m_FKSolver.getCoMJacobian(m_comJacobian))
+    {
+        yError() << "[evaluateInputs] Unable to evaluate the jacobians.";
+        return false;
+    }
+
+    return true;
+}
+
+iDynTree::Vector2 WalkingMicroBenchmark::perturbation(unsigned int iteration) const
+{
+    // circle of 5mm of radius covered in 100 iterations
+    double angle = 2 * M_PI * (iteration % 100) / 100.0;
+    iDynTree::Vector2 perturbation;
+    perturbation(0) = 0.005 * std::cos(angle);
+    perturbation(1) = 0.005 * std::sin(angle);
+    return perturbation;
+}
+
+template <typename Setup, typename Function>
+bool WalkingMicroBenchmark::measure(const std::string& name, const std::string& parameter,
+                                    Setup setup, Function function)
+{
+    Timer timer;
+    timer.setWindowSize(m_iterations);
+
+    for(unsigned int i = 0; i < m_warmUpIterations + m_iterations; i++)
+    {
+        if(!setup(i))
+        {
+            yError() << "[measure] Unable to prepare the inputs of" << name << parameter;
+            return false;
+        }
+
+        timer.setInitTime();
+        bool ok = function();
+        timer.setEndTime();
+
+        if(!ok)
+        {
+            yError() << "[measure] The benchmark" << name << parameter << "failed at iteration" << i;
+            return false;
+        }
+
+        if(i >= m_warmUpIterations)
+            timer.evaluateDuration();
+    }
+    timer.evaluateStatistics();
+
+    MicroBenchmarkResult result;
+    result.name = name;
+    result.parameter = parameter;
+    result.iterations = m_iterations;
+    result.statistics = timer.getStatistics();
+    m_results.push_back(result);
+
+    yInfo() << "[measure]" << name << parameter << "average" << result.statistics.average << "ms";
+    return true;
+}
+
+bool WalkingMicroBenchmark::benchmarkMPC(yarp::os::ResourceFinder& rf)
+{
+    iDynTree::VectorDynSize horizons(4);
+    horizons(0) = 0.5;
+    horizons(1) = 1.0;
+    horizons(2) = 2.0;
+    horizons(3) = 3.0;
+    yarp::os::Value* horizonsYarp;
+    if(rf.check("microbench_horizons", horizonsYarp)
+       && !YarpHelper::yarpListToiDynTreeVectorDynSize(*horizonsYarp, horizons))
+    {
+        yError() << "[benchmarkMPC] Unable to read the horizons.";
+        return false;
+    }
+
+    std::vector<std::string> formulations{"sparse", "condensed"};
+    yarp::os::Value* formulationsYarp;
+    if(rf.check("microbench_mpc_formulations", formulationsYarp)
+       && !YarpHelper::yarpListToStringVector(formulationsYarp, formulations))
+    {
+        yError() << "[benchmarkMPC] Unable to read the MPC formulations.";
+        return false;
+    }
+
+    yarp::os::Bottle& generalOptions = rf.findGroup("GENERAL");
+    double dT = generalOptions.check("sampling_time", yarp::os::Value(0.016)).asDouble();
+
+    // the feet are in double support and the DCM reference is constant
+    bool inContact = true;
+    TrajectoryView<iDynTree::Transform> leftFoot(&m_leftFoot, 1, 1);
+    TrajectoryView<iDynTree::Transform> rightFoot(&m_rightFoot, 1, 1);
+    TrajectoryView<bool> contact(&inContact, 1, 1);
+
+    iDynTree::Vector2 nominalDCM;
+    nominalDCM(0) = m_com(0);
+    nominalDCM(1) = m_com(1);
+
+    for(const auto& formulation : formulations)
+    {
+        for(unsigned int i = 0; i < horizons.size(); i++)
+        {
+            // the first element found is used by the controller
+            yarp::os::Bottle dcmControllerOptions;
+            yarp::os::Bottle& formulationOption = dcmControllerOptions.addList();
+            formulationOption.addString("mpc_formulation");
+            formulationOption.addString(formulation);
+            yarp::os::Bottle& horizonOption = dcmControllerOptions.addList();
+            horizonOption.addString("controllerHorizon");
+            horizonOption.addDouble(horizons(i));
+            dcmControllerOptions.append(rf.findGroup("DCM_MPC_CONTROLLER"));
+            dcmControllerOptions.append(generalOptions);
+
+            WalkingController controller;
+            if(!controller.initialize(dcmControllerOptions)
+               || !controller.setConvexHullConstraint(leftFoot, rightFoot, contact, contact))
+            {
+                yError() << "[benchmarkMPC] Unable to initialize the controller.";
+                return false;
+            }
+
+            std::vector<iDynTree::Vector2> reference(static_cast<std::size_t>(std::round(horizons(i) / dT)) + 1,
+                                                     nominalDCM);
+
+            std::ostringstream parameter;
+            parameter << formulation << " horizon " << horizons(i);
+            auto setup = [&](unsigned int iteration)
+                {
+                    iDynTree::Vector2 delta = perturbation(iteration);
+                    iDynTree::Vector2 dcm;
+                    dcm(0) = nominalDCM(0) + delta(0);
+                    dcm(1) = nominalDCM(1) + delta(1);
+                    TrajectoryView<iDynTree::Vector2> referenceView(reference.data(),
+                                                                    reference.size(),
+                                                                    reference.size());
+                    return controller.setFeedback(dcm)
+                    && controller.setReferenceSignal(referenceView, iteration == 0);
+                };
+            auto solve = [&controller]()
+                {
+                    return controller.solve();
+                };
+
+            if(!measure("mpc", parameter.str(), setup, solve))
+            {
+                yError() << "[benchmarkMPC] Unable to benchmark the MPC.";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool WalkingMicroBenchmark::benchmarkQPIK(yarp::os::ResourceFinder& rf)
+{
+    // the limits are not exposed by a device. The same limit is used for all the joints
+    double maxJointVelocity = rf.check("microbench_max_joint_velocity", yarp::os::Value(100.0)).asDouble();
+    iDynTree::VectorDynSize minJointsLimit(m_actuatedDOFs), maxJointsLimit(m_actuatedDOFs);
+    for(int i = 0; i < m_actuatedDOFs; i++)
+    {
+        minJointsLimit(i) = -iDynTree::deg2rad(maxJointVelocity);
+        maxJointsLimit(i) = iDynTree::deg2rad(maxJointVelocity);
+    }
+
+    yarp::os::Bottle inverseKinematicsQPSolverOptions = rf.findGroup("INVERSE_KINEMATICS_QP_SOLVER");
+
+    auto osqp = std::make_unique<WalkingQPIK_osqp>();
+    if(!osqp->initialize(inverseKinematicsQPSolverOptions, m_actuatedDOFs,
+                         minJointsLimit, maxJointsLimit))
+    {
+        yError() << "[benchmarkQPIK] Failed to configure the QP-IK solver (osqp)";
+        return false;
+    }
+
+    auto qpOASES = std::make_unique<WalkingQPIK_qpOASES>();
+    if(!qpOASES->initialize(inverseKinematicsQPSolverOptions, m_actuatedDOFs,
+                            minJointsLimit, maxJointsLimit))
+    {
+        yError() << "[benchmarkQPIK] Failed to configure the QP-IK solver (qpOASES)";
+        return false;
+    }
+
+    // both the solvers are fed with the same inputs
+    auto setInputs = [this](auto& solver, unsigned int iteration)
+        {
+            iDynTree::Vector2 delta = perturbation(iteration);
+            iDynTree::Position desiredCoMPosition = m_com;
+            desiredCoMPosition(0) += delta(0);
+            desiredCoMPosition(1) += delta(1);
+
+            iDynTree::Vector3 desiredCoMVelocity;
+            desiredCoMVelocity.zero();
+
+            if(!solver->setRobotState(m_jointPosition, m_leftFoot, m_rightFoot,
+                                      m_neckOrientation, m_com))
+                return false;
+
+            solver->setDesiredNeckOrientation(m_neckOrientation);
+            solver->setDesiredFeetTransformation(m_leftFoot, m_rightFoot);
+            solver->setDesiredFeetTwist(iDynTree::Twist::Zero(), iDynTree::Twist::Zero());
+            solver->setDesiredCoMVelocity(desiredCoMVelocity);
+            solver->setDesiredCoMPosition(desiredCoMPosition);
+
+            return solver->setLeftFootJacobian(m_leftFootJacobian)
+            && solver->setRightFootJacobian(m_rightFootJacobian)
+            && solver->setNeckJacobian(m_neckJacobian)
+            && solver->setCoMJacobian(m_comJacobian);
+        };
+
+    if(!measure("qpik", "osqp",
+                [&](unsigned int iteration){return setInputs(osqp, iteration);},
+                [&osqp](){return osqp->solve();}))
+    {
+        yError() << "[benchmarkQPIK] Unable to benchmark the QP-IK (osqp).";
+        return false;
+    }
+
+    if(!measure("qpik", "qpOASES",
+                [&](unsigned int iteration){return setInputs(qpOASES, iteration);},
+                [&qpOASES](){return qpOASES->solve();}))
+    {
+        yError() << "[benchmarkQPIK] Unable to benchmark the QP-IK (qpOASES).";
+        return false;
+    }
+
+    return true;
+}
+
+bool WalkingMicroBenchmark::benchmarkIK(yarp::os::ResourceFinder& rf)
+{
+    WalkingIK IKSolver;
+    yarp::os::Bottle inverseKinematicsSolverOptions = rf.findGroup("INVERSE_KINEMATICS_SOLVER");
+    if(!IKSolver.initialize(inverseKinematicsSolverOptions, m_loader.model(), m_axesList))
+    {
+        yError() << "[benchmarkIK] Failed to configure the ik solver";
+        return false;
+    }
+
+    if(IKSolver.usingAdditionalRotationTarget()
+       && !IKSolver.updateIntertiaToWorldFrameRotation(iDynTree::Rotation::Identity()))
+    {
+        yError() << "[benchmarkIK] Error updating the inertia to world frame rotation.";
+        return false;
+    }
+
+    iDynTree::Position desiredCoMPosition;
+    iDynTree::VectorDynSize result(m_actuatedDOFs);
+    auto setup = [&](unsigned int iteration)
+        {
+            iDynTree::Vector2 delta = perturbation(iteration);
+            desiredCoMPosition = m_com;
+            desiredCoMPosition(0) += delta(0);
+            desiredCoMPosition(1) += delta(1);
+            return IKSolver.setFullModelFeedBack(m_jointPosition);
+        };
+    auto computeIK = [&]()
+        {
+            return IKSolver.computeIK(m_leftFoot, m_rightFoot, desiredCoMPosition, result);
+        };
+
+    if(!measure("ik", "computeIK", setup, computeIK))
+    {
+        yError() << "[benchmarkIK] Unable to benchmark the IK.";
+        return false;
+    }
+    return true;
+}
+
+bool WalkingMicroBenchmark::benchmarkFK()
+{
+    auto noSetup = [](unsigned int){return true;};
+    auto setState = [this]()
+        {
+            return m_FKSolver.setInternalRobotState(m_jointPosition, m_jointVelocity);
+        };
+    auto getJacobians = [this]()
+        {
+            return m_FKSolver.getLeftFootJacobian(m_leftFootJacobian)
+            && m_FKSolver.getRightFootJacobian(m_rightFootJacobian)
+            && m_FKSolver.getNeckJacobian(m_neckJacobian)
+            && m_FKSolver.getCoMJacobian(m_comJacobian);
+        };
+
+    if(!measure("fk", "setInternalRobotState", noSetup, setState))
+    {
+        yError() << "[benchmarkFK] Unable to benchmark the FK (state).";
+        return false;
+    }
+
+    // the state is updated at every iteration so the kinematics is not cached
+    if(!measure("fk", "jacobians", [&](unsigned int){return setState();}, getJacobians))
+    {
+        yError() << "[benchmarkFK] Unable to benchmark the FK (jacobians).";
+        return false;
+    }
+
+    if(!measure("fk", "setInternalRobotState+jacobians", noSetup,
+                [&](){return setState() && getJacobians();}))
+    {
+        yError() << "[benchmarkFK] Unable to benchmark the FK.";
+        return false;
+    }
+    return true;
+}
+
+bool WalkingMicroBenchmark::benchmarkConvexHull(yarp::os::ResourceFinder& rf)
+{
+    WalkingController controller;
+    yarp::os::Bottle dcmControllerOptions = rf.findGroup("DCM_MPC_CONTROLLER");
+    dcmControllerOptions.append(rf.findGroup("GENERAL"));
+    if(!controller.initialize(dcmControllerOptions))
+    {
+        yError() << "[benchmarkConvexHull] Unable to initialize the controller.";
+        return false;
+    }
+
+    // double support, left support, double support, right support...
+    bool leftInContact, rightInContact;
+    TrajectoryView<iDynTree::Transform> leftFoot(&m_leftFoot, 1, 1);
+    TrajectoryView<iDynTree::Transform> rightFoot(&m_rightFoot, 1, 1);
+    TrajectoryView<bool> leftContact(&leftInContact, 1, 1);
+    TrajectoryView<bool> rightContact(&rightInContact, 1, 1);
+
+    auto setup = [&](unsigned int iteration)
+        {
+            leftInContact = iteration % 4 != 3;
+            rightInContact = iteration % 4 != 1;
+            return true;
+        };
+    auto buildConvexHull = [&]()
+        {
+            return controller.setConvexHullConstraint(leftFoot, rightFoot, leftContact, rightContact);
+        };
+
+    if(!measure("convex_hull", "setConvexHullConstraint", setup, buildConvexHull))
+    {
+        yError() << "[benchmarkConvexHull] Unable to benchmark the convex hull.";
+        return false;
+    }
+    return true;
+}
+
+bool WalkingMicroBenchmark::configure(yarp::os::ResourceFinder& rf)
+{
+    int iterations = rf.check("microbench_iterations", yarp::os::Value(500)).asInt();
+    int warmUpIterations = rf.check("microbench_warm_up_iterations", yarp::os::Value(20)).asInt();
+    m_tag = rf.check("microbench_tag", yarp::os::Value("")).asString();
+
+    if(iterations <= 0 || warmUpIterations < 0)
+    {
+        yError() << "[configure] The number of iterations has to be positive.";
+        return false;
+    }
+    m_iterations = iterations;
+    m_warmUpIterations = warmUpIterations;
+
+    const char* robot = std::getenv("YARP_ROBOT_NAME");
+    m_robot = robot != nullptr ? robot : "";
+
+    m_suite = {"mpc", "qpik", "ik", "fk", "convex_hull"};
+    yarp::os::Value* suiteYarp;
+    if(rf.check("microbench_suite", suiteYarp)
+       && !YarpHelper::yarpListToStringVector(suiteYarp, m_suite))
+    {
+        yError() << "[configure] Unable to read the list of the benchmarks.";
+        return false;
+    }
+
+    if(!setRobotModel(rf))
+    {
+        yError() << "[configure] Unable to set the robot model.";
+        return false;
+    }
+
+    if(!evaluateInputs(rf))
+    {
+        yError() << "[configure] Unable to evaluate the inputs of the benchmarks.";
+        return false;
+    }
+
+    return true;
+}
+
+bool WalkingMicroBenchmark::run(yarp::os::ResourceFinder& rf)
+{
+    m_results.clear();
+    for(const auto& component : m_suite)
+    {
+        bool ok;
+        if(component == "mpc")
+            ok = benchmarkMPC(rf);
+        else if(component == "qpik")
+            ok = benchmarkQPIK(rf);
+        else if(component == "ik")
+            ok = benchmarkIK(rf);
+        else if(component == "fk")
+            ok = benchmarkFK();
+        else if(component == "convex_hull")
+            ok = benchmarkConvexHull(rf);
+        else
+        {
+            yError() << "[run] Unknown benchmark" << component
+                     << "(available: mpc, qpik, ik, fk, convex_hull).";
+            return false;
+        }
+
+        if(!ok)
+        {
+            yError() << "[run] The benchmark" << component << "failed.";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string WalkingMicroBenchmark::getReport() const
+{
+    std::ostringstream report;
+    report << std::setprecision(6);
+
+    report << "tag,robot,benchmark,parameter,iterations,average_ms,p50_ms,p99_ms,min_ms,max_ms\n";
+    for(const auto& result : m_results)
+        report << m_tag << "," << m_robot << "," << result.name << "," << result.parameter << ","
+               << result.iterations << "," << result.statistics.average << ","
+               << result.statistics.p50 << "," << result.statistics.p99 << ","
+               << result.statistics.min << "," << result.statistics.max << "\n";
+
+    return report.str();
+}
@@ -0,0 +1,65 @@
+/**
+ * @file WalkingMicroBenchmarkMain.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// YARP
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/Value.h>
+
+#include "WalkingMicroBenchmark.hpp"
+
+int main(int argc, char * argv[])
+{
+    // initialise yarp. The benchmark does not open any port so the yarp server is not required
+    yarp::os::Network yarp;
+
+    // prepare and configure the resource finder (the configuration of the WalkingModule is used)
+    yarp::os::ResourceFinder& rf = yarp::os::ResourceFinder::getResourceFinderSingleton();
+
+    rf.setDefaultConfigFile("dcmWalkingCoordinator.ini");
+
+    rf.configure(argc, argv);
+
+    WalkingMicroBenchmark benchmark;
+    if(!benchmark.configure(rf))
+    {
+        yError() << "[main] Unable to configure the micro-benchmark.";
+        return EXIT_FAILURE;
+    }
+
+    if(!benchmark.run(rf))
+    {
+        yError() << "[main] The micro-benchmark failed.";
+        return EXIT_FAILURE;
+    }
+
+    // the results are printed on the standard output if the file is not specified
+    std::string fileName = rf.check("microbench_output", yarp::os::Value("")).asString();
+    if(fileName.empty())
+    {
+        std::cout << benchmark.getReport();
+        return EXIT_SUCCESS;
+    }
+
+    std::ofstream stream(fileName.c_str());
+    if(!stream.is_open())
+    {
+        yError() << "[main] Unable to open the file" << fileName;
+        return EXIT_FAILURE;
+    }
+    stream << benchmark.getReport();
+
+    return EXIT_SUCCESS;
+}
@@ -7,8 +7,12 @@
  */
 
 // std
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <memory>
+#include <cmath>
+#include <thread>
 
 // YARP
 #include <yarp/os/RFModule.h>
@@ -25,6 +29,14 @@
 
 #include "WalkingModule.hpp"
 #include "Utils.hpp"
+#include "AllocationCounter.hpp"
+
+namespace
+{
+    // indices of the solvers in the QP-IK race
+    constexpr int OSQPRaceIndex = 0;
+    constexpr int qpOASESRaceIndex = 1;
+}
 
 void WalkingModule::propagateTime()
 {
@@ -34,69 +46,28 @@ void WalkingModule::propagateTime()
 
 bool WalkingModule::propagateReferenceSignals()
 {
-    // check if vector is not initialized
-    if(m_leftTrajectory.empty()
-       || m_rightTrajectory.empty()
-       || m_leftInContact.empty()
-       || m_rightInContact.empty()
-       || m_DCMPositionDesired.empty()
-       || m_DCMVelocityDesired.empty()
-       || m_comHeightTrajectory.empty())
+    // check if the trajectories are not initialized
+    if(m_trajectory.empty())
     {
         yError() << "[propagateReferenceSignals] Cannot propagate empty reference signals.";
         return false;
     }
 
-    m_rightTrajectory.pop_front();
-    m_rightTrajectory.push_back(m_rightTrajectory.back());
-
-    m_leftTrajectory.pop_front();
-    m_leftTrajectory.push_back(m_leftTrajectory.back());
-
-    m_rightTwistTrajectory.pop_front();
-    m_rightTwistTrajectory.push_back(m_rightTwistTrajectory.back());
-
-    m_leftTwistTrajectory.pop_front();
-    m_leftTwistTrajectory.push_back(m_leftTwistTrajectory.back());
-
-    m_rightInContact.pop_front();
-    m_rightInContact.push_back(m_rightInContact.back());
-
-    m_leftInContact.pop_front();
-    m_leftInContact.push_back(m_leftInContact.back());
-
-    m_isLeftFixedFrame.pop_front();
-    m_isLeftFixedFrame.push_back(m_isLeftFixedFrame.back());
-
-    m_DCMPositionDesired.pop_front();
-    m_DCMPositionDesired.push_back(m_DCMPositionDesired.back());
-
-    m_DCMVelocityDesired.pop_front();
-    m_DCMVelocityDesired.push_back(m_DCMVelocityDesired.back());
-
-    m_comHeightTrajectory.pop_front();
-    m_comHeightTrajectory.push_back(m_comHeightTrajectory.back());
-
-    m_comHeightVelocity.pop_front();
-    m_comHeightVelocity.push_back(m_comHeightVelocity.back());
-
-    // at each sampling time the merge points are decreased by one.
-    // If the first merge point is equal to 0 it will be dropped.
-    // A new trajectory will be merged at the first merge point or if the deque is empty
+    // at each sampling time the trajectories are shifted by one sample (the last one is repeated)
+    // and the merge points that are reached are dropped.
+    // A new trajectory will be merged at the first merge point or if there are no merge points
     // as soon as possible.
-    if(!m_mergePoints.empty())
-    {
-        for(auto& mergePoint : m_mergePoints)
-            mergePoint--;
+    m_trajectory.advance();
 
-        if(m_mergePoints[0] == 0)
-            m_mergePoints.pop_front();
-    }
     return true;
 }
 
 double WalkingModule::getPeriod()
 {
+    // in the real-time mode the control loop does not depend on the period of the RFModule
+    if(m_realTimeThread != nullptr)
+        return 0.1;
+
     //  period of the module (seconds)
     return m_dT;
 }
@@ -115,6 +86,7 @@ bool WalkingModule::setControlledJoints(const yarp::os::Searchable& rf)
         yError() << "[setControlledJoints] Unable to convert yarp list into a vector of strings.";
         return false;
     }
+    m_actuatedDOFs = m_axesList.size();
     return true;
 }
 
@@ -178,8 +150,6 @@ bool WalkingModule::configureRobot(const yarp::os::Searchable& rf)
     yarp::os::Property& remoteControlBoardsOpts = options.addGroup("REMOTE_CONTROLBOARD_OPTIONS");
     remoteControlBoardsOpts.put("writeStrict", "on");
 
-    m_actuatedDOFs = m_axesList.size();
-
     // open the device
     if(!m_robotDevice.open(options))
     {
@@ -231,25 +201,12 @@ bool WalkingModule::configureRobot(const yarp::os::Searchable& rf)
         return false;
     }
 
-    // resize the buffers
+    // resize the buffers of the measurements (the other ones are resized by configureController())
     m_positionFeedbackInDegrees.resize(m_actuatedDOFs, 0.0);
     m_velocityFeedbackInDegrees.resize(m_actuatedDOFs, 0.0);
-
-    m_positionFeedbackInRadians.resize(m_actuatedDOFs);
-    m_velocityFeedbackInRadians.resize(m_actuatedDOFs);
-    m_qDesired.resize(m_actuatedDOFs);
-    m_dqDesired_osqp.resize(m_actuatedDOFs);
-    m_dqDesired_qpOASES.resize(m_actuatedDOFs);
-    m_toDegBuffer.resize(m_actuatedDOFs);
     m_minJointsLimit.resize(m_actuatedDOFs);
     m_maxJointsLimit.resize(m_actuatedDOFs);
 
-    // m_positionFeedbackInDegreesFiltered.resize(m_actuatedDOFs);
-    // m_positionFeedbackInDegreesFiltered.zero();
-
-    m_velocityFeedbackInDegreesFiltered.resize(m_actuatedDOFs);
-    m_velocityFeedbackInDegreesFiltered.zero();
-
     // check if the robot is alive
     bool okPosition = false;
     bool okVelocity = false;
@@ -273,41 +230,6 @@ bool WalkingModule::configureRobot(const yarp::os::Searchable& rf)
         return false;
     }
 
-    // set the inertial to world rotation
-    m_inertial_R_worldFrame = iDynTree::Rotation::Identity();
-
-    m_useVelocityFilter = rf.check("use_joint_velocity_filter", yarp::os::Value("False")).asBool();
-    if(m_useVelocityFilter)
-    {
-        double cutFrequency;
-        if(!YarpHelper::getDoubleFromSearchable(rf, "joint_velocity_cut_frequency", cutFrequency))
-        {
-            yError() << "[configure] Unable get double from searchable.";
-            return false;
-        }
-
-        // set filters
-        // m_positionFilter = std::make_unique<iCub::ctrl::FirstOrderLowPassFilter>(10, m_dT);
-        m_velocityFilter = std::make_unique<iCub::ctrl::FirstOrderLowPassFilter>(cutFrequency, m_dT);
-
-        // m_positionFilter->init(m_positionFeedbackInDegrees);
-        m_velocityFilter->init(m_velocityFeedbackInDegrees);
-    }
-
-    m_useWrenchFilter = rf.check("use_wrench_filter", yarp::os::Value("False")).asBool();
-    if(m_useWrenchFilter)
-    {
-        double cutFrequency;
-        if(!YarpHelper::getDoubleFromSearchable(rf, "wrench_cut_frequency", cutFrequency))
-        {
-            yError() << "[configure] Unable get double from searchable.";
-            return false;
-        }
-
-        m_leftWrenchFilter = std::make_unique<iCub::ctrl::FirstOrderLowPassFilter>(cutFrequency, m_dT);
-        m_rightWrenchFilter = std::make_unique<iCub::ctrl::FirstOrderLowPassFilter>(cutFrequency, m_dT);
-    }
-
     // get the limits
     double max, min;
     for(int i = 0; i < m_actuatedDOFs; i++)
@@ -389,9 +311,6 @@ bool WalkingModule::configure(yarp::os::ResourceFinder& rf)
     }
     setName(string.c_str());
 
-    m_useMPC = rf.check("use_mpc", yarp::os::Value(false)).asBool();
-    m_useQPIK = rf.check("use_QP-IK", yarp::os::Value(false)).asBool();
-    m_useOSQP = rf.check("use_osqp", yarp::os::Value(false)).asBool();
     m_dumpData = rf.check("dump_data", yarp::os::Value(false)).asBool();
 
     if(!setControlledJoints(rf))
@@ -406,15 +325,15 @@ bool WalkingModule::configure(yarp::os::ResourceFinder& rf)
         return false;
     }
 
+    yarp::os::Bottle& generalOptions = rf.findGroup("GENERAL");
+    m_dT = generalOptions.check("sampling_time", yarp::os::Value(0.016)).asDouble();
+
     if(!configureRobot(rf))
     {
         yError() << "[configure] Unable to configure the robot.";
         return false;
     }
 
-    yarp::os::Bottle& generalOptions = rf.findGroup("GENERAL");
-    m_dT = generalOptions.check("sampling_time", yarp::os::Value(0.016)).asDouble();
-
     yarp::os::Bottle& forceTorqueSensorsOptions = rf.findGroup("FT_SENSORS");
     if(!configureForceTorqueSensors(forceTorqueSensorsOptions))
     {
@@ -422,6 +341,22 @@ bool WalkingModule::configure(yarp::os::ResourceFinder& rf)
         return false;
     }
 
+    // the sensors can be read by a dedicated thread
+    if(rf.check("use_sensor_acquisition_thread", yarp::os::Value(false)).asBool())
+    {
+        m_maxFeedbackDelay = rf.check("max_feedback_delay", yarp::os::Value(0.05)).asDouble();
+        m_maxFeedbackMisalignment = rf.check("max_feedback_misalignment",
+                                             yarp::os::Value(0.02)).asDouble();
+
+        m_sensorAcquisition = std::make_unique<SensorAcquisition>();
+        if(!m_sensorAcquisition->initialize(rf, m_encodersInterface, m_actuatedDOFs,
+                                            &m_leftWrenchPort, &m_rightWrenchPort))
+        {
+            yError() << "[configure] Unable to start the sensor acquisition thread.";
+            return false;
+        }
+    }
+
     // open RPC port for external command
     std::string rpcPortName = "/" + getName() + "/rpc";
     this->yarp().attachAsServer(this->m_rpcPort);
@@ -431,16 +366,191 @@ bool WalkingModule::configure(yarp::os::ResourceFinder& rf)
         return false;
     }
 
+    // statistics of the solvers streamed on a port
+    if(rf.check("publish_solver_statistics", yarp::os::Value(false)).asBool())
+    {
+        m_solverStatisticsPublisher = std::make_unique<SolverStatisticsPublisher>();
+        if(!m_solverStatisticsPublisher->configure(rf, "/" + getName()))
+        {
+            yError() << "[configure] Unable to configure the solver statistics publisher.";
+            return false;
+        }
+    }
+
+    // the goal can be also streamed (only the last sample received is used)
+    m_useGoalPort = rf.check("use_goal_port", yarp::os::Value(false)).asBool();
+    if(m_useGoalPort)
+    {
+        std::string goalPortName = "/" + getName() + "/goal:i";
+        if(!m_goalPort.open(goalPortName))
+        {
+            yError() << "Could not open" << goalPortName.c_str() << "port.";
+            return false;
+        }
+    }
+
+    if(!configureController(rf))
+    {
+        yError() << "[configure] Unable to configure the controller.";
+        return false;
+    }
+
+    // set PIDs gains
+    m_PIDHandler = std::make_unique<WalkingPIDHandler>();
+    yarp::os::Bottle& pidOptions = rf.findGroup("PID");
+    if (!m_PIDHandler->initialize(pidOptions, m_robotDevice, m_remoteControlBoards))
+    {
+        yError() << "[configure] Failed to configure the PIDs.";
+        return false;
+    }
+
+    // initialize the logger
+    if(m_dumpData)
+    {
+        m_walkingLogger = std::make_unique<WalkingLogger>();
+        yarp::os::Bottle& loggerOptions = rf.findGroup("WALKING_LOGGER");
+        if(!m_walkingLogger->configure(loggerOptions, getName()))
+        {
+            yError() << "[configure] Unable to configure the logger.";
+            return false;
+        }
+    }
+
+    m_robotState = WalkingFSM::Configured;
+
+    // the control loop is started as last since it uses all the components
+    if(rf.check("use_real_time_thread", yarp::os::Value(false)).asBool())
+    {
+        if(!configureRealTimeThread(rf))
+        {
+            yError() << "[configure] Unable to configure the real-time thread.";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool WalkingModule::configureController(const yarp::os::Searchable& rf)
+{
+    m_useMPC = rf.check("use_mpc", yarp::os::Value(false)).asBool();
+    m_useQPIK = rf.check("use_QP-IK", yarp::os::Value(false)).asBool();
+    m_useOSQP = rf.check("use_osqp", yarp::os::Value(false)).asBool();
+    m_useSolversWarmUp = rf.check("use_solvers_warm_up", yarp::os::Value(true)).asBool();
+    m_compareMPCFormulations = false;
+
+    yarp::os::Bottle& generalOptions = rf.findGroup("GENERAL");
+
+    // resize the buffers of the control loop
+    m_positionFeedbackInRadians.resize(m_actuatedDOFs);
+    m_velocityFeedbackInRadians.resize(m_actuatedDOFs);
+    m_qDesired.resize(m_actuatedDOFs);
+    m_dqDesired_osqp.resize(m_actuatedDOFs);
+    m_dqDesired_qpOASES.resize(m_actuatedDOFs);
+    m_toDegBuffer.resize(m_actuatedDOFs);
+
+    m_bufferVelocity.resize(m_actuatedDOFs, 0.0);
+    m_previousBufferVelocity.resize(m_actuatedDOFs, 0.0);
+    m_scalarBuffer.resize(1, 0.0);
+    m_desiredJointInRad.resize(m_actuatedDOFs);
+    m_feetJacobianBuffer.resize(6, m_actuatedDOFs + 6);
+    m_comJacobianBuffer.resize(3, m_actuatedDOFs + 6);
+    m_leftFootError.resize(6);
+    m_rightFootError.resize(6);
+
+    // set the inertial to world rotation
+    m_inertial_R_worldFrame = iDynTree::Rotation::Identity();
+
+    double velocityCutFrequency = 0;
+    m_useVelocityFilter = rf.check("use_joint_velocity_filter", yarp::os::Value("False")).asBool();
+    if(m_useVelocityFilter)
+    {
+        if(!YarpHelper::getDoubleFromSearchable(rf, "joint_velocity_cut_frequency", velocityCutFrequency))
+        {
+            yError() << "[configureController] Unable get double from searchable.";
+            return false;
+        }
+    }
+
+    double wrenchCutFrequency = 0;
+    m_useWrenchFilter = rf.check("use_wrench_filter", yarp::os::Value("False")).asBool();
+    if(m_useWrenchFilter)
+    {
+        if(!YarpHelper::getDoubleFromSearchable(rf, "wrench_cut_frequency", wrenchCutFrequency))
+        {
+            yError() << "[configureController] Unable get double from searchable.";
+            return false;
+        }
+    }
+
+    // set the filters. The joint position is only converted in radians, the joint velocity and
+    // the wrenches are filtered only if required (a non positive cut frequency disables the filter)
+    double degToRad = iDynTree::deg2rad(1.0);
+    m_jointPositionGroup = m_feedbackFilters.addGroup(m_actuatedDOFs, 0, m_dT, degToRad);
+    m_jointVelocityGroup = m_feedbackFilters.addGroup(m_actuatedDOFs, velocityCutFrequency, m_dT, degToRad);
+    m_leftForceGroup = m_feedbackFilters.addGroup(3, wrenchCutFrequency, m_dT);
+    m_leftTorqueGroup = m_feedbackFilters.addGroup(3, wrenchCutFrequency, m_dT);
+    m_rightForceGroup = m_feedbackFilters.addGroup(3, wrenchCutFrequency, m_dT);
+    m_rightTorqueGroup = m_feedbackFilters.addGroup(3, wrenchCutFrequency, m_dT);
+    if(m_jointPositionGroup < 0 || m_jointVelocityGroup < 0 || m_leftForceGroup < 0
+       || m_leftTorqueGroup < 0 || m_rightForceGroup < 0 || m_rightTorqueGroup < 0)
+    {
+        yError() << "[configureController] Unable to set the feedback filters.";
+        return false;
+    }
+
+    // the outputs are written directly in the iDynTree feedbacks
+    m_feedbackFilters.setOutput(m_jointPositionGroup, m_positionFeedbackInRadians.data());
+    m_feedbackFilters.setOutput(m_jointVelocityGroup, m_velocityFeedbackInRadians.data());
+    m_feedbackFilters.setOutput(m_leftForceGroup, m_leftWrench.getLinearVec3().data());
+    m_feedbackFilters.setOutput(m_leftTorqueGroup, m_leftWrench.getAngularVec3().data());
+    m_feedbackFilters.setOutput(m_rightForceGroup, m_rightWrench.getLinearVec3().data());
+    m_feedbackFilters.setOutput(m_rightTorqueGroup, m_rightWrench.getAngularVec3().data());
+
+    m_feedbackFilters.init(m_jointPositionGroup, m_positionFeedbackInDegrees.data());
+    m_feedbackFilters.init(m_jointVelocityGroup, m_velocityFeedbackInDegrees.data());
+
+    // the new trajectory can be asked according to the measured latency of the planner
+    m_useAdaptiveMergeLead = rf.check("use_adaptive_merge_lead", yarp::os::Value(false)).asBool();
+    m_plannerLatencyPercentile = rf.check("planner_latency_percentile", yarp::os::Value(0.95)).asDouble();
+    m_mergeLeadMargin = rf.check("merge_lead_margin", yarp::os::Value(2)).asInt();
+    m_minMergeLead = rf.check("min_merge_lead", yarp::os::Value(5)).asInt();
+    m_maxMergeLead = rf.check("max_merge_lead", yarp::os::Value(40)).asInt();
+    if(m_useAdaptiveMergeLead && (m_minMergeLead <= 2 || m_maxMergeLead < m_minMergeLead))
+    {
+        yError() << "[configureController] The minimum merge lead has to be greater than 2 and "
+                 << "lower or equal than the maximum one.";
+        return false;
+    }
+
+    // the control loop waits for the sensor readings at most for max_feedback_wait_time seconds
+    // (measured from the beginning of the tick). Then the last valid feedback is used
+    m_maxFeedbackWaitTime = rf.check("max_feedback_wait_time", yarp::os::Value(0.5 * m_dT)).asDouble();
+    m_maxStaleFeedbacks = rf.check("max_stale_feedbacks", yarp::os::Value(5)).asInt();
+    if(m_maxFeedbackWaitTime < 0 || m_maxStaleFeedbacks < 0)
+    {
+        yError() << "[configureController] The maximum feedback wait time and the maximum number "
+                 << "of stale feedbacks have to be positive.";
+        return false;
+    }
+
     // initialize the trajectory planner
     m_trajectoryGenerator = std::make_unique<TrajectoryGenerator>();
     yarp::os::Bottle& trajectoryPlannerOptions = rf.findGroup("TRAJECTORY_PLANNER");
     trajectoryPlannerOptions.append(generalOptions);
     if(!m_trajectoryGenerator->initialize(trajectoryPlannerOptions))
     {
-        yError() << "[configure] Unable to initialize the planner.";
+        yError() << "[configureController] Unable to initialize the planner.";
         return false;
     }
 
+    // allocate the memory of the desired trajectories. The buffer contains at most two planned
+    // trajectories (the current one and the merged one). Since the memory is exchanged with the
+    // planner when a new trajectory is merged, it will be reused by the next planned trajectories
+    double plannerHorizon = trajectoryPlannerOptions.check("plannerHorizon", yarp::os::Value(20.0)).asDouble();
+    m_trajectory.reserve(2 * (static_cast<std::size_t>(plannerHorizon / m_dT) + 1));
+    m_plannedTrajectory = std::make_unique<PlannedTrajectory>();
+
     if(m_useMPC)
     {
         // initialize the MPC controller
@@ -449,19 +559,57 @@ bool WalkingModule::configure(yarp::os::ResourceFinder& rf)
         dcmControllerOptions.append(generalOptions);
         if(!m_walkingController->initialize(dcmControllerOptions))
         {
-            yError() << "[configure] Unable to initialize the controller.";
+            yError() << "[configureController] Unable to initialize the controller.";
             return false;
         }
+
+        // the other formulation of the MPC problem can be solved alongside the used one.
+        // Its output is never used, it is useful only to compare the computational time
+        m_compareMPCFormulations = dcmControllerOptions.check("compare_mpc_formulations",
+                                                              yarp::os::Value(false)).asBool();
+        if(m_compareMPCFormulations)
+        {
+            std::string formulation = dcmControllerOptions.check("mpc_formulation",
+                                                                 yarp::os::Value("sparse")).asString();
+            std::string comparisonFormulation = formulation == "sparse" ? "condensed" : "sparse";
+            m_comparisonTimerName = "MPC-" + comparisonFormulation;
+
+            // the first element found is used by the controller
+            yarp::os::Bottle comparisonControllerOptions;
+            yarp::os::Bottle& formulationOption = comparisonControllerOptions.addList();
+            formulationOption.addString("mpc_formulation");
+            formulationOption.addString(comparisonFormulation);
+            comparisonControllerOptions.append(dcmControllerOptions);
+
+            m_walkingControllerComparison = std::make_unique<WalkingController>();
+            if(!m_walkingControllerComparison->initialize(comparisonControllerOptions))
+            {
+                yError() << "[configureController] Unable to initialize the comparison controller.";
+                return false;
+            }
+        }
     }
-    else
+
+    // the reactive controller is used in the ticks in which the MPC is late or it fails
+    if(m_useMPC && rf.check("use_mpc_supervisor", yarp::os::Value(false)).asBool())
     {
-        // initialize the MPC controller
+        m_controllerSupervisor = std::make_unique<DCMControllerSupervisor>();
+        if(!m_controllerSupervisor->initialize(rf, m_dT))
+        {
+            yError() << "[configureController] Unable to initialize the MPC supervisor.";
+            return false;
+        }
+    }
+
+    if(!m_useMPC || m_controllerSupervisor != nullptr)
+    {
+        // initialize the reactive controller
         m_walkingDCMReactiveController = std::make_unique<WalkingDCMReactiveController>();
         yarp::os::Bottle& dcmControllerOptions = rf.findGroup("DCM_REACTIVE_CONTROLLER");
         dcmControllerOptions.append(generalOptions);
         if(!m_walkingDCMReactiveController->initialize(dcmControllerOptions))
         {
-            yError() << "[configure] Unable to initialize the controller.";
+            yError() << "[configureController] Unable to initialize the controller.";
             return false;
         }
     }
@@ -472,7 +620,7 @@ bool WalkingModule::configure(yarp::os::ResourceFinder& rf)
     zmpControllerOptions.append(generalOptions);
     if(!m_walkingZMPController->initialize(zmpControllerOptions))
     {
-        yError() << "[configure] Unable to initialize the ZMP controller.";
+        yError() << "[configureController] Unable to initialize the ZMP controller.";
         return false;
     }
 
@@ -481,7 +629,7 @@ bool WalkingModule::configure(yarp::os::ResourceFinder& rf)
     yarp::os::Bottle& inverseKinematicsSolverOptions = rf.findGroup("INVERSE_KINEMATICS_SOLVER");
     if(!m_IKSolver->initialize(inverseKinematicsSolverOptions, m_loader.model(), m_axesList))
     {
-        yError() << "[configure] Failed to configure the ik solver";
+        yError() << "[configureController] Failed to configure the ik solver";
         return false;
     }
 
@@ -489,12 +637,37 @@ bool WalkingModule::configure(yarp::os::ResourceFinder& rf)
     {
         yarp::os::Bottle& inverseKinematicsQPSolverOptions = rf.findGroup("INVERSE_KINEMATICS_QP_SOLVER");
 
+        // the QP-IK can be regularized with the postures evaluated by the nonlinear IK
+        // a few samples ahead
+        if(rf.check("use_look_ahead_ik", yarp::os::Value(false)).asBool())
+        {
+            m_lookAheadIK = std::make_unique<LookAheadIK>();
+            if(!m_lookAheadIK->initialize(rf, inverseKinematicsSolverOptions, generalOptions,
+                                          m_loader.model(), m_axesList))
+            {
+                yError() << "[configureController] Unable to start the look-ahead IK thread.";
+                return false;
+            }
+
+            m_lookAheadPosture.resize(m_actuatedDOFs);
+            m_QPIKRegularizationTerm.resize(m_actuatedDOFs);
+            yarp::os::Value jointRegularization = inverseKinematicsQPSolverOptions.find("jointRegularization");
+            if(!YarpHelper::yarpListToiDynTreeVectorDynSize(jointRegularization, m_QPIKRegularizationTerm))
+            {
+                yError() << "[configureController] Unable to convert a YARP list to an iDynTree::VectorDynSize, "
+                         << "joint regularization";
+                return false;
+            }
+            iDynTree::toEigen(m_QPIKRegularizationTerm) = iDynTree::toEigen(m_QPIKRegularizationTerm) *
+                iDynTree::deg2rad(1);
+        }
+
         m_QPIKSolver_osqp = std::make_unique<WalkingQPIK_osqp>();
         if(!m_QPIKSolver_osqp->initialize(inverseKinematicsQPSolverOptions,
                                           m_actuatedDOFs,
                                           m_minJointsLimit, m_maxJointsLimit))
         {
-            yError() << "[configure] Failed to configure the QP-IK solver (osqp)";
+            yError() << "[configureController] Failed to configure the QP-IK solver (osqp)";
             return false;
         }
 
@@ -503,9 +676,19 @@ bool WalkingModule::configure(yarp::os::ResourceFinder& rf)
                                              m_actuatedDOFs,
                                              m_minJointsLimit, m_maxJointsLimit))
         {
-            yError() << "[configure] Failed to configure the QP-IK solver (qpOASES)";
+            yError() << "[configureController] Failed to configure the QP-IK solver (qpOASES)";
             return false;
         }
+
+        // osqp and qpOASES solve the same problem at the same time
+        if(rf.check("use_qpik_race", yarp::os::Value(false)).asBool())
+        {
+            if(!configureQPIKRace(rf))
+            {
+                yError() << "[configureController] Failed to configure the QP-IK race.";
+                return false;
+            }
+        }
     }
 
     // initialize the forward kinematics solver
@@ -514,143 +697,367 @@ bool WalkingModule::configure(yarp::os::ResourceFinder& rf)
     forwardKinematicsSolverOptions.append(generalOptions);
     if(!m_FKSolver->initialize(forwardKinematicsSolverOptions, m_loader.model()))
     {
-        yError() << "[configure] Failed to configure the fk solver";
+        yError() << "[configureController] Failed to configure the fk solver";
         return false;
     }
 
+    // the warm-up of the QP-IK runs while the robot is prepared, it has its own kinematics
+    if(m_useSolversWarmUp && m_useQPIK)
+    {
+        m_warmUpFKSolver = std::make_unique<WalkingFK>();
+        if(!m_warmUpFKSolver->initialize(forwardKinematicsSolverOptions, m_loader.model()))
+        {
+            yError() << "[configureController] Failed to configure the fk solver of the warm-up.";
+            return false;
+        }
+    }
+
     // initialize the linear inverted pendulum model
     m_stableDCMModel = std::make_unique<StableDCMModel>();
     if(!m_stableDCMModel->initialize(generalOptions))
     {
-        yError() << "[configure] Failed to configure the lipm.";
+        yError() << "[configureController] Failed to configure the lipm.";
         return false;
     }
 
-    // set PIDs gains
-    m_PIDHandler = std::make_unique<WalkingPIDHandler>();
-    yarp::os::Bottle& pidOptions = rf.findGroup("PID");
-    if (!m_PIDHandler->initialize(pidOptions, m_robotDevice, m_remoteControlBoards))
+    // time profiler
+    m_profiler = std::make_unique<TimeProfiler>();
+    // the statistics are printed every 0.1 seconds but they are evaluated over a longer window,
+    // otherwise the percentiles would be evaluated with a few samples
+    double profilingWindow = rf.check("profiling_window", yarp::os::Value(5.0)).asDouble();
+    if(profilingWindow < 0.1)
     {
-        yError() << "[configure] Failed to configure the PIDs.";
+        yError() << "[configureController] The profiling window has to be at least 0.1 seconds.";
         return false;
     }
-
-    // initialize the logger
-    if(m_dumpData)
-    {
-        m_walkingLogger = std::make_unique<WalkingLogger>();
-        yarp::os::Bottle& loggerOptions = rf.findGroup("WALKING_LOGGER");
-        if(!m_walkingLogger->configure(loggerOptions, getName()))
-        {
-            yError() << "[configure] Unable to configure the logger.";
-            return false;
-        }
-    }
-
-    // time profiler
-    m_profiler = std::make_unique<TimeProfiler>();
     m_profiler->setPeriod(round(0.1 / m_dT));
+    m_profiler->setWindowSize(round(profilingWindow / m_dT));
+    m_profiler->setDeadline(m_dT);
+    m_profiler->setVerbose(rf.check("print_profiling_info", yarp::os::Value(false)).asBool());
     if(m_useMPC)
         m_profiler->addTimer("MPC");
 
+    if(m_useMPC && m_compareMPCFormulations)
+        m_profiler->addTimer(m_comparisonTimerName);
+
+    // number of switches between the MPC and the reactive controller
+    if(m_controllerSupervisor != nullptr)
+        m_profiler->addCounter("DCM controller switches", "sw");
+
+    // distance of the ZMP planned along the MPC horizon from the edges of the convex hull
+    if(m_useMPC && m_walkingController->isHorizonMarginChecked())
+        m_profiler->addCounter("ZMP horizon margin", "mm");
+
+    m_profiler->addTimer("Feedbacks");
+    m_profiler->addCounter("Stale feedbacks", "ticks");
     m_profiler->addTimer("IK");
     m_profiler->addTimer("Total");
 
+    // resources used by qpOASES in each tick
+    if(m_useQPIK && !m_useOSQP && m_QPIKRace == nullptr)
+    {
+        m_profiler->addTimer("QP-IK solver");
+        m_profiler->addCounter("QP-IK nWSR", "it");
+    }
+
+    // percentage of the races won by each solver
+    if(m_QPIKRace != nullptr)
+    {
+        m_profiler->addCounter("QP-IK osqp wins", "%");
+        m_profiler->addCounter("QP-IK qpOASES wins", "%");
+    }
+
+    // heap allocations made by the control loop in each tick (diagnostic build only)
+    if(AllocationCounter::isEnabled())
+        m_profiler->addCounter("Allocations", "alloc");
+
     // initialize some variables
     m_firstStep = false;
     m_newTrajectoryRequired = false;
     m_newTrajectoryMergeCounter = -1;
-    m_robotState = WalkingFSM::Configured;
 
     return true;
 }
 
-bool WalkingModule::close()
+bool WalkingModule::configureWithPlant(const yarp::os::Searchable& rf)
 {
-    // set position control when the module is closed
-    if(!switchToControlMode(VOCAB_CM_POSITION))
+    // the plant is controlled by the caller, the logger and the goal port are not used
+    m_dumpData = false;
+    m_useGoalPort = false;
+
+    if(!setControlledJoints(rf))
     {
-        yError() << "[close] Unable to switch in position control.";
+        yError() << "[configureWithPlant] Unable to set the controlled joints.";
         return false;
     }
 
-    if(m_dumpData)
-        m_walkingLogger->quit();
-
-    // restore PID
-    m_PIDHandler->restorePIDs();
+    if(!setRobotModel(rf))
+    {
+        yError() << "[configureWithPlant] Unable to set the robot model.";
+        return false;
+    }
 
-    // close the driver
-    if(!m_robotDevice.close())
-        yError() << "[close] Unable to close the device.";
+    yarp::os::Bottle& generalOptions = rf.findGroup("GENERAL");
+    m_dT = generalOptions.check("sampling_time", yarp::os::Value(0.016)).asDouble();
 
-    // clear all the pointer
-    m_trajectoryGenerator.reset(nullptr);
-    m_walkingController.reset(nullptr);
+    // the limits are not exposed by a device. The same limit is used for all the joints
+    double maxJointVelocity = rf.check("benchmark_max_joint_velocity", yarp::os::Value(100.0)).asDouble();
+    m_minJointsLimit.resize(m_actuatedDOFs);
+    m_maxJointsLimit.resize(m_actuatedDOFs);
+    for(int i = 0; i < m_actuatedDOFs; i++)
+    {
+        m_minJointsLimit(i) = -iDynTree::deg2rad(maxJointVelocity);
+        m_maxJointsLimit(i) = iDynTree::deg2rad(maxJointVelocity);
+    }
+
+    m_positionFeedbackInDegrees.resize(m_actuatedDOFs, 0.0);
+    m_velocityFeedbackInDegrees.resize(m_actuatedDOFs, 0.0);
+    m_leftWrenchInput.resize(6, 0.0);
+    m_rightWrenchInput.resize(6, 0.0);
+
+    m_plant = std::make_unique<BenchmarkPlant>();
+    if(!m_plant->initialize(rf, m_loader.model(), m_dT))
+    {
+        yError() << "[configureWithPlant] Unable to initialize the plant.";
+        return false;
+    }
+
+    if(!configureController(rf))
+    {
+        yError() << "[configureWithPlant] Unable to configure the controller.";
+        return false;
+    }
+
+    // the robot is standing in the regularization configuration of the IK
+    iDynTree::Vector2 initialZMP;
+    initialZMP.zero();
+    m_plant->reset(m_IKSolver->desiredJointConfiguration(), initialZMP);
+
+    m_robotState = WalkingFSM::Configured;
+    return true;
+}
+
+bool WalkingModule::configureRealTimeThread(const yarp::os::Searchable& config)
+{
+    m_realTimeThread = std::make_unique<RealTimeThread>();
+    if(!m_realTimeThread->configure(config, m_dT))
+    {
+        yError() << "[configureRealTimeThread] Unable to configure the thread.";
+        m_realTimeThread.reset(nullptr);
+        return false;
+    }
+
+    // the worker threads cannot preempt the control loop
+    std::vector<int> workerCores;
+    if(!RealTimeHelper::getCoresFromSearchable(config, "worker_cores", workerCores))
+    {
+        yError() << "[configureRealTimeThread] Unable to get the cores of the worker threads.";
+        m_realTimeThread.reset(nullptr);
+        return false;
+    }
+
+    int realTimeCore = config.check("real_time_core", yarp::os::Value(-1)).asInt();
+    if(realTimeCore >= 0
+       && std::find(workerCores.begin(), workerCores.end(), realTimeCore) != workerCores.end())
+    {
+        yError() << "[configureRealTimeThread] The core" << realTimeCore
+                 << "is reserved to the control loop.";
+        m_realTimeThread.reset(nullptr);
+        return false;
+    }
+
+    if(!m_trajectoryGenerator->setThreadsAffinity(workerCores)
+       || !m_PIDHandler->setThreadAffinity(workerCores)
+       || (m_lookAheadIK != nullptr && !m_lookAheadIK->setThreadAffinity(workerCores)))
+    {
+        yError() << "[configureRealTimeThread] Unable to pin the worker threads.";
+        m_realTimeThread.reset(nullptr);
+        return false;
+    }
+
+    m_profiler->addCounter("Period jitter", "ms");
+
+    if(!m_realTimeThread->start([this]{return updateController();}))
+    {
+        yError() << "[configureRealTimeThread] Unable to start the thread.";
+        m_realTimeThread.reset(nullptr);
+        return false;
+    }
+
+    return true;
+}
+
+bool WalkingModule::configureQPIKRace(const yarp::os::Searchable& config)
+{
+    // the race has to end before the deadline of the tick
+    double budget = config.check("qpik_race_budget_ratio", yarp::os::Value(0.5)).asDouble() * m_dT;
+    m_QPIKRaceMaxConsecutiveFallbacks = config.check("qpik_race_max_consecutive_fallbacks",
+                                                     yarp::os::Value(5)).asInt();
+
+    std::vector<int> cores;
+    if(!RealTimeHelper::getCoresFromSearchable(config, "qpik_race_cores", cores))
+    {
+        yError() << "[configureQPIKRace] Unable to get the cores of the race threads.";
+        return false;
+    }
+
+    int realTimeCore = config.check("real_time_core", yarp::os::Value(-1)).asInt();
+    if(realTimeCore >= 0 && std::find(cores.begin(), cores.end(), realTimeCore) != cores.end())
+    {
+        yError() << "[configureQPIKRace] The core" << realTimeCore
+                 << "is reserved to the control loop.";
+        return false;
+    }
+
+    // a result of qpOASES is valid only if it is not the last feasible solution
+    std::array<std::function<bool()>, QPIKRace::NumberOfSolvers> solvers;
+    solvers[OSQPRaceIndex] = [this]{return m_QPIKSolver_osqp->solve();};
+    solvers[qpOASESRaceIndex] = [this]{return m_QPIKSolver_qpOASES->solve()
+            && m_QPIKSolver_qpOASES->getNumberOfConsecutiveFallbacks() == 0;};
+
+    m_QPIKRace = std::make_unique<QPIKRace>();
+    if(!m_QPIKRace->initialize(solvers, budget, cores))
+    {
+        yError() << "[configureQPIKRace] Unable to initialize the race.";
+        m_QPIKRace.reset(nullptr);
+        return false;
+    }
+
+    // base twist and joint velocities
+    m_QPIKPrimalVariable = Eigen::VectorXd::Zero(m_actuatedDOFs + 6);
+    m_isQPIKSolverIdle.fill(true);
+    m_QPIKRaceWinner = -1;
+    m_QPIKRaceConsecutiveFallbacks = 0;
+    return true;
+}
+
+bool WalkingModule::close()
+{
+    // the control loop is stopped before the other components
+    if(m_realTimeThread != nullptr)
+        m_realTimeThread->stop();
+
+    // set position control when the module is closed
+    if(!switchToControlMode(VOCAB_CM_POSITION))
+    {
+        yError() << "[close] Unable to switch in position control.";
+        return false;
+    }
+
+    if(m_dumpData)
+        m_walkingLogger->quit();
+
+    // restore PID
+    if(m_PIDHandler != nullptr)
+        m_PIDHandler->restorePIDs();
+
+    // the acquisition thread uses the interfaces of the driver
+    m_sensorAcquisition.reset(nullptr);
+
+    // the look-ahead thread has to be stopped before the other components
+    m_lookAheadIK.reset(nullptr);
+
+    // the race threads use the QP-IK solvers
+    m_QPIKRace.reset(nullptr);
+
+    // close the driver
+    if(!m_robotDevice.close())
+        yError() << "[close] Unable to close the device.";
+
+    // clear all the pointer
+    m_realTimeThread.reset(nullptr);
+    m_trajectoryGenerator.reset(nullptr);
+    m_walkingController.reset(nullptr);
+    m_walkingControllerComparison.reset(nullptr);
+    m_walkingDCMReactiveController.reset(nullptr);
+    m_controllerSupervisor.reset(nullptr);
     m_walkingZMPController.reset(nullptr);
     m_IKSolver.reset(nullptr);
     m_QPIKSolver_osqp.reset(nullptr);
     m_QPIKSolver_qpOASES.reset(nullptr);
     m_FKSolver.reset(nullptr);
+    m_warmUpFKSolver.reset(nullptr);
     m_stableDCMModel.reset(nullptr);
     m_PIDHandler.reset(nullptr);
-    m_leftWrenchFilter.reset(nullptr);
-    m_rightWrenchFilter.reset(nullptr);
-    m_positionFilter.reset(nullptr);
-    m_velocityFilter.reset(nullptr);
 
     // close the ports
     m_rpcPort.close();
+    if(m_solverStatisticsPublisher != nullptr)
+        m_solverStatisticsPublisher->close();
+    if(m_useGoalPort)
+        m_goalPort.close();
     m_rightWrenchPort.close();
     m_leftWrenchPort.close();
 
     return true;
 }
 
-bool WalkingModule::solveQPIK(auto& solver, const iDynTree::Position& desiredCoMPosition,
-                              const iDynTree::Vector3& desiredCoMVelocity,
-                              const iDynTree::Position& actualCoMPosition,
-                              const iDynTree::Rotation& desiredNeckOrientation,
-                              iDynTree::VectorDynSize &output)
+bool WalkingModule::setQPIKProblem(auto& solver, const iDynTree::Position& desiredCoMPosition,
+                                   const iDynTree::Vector3& desiredCoMVelocity,
+                                   const iDynTree::Position& actualCoMPosition,
+                                   const iDynTree::Rotation& desiredNeckOrientation)
+{
+    return setQPIKProblem(solver, *m_FKSolver, m_positionFeedbackInRadians,
+                          m_feetJacobianBuffer, m_comJacobianBuffer, desiredCoMPosition,
+                          desiredCoMVelocity, actualCoMPosition, desiredNeckOrientation);
+}
+
+bool WalkingModule::setQPIKProblem(auto& solver, WalkingFK& kinematics,
+                                   const iDynTree::VectorDynSize& jointPositions,
+                                   iDynTree::MatrixDynSize& feetJacobianBuffer,
+                                   iDynTree::MatrixDynSize& comJacobianBuffer,
+                                   const iDynTree::Position& desiredCoMPosition,
+                                   const iDynTree::Vector3& desiredCoMVelocity,
+                                   const iDynTree::Position& actualCoMPosition,
+                                   const iDynTree::Rotation& desiredNeckOrientation)
 {
-    if(!solver->setRobotState(m_positionFeedbackInRadians,
-                              m_FKSolver->getLeftFootToWorldTransform(),
-                              m_FKSolver->getRightFootToWorldTransform(),
-                              m_FKSolver->getNeckOrientation(),
+    if(!solver->setRobotState(jointPositions,
+                              kinematics.getLeftFootToWorldTransform(FKState::Desired),
+                              kinematics.getRightFootToWorldTransform(FKState::Desired),
+                              kinematics.getNeckOrientation(FKState::Desired),
                               actualCoMPosition))
     {
-        yError() << "[solveQPIK] Unable to update the QP-IK solver";
+        yError() << "[setQPIKProblem] Unable to update the QP-IK solver";
         return false;
     }
 
     solver->setDesiredNeckOrientation(desiredNeckOrientation.inverse());
 
-    solver->setDesiredFeetTransformation(m_leftTrajectory.front(),
-                                         m_rightTrajectory.front());
+    solver->setDesiredFeetTransformation(m_trajectory.getLeftFootTrajectory().front(),
+                                         m_trajectory.getRightFootTrajectory().front());
 
-    solver->setDesiredFeetTwist(m_leftTwistTrajectory.front(),
-                                m_rightTwistTrajectory.front());
+    solver->setDesiredFeetTwist(m_trajectory.getLeftFootTwistTrajectory().front(),
+                                m_trajectory.getRightFootTwistTrajectory().front());
 
     solver->setDesiredCoMVelocity(desiredCoMVelocity);
 
     solver->setDesiredCoMPosition(desiredCoMPosition);
 
     // set jacobians
-    iDynTree::MatrixDynSize jacobian, comJacobian;
-    jacobian.resize(6, m_actuatedDOFs + 6);
-    comJacobian.resize(3, m_actuatedDOFs + 6);
+    kinematics.getLeftFootJacobian(feetJacobianBuffer, FKState::Desired);
+    solver->setLeftFootJacobian(feetJacobianBuffer);
 
-    m_FKSolver->getLeftFootJacobian(jacobian);
-    solver->setLeftFootJacobian(jacobian);
+    kinematics.getRightFootJacobian(feetJacobianBuffer, FKState::Desired);
+    solver->setRightFootJacobian(feetJacobianBuffer);
 
-    m_FKSolver->getRightFootJacobian(jacobian);
-    solver->setRightFootJacobian(jacobian);
+    kinematics.getNeckJacobian(feetJacobianBuffer, FKState::Desired);
+    solver->setNeckJacobian(feetJacobianBuffer);
 
-    m_FKSolver->getNeckJacobian(jacobian);
-    solver->setNeckJacobian(jacobian);
+    kinematics.getCoMJacobian(comJacobianBuffer, FKState::Desired);
+    solver->setCoMJacobian(comJacobianBuffer);
 
-    m_FKSolver->getCoMJacobian(comJacobian);
-    solver->setCoMJacobian(comJacobian);
+    return true;
+}
+
+bool WalkingModule::solveQPIK(auto& solver, const iDynTree::Position& desiredCoMPosition,
+                              const iDynTree::Vector3& desiredCoMVelocity,
+                              const iDynTree::Position& actualCoMPosition,
+                              const iDynTree::Rotation& desiredNeckOrientation,
+                              iDynTree::VectorDynSize &output)
+{
+    if(!setQPIKProblem(solver, desiredCoMPosition, desiredCoMVelocity, actualCoMPosition,
+                       desiredNeckOrientation))
+        return false;
 
     if(!solver->solve())
     {
@@ -667,434 +1074,736 @@ bool WalkingModule::solveQPIK(auto& solver, const iDynTree::Position& desiredCoM
     return true;
 }
 
-bool WalkingModule::updateModule()
+bool WalkingModule::solveQPIKRace(const iDynTree::Position& desiredCoMPosition,
+                                  const iDynTree::Vector3& desiredCoMVelocity,
+                                  const iDynTree::Position& actualCoMPosition,
+                                  const iDynTree::Rotation& desiredNeckOrientation)
 {
-    std::lock_guard<std::mutex> guard(m_mutex);
+    // the solvers that are still running since the previous tick are not updated
+    if(m_isQPIKSolverIdle[OSQPRaceIndex]
+       && !setQPIKProblem(m_QPIKSolver_osqp, desiredCoMPosition, desiredCoMVelocity,
+                          actualCoMPosition, desiredNeckOrientation))
+        return false;
 
-    if(m_robotState == WalkingFSM::Walking
-       || m_robotState == WalkingFSM::Stance
-       || m_robotState == WalkingFSM::OnTheFly)
-    {
-        iDynTree::Vector2 measuredDCM, measuredZMP;
-        iDynTree::Position measuredCoM;
-        iDynTree::Vector3 measuredCoMVelocity;
+    if(m_isQPIKSolverIdle[qpOASESRaceIndex]
+       && !setQPIKProblem(m_QPIKSolver_qpOASES, desiredCoMPosition, desiredCoMVelocity,
+                          actualCoMPosition, desiredNeckOrientation))
+        return false;
 
-        bool resetTrajectory = false;
+    m_QPIKRaceWinner = m_QPIKRace->race(m_isQPIKSolverIdle);
 
-        m_profiler->setInitTime("Total");
+    m_profiler->setValue("QP-IK osqp wins", m_QPIKRaceWinner == OSQPRaceIndex ? 100 : 0);
+    m_profiler->setValue("QP-IK qpOASES wins", m_QPIKRaceWinner == qpOASESRaceIndex ? 100 : 0);
 
-        // if a new trajectory is required check if its the time to evaluate the new trajectory or
-        // the time to attach new one
-        if(m_newTrajectoryRequired)
+    if(m_QPIKRaceWinner < 0)
+    {
+        if(m_QPIKRaceConsecutiveFallbacks >= m_QPIKRaceMaxConsecutiveFallbacks)
         {
-            // when we are near to the merge point the new trajectory is evaluated
-            if(m_newTrajectoryMergeCounter == 20)
-            {
-
-                double initTimeTrajectory;
-                initTimeTrajectory = m_time + m_newTrajectoryMergeCounter * m_dT;
-
-                iDynTree::Transform measuredTransform = m_isLeftFixedFrame.front() ?
-                    m_rightTrajectory[m_newTrajectoryMergeCounter] :
-                    m_leftTrajectory[m_newTrajectoryMergeCounter];
-
-                // ask for a new trajectory
-                if(!askNewTrajectories(initTimeTrajectory, !m_isLeftFixedFrame.front(),
-                                       measuredTransform, m_newTrajectoryMergeCounter,
-                                       m_desiredPosition))
-                {
-                    yError() << "[updateModule] Unable to ask for a new trajectory.";
-                    return false;
-                }
-            }
-
-            if(m_newTrajectoryMergeCounter == 2)
-            {
-                if(!updateTrajectories(m_newTrajectoryMergeCounter))
-                {
-                    yError() << "[updateModule] Error while updating trajectories. They were not computed yet.";
-                    return false;
-                }
-                m_newTrajectoryRequired = false;
-                resetTrajectory = true;
-            }
-
-            m_newTrajectoryMergeCounter--;
+            yError() << "[solveQPIKRace] No solver found a solution within the budget.";
+            return false;
         }
 
-        if (m_PIDHandler->usingGainScheduling())
-        {
-            if (!m_PIDHandler->updatePhases(m_leftInContact, m_rightInContact, m_time))
-            {
-                yError() << "[updateModule] Unable to get the update PID.";
-                return false;
-            }
-        }
+        m_QPIKRaceConsecutiveFallbacks++;
+        yWarning() << "[solveQPIKRace] No solver found a solution within the budget. "
+                   << "The previous joint velocity is used.";
+        return true;
+    }
+    m_QPIKRaceConsecutiveFallbacks = 0;
 
-        // get feedbacks and evaluate useful quantities
-        if(!getFeedbacks(100))
+    // the winner is idle until the next race, the other solver is warm started only if it is
+    // not running
+    if(m_QPIKRaceWinner == OSQPRaceIndex)
+    {
+        if(!m_QPIKSolver_osqp->getSolution(m_dqDesired_osqp)
+           || !m_QPIKSolver_osqp->getPrimalVariable(m_QPIKPrimalVariable))
         {
-            yError() << "[updateModule] Unable to get the feedback.";
+            yError() << "[solveQPIKRace] Unable to get the solution of osqp.";
             return false;
         }
 
-        if(!updateFKSolver())
+        if(m_QPIKRace->isIdle(qpOASESRaceIndex)
+           && !m_QPIKSolver_qpOASES->setPrimalVariable(m_QPIKPrimalVariable))
         {
-            yError() << "[updateModule] Unable to update the FK solver.";
+            yError() << "[solveQPIKRace] Unable to warm start qpOASES.";
             return false;
         }
 
-        if(!evaluateCoM(measuredCoM, measuredCoMVelocity))
-        {
-            yError() << "[updateModule] Unable to evaluate the CoM.";
-            return false;
-        }
+        if(m_solverStatisticsPublisher != nullptr)
+            m_QPIKSolver_osqp->getStatistics(m_solverStatistics.qpIK);
 
-        if(!evaluateDCM(measuredDCM))
+        iDynTree::toYarp(m_dqDesired_osqp, m_bufferVelocity);
+    }
+    else
+    {
+        if(!m_QPIKSolver_qpOASES->getSolution(m_dqDesired_qpOASES)
+           || !m_QPIKSolver_qpOASES->getPrimalVariable(m_QPIKPrimalVariable))
         {
-            yError() << "[updateModule] Unable to evaluate the DCM.";
+            yError() << "[solveQPIKRace] Unable to get the solution of qpOASES.";
             return false;
         }
 
-        if(!evaluateZMP(measuredZMP))
+        if(m_QPIKRace->isIdle(OSQPRaceIndex)
+           && !m_QPIKSolver_osqp->setPrimalVariable(m_QPIKPrimalVariable))
         {
-            yError() << "[updateModule] Unable to evaluate the ZMP.";
+            yError() << "[solveQPIKRace] Unable to warm start osqp.";
             return false;
         }
 
-        // evaluate 3D-LIPM reference signal
-        m_stableDCMModel->setInput(m_DCMPositionDesired.front());
-        if(!m_stableDCMModel->integrateModel())
+        if(m_solverStatisticsPublisher != nullptr)
+            m_QPIKSolver_qpOASES->getStatistics(m_solverStatistics.qpIK);
+
+        iDynTree::toYarp(m_dqDesired_qpOASES, m_bufferVelocity);
+    }
+
+    return true;
+}
+
+bool WalkingModule::updateModule()
+{
+    // in the real-time mode the RFModule only checks that the control loop is running
+    if(m_realTimeThread != nullptr)
+    {
+        if(!m_realTimeThread->isRunning())
         {
-            yError() << "[updateModule] Unable to propagate the 3D-LIPM.";
+            yError() << "[updateModule] The real-time thread is not running.";
             return false;
         }
+        return true;
+    }
 
-        iDynTree::Vector2 desiredCoMPositionXY;
-        if(!m_stableDCMModel->getCoMPosition(desiredCoMPositionXY))
+    return updateController();
+}
+
+bool WalkingModule::updateController()
+{
+    // the mutex is taken by the RPC handlers only when the robot is not controlled
+    // (onTheFlyStartWalking), setGoal and startWalking post their commands in m_commands
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    processCommands();
+    processStreamedGoal();
+
+    if(m_robotState == WalkingFSM::Walking
+       || m_robotState == WalkingFSM::Stance
+       || m_robotState == WalkingFSM::OnTheFly)
+    {
+        if(!tick())
         {
-            yError() << "[updateModule] Unable to get the desired CoM position.";
+            yError() << "[updateController] Unable to evaluate the tick of the controller.";
             return false;
         }
 
-        iDynTree::Vector2 desiredCoMVelocityXY;
-        if(!m_stableDCMModel->getCoMVelocity(desiredCoMVelocityXY))
+        if(!propagate())
         {
-            yError() << "[updateModule] Unable to get the desired CoM velocity.";
+            yError() << "[updateController] Unable to propagate the controller.";
             return false;
         }
+    }
+    return true;
+}
 
-        // DCM controller
-        iDynTree::Vector2 desiredZMP;
-        if(m_useMPC)
+bool WalkingModule::tick()
+{
+    iDynTree::Vector2 measuredDCM, measuredZMP;
+    iDynTree::Position measuredCoM;
+    iDynTree::Vector3 measuredCoMVelocity;
+
+    bool resetTrajectory = false;
+
+    std::size_t allocationsAtTickStart = AllocationCounter::getThreadAllocations();
+
+    m_profiler->setInitTime("Total");
+    auto tickInitTime = std::chrono::steady_clock::now();
+    if(m_solverStatisticsPublisher != nullptr)
+        m_solverStatistics = SolverStatistics();
+
+    // period jitter of the real-time thread
+    if(m_realTimeThread != nullptr)
+        m_profiler->setValue("Period jitter", std::abs(m_realTimeThread->getLastPeriod() - m_dT) * 1000.0);
+
+    // if a new trajectory is required check if its the time to evaluate the new trajectory or
+    // the time to attach new one
+    if(m_newTrajectoryRequired)
+    {
+        // when we are near to the merge point the new trajectory is evaluated
+        // (the candidate trajectories of the speculative planners are already evaluated).
+        // If the planner is still evaluating a previous trajectory the request is delayed
+        if(m_newTrajectoryMergeCounter <= m_newTrajectoryRequestCounter
+           && m_newTrajectoryMergeCounter > 2
+           && !m_isNewTrajectoryAsked && !m_isSpeculativeTrajectoryAdopted
+           && !m_trajectoryGenerator->isTrajectoryAsked())
         {
-            // Model predictive controller
-            m_profiler->setInitTime("MPC");
-            if(!m_walkingController->setConvexHullConstraint(m_leftTrajectory, m_rightTrajectory,
-                                                             m_leftInContact, m_rightInContact))
-            {
-                yError() << "[updateModule] unable to evaluate the convex hull.";
-                return false;
-            }
 
-            if(!m_walkingController->setFeedback(measuredDCM))
-            {
-                yError() << "[updateModule] unable to set the feedback.";
-                return false;
-            }
+            double initTimeTrajectory;
+            initTimeTrajectory = m_time + m_newTrajectoryMergeCounter * m_dT;
 
-            if(!m_walkingController->setReferenceSignal(m_DCMPositionDesired, resetTrajectory))
+            iDynTree::Transform measuredTransform = m_trajectory.getIsLeftFixedFrame().front() ?
+                m_trajectory.getRightFootTrajectory()[m_newTrajectoryMergeCounter] :
+                m_trajectory.getLeftFootTrajectory()[m_newTrajectoryMergeCounter];
+
+            // ask for a new trajectory
+            if(!askNewTrajectories(initTimeTrajectory, !m_trajectory.getIsLeftFixedFrame().front(),
+                                   measuredTransform, m_newTrajectoryMergeCounter,
+                                   m_desiredPosition))
             {
-                yError() << "[updateModule] unable to set the reference Signal.";
+                yError() << "[tick] Unable to ask for a new trajectory.";
                 return false;
             }
+            m_isNewTrajectoryAsked = true;
+        }
 
-            if(!m_walkingController->solve())
+        if(m_newTrajectoryMergeCounter == 2)
+        {
+            // if the planner is late the current trajectory is kept
+            if(!m_isSpeculativeTrajectoryAdopted
+               && !(m_isNewTrajectoryAsked && m_trajectoryGenerator->isTrajectoryComputed()))
             {
-                yError() << "[updateModule] Unable to solve the problem.";
-                return false;
+                yWarning() << "[tick] The new trajectory is not computed yet. It will be "
+                           << "merged at the next merge point.";
+                postponeNewTrajectory();
             }
-
-            if(!m_walkingController->getControllerOutput(desiredZMP))
+            else
             {
-                yError() << "[updateModule] Unable to get the MPC output.";
-                return false;
+                if(!updateTrajectories(m_newTrajectoryMergeCounter))
+                {
+                    yError() << "[tick] Error while updating trajectories. They were not computed yet.";
+                    return false;
+                }
+                m_newTrajectoryRequired = false;
+                m_isNewTrajectoryAsked = false;
+                resetTrajectory = true;
             }
+        }
+
+        m_newTrajectoryMergeCounter--;
+    }
 
-            m_profiler->setEndTime("MPC");
+    // keep evaluating the trajectories for the next merge point, so a new goal can be
+    // adopted without waiting for the planner
+    if(m_robotState == WalkingFSM::Walking && !m_newTrajectoryRequired
+       && m_trajectoryGenerator->isSpeculativePlanningEnabled())
+    {
+        if(!askSpeculativeTrajectories())
+        {
+            yError() << "[tick] Unable to ask for the speculative trajectories.";
+            return false;
         }
-        else
+    }
+
+    if (m_PIDHandler != nullptr && m_PIDHandler->usingGainScheduling())
+    {
+        if (!m_PIDHandler->updatePhases(m_time))
         {
-            m_walkingDCMReactiveController->setFeedback(measuredDCM);
-            m_walkingDCMReactiveController->setReferenceSignal(m_DCMPositionDesired.front(), m_DCMVelocityDesired.front());
+            yError() << "[tick] Unable to get the update PID.";
+            return false;
+        }
+    }
 
-            if(!m_walkingDCMReactiveController->evaluateControl())
-            {
-                yError() << "[updateModule] Unable to evaluate the DCM control output.";
-                return false;
-            }
+    // get feedbacks and evaluate useful quantities
+    m_profiler->setInitTime("Feedbacks");
+    if(!getControlLoopFeedbacks(tickInitTime))
+    {
+        yError() << "[tick] Unable to get the feedback.";
+        return false;
+    }
+    m_profiler->setEndTime("Feedbacks");
+
+    if(!updateFKSolver())
+    {
+        yError() << "[tick] Unable to update the FK solver.";
+        return false;
+    }
 
-            if(!m_walkingDCMReactiveController->getControllerOutput(desiredZMP))
+    if(!evaluateCoM(measuredCoM, measuredCoMVelocity))
+    {
+        yError() << "[tick] Unable to evaluate the CoM.";
+        return false;
+    }
+
+    if(!evaluateDCM(measuredDCM))
+    {
+        yError() << "[tick] Unable to evaluate the DCM.";
+        return false;
+    }
+
+    if(!evaluateZMP(measuredZMP))
+    {
+        yError() << "[tick] Unable to evaluate the ZMP.";
+        return false;
+    }
+
+    // evaluate 3D-LIPM reference signal
+    m_stableDCMModel->setInput(m_trajectory.getDCMPositionDesired().front());
+    if(!m_stableDCMModel->integrateModel())
+    {
+        yError() << "[tick] Unable to propagate the 3D-LIPM.";
+        return false;
+    }
+
+    iDynTree::Vector2 desiredCoMPositionXY;
+    if(!m_stableDCMModel->getCoMPosition(desiredCoMPositionXY))
+    {
+        yError() << "[tick] Unable to get the desired CoM position.";
+        return false;
+    }
+
+    iDynTree::Vector2 desiredCoMVelocityXY;
+    if(!m_stableDCMModel->getCoMVelocity(desiredCoMVelocityXY))
+    {
+        yError() << "[tick] Unable to get the desired CoM velocity.";
+        return false;
+    }
+
+    // ask for the posture that will be used in a few samples
+    if(m_lookAheadIK != nullptr && m_robotState != WalkingFSM::OnTheFly)
+    {
+        if(resetTrajectory)
+            m_lookAheadIK->reset();
+
+        if(!m_lookAheadIK->setRequest(m_trajectory, desiredCoMPositionXY,
+                                      m_inertial_R_worldFrame, m_positionFeedbackInRadians))
+        {
+            yError() << "[tick] Unable to send the request to the look-ahead IK thread.";
+            return false;
+        }
+    }
+
+    // DCM controller
+    iDynTree::Vector2 desiredZMP;
+    bool useReactiveController = !m_useMPC;
+    if(m_useMPC && m_controllerSupervisor != nullptr
+       && !m_controllerSupervisor->isMPCSolveRequired())
+    {
+        // while the reactive controller is used the MPC is solved only in the probe ticks.
+        // The reference of the MPC is shifted by one sample in each solve, so after a
+        // skipped tick it has to be set again in the next probe
+        m_controllerSupervisor->setMPCSkipped();
+        m_isMPCReferenceResetPending = true;
+        useReactiveController = true;
+    }
+    else if(m_useMPC)
+    {
+        bool resetMPCTrajectory = resetTrajectory || m_isMPCReferenceResetPending;
+        m_isMPCReferenceResetPending = false;
+
+        // Model predictive controller
+        m_profiler->setInitTime("MPC");
+        auto mpcInitTime = std::chrono::steady_clock::now();
+        bool isMPCSolved = solveMPC(measuredDCM, resetMPCTrajectory, desiredZMP);
+        double mpcSolveTime = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                            - mpcInitTime).count();
+        m_profiler->setEndTime("MPC");
+
+        if(m_controllerSupervisor == nullptr)
+        {
+            if(!isMPCSolved)
             {
-                yError() << "[updateModule] Unable to get the DCM control output.";
+                yError() << "[tick] Unable to evaluate the MPC controller.";
                 return false;
             }
         }
+        else
+        {
+            m_controllerSupervisor->setMPCStatus(isMPCSolved, mpcSolveTime);
+            useReactiveController = m_controllerSupervisor->getMode() == DCMControllerMode::Reactive;
+            m_profiler->setValue("DCM controller switches", m_controllerSupervisor->getNumberOfSwitches());
+        }
 
-        // inner COM-ZMP controller
-        m_walkingZMPController->setFeedback(measuredZMP, measuredCoM);
-        m_walkingZMPController->setReferenceSignal(desiredZMP, desiredCoMPositionXY, desiredCoMVelocityXY);
+        if(m_solverStatisticsPublisher != nullptr)
+        {
+            m_solverStatistics.isMPCSolved = isMPCSolved;
+            m_solverStatistics.isMPCUnconstrained = m_walkingController->isSolutionUnconstrained();
+            m_walkingController->getSolverStatistics(m_solverStatistics.mpc);
+            m_solverStatistics.mpc.solveTime = mpcSolveTime;
+            m_solverStatistics.zmpMargin = m_walkingController->getZMPMargin();
+            if(m_walkingController->isHorizonMarginChecked())
+                m_solverStatistics.zmpHorizonMargin = m_walkingController->getHorizonMargin();
+        }
 
-        if(!m_walkingZMPController->evaluateControl())
+        if(m_compareMPCFormulations)
         {
-            yError() << "[updateModule] Unable to evaluate the ZMP control output.";
+            // the output of this controller is not used. A failure is not critical
+            m_profiler->setInitTime(m_comparisonTimerName);
+            if(!m_walkingControllerComparison->setConvexHullConstraint(m_trajectory.getLeftFootTrajectory(),
+                                                                       m_trajectory.getRightFootTrajectory(),
+                                                                       m_trajectory.getLeftInContact(),
+                                                                       m_trajectory.getRightInContact())
+               || !m_walkingControllerComparison->setFeedback(measuredDCM)
+               || !m_walkingControllerComparison->setReferenceSignal(m_trajectory.getDCMPositionDesired(), resetMPCTrajectory)
+               || !m_walkingControllerComparison->solve())
+                yWarning() << "[tick] Unable to evaluate the comparison MPC controller.";
+            m_profiler->setEndTime(m_comparisonTimerName);
+        }
+    }
+
+    if(useReactiveController)
+    {
+        m_walkingDCMReactiveController->setFeedback(measuredDCM);
+        m_walkingDCMReactiveController->setReferenceSignal(m_trajectory.getDCMPositionDesired().front(),
+                                                           m_trajectory.getDCMVelocityDesired().front());
+
+        if(!m_walkingDCMReactiveController->evaluateControl())
+        {
+            yError() << "[tick] Unable to evaluate the DCM control output.";
             return false;
         }
 
-        iDynTree::Vector2 outputZMPCoMControllerPosition, outputZMPCoMControllerVelocity;
-        if(!m_walkingZMPController->getControllerOutput(outputZMPCoMControllerPosition,
-                                                        outputZMPCoMControllerVelocity))
+        if(!m_walkingDCMReactiveController->getControllerOutput(desiredZMP))
         {
-            yError() << "[updateModule] Unable to get the ZMP controller output.";
+            yError() << "[tick] Unable to get the DCM control output.";
             return false;
         }
+    }
 
-        // inverse kinematics
-        m_profiler->setInitTime("IK");
+    if(m_solverStatisticsPublisher != nullptr)
+        m_solverStatistics.isReactiveControllerUsed = useReactiveController;
 
-        iDynTree::Position desiredCoMPosition;
-        desiredCoMPosition(0) = outputZMPCoMControllerPosition(0);
-        desiredCoMPosition(1) = outputZMPCoMControllerPosition(1);
+    // the output is continuous when the controller changes
+    if(m_controllerSupervisor != nullptr)
+        m_controllerSupervisor->filterOutput(desiredZMP);
 
-        if(m_robotState == WalkingFSM::OnTheFly)
-        {
-            m_heightSmoother->computeNextValues(yarp::sig::Vector(1,m_comHeightTrajectory.front()));
-            desiredCoMPosition(2) = m_heightSmoother->getPos()[0];
-        }
-        else
-            desiredCoMPosition(2) = m_comHeightTrajectory.front();
+    // inner COM-ZMP controller
+    m_walkingZMPController->setFeedback(measuredZMP, measuredCoM);
+    m_walkingZMPController->setReferenceSignal(desiredZMP, desiredCoMPositionXY, desiredCoMVelocityXY);
+
+    if(!m_walkingZMPController->evaluateControl())
+    {
+        yError() << "[tick] Unable to evaluate the ZMP control output.";
+        return false;
+    }
 
+    iDynTree::Vector2 outputZMPCoMControllerPosition, outputZMPCoMControllerVelocity;
+    if(!m_walkingZMPController->getControllerOutput(outputZMPCoMControllerPosition,
+                                                    outputZMPCoMControllerVelocity))
+    {
+        yError() << "[tick] Unable to get the ZMP controller output.";
+        return false;
+    }
 
-        iDynTree::Vector3 desiredCoMVelocity;
-        desiredCoMVelocity(0) = outputZMPCoMControllerVelocity(0);
-        desiredCoMVelocity(1) = outputZMPCoMControllerVelocity(1);
-        desiredCoMVelocity(2) = m_comHeightVelocity.front();
+    // inverse kinematics
+    m_profiler->setInitTime("IK");
 
-        // evaluate desired neck transformation
-        double yawLeft = m_leftTrajectory.front().getRotation().asRPY()(2);
-        double yawRight = m_rightTrajectory.front().getRotation().asRPY()(2);
+    iDynTree::Position desiredCoMPosition;
+    desiredCoMPosition(0) = outputZMPCoMControllerPosition(0);
+    desiredCoMPosition(1) = outputZMPCoMControllerPosition(1);
 
-        double meanYaw = std::atan2(std::sin(yawLeft) + std::sin(yawRight),
-                                    std::cos(yawLeft) + std::cos(yawRight));
-        iDynTree::Rotation yawRotation, modifiedInertial;
+    if(m_robotState == WalkingFSM::OnTheFly)
+    {
+        m_scalarBuffer(0) = m_trajectory.getCoMHeightTrajectory().front();
+        m_heightSmoother->computeNextValues(m_scalarBuffer);
+        desiredCoMPosition(2) = m_heightSmoother->getPos()[0];
+    }
+    else
+        desiredCoMPosition(2) = m_trajectory.getCoMHeightTrajectory().front();
 
-        yawRotation = iDynTree::Rotation::RotZ(meanYaw);
-        yawRotation = yawRotation.inverse();
-        modifiedInertial = yawRotation * m_inertial_R_worldFrame;
 
-        if(m_useQPIK && m_robotState != WalkingFSM::OnTheFly)
+    iDynTree::Vector3 desiredCoMVelocity;
+    desiredCoMVelocity(0) = outputZMPCoMControllerVelocity(0);
+    desiredCoMVelocity(1) = outputZMPCoMControllerVelocity(1);
+    desiredCoMVelocity(2) = m_trajectory.getCoMHeightVelocity().front();
+
+    // evaluate desired neck transformation
+    double yawLeft = m_trajectory.getLeftFootTrajectory().front().getRotation().asRPY()(2);
+    double yawRight = m_trajectory.getRightFootTrajectory().front().getRotation().asRPY()(2);
+
+    double meanYaw = std::atan2(std::sin(yawLeft) + std::sin(yawRight),
+                                std::cos(yawLeft) + std::cos(yawRight));
+    iDynTree::Rotation yawRotation, modifiedInertial;
+
+    yawRotation = iDynTree::Rotation::RotZ(meanYaw);
+    yawRotation = yawRotation.inverse();
+    modifiedInertial = yawRotation * m_inertial_R_worldFrame;
+
+    if(m_useQPIK && m_robotState != WalkingFSM::OnTheFly)
+    {
+        // integrate dq because velocity control mode seems not available
+        if(!m_FKSolver->setDesiredRobotState(m_qDesired, m_dqDesired_osqp))
         {
-            // integrate dq because velocity control mode seems not available
-            yarp::sig::Vector bufferVelocity(m_actuatedDOFs);
-            yarp::sig::Vector bufferPosition(m_actuatedDOFs);
+            yError() << "[updateFKSolver] Unable to evaluate the CoM.";
+            return false;
+        }
 
-            if(!m_FKSolver->setInternalRobotState(m_qDesired, m_dqDesired_osqp))
+        // in the race only the solvers that are idle are updated (a solver becomes busy
+        // only when the race starts)
+        if(m_QPIKRace != nullptr)
+            for(std::size_t i = 0; i < QPIKRace::NumberOfSolvers; i++)
+                m_isQPIKSolverIdle[i] = m_QPIKRace->isIdle(i);
+
+        // the QP-IK is regularized around the posture evaluated by the look-ahead thread.
+        // If the posture is late the last one is held, so the reference does not jump back
+        // to the constant posture
+        if(m_lookAheadIK != nullptr)
+        {
+            if(m_lookAheadIK->getPosture(m_lookAheadPosture))
+                m_isLookAheadPostureValid = true;
+
+            const iDynTree::VectorDynSize& regularizationTerm =
+                m_isLookAheadPostureValid ? m_lookAheadPosture : m_QPIKRegularizationTerm;
+
+            bool isOSQPUpdated = m_QPIKRace == nullptr || m_isQPIKSolverIdle[OSQPRaceIndex];
+            bool isQPOASESUpdated = m_QPIKRace == nullptr || m_isQPIKSolverIdle[qpOASESRaceIndex];
+            if((isOSQPUpdated && !m_QPIKSolver_osqp->setDesiredJointPosition(regularizationTerm))
+               || (isQPOASESUpdated && !m_QPIKSolver_qpOASES->setDesiredJointPosition(regularizationTerm)))
             {
-                yError() << "[updateFKSolver] Unable to evaluate the CoM.";
+                yError() << "[tick] Unable to set the QP-IK regularization term.";
                 return false;
             }
+        }
 
-            if(m_useOSQP)
+        if(m_QPIKRace != nullptr)
+        {
+            if(!solveQPIKRace(desiredCoMPosition, desiredCoMVelocity, measuredCoM, yawRotation))
             {
-                if(!solveQPIK(m_QPIKSolver_osqp, desiredCoMPosition,
-                              desiredCoMVelocity, measuredCoM,
-                              yawRotation, m_dqDesired_osqp))
-                {
-                    yError() << "[updateModule] Unable to solve the QP problem with osqp.";
-                    return false;
-                }
-
-                iDynTree::toYarp(m_dqDesired_osqp, bufferVelocity);
+                yError() << "[tick] Unable to solve the QP problem with the race of the solvers.";
+                return false;
             }
-            else
+        }
+        else if(m_useOSQP)
+        {
+            if(!solveQPIK(m_QPIKSolver_osqp, desiredCoMPosition,
+                          desiredCoMVelocity, measuredCoM,
+                          yawRotation, m_dqDesired_osqp))
             {
-                if(!solveQPIK(m_QPIKSolver_qpOASES, desiredCoMPosition,
-                              desiredCoMVelocity, measuredCoM,
-                              yawRotation, m_dqDesired_qpOASES))
-                {
-                    yError() << "[updateModule] Unable to solve the QP problem with osqp.";
-                    return false;
-                }
-
-                iDynTree::toYarp(m_dqDesired_qpOASES, bufferVelocity);
+                yError() << "[tick] Unable to solve the QP problem with osqp.";
+                return false;
             }
 
+            if(m_solverStatisticsPublisher != nullptr)
+                m_QPIKSolver_osqp->getStatistics(m_solverStatistics.qpIK);
 
-            bufferPosition = m_velocityIntegral->integrate(bufferVelocity);
-            iDynTree::toiDynTree(bufferPosition, m_qDesired);
+            iDynTree::toYarp(m_dqDesired_osqp, m_bufferVelocity);
         }
         else
         {
-            if(m_robotState == WalkingFSM::OnTheFly)
+            if(!solveQPIK(m_QPIKSolver_qpOASES, desiredCoMPosition,
+                          desiredCoMVelocity, measuredCoM,
+                          yawRotation, m_dqDesired_qpOASES))
             {
-                iDynTree::VectorDynSize desiredJointInRad(m_actuatedDOFs);
-                m_jointsSmoother->computeNextValues(m_desiredJointInRadYarp);
-                iDynTree::toiDynTree(m_jointsSmoother->getPos(), desiredJointInRad);
-                if (!m_IKSolver->setDesiredJointConfiguration(desiredJointInRad))
-                {
-                    yError() << "[updateModule] Unable to set the desired Joint Configuration.";
-                    return false;
-                }
+                yError() << "[tick] Unable to solve the QP problem with osqp.";
+                return false;
             }
 
-            if(m_IKSolver->usingAdditionalRotationTarget())
-            {
+            m_profiler->setValue("QP-IK solver", m_QPIKSolver_qpOASES->getSolverTime() * 1000.0);
+            m_profiler->setValue("QP-IK nWSR",
+                                 m_QPIKSolver_qpOASES->getNumberOfWorkingSetRecalculations());
 
-                if(m_robotState == WalkingFSM::OnTheFly)
-                {
-                    m_additionalRotationWeightSmoother->computeNextValues(yarp::sig::Vector(1,
-                                                                                            m_additionalRotationWeightDesired));
-                    double rotationWeight = m_additionalRotationWeightSmoother->getPos()[0];
-                    if (!m_IKSolver->setAdditionalRotationWeight(rotationWeight))
-                    {
-                        yError() << "[updateModule] Unable to set the additional rotational weight.";
-                        return false;
-                    }
-
-                    m_desiredJointWeightSmoother->computeNextValues(yarp::sig::Vector(1, m_desiredJointsWeight));
-                    double jointWeight = m_desiredJointWeightSmoother->getPos()[0];
-                    if (!m_IKSolver->setDesiredJointsWeight(jointWeight))
-                    {
-                        yError() << "[updateModule] Unable to set the desired joint weight.";
-                        return false;
-                    }
-                }
+            if(m_solverStatisticsPublisher != nullptr)
+                m_QPIKSolver_qpOASES->getStatistics(m_solverStatistics.qpIK);
 
-                if(!m_IKSolver->updateIntertiaToWorldFrameRotation(modifiedInertial))
-                {
-                    yError() << "[updateModule] Error updating the inertia to world frame rotation.";
-                    return false;
-                }
+            iDynTree::toYarp(m_dqDesired_qpOASES, m_bufferVelocity);
+        }
 
-                if(!m_IKSolver->setFullModelFeedBack(m_positionFeedbackInRadians))
+
+        // trapezoidal rule evaluated in place, the joint position is the state of the integrator
+        iDynTree::toEigen(m_qDesired) += 0.5 * m_dT * (iDynTree::toEigen(m_bufferVelocity)
+                                                       + iDynTree::toEigen(m_previousBufferVelocity));
+        iDynTree::toEigen(m_previousBufferVelocity) = iDynTree::toEigen(m_bufferVelocity);
+    }
+    else
+    {
+        if(m_robotState == WalkingFSM::OnTheFly)
+        {
+            m_jointsSmoother->computeNextValues(m_desiredJointInRadYarp);
+            iDynTree::toiDynTree(m_jointsSmoother->getPos(), m_desiredJointInRad);
+            if (!m_IKSolver->setDesiredJointConfiguration(m_desiredJointInRad))
+            {
+                yError() << "[tick] Unable to set the desired Joint Configuration.";
+                return false;
+            }
+        }
+
+        if(m_IKSolver->usingAdditionalRotationTarget())
+        {
+
+            if(m_robotState == WalkingFSM::OnTheFly)
+            {
+                m_scalarBuffer(0) = m_additionalRotationWeightDesired;
+                m_additionalRotationWeightSmoother->computeNextValues(m_scalarBuffer);
+                double rotationWeight = m_additionalRotationWeightSmoother->getPos()[0];
+                if (!m_IKSolver->setAdditionalRotationWeight(rotationWeight))
                 {
-                    yError() << "[updateModule] Error while setting the feedback to the inverse Kinematics.";
+                    yError() << "[tick] Unable to set the additional rotational weight.";
                     return false;
                 }
 
-                if(!m_IKSolver->computeIK(m_leftTrajectory.front(), m_rightTrajectory.front(),
-                                          desiredCoMPosition, m_qDesired))
+                m_scalarBuffer(0) = m_desiredJointsWeight;
+                m_desiredJointWeightSmoother->computeNextValues(m_scalarBuffer);
+                double jointWeight = m_desiredJointWeightSmoother->getPos()[0];
+                if (!m_IKSolver->setDesiredJointsWeight(jointWeight))
                 {
-                    yError() << "[updateModule] Error during the inverse Kinematics iteration.";
+                    yError() << "[tick] Unable to set the desired joint weight.";
                     return false;
                 }
             }
-        }
-        m_profiler->setEndTime("IK");
 
-        if(m_useQPIK)
-        {
-            if(!setDirectPositionReferences(m_qDesired))
+            if(!m_IKSolver->updateIntertiaToWorldFrameRotation(modifiedInertial))
             {
-                yError() << "[updateModule] Error while setting the reference position to iCub.";
+                yError() << "[tick] Error updating the inertia to world frame rotation.";
                 return false;
             }
-        }
-        else
-        {
-            if(!setDirectPositionReferences(m_qDesired))
+
+            if(!m_IKSolver->setFullModelFeedBack(m_positionFeedbackInRadians))
             {
-                yError() << "[updateModule] Error while setting the reference position to iCub.";
+                yError() << "[tick] Error while setting the feedback to the inverse Kinematics.";
                 return false;
             }
-        }
 
-        m_profiler->setEndTime("Total");
-
-        // print timings
-        m_profiler->profiling();
-
-        iDynTree::VectorDynSize errorL(6), errorR(6);
-        if(m_robotState != WalkingFSM::OnTheFly && m_useQPIK)
-        {
-            if(m_useOSQP)
+            if(!m_IKSolver->computeIK(m_trajectory.getLeftFootTrajectory().front(),
+                                      m_trajectory.getRightFootTrajectory().front(),
+                                      desiredCoMPosition, m_qDesired))
             {
-                m_QPIKSolver_osqp->getRightFootError(errorR);
-                m_QPIKSolver_osqp->getLeftFootError(errorL);
+                yError() << "[tick] Error during the inverse Kinematics iteration.";
+                return false;
             }
-            else
+
+            if(m_solverStatisticsPublisher != nullptr)
             {
-                m_QPIKSolver_qpOASES->getRightFootError(errorR);
-                m_QPIKSolver_qpOASES->getLeftFootError(errorL);
+                m_solverStatistics.ikSolveTime = m_IKSolver->getSolverTime();
+                m_solverStatistics.ikConsecutiveFallbacks = m_IKSolver->getNumberOfConsecutiveFallbacks();
             }
         }
+    }
+    m_profiler->setEndTime("IK");
 
-        // send data to the WalkingLogger
-        if(m_dumpData)
+    // the references are sent to the plant when the controller is benchmarked
+    if(m_plant != nullptr)
+    {
+        if(!m_plant->setJointReferences(m_qDesired))
         {
-            auto leftFoot = m_FKSolver->getLeftFootToWorldTransform();
-            auto rightFoot = m_FKSolver->getRightFootToWorldTransform();
-            m_walkingLogger->sendData(measuredDCM, m_DCMPositionDesired.front(), m_DCMVelocityDesired.front(),
-                                      measuredZMP, desiredZMP, measuredCoM,
-                                      desiredCoMPositionXY, desiredCoMVelocityXY,
-                                      leftFoot.getPosition(), leftFoot.getRotation().asRPY(),
-                                      rightFoot.getPosition(), rightFoot.getRotation().asRPY(),
-                                      m_leftTrajectory.front().getPosition(), m_leftTrajectory.front().getRotation().asRPY(),
-                                      m_rightTrajectory.front().getPosition(), m_rightTrajectory.front().getRotation().asRPY(),
-                                      errorL, errorR);
-
-            // m_walkingLogger->sendData(m_dqDesired_osqp, m_dqDesired_qpOASES);
+            yError() << "[tick] Error while setting the reference position to the plant.";
+            return false;
         }
+        m_plant->setZMPReference(desiredZMP);
+        m_plant->step();
+    }
+    else if(!setDirectPositionReferences(m_qDesired))
+    {
+        yError() << "[tick] Error while setting the reference position to iCub.";
+        return false;
+    }
 
-        propagateTime();
+    m_profiler->setEndTime("Total");
 
-        if(m_robotState != WalkingFSM::OnTheFly)
-            // propagate all the signals
-            propagateReferenceSignals();
+    // print timings (the allocations of the profiler are not attributed to the controller)
+    std::size_t allocationsBeforeProfiling = AllocationCounter::getThreadAllocations();
+    m_profiler->profiling();
+    std::size_t allocationsAfterProfiling = AllocationCounter::getThreadAllocations();
 
-        if((m_robotState == WalkingFSM::OnTheFly) && (m_time > m_onTheFlySmoothingTime))
+    // the statistics are sent in background (one tick out of the decimation)
+    if(m_solverStatisticsPublisher != nullptr)
+    {
+        m_solverStatistics.time = m_time;
+        m_solverStatistics.tickDuration = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                                        - tickInitTime).count();
+        m_solverStatisticsPublisher->publish(m_solverStatistics);
+    }
+
+    m_leftFootError.zero();
+    m_rightFootError.zero();
+    if(m_robotState != WalkingFSM::OnTheFly && m_useQPIK)
+    {
+        if(m_QPIKRace != nullptr)
         {
-            // reset gains and desired joint position
-            iDynTree::VectorDynSize desiredJointInRad(m_actuatedDOFs);
-            iDynTree::toiDynTree(m_desiredJointInRadYarp, desiredJointInRad);
-            if (!m_IKSolver->setDesiredJointConfiguration(desiredJointInRad))
+            // the winner is not running until the next race
+            if(m_QPIKRaceWinner == OSQPRaceIndex)
             {
-                yError() << "[updateModule] Unable to set the desired Joint Configuration.";
-                return false;
+                m_QPIKSolver_osqp->getRightFootError(m_rightFootError);
+                m_QPIKSolver_osqp->getLeftFootError(m_leftFootError);
             }
-
-            if (!m_IKSolver->setAdditionalRotationWeight(m_additionalRotationWeightDesired))
+            else if(m_QPIKRaceWinner == qpOASESRaceIndex)
             {
-                yError() << "[updateModule] Unable to set the additional rotational weight.";
-                return false;
+                m_QPIKSolver_qpOASES->getRightFootError(m_rightFootError);
+                m_QPIKSolver_qpOASES->getLeftFootError(m_leftFootError);
             }
+        }
+        else if(m_useOSQP)
+        {
+            m_QPIKSolver_osqp->getRightFootError(m_rightFootError);
+            m_QPIKSolver_osqp->getLeftFootError(m_leftFootError);
+        }
+        else
+        {
+            m_QPIKSolver_qpOASES->getRightFootError(m_rightFootError);
+            m_QPIKSolver_qpOASES->getLeftFootError(m_leftFootError);
+        }
+    }
 
-            if (!m_IKSolver->setDesiredJointsWeight(m_desiredJointsWeight))
-            {
-                yError() << "[updateModule] Unable to set the desired joint weight.";
-                return false;
-            }
-            m_robotState = WalkingFSM::Stance;
-            m_firstStep = true;
+    // send data to the WalkingLogger
+    if(m_dumpData)
+    {
+        auto leftFoot = m_FKSolver->getLeftFootToWorldTransform();
+        auto rightFoot = m_FKSolver->getRightFootToWorldTransform();
+        const iDynTree::Transform& leftFootDesired = m_trajectory.getLeftFootTrajectory().front();
+        const iDynTree::Transform& rightFootDesired = m_trajectory.getRightFootTrajectory().front();
+        m_walkingLogger->sendData(measuredDCM, m_trajectory.getDCMPositionDesired().front(),
+                                  m_trajectory.getDCMVelocityDesired().front(),
+                                  measuredZMP, desiredZMP, measuredCoM,
+                                  desiredCoMPositionXY, desiredCoMVelocityXY,
+                                  leftFoot.getPosition(), leftFoot.getRotation().asRPY(),
+                                  rightFoot.getPosition(), rightFoot.getRotation().asRPY(),
+                                  leftFootDesired.getPosition(), leftFootDesired.getRotation().asRPY(),
+                                  rightFootDesired.getPosition(), rightFootDesired.getRotation().asRPY(),
+                                  m_leftFootError, m_rightFootError);
+
+        // m_walkingLogger->sendData(m_dqDesired_osqp, m_dqDesired_qpOASES);
+    }
+
+    // the sample is processed by the profiler in the next tick
+    if(AllocationCounter::isEnabled())
+        m_profiler->setValue("Allocations",
+                             (allocationsBeforeProfiling - allocationsAtTickStart)
+                             + (AllocationCounter::getThreadAllocations() - allocationsAfterProfiling));
+
+    return true;
+}
+
+bool WalkingModule::propagate()
+{
+    propagateTime();
+
+    if(m_robotState != WalkingFSM::OnTheFly)
+        // propagate all the signals
+        propagateReferenceSignals();
 
-            // reset time
-            m_time = 0.0;
+    if((m_robotState == WalkingFSM::OnTheFly) && (m_time > m_onTheFlySmoothingTime))
+    {
+        // reset gains and desired joint position
+        iDynTree::toiDynTree(m_desiredJointInRadYarp, m_desiredJointInRad);
+        if (!m_IKSolver->setDesiredJointConfiguration(m_desiredJointInRad))
+        {
+            yError() << "[propagate] Unable to set the desired Joint Configuration.";
+            return false;
+        }
+
+        if (!m_IKSolver->setAdditionalRotationWeight(m_additionalRotationWeightDesired))
+        {
+            yError() << "[propagate] Unable to set the additional rotational weight.";
+            return false;
+        }
 
-            yarp::sig::Vector buffer(m_qDesired.size());
-            iDynTree::toYarp(m_qDesired, buffer);
-            // instantiate Integrator object
-            m_velocityIntegral = std::make_unique<iCub::ctrl::Integrator>(m_dT, buffer);
+        if (!m_IKSolver->setDesiredJointsWeight(m_desiredJointsWeight))
+        {
+            yError() << "[propagate] Unable to set the desired joint weight.";
+            return false;
         }
-        else if(m_firstStep)
-            m_firstStep = false;
+        m_robotState = WalkingFSM::Stance;
+        m_firstStep = true;
 
+        // reset time
+        m_time = 0.0;
+
+        // the QP-IK output is integrated starting from the current desired position
+        m_previousBufferVelocity.zero();
     }
+    else if(m_firstStep)
+        m_firstStep = false;
+
     return true;
 }
 
-bool WalkingModule::getFeedbacks(unsigned int maxAttempts)
+bool WalkingModule::getFeedbacks(double maxWaitTime)
 {
-    if(!m_encodersInterface)
+    if(m_plant == nullptr && !m_encodersInterface)
     {
         yError() << "[getFeedbacks] Encoders I/F is not ready";
         return false;
@@ -1106,98 +1815,104 @@ bool WalkingModule::getFeedbacks(unsigned int maxAttempts)
     bool okLeftWrench = false;
     bool okRightWrench = false;
 
-    unsigned int attempt = 0;
+    auto deadline = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(maxWaitTime));
 
-    do
+    while(true)
     {
-        if(!okPosition)
-            okPosition = m_encodersInterface->getEncoders(m_positionFeedbackInDegrees.data());
-
-        if(!okVelocity)
-            okVelocity = m_encodersInterface->getEncoderSpeeds(m_velocityFeedbackInDegrees.data());
-
-        if(!okLeftWrench)
+        // the readings of the plant are always available. The wrenches depend on the desired
+        // feet, they are zero until the first trajectory is evaluated
+        if(m_plant != nullptr)
         {
-            yarp::sig::Vector *leftWrenchRaw = NULL;
-            leftWrenchRaw = m_leftWrenchPort.read(false);
-            if(leftWrenchRaw != NULL)
+            m_plant->getEncoders(m_positionFeedbackInDegrees, m_velocityFeedbackInDegrees);
+            if(m_trajectory.empty())
             {
-                m_leftWrenchInput = *leftWrenchRaw;
-                okLeftWrench = true;
+                m_leftWrenchInput.zero();
+                m_rightWrenchInput.zero();
             }
+            else
+                m_plant->getWrenches(m_trajectory.getLeftFootTrajectory().front(),
+                                     m_trajectory.getRightFootTrajectory().front(),
+                                     m_trajectory.getLeftInContact().front(),
+                                     m_trajectory.getRightInContact().front(),
+                                     m_leftWrenchInput, m_rightWrenchInput);
+            okPosition = okVelocity = okLeftWrench = okRightWrench = true;
         }
-
-        if(!okRightWrench)
+        // the acquisition thread reads the sensors, here only the last snapshot is taken
+        else if(m_sensorAcquisition != nullptr)
         {
-            yarp::sig::Vector *rightWrenchRaw = NULL;
-            rightWrenchRaw = m_rightWrenchPort.read(false);
-            if(rightWrenchRaw != NULL)
-            {
-                m_rightWrenchInput = *rightWrenchRaw;
-                okRightWrench = true;
-            }
+            readSensorSnapshot(okPosition, okLeftWrench, okRightWrench);
+            okVelocity = okPosition;
         }
-
-        if(okVelocity && okPosition && okLeftWrench && okRightWrench)
+        else
         {
-            if(m_useVelocityFilter)
+            if(!okPosition)
+                okPosition = m_encodersInterface->getEncoders(m_positionFeedbackInDegrees.data());
+
+            if(!okVelocity)
+                okVelocity = m_encodersInterface->getEncoderSpeeds(m_velocityFeedbackInDegrees.data());
+
+            if(!okLeftWrench)
             {
-                // filter the joint position and the velocity
-                m_velocityFeedbackInDegreesFiltered = m_velocityFilter->filt(m_velocityFeedbackInDegrees);
-                for(unsigned j = 0; j < m_actuatedDOFs; ++j)
+                yarp::sig::Vector *leftWrenchRaw = NULL;
+                leftWrenchRaw = m_leftWrenchPort.read(false);
+                if(leftWrenchRaw != NULL)
                 {
-                    m_positionFeedbackInRadians(j) = iDynTree::deg2rad(m_positionFeedbackInDegrees(j));
-                    m_velocityFeedbackInRadians(j) = iDynTree::deg2rad(m_velocityFeedbackInDegreesFiltered(j));
+                    m_leftWrenchInput = *leftWrenchRaw;
+                    okLeftWrench = true;
                 }
             }
-            else
+
+            if(!okRightWrench)
             {
-                for(unsigned j = 0; j < m_actuatedDOFs; ++j)
+                yarp::sig::Vector *rightWrenchRaw = NULL;
+                rightWrenchRaw = m_rightWrenchPort.read(false);
+                if(rightWrenchRaw != NULL)
                 {
-                    m_positionFeedbackInRadians(j) = iDynTree::deg2rad(m_positionFeedbackInDegrees(j));
-                    m_velocityFeedbackInRadians(j) = iDynTree::deg2rad(m_velocityFeedbackInDegrees(j));
+                    m_rightWrenchInput = *rightWrenchRaw;
+                    okRightWrench = true;
                 }
             }
-            if(m_useWrenchFilter)
-            {
-                if(m_firstStep)
-                {
-                    m_leftWrenchFilter->init(m_leftWrenchInput);
-                    m_rightWrenchFilter->init(m_rightWrenchInput);
-                }
-                m_leftWrenchInputFiltered = m_leftWrenchFilter->filt(m_leftWrenchInput);
-                m_rightWrenchInputFiltered = m_rightWrenchFilter->filt(m_rightWrenchInput);
+        }
 
-                if(!iDynTree::toiDynTree(m_leftWrenchInputFiltered, m_leftWrench))
-                {
-                    yError() << "[getFeedbacks] Unable to convert left foot wrench.";
-                    return false;
-                }
-                if(!iDynTree::toiDynTree(m_rightWrenchInputFiltered, m_rightWrench))
-                {
-                    yError() << "[getFeedbacks] Unable to convert right foot wrench.";
-                    return false;
-                }
+        if(okVelocity && okPosition && okLeftWrench && okRightWrench)
+        {
+            if(m_leftWrenchInput.size() != 6 || m_rightWrenchInput.size() != 6)
+            {
+                yError() << "[getFeedbacks] The size of the wrenches has to be 6.";
+                return false;
             }
-            else
+
+            if(m_useWrenchFilter && m_firstStep)
             {
-                if(!iDynTree::toiDynTree(m_leftWrenchInput, m_leftWrench))
-                {
-                    yError() << "[getFeedbacks] Unable to convert left foot wrench.";
-                    return false;
-                }
-                if(!iDynTree::toiDynTree(m_rightWrenchInput, m_rightWrench))
-                {
-                    yError() << "[getFeedbacks] Unable to convert right foot wrench.";
-                    return false;
-                }
+                m_feedbackFilters.init(m_leftForceGroup, m_leftWrenchInput.data());
+                m_feedbackFilters.init(m_leftTorqueGroup, m_leftWrenchInput.data() + 3);
+                m_feedbackFilters.init(m_rightForceGroup, m_rightWrenchInput.data());
+                m_feedbackFilters.init(m_rightTorqueGroup, m_rightWrenchInput.data() + 3);
             }
+
+            // convert and filter all the feedbacks in one pass, the results are written in
+            // m_positionFeedbackInRadians, m_velocityFeedbackInRadians and in the wrenches
+            m_feedbackFilters.setInput(m_jointPositionGroup, m_positionFeedbackInDegrees.data());
+            m_feedbackFilters.setInput(m_jointVelocityGroup, m_velocityFeedbackInDegrees.data());
+            m_feedbackFilters.setInput(m_leftForceGroup, m_leftWrenchInput.data());
+            m_feedbackFilters.setInput(m_leftTorqueGroup, m_leftWrenchInput.data() + 3);
+            m_feedbackFilters.setInput(m_rightForceGroup, m_rightWrenchInput.data());
+            m_feedbackFilters.setInput(m_rightTorqueGroup, m_rightWrenchInput.data() + 3);
+            m_feedbackFilters.process();
+
+            m_isFeedbackValid = true;
             return true;
         }
 
-        yarp::os::Time::delay(0.001);
-        attempt++;
-    } while(attempt < maxAttempts);
+        // the last attempt is done at the deadline
+        auto now = std::chrono::steady_clock::now();
+        if(now >= deadline)
+            break;
+
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(std::chrono::milliseconds(1),
+                                                                                  deadline - now));
+    }
 
     yInfo() << "[getFeedbacks] The following readings failed:";
     if(!okPosition)
@@ -1215,6 +1930,117 @@ bool WalkingModule::getFeedbacks(unsigned int maxAttempts)
     return false;
 }
 
+bool WalkingModule::getControlLoopFeedbacks(const std::chrono::steady_clock::time_point& tickInitTime)
+{
+    double elapsedTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - tickInitTime).count();
+    if(getFeedbacks(std::max(0.0, m_maxFeedbackWaitTime - elapsedTime)))
+    {
+        if(m_staleFeedbacks > 0)
+            yInfo() << "[getControlLoopFeedbacks] The feedback is available again after"
+                    << m_staleFeedbacks << "ticks.";
+        m_staleFeedbacks = 0;
+    }
+    else
+    {
+        if(!m_isFeedbackValid || m_staleFeedbacks >= m_maxStaleFeedbacks)
+        {
+            yError() << "[getControlLoopFeedbacks] The feedback is not available.";
+            return false;
+        }
+
+        // the quantities evaluated in the last valid tick are not changed, the filters are not
+        // updated since the new sample is missing
+        if(m_staleFeedbacks == 0)
+            yWarning() << "[getControlLoopFeedbacks] The feedback is not available, the last valid one is used.";
+        m_staleFeedbacks++;
+    }
+
+    m_profiler->setValue("Stale feedbacks", m_staleFeedbacks);
+    return true;
+}
+
+void WalkingModule::readSensorSnapshot(bool& okEncoders, bool& okLeftWrench, bool& okRightWrench)
+{
+    const SensorSnapshot& snapshot = m_sensorAcquisition->getLatestSnapshot();
+    double now = yarp::os::Time::now();
+
+    // the readings that are too old are discarded
+    okEncoders = snapshot.encodersTimeStamp >= 0
+        && now - snapshot.encodersTimeStamp <= m_maxFeedbackDelay;
+    okLeftWrench = snapshot.leftWrenchTimeStamp >= 0
+        && now - snapshot.leftWrenchTimeStamp <= m_maxFeedbackDelay;
+    okRightWrench = snapshot.rightWrenchTimeStamp >= 0
+        && now - snapshot.rightWrenchTimeStamp <= m_maxFeedbackDelay;
+
+    if(okEncoders)
+    {
+        m_positionFeedbackInDegrees = snapshot.positionInDegrees;
+        m_velocityFeedbackInDegrees = snapshot.velocityInDegrees;
+    }
+
+    if(okLeftWrench)
+        m_leftWrenchInput = snapshot.leftWrench;
+
+    if(okRightWrench)
+        m_rightWrenchInput = snapshot.rightWrench;
+
+    // the warning is printed only when the misalignment starts
+    if(okEncoders && okLeftWrench && okRightWrench)
+    {
+        bool isMisaligned =
+            std::fabs(snapshot.encodersTimeStamp - snapshot.leftWrenchTimeStamp) > m_maxFeedbackMisalignment
+            || std::fabs(snapshot.encodersTimeStamp - snapshot.rightWrenchTimeStamp) > m_maxFeedbackMisalignment;
+
+        if(isMisaligned && !m_isFeedbackMisaligned)
+            yWarning() << "[readSensorSnapshot] The time stamps of the encoders and of the wrenches differ more than"
+                       << m_maxFeedbackMisalignment << "seconds.";
+
+        m_isFeedbackMisaligned = isMisaligned;
+    }
+}
+
+bool WalkingModule::solveMPC(const iDynTree::Vector2& measuredDCM, bool resetTrajectory,
+                             iDynTree::Vector2& desiredZMP)
+{
+    if(!m_walkingController->setConvexHullConstraint(m_trajectory.getLeftFootTrajectory(),
+                                                     m_trajectory.getRightFootTrajectory(),
+                                                     m_trajectory.getLeftInContact(),
+                                                     m_trajectory.getRightInContact()))
+    {
+        yError() << "[solveMPC] unable to evaluate the convex hull.";
+        return false;
+    }
+
+    if(!m_walkingController->setFeedback(measuredDCM))
+    {
+        yError() << "[solveMPC] unable to set the feedback.";
+        return false;
+    }
+
+    if(!m_walkingController->setReferenceSignal(m_trajectory.getDCMPositionDesired(), resetTrajectory))
+    {
+        yError() << "[solveMPC] unable to set the reference Signal.";
+        return false;
+    }
+
+    if(!m_walkingController->solve())
+    {
+        yError() << "[solveMPC] Unable to solve the problem.";
+        return false;
+    }
+
+    if(!m_walkingController->getControllerOutput(desiredZMP))
+    {
+        yError() << "[solveMPC] Unable to get the MPC output.";
+        return false;
+    }
+
+    if(m_walkingController->isHorizonMarginChecked())
+        m_profiler->setValue("ZMP horizon margin", m_walkingController->getHorizonMargin() * 1000.0);
+
+    return true;
+}
+
 bool WalkingModule::evaluateZMP(iDynTree::Vector2& zmp)
 {
     if(m_FKSolver == nullptr)
@@ -1276,7 +2102,19 @@ bool WalkingModule::getWorstError(const iDynTree::VectorDynSize& desiredJointPos
         return false;
     }
 
-    if(!m_encodersInterface->getEncoders(m_positionFeedbackInDegrees.data()))
+    // if the acquisition thread is running the encoders are not read again
+    if(m_sensorAcquisition != nullptr)
+    {
+        const SensorSnapshot& snapshot = m_sensorAcquisition->getLatestSnapshot();
+        if(snapshot.encodersTimeStamp < 0
+           || yarp::os::Time::now() - snapshot.encodersTimeStamp > m_maxFeedbackDelay)
+        {
+            yError() << "[getWorstError] The encoders readings are too old.";
+            return false;
+        }
+        m_positionFeedbackInDegrees = snapshot.positionInDegrees;
+    }
+    else if(!m_encodersInterface->getEncoders(m_positionFeedbackInDegrees.data()))
     {
         yError() << "[getWorstError] Error reading encoders.";
         return false;
@@ -1523,7 +2361,7 @@ bool WalkingModule::prepareRobot(bool onTheFly)
     // get the current state of the robot
     // this is necessary because the trajectories for the joints, CoM height and neck orientation
     // depend on the current state of the robot
-    if(!getFeedbacks(10))
+    if(!getFeedbacks(0.01))
     {
         yError() << "[onTheFlyStartWalking] Unable to get the feedback.";
         return false;
@@ -1564,7 +2402,7 @@ bool WalkingModule::prepareRobot(bool onTheFly)
     }
 
     // reset the gains
-    if (m_PIDHandler->usingGainScheduling())
+    if (m_PIDHandler != nullptr && m_PIDHandler->usingGainScheduling())
     {
         if (!(m_PIDHandler->reset()))
             return false;
@@ -1580,15 +2418,15 @@ bool WalkingModule::prepareRobot(bool onTheFly)
     }
 
     iDynTree::Position desiredCoMPosition;
-    desiredCoMPosition(0) = m_DCMPositionDesired.front()(0);
-    desiredCoMPosition(1) = m_DCMPositionDesired.front()(1);
-    desiredCoMPosition(2) = m_comHeightTrajectory.front();
+    desiredCoMPosition(0) = m_trajectory.getDCMPositionDesired().front()(0);
+    desiredCoMPosition(1) = m_trajectory.getDCMPositionDesired().front()(1);
+    desiredCoMPosition(2) = m_trajectory.getCoMHeightTrajectory().front();
 
     if(m_IKSolver->usingAdditionalRotationTarget())
     {
         // get the yow angle of both feet
-        double yawLeft = m_leftTrajectory.front().getRotation().asRPY()(2);
-        double yawRight = m_rightTrajectory.front().getRotation().asRPY()(2);
+        double yawLeft = m_trajectory.getLeftFootTrajectory().front().getRotation().asRPY()(2);
+        double yawRight = m_trajectory.getRightFootTrajectory().front().getRotation().asRPY()(2);
 
         // evaluate the mean of the angles
         double meanYaw = std::atan2(std::sin(yawLeft) + std::sin(yawRight),
@@ -1608,54 +2446,149 @@ bool WalkingModule::prepareRobot(bool onTheFly)
         }
     }
 
-    if(!m_IKSolver->computeIK(m_leftTrajectory.front(), m_rightTrajectory.front(),
+    if(!m_IKSolver->computeIK(m_trajectory.getLeftFootTrajectory().front(),
+                              m_trajectory.getRightFootTrajectory().front(),
                               desiredCoMPosition, m_qDesired))
     {
         yError() << "[prepareRobot] Inverse Kinematics failed while computing the initial position.";
         return false;
     }
 
-    if(!setPositionReferences(m_qDesired, 5.0))
+    // the solvers are warmed up while the robot moves to the initial posture. Until the thread
+    // is joined the controllers and the QP-IK solvers are used only by warmUpSolvers, while the
+    // feedback and m_FKSolver are used only by setPositionReferences
+    bool isWarmedUp = false;
+    std::thread warmUpThread;
+    if(m_useSolversWarmUp)
+        warmUpThread = std::thread([&]{isWarmedUp = warmUpSolvers(desiredCoMPosition);});
+
+    // the plant reaches the initial configuration instantaneously
+    bool isPositioned = true;
+    if(m_plant != nullptr)
+        m_plant->reset(m_qDesired, m_trajectory.getDCMPositionDesired().front());
+    else
+        isPositioned = setPositionReferences(m_qDesired, 5.0);
+
+    if(warmUpThread.joinable())
+    {
+        warmUpThread.join();
+        if(!isWarmedUp)
+            yWarning() << "[prepareRobot] Unable to warm up the solvers. They will be initialized "
+                       << "by the first iterations of the controller.";
+    }
+
+    if(!isPositioned)
     {
         yError() << "[prepareRobot] Error while setting the initial position.";
         return false;
     }
 
-    if(m_useQPIK)
+    if(m_plant == nullptr)
     {
         if(!switchToControlMode(VOCAB_CM_POSITION_DIRECT))
         {
             yError() << "[prepareRobot] Failed in setting POSITION DIRECT mode.";
             return false;
         }
+
+        // send the reference again in order to reduce error
+        if(!setDirectPositionReferences(m_qDesired))
+        {
+            yError() << "[prepareRobot] Error while setting the initial position using "
+                     << "POSITION DIRECT mode.";
+            return false;
+        }
     }
-    else
+
+    // the QP-IK output is integrated starting from the initial position
+    m_previousBufferVelocity.zero();
+
+    // reset the models
+    m_walkingZMPController->reset(m_trajectory.getDCMPositionDesired().front());
+    m_stableDCMModel->reset(m_trajectory.getDCMPositionDesired().front());
+    if(m_controllerSupervisor != nullptr)
+        m_controllerSupervisor->reset();
+    m_isMPCReferenceResetPending = false;
+
+    m_robotState = WalkingFSM::Prepared;
+    return true;
+}
+
+bool WalkingModule::warmUpSolvers(const iDynTree::Position& desiredCoMPosition)
+{
+    if(m_useMPC)
     {
-        if(!switchToControlMode(VOCAB_CM_POSITION_DIRECT))
+        if(!m_walkingController->warmUp(m_trajectory.getLeftFootTrajectory(),
+                                        m_trajectory.getRightFootTrajectory(),
+                                        m_trajectory.getLeftInContact(),
+                                        m_trajectory.getRightInContact(),
+                                        m_trajectory.getDCMPositionDesired()))
         {
-            yError() << "[prepareRobot] Failed in setting POSITION DIRECT mode.";
+            yError() << "[warmUpSolvers] Unable to warm up the MPC controller.";
             return false;
         }
+
+        if(m_compareMPCFormulations
+           && !m_walkingControllerComparison->warmUp(m_trajectory.getLeftFootTrajectory(),
+                                                     m_trajectory.getRightFootTrajectory(),
+                                                     m_trajectory.getLeftInContact(),
+                                                     m_trajectory.getRightInContact(),
+                                                     m_trajectory.getDCMPositionDesired()))
+            yWarning() << "[warmUpSolvers] Unable to warm up the comparison MPC controller.";
     }
 
-    // send the reference again in order to reduce error
-    if(!setDirectPositionReferences(m_qDesired))
+    if(!m_useQPIK)
+        return true;
+
+    // the robot is still in the initial posture at the first iteration. The feedback and the
+    // kinematics of the controller are used by setPositionReferences, the problem is evaluated
+    // with a dedicated kinematics, joint positions and jacobians
+    iDynTree::VectorDynSize jointPositions = m_qDesired;
+    iDynTree::VectorDynSize jointVelocity(m_actuatedDOFs);
+    jointVelocity.zero();
+    if(!m_warmUpFKSolver->evaluateWorldToBaseTransformation(m_trajectory.getLeftFootTrajectory().front(),
+                                                            m_trajectory.getRightFootTrajectory().front(),
+                                                            m_trajectory.getIsLeftFixedFrame().front())
+       || !m_warmUpFKSolver->setDesiredRobotState(jointPositions, jointVelocity))
     {
-        yError() << "[prepareRobot] Error while setting the initial position using "
-                 << "POSITION DIRECT mode.";
+        yError() << "[warmUpSolvers] Unable to evaluate the initial posture.";
         return false;
     }
+    iDynTree::MatrixDynSize feetJacobian(6, m_actuatedDOFs + 6);
+    iDynTree::MatrixDynSize comJacobian(3, m_actuatedDOFs + 6);
 
-    yarp::sig::Vector buffer(m_qDesired.size());
-    iDynTree::toYarp(m_qDesired, buffer);
-    // instantiate Integrator object
-    m_velocityIntegral = std::make_unique<iCub::ctrl::Integrator>(m_dT, buffer);
+    iDynTree::Vector3 desiredCoMVelocity;
+    desiredCoMVelocity.zero();
+    desiredCoMVelocity(2) = m_trajectory.getCoMHeightVelocity().front();
 
-    // reset the models
-    m_walkingZMPController->reset(m_DCMPositionDesired.front());
-    m_stableDCMModel->reset(m_DCMPositionDesired.front());
+    double yawLeft = m_trajectory.getLeftFootTrajectory().front().getRotation().asRPY()(2);
+    double yawRight = m_trajectory.getRightFootTrajectory().front().getRotation().asRPY()(2);
+    double meanYaw = std::atan2(std::sin(yawLeft) + std::sin(yawRight),
+                                std::cos(yawLeft) + std::cos(yawRight));
+    iDynTree::Rotation yawRotation = iDynTree::Rotation::RotZ(meanYaw).inverse();
+
+    // the solutions are discarded, so the joint velocity of the first iteration is not affected
+    auto warmUp = [&](auto& solver)
+    {
+        return setQPIKProblem(solver, *m_warmUpFKSolver, jointPositions, feetJacobian,
+                              comJacobian, desiredCoMPosition, desiredCoMVelocity,
+                              desiredCoMPosition, yawRotation)
+            && solver->solve() && solver->getSolution(jointVelocity);
+    };
+
+    // both the solvers are used by the race
+    if((m_QPIKRace != nullptr || m_useOSQP) && !warmUp(m_QPIKSolver_osqp))
+    {
+        yError() << "[warmUpSolvers] Unable to warm up the QP-IK solver (osqp).";
+        return false;
+    }
+
+    if((m_QPIKRace != nullptr || !m_useOSQP) && !warmUp(m_QPIKSolver_qpOASES))
+    {
+        yError() << "[warmUpSolvers] Unable to warm up the QP-IK solver (qpOASES).";
+        return false;
+    }
 
-    m_robotState = WalkingFSM::Prepared;
     return true;
 }
 
@@ -1721,7 +2654,7 @@ bool WalkingModule::askNewTrajectories(const double& initTime, const bool& isLef
         return false;
     }
 
-    if(mergePoint >= m_DCMPositionDesired.size())
+    if(mergePoint >= m_trajectory.getDCMPositionDesired().size())
     {
         yError() << "[askNewTrajectories] The mergePoint has to be lower than the trajectory size.";
         return false;
@@ -1729,9 +2662,14 @@ bool WalkingModule::askNewTrajectories(const double& initTime, const bool& isLef
 
     yInfo() << "init Time before updateTrajectories " << initTime;
 
-    if(!m_trajectoryGenerator->updateTrajectories(initTime, m_DCMPositionDesired[mergePoint],
-                                                  m_DCMVelocityDesired[mergePoint], isLeftSwinging,
-                                                  measuredTransform, desiredPosition))
+    // the pose of the other foot is used only by the plan cache of the planner
+    const iDynTree::Transform& otherFootTransform = isLeftSwinging ?
+        m_trajectory.getRightFootTrajectory()[mergePoint] :
+        m_trajectory.getLeftFootTrajectory()[mergePoint];
+
+    if(!m_trajectoryGenerator->updateTrajectories(initTime, m_trajectory.getDCMPositionDesired()[mergePoint],
+                                                  m_trajectory.getDCMVelocityDesired()[mergePoint], isLeftSwinging,
+                                                  measuredTransform, desiredPosition, otherFootTransform))
     {
         yError() << "[askNewTrajectories] Unable to update the trajectory.";
         return false;
@@ -1739,64 +2677,113 @@ bool WalkingModule::askNewTrajectories(const double& initTime, const bool& isLef
     return true;
 }
 
-bool WalkingModule::updateTrajectories(const size_t& mergePoint)
+bool WalkingModule::askSpeculativeTrajectories()
 {
-    if(!(m_trajectoryGenerator->isTrajectoryComputed()))
+    // the candidates have to be evaluated before the merge point is reached
+    if(m_trajectory.getNumberOfMergePoints() == 0 || m_trajectory.getMergePoint(0) <= 2)
+        return true;
+
+    size_t mergePoint = m_trajectory.getMergePoint(0);
+    double initTime = m_time + mergePoint * m_dT;
+    if(std::abs(initTime - m_speculativeInitTime) < m_dT / 2)
+        return true;
+
+    iDynTree::Transform measuredTransform = m_trajectory.getIsLeftFixedFrame().front() ?
+        m_trajectory.getRightFootTrajectory()[mergePoint] :
+        m_trajectory.getLeftFootTrajectory()[mergePoint];
+
+    if(!m_trajectoryGenerator->updateSpeculativeTrajectories(initTime,
+                                                             m_trajectory.getDCMPositionDesired()[mergePoint],
+                                                             m_trajectory.getDCMVelocityDesired()[mergePoint],
+                                                             !m_trajectory.getIsLeftFixedFrame().front(),
+                                                             measuredTransform, m_desiredPosition))
     {
-        yError() << "[updateTrajectories] The trajectory is not computed.";
+        yError() << "[askSpeculativeTrajectories] Unable to update the speculative trajectories.";
         return false;
     }
 
-    std::vector<iDynTree::Transform> leftTrajectory;
-    std::vector<iDynTree::Transform> rightTrajectory;
-    std::vector<iDynTree::Twist> leftTwistTrajectory;
-    std::vector<iDynTree::Twist> rightTwistTrajectory;
-    std::vector<iDynTree::Vector2> DCMPositionDesired;
-    std::vector<iDynTree::Vector2> DCMVelocityDesired;
-    std::vector<bool> rightInContact;
-    std::vector<bool> leftInContact;
-    std::vector<double> comHeightTrajectory;
-    std::vector<double> comHeightVelocity;
-    std::vector<size_t> mergePoints;
-    std::vector<bool> isLeftFixedFrame;
+    m_speculativeInitTime = initTime;
+    return true;
+}
+
+size_t WalkingModule::evaluateMergeLead()
+{
+    if(!m_useAdaptiveMergeLead)
+        return 20;
 
-    // get dcm position and velocity
-    m_trajectoryGenerator->getDCMPositionTrajectory(DCMPositionDesired);
-    m_trajectoryGenerator->getDCMVelocityTrajectory(DCMVelocityDesired);
+    // if the latency is not measured yet the default lead is used
+    double latency;
+    if(!m_trajectoryGenerator->getPlannerLatency(m_plannerLatencyPercentile, latency))
+        return std::min(std::max(size_t(20), m_minMergeLead), m_maxMergeLead);
 
-    // get feet trajectories
-    m_trajectoryGenerator->getFeetTrajectories(leftTrajectory, rightTrajectory);
-    m_trajectoryGenerator->getFeetTwist(leftTwistTrajectory, rightTwistTrajectory);
-    m_trajectoryGenerator->getFeetStandingPeriods(leftInContact, rightInContact);
-    m_trajectoryGenerator->getWhenUseLeftAsFixed(isLeftFixedFrame);
+    // the trajectory is merged two samples before the merge counter is equal to zero
+    size_t lead = 2 + static_cast<size_t>(std::ceil(latency / m_dT)) + m_mergeLeadMargin;
+    return std::min(std::max(lead, m_minMergeLead), m_maxMergeLead);
+}
 
-    // get com height trajectory
-    m_trajectoryGenerator->getCoMHeightTrajectory(comHeightTrajectory);
-    m_trajectoryGenerator->getCoMHeightVelocity(comHeightVelocity);
+void WalkingModule::postponeNewTrajectory()
+{
+    // the trajectory evaluated for the missed merge point will be discarded. It is never merged,
+    // so the planner removes it from its internal state before the next request
+    m_isNewTrajectoryAsked = false;
+    m_newTrajectoryRequestCounter = evaluateMergeLead();
 
-    // get merge points
-    m_trajectoryGenerator->getMergePoints(mergePoints);
+    // look for the first merge point after the current one
+    for(size_t i = 0; i < m_trajectory.getNumberOfMergePoints(); i++)
+    {
+        if(m_trajectory.getMergePoint(i) > m_newTrajectoryMergeCounter)
+        {
+            m_newTrajectoryMergeCounter = m_trajectory.getMergePoint(i);
+            return;
+        }
+    }
 
-    // append vectors to deques
-    StdHelper::appendVectorToDeque(leftTrajectory, m_leftTrajectory, mergePoint);
-    StdHelper::appendVectorToDeque(rightTrajectory, m_rightTrajectory, mergePoint);
-    StdHelper::appendVectorToDeque(leftTwistTrajectory, m_leftTwistTrajectory, mergePoint);
-    StdHelper::appendVectorToDeque(rightTwistTrajectory, m_rightTwistTrajectory, mergePoint);
-    StdHelper::appendVectorToDeque(isLeftFixedFrame, m_isLeftFixedFrame, mergePoint);
+    // the new trajectory will be attached as soon as possible
+    m_newTrajectoryMergeCounter = m_newTrajectoryRequestCounter;
+}
 
-    StdHelper::appendVectorToDeque(DCMPositionDesired, m_DCMPositionDesired, mergePoint);
-    StdHelper::appendVectorToDeque(DCMVelocityDesired, m_DCMVelocityDesired, mergePoint);
+bool WalkingModule::updateTrajectories(const size_t& mergePoint)
+{
+    // the candidate of the speculative planners is already stored in m_plannedTrajectory
+    if(m_isSpeculativeTrajectoryAdopted)
+        m_isSpeculativeTrajectoryAdopted = false;
+    else
+    {
+        if(!(m_trajectoryGenerator->isTrajectoryComputed()))
+        {
+            yError() << "[updateTrajectories] The trajectory is not computed.";
+            return false;
+        }
 
-    StdHelper::appendVectorToDeque(leftInContact, m_leftInContact, mergePoint);
-    StdHelper::appendVectorToDeque(rightInContact, m_rightInContact, mergePoint);
+        // get the new trajectories. Only the pointers are swapped
+        if(!m_trajectoryGenerator->getPlannedTrajectory(m_plannedTrajectory))
+        {
+            yError() << "[updateTrajectories] Unable to get the planned trajectory.";
+            return false;
+        }
+    }
 
-    StdHelper::appendVectorToDeque(comHeightTrajectory, m_comHeightTrajectory, mergePoint);
-    StdHelper::appendVectorToDeque(comHeightVelocity, m_comHeightVelocity, mergePoint);
+    // merge the new trajectories. The memory of the buffer is swapped with the one of the planned
+    // trajectory and it will be returned to the planner at the next call
+    if(!m_trajectory.merge(*m_plannedTrajectory, mergePoint))
+    {
+        yError() << "[updateTrajectories] Unable to merge the new trajectory.";
+        return false;
+    }
 
-    m_mergePoints.assign(mergePoints.begin(), mergePoints.end());
+    // the merged trajectories are used to keep the internal state of the planner consistent
+    m_trajectoryGenerator->setTrajectoryMerged();
 
-    // the first merge point is always equal to 0
-    m_mergePoints.pop_front();
+    // the contact sequence changes only here, so the phases of the gain scheduling are evaluated once
+    if (m_PIDHandler != nullptr && m_PIDHandler->usingGainScheduling())
+    {
+        if (!m_PIDHandler->updateTimeline(m_trajectory.getLeftInContact(),
+                                          m_trajectory.getRightInContact()))
+        {
+            yError() << "[updateTrajectories] Unable to update the phases of the gain scheduling.";
+            return false;
+        }
+    }
 
     return true;
 }
@@ -1805,7 +2792,7 @@ bool WalkingModule::updateFKSolver()
 {
     // if(m_firstStep)
     // {
-    //     if(!m_FKSolver->evaluateFirstWorldToBaseTransformation(m_leftTrajectory.front()))
+    //     if(!m_FKSolver->evaluateFirstWorldToBaseTransformation(m_trajectory.getLeftFootTrajectory().front()))
     //     {
     //         yError() << "[updateFKSolver] Unable to evaluate the world to base transformation.";
     //         return false;
@@ -1813,16 +2800,16 @@ bool WalkingModule::updateFKSolver()
     // }
     // else
     // {
-    //     if(!m_FKSolver->evaluateWorldToBaseTransformation(m_isLeftFixedFrame.front()))
+    //     if(!m_FKSolver->evaluateWorldToBaseTransformation(m_trajectory.getIsLeftFixedFrame().front()))
     //     {
     //         yError() << "[updateFKSolver] Unable to evaluate the world to base transformation.";
     //         return false;
     //     }
     // }
 
-    if(!m_FKSolver->evaluateWorldToBaseTransformation(m_leftTrajectory.front(),
-                                                      m_rightTrajectory.front(),
-                                                      m_isLeftFixedFrame.front()))
+    if(!m_FKSolver->evaluateWorldToBaseTransformation(m_trajectory.getLeftFootTrajectory().front(),
+                                                      m_trajectory.getRightFootTrajectory().front(),
+                                                      m_trajectory.getIsLeftFixedFrame().front()))
     {
         yError() << "[updateFKSolver] Unable to evaluate the world to base transformation.";
         return false;
@@ -1891,7 +2878,7 @@ bool WalkingModule::evaluateDCM(iDynTree::Vector2& dcm)
 
 bool WalkingModule::startWalking()
 {
-    if(m_robotState != WalkingFSM::Prepared)
+    if(m_robotState != WalkingFSM::Prepared || m_isStartWalkingPending)
     {
         yError() << "[startWalking] Unable to start walking if the robot is not prepared.";
         return false;
@@ -1937,31 +2924,150 @@ bool WalkingModule::startWalking()
     //             "l_hip_pitch_qpOASES", "l_hip_roll_qpOASES", "l_hip_yaw_qpOASES", "l_knee_qpOASES", "l_ankle_pitch_qpOASES", "l_ankle_roll_qpOASES",
     //             "r_hip_pitch_qpOASES", "r_hip_roll_qpOASES", "r_hip_yaw_qpOASES", "r_knee_qpOASES", "r_ankle_pitch_qpOASES", "r_ankle_roll_qpOASES"});
     }
+
+    // the state is changed by the control loop at the beginning of the next tick
+    WalkingCommand command;
+    command.type = WalkingCommandType::StartWalking;
+    if(!postCommand(command))
     {
-        std::lock_guard<std::mutex> guard(m_mutex);
-        m_robotState = WalkingFSM::Stance;
-        m_firstStep = true;
+        yError() << "[startWalking] Unable to post the command.";
+        return false;
+    }
+    m_isStartWalkingPending = true;
+
+    return true;
+}
+
+bool WalkingModule::applyStartWalking()
+{
+    m_isStartWalkingPending = false;
+
+    if(m_robotState != WalkingFSM::Prepared)
+    {
+        yError() << "[applyStartWalking] Unable to start walking if the robot is not prepared.";
+        return false;
     }
 
+    if(m_lookAheadIK != nullptr)
+        m_lookAheadIK->reset();
+    m_isLookAheadPostureValid = false;
+
+    m_isSpeculativeTrajectoryAdopted = false;
+    m_speculativeInitTime = -1.0;
+    m_isNewTrajectoryAsked = false;
+
+    m_robotState = WalkingFSM::Stance;
+    m_firstStep = true;
+
     return true;
 }
 
+bool WalkingModule::postCommand(const WalkingCommand& command)
+{
+    // the mutex serializes the RPC handlers, the control loop pops the commands without locking
+    std::lock_guard<std::mutex> guard(m_commandsMutex);
+    return m_commands.push(command);
+}
+
+void WalkingModule::processCommands()
+{
+    WalkingCommand command;
+    while(m_commands.pop(command))
+    {
+        switch(command.type)
+        {
+        case WalkingCommandType::StartWalking:
+            if(!applyStartWalking())
+                yWarning() << "[processCommands] The start walking command has been discarded.";
+            break;
+
+        case WalkingCommandType::SetGoal:
+        {
+            // the goals set through the RPC port are not retried if they are deferred
+            bool isApplied;
+            if(!applyGoal(command.x, command.y, isApplied))
+                yWarning() << "[processCommands] The goal (" << command.x << command.y
+                           << ") has been discarded.";
+            break;
+        }
+        }
+    }
+}
+
+void WalkingModule::processStreamedGoal()
+{
+    if(!m_useGoalPort)
+        return;
+
+    // the samples received when the robot is not walking are discarded
+    yarp::sig::Vector* goal = m_goalPort.read(false);
+    if(m_robotState != WalkingFSM::Walking && m_robotState != WalkingFSM::Stance)
+    {
+        m_streamedGoal.clear();
+        return;
+    }
+
+    if(goal != nullptr)
+    {
+        if(goal->size() != 2)
+            yWarning() << "[processStreamedGoal] The goal is expected to contain two elements.";
+        else
+            m_streamedGoal.set((*goal)(0), (*goal)(1));
+    }
+
+    // the latest goal is retried at each tick until it is applied (it is deferred while the
+    // planner is evaluating the previous one)
+    auto apply = [&](double x, double y, bool& isApplied){return applyGoal(x, y, isApplied);};
+    if(!m_streamedGoal.apply(apply))
+        yWarning() << "[processStreamedGoal] The goal (" << m_streamedGoal.get()(0)
+                   << m_streamedGoal.get()(1) << ") has been discarded.";
+}
+
 bool WalkingModule::setGoal(double x, double y)
 {
-    std::lock_guard<std::mutex> guard(m_mutex);
+    // the goals received before the start walking command is applied are accepted as well
+    if(m_robotState != WalkingFSM::Walking && m_robotState != WalkingFSM::Stance
+       && !m_isStartWalkingPending)
+        return false;
+
+    WalkingCommand command;
+    command.type = WalkingCommandType::SetGoal;
+    command.x = x;
+    command.y = y;
+    if(!postCommand(command))
+    {
+        yError() << "[setGoal] Too many pending commands.";
+        return false;
+    }
+
+    return true;
+}
+
+bool WalkingModule::applyGoal(double x, double y, bool& isApplied)
+{
+    isApplied = false;
 
     if(m_robotState != WalkingFSM::Walking && m_robotState != WalkingFSM::Stance)
         return false;
 
     if(x == 0 && y == 0 && m_robotState == WalkingFSM::Stance)
+    {
+        isApplied = true;
         return true;
+    }
+
+    // the planner is already evaluating the new trajectory
+    if(m_newTrajectoryRequired && m_isNewTrajectoryAsked)
+        return true;
+
+    size_t mergeLead = evaluateMergeLead();
 
     // the trajectory was already finished the new trajectory will be attached as soon as possible
-    if(m_mergePoints.empty())
+    if(m_trajectory.getNumberOfMergePoints() == 0)
     {
-        if(!(m_leftInContact.front() && m_rightInContact.front()))
+        if(!(m_trajectory.getLeftInContact().front() && m_trajectory.getRightInContact().front()))
         {
-            yError() << "[setGoal] The trajectory has already finished but the system is not in double support.";
+            yError() << "[applyGoal] The trajectory has already finished but the system is not in double support.";
             return false;
         }
 
@@ -1969,27 +3075,48 @@ bool WalkingModule::setGoal(double x, double y)
               return true;
 
         // Since the evaluation of a new trajectory takes time the new trajectory will be merged after x cycles
-        m_newTrajectoryMergeCounter = 20;
+        m_newTrajectoryMergeCounter = mergeLead;
+        m_isSpeculativeTrajectoryAdopted = false;
     }
 
     // the trajectory was not finished the new trajectory will be attached at the next merge point
     else
     {
-        if(m_mergePoints.front() > 20)
-            m_newTrajectoryMergeCounter = m_mergePoints.front();
-        else if(m_mergePoints.size() > 1)
+        // if a candidate trajectory evaluated for the next merge point is close to the goal it is
+        // merged without waiting for the planner (the stop command is always planned). Once it is
+        // merged the main planner evaluates it again to keep its internal state aligned
+        iDynTree::Vector2 goal;
+        goal(0) = x;
+        goal(1) = y;
+        if(!m_newTrajectoryRequired && m_robotState == WalkingFSM::Walking && !(x == 0 && y == 0)
+           && m_trajectory.getMergePoint(0) > 2
+           && m_trajectoryGenerator->isSpeculativePlanningEnabled()
+           && m_trajectoryGenerator->getSpeculativeTrajectory(m_time + m_trajectory.getMergePoint(0) * m_dT,
+                                                              goal, m_plannedTrajectory))
+        {
+            m_newTrajectoryMergeCounter = m_trajectory.getMergePoint(0);
+            m_isSpeculativeTrajectoryAdopted = true;
+        }
+        else if(m_trajectory.getMergePoint(0) > mergeLead)
+        {
+            m_newTrajectoryMergeCounter = m_trajectory.getMergePoint(0);
+            m_isSpeculativeTrajectoryAdopted = false;
+        }
+        else if(m_trajectory.getNumberOfMergePoints() > 1)
         {
             if(m_newTrajectoryRequired)
                 return true;
 
-            m_newTrajectoryMergeCounter = m_mergePoints[1];
+            m_newTrajectoryMergeCounter = m_trajectory.getMergePoint(1);
+            m_isSpeculativeTrajectoryAdopted = false;
         }
         else
         {
             if(m_newTrajectoryRequired)
                 return true;
 
-            m_newTrajectoryMergeCounter = 20;
+            m_newTrajectoryMergeCounter = mergeLead;
+            m_isSpeculativeTrajectoryAdopted = false;
         }
     }
 
@@ -2007,8 +3134,11 @@ bool WalkingModule::setGoal(double x, double y)
     m_desiredPosition(0) = x;
     m_desiredPosition(1) = y;
 
+    m_newTrajectoryRequestCounter = mergeLead;
+    m_isNewTrajectoryAsked = false;
     m_newTrajectoryRequired = true;
 
+    isApplied = true;
     return true;
 }
 
@@ -2037,7 +3167,7 @@ bool WalkingModule::onTheFlyStartWalking(const double smoothingTime)
     // get the current state of the robot
     // this is necessary because the trajectories for the joints, CoM height and neck orientation
     // depend on the current state of the robot
-    if(!getFeedbacks(10))
+    if(!getFeedbacks(0.01))
     {
         yError() << "[onTheFlyStartWalking] Unable to get the feedback.";
         return false;
@@ -2119,11 +3249,14 @@ bool WalkingModule::onTheFlyStartWalking(const double smoothingTime)
     buff(1) = measuredCoM(1);
     m_walkingZMPController->reset(buff);
     m_stableDCMModel->reset(buff);
+    if(m_controllerSupervisor != nullptr)
+        m_controllerSupervisor->reset();
+    m_isMPCReferenceResetPending = false;
     // todo
     // yInfo() << measuredCoM(0) << " "<<measuredCoM(1) << " "<<measuredCoM(2);
 
     // reset the gains
-    if (m_PIDHandler->usingGainScheduling())
+    if (m_PIDHandler != nullptr && m_PIDHandler->usingGainScheduling())
     {
         if (!(m_PIDHandler->reset()))
             return false;
@@ -2157,3 +3290,12 @@ bool WalkingModule::onTheFlyStartWalking(const double smoothingTime)
 
     return true;
 }
+
+std::string WalkingModule::getProfilingInfo()
+{
+    if(m_profiler == nullptr)
+        return "The profiler is not initialized.";
+
+    // the statistics are published by the control loop at the end of each window
+    return m_profiler->getPublishedStatisticsDescription();
+}
@@ -11,6 +11,7 @@
  */
 
 #include "WalkingPIDHandler.hpp"
+#include "RealTimeThread.hpp"
 
 #include <yarp/dev/PolyDriver.h>
 #include <yarp/dev/IPidControl.h>
@@ -26,6 +27,9 @@
 WalkingPIDHandler::WalkingPIDHandler()
     :m_useGainScheduling(false)
     ,m_pidInterface(nullptr)
+    ,m_timelineHorizon(0)
+    ,m_timelineTick(0)
+    ,m_timelineCursor(0)
     ,m_phaseInitTime(0.0)
     ,m_previousPhase(PIDPhase::Default)
     ,m_currentPIDIndex(-1) //DEFAULT
@@ -223,58 +227,34 @@ bool WalkingPIDHandler::fromStringToPIDPhase(const std::string &input, PIDPhase
     return true;
 }
 
-bool WalkingPIDHandler::guessPhases(const std::deque<bool> &leftIsFixed, const std::deque<bool> &rightIsFixed)
+bool WalkingPIDHandler::guessPhase(bool leftIsFixed, bool rightIsFixed, PIDPhase &phase)
 {
-    if (leftIsFixed.size() != rightIsFixed.size()){
-        yError() << "Incongruous dimension of the leftIsFixed and rightIsFixed vectors.";
+    if (leftIsFixed && rightIsFixed){
+        phase = PIDPhase::Switch;
+    } else if (leftIsFixed) {
+        phase = PIDPhase::SwingRight;
+    } else if (rightIsFixed) {
+        phase = PIDPhase::SwingLeft;
+    } else {
+        yError() << "Unrecognized phase.";
         return false;
     }
-
-    if (m_phases.size() != leftIsFixed.size())
-        m_phases.resize(leftIsFixed.size());
-
-    for (size_t instant = 0; instant < leftIsFixed.size(); ++instant){
-        if (leftIsFixed[instant] && rightIsFixed[instant]){
-            m_phases[instant] = PIDPhase::Switch;
-        } else if (leftIsFixed[instant]) {
-            m_phases[instant] = PIDPhase::SwingRight;
-        } else if (rightIsFixed[instant]) {
-            m_phases[instant] = PIDPhase::SwingLeft;
-        } else {
-            yError() << "Unrecognized phase.";
-            return false;
-        }
-    }
     return true;
 }
 
 void WalkingPIDHandler::setPIDThread()
 {
-    double smoothingTime = 1.0;
     std::string name;
-    PIDmap oldPIDs, desiredPIDs, defaultPIDs;
-    bool previousWasDefault = false;
-    AxisMap axisMap;
+    int previousIndex, desiredIndex;
 
     while (m_useGainScheduling){
         {
             std::unique_lock<std::mutex> lock(m_mutex);
             m_conditionVariable.wait(lock, [&]{return (((m_desiredPIDIndex != -1) && (m_desiredPIDIndex != m_currentPIDIndex)) || !m_useGainScheduling);});
             if (m_useGainScheduling){
-
-                if (m_currentPIDIndex == -1){
-                    previousWasDefault = true;
-                    oldPIDs = m_defaultPID;
-                } else {
-                    oldPIDs = m_PIDs[static_cast<size_t>(m_currentPIDIndex)].getDesiredGains();
-                    previousWasDefault = false;
-                }
-
+                previousIndex = m_currentPIDIndex;
                 m_currentPIDIndex = m_desiredPIDIndex;
-                defaultPIDs = m_defaultPID;
-                axisMap = m_axisMap;
-                smoothingTime = m_PIDs[static_cast<size_t>(m_desiredPIDIndex)].smoothingTime();
-                desiredPIDs = m_PIDs[static_cast<size_t>(m_desiredPIDIndex)].getDesiredGains();
+                desiredIndex = m_desiredPIDIndex;
                 name = m_PIDs[static_cast<size_t>(m_desiredPIDIndex)].name();
 
                 yInfo() << "Inserting " << name << " PID group.";
@@ -283,14 +263,9 @@ void WalkingPIDHandler::setPIDThread()
         if (!m_useGainScheduling)
             break;
 
-        if (previousWasDefault){
-            if (!setPID(desiredPIDs, axisMap, smoothingTime)){
-                yError() << "Unable to set the PIDs for group " << name;
-            }
-        } else {
-            if (!setAndRestorePIDs(desiredPIDs, oldPIDs, defaultPIDs, axisMap, smoothingTime)){
-                yError() << "Unable to set the PIDs for group " << name;
-            }
+        // the gains and the changed axes are computed in initialize and never modified afterwards
+        if (!setPIDTransition(previousIndex, desiredIndex)){
+            yError() << "Unable to set the PIDs for group " << name;
         }
     }
 }
@@ -497,59 +472,160 @@ bool WalkingPIDHandler::setPID(const PIDmap &pidMap)
     return true;
 }
 
-bool WalkingPIDHandler::setPID(const PIDmap &pidMap, const AxisMap &axisMap, double smoothingTime)
+static bool samePID(const yarp::dev::Pid &first, const yarp::dev::Pid &second)
 {
-    //For the time being we use a common smoothingTime
+    return (first.kp == second.kp) && (first.kd == second.kd) && (first.ki == second.ki) &&
+           (first.max_int == second.max_int) && (first.scale == second.scale) &&
+           (first.max_output == second.max_output) && (first.offset == second.offset) &&
+           (first.stiction_up_val == second.stiction_up_val) &&
+           (first.stiction_down_val == second.stiction_down_val) && (first.kff == second.kff);
+}
 
-    if (pidMap.empty()) {
-        return true;
+bool WalkingPIDHandler::computeGroupTransitions()
+{
+    if (m_axisMap.empty()) {
+        yError("Empty axis map. Cannot compute the PID transitions.");
+        return false;
     }
 
-    if (axisMap.empty()) {
-        yError("Empty axis map. Cannot setPIDs.");
+    // the first element refers to the DEFAULT group, which contains all the axes
+    std::vector<yarp::dev::Pid> defaultGains(m_axisMap.size());
+    for (AxisMap::const_iterator axis = m_axisMap.cbegin(); axis != m_axisMap.cend(); ++axis) {
+        PIDmap::const_iterator defaultPID = m_defaultPID.find(axis->first);
+        if (defaultPID == m_defaultPID.cend()) {
+            yError() << "Unable to find the default PID for joint " << axis->first;
+            return false;
+        }
+        defaultGains[static_cast<size_t>(axis->second)] = defaultPID->second;
+    }
+
+    m_groupGains.assign(m_PIDs.size() + 1, defaultGains);
+    for (size_t group = 0; group < m_PIDs.size(); ++group) {
+        const PIDmap &desiredGains = m_PIDs[group].getDesiredGains();
+        for (PIDmap::const_iterator pid = desiredGains.cbegin(); pid != desiredGains.cend(); ++pid){
+            AxisMap::const_iterator axis = m_axisMap.find(pid->first);
+
+            if (axis != m_axisMap.cend())
+                m_groupGains[group + 1][static_cast<size_t>(axis->second)] = pid->second;
+        }
+    }
+
+    return true;
+}
+
+bool WalkingPIDHandler::openPIDControlBoards()
+{
+    if (!(m_remoteControlBoards.get(0).isList())){
+        yError() << "The remoteControlBoards variable does not contain any list.";
         return false;
     }
 
-    for (PIDmap::const_iterator pid = pidMap.cbegin(); pid != pidMap.cend(); ++pid){
-        AxisMap::const_iterator axis = axisMap.find(pid->first);
+    yarp::os::Bottle &remoteControlBoardsList = *(m_remoteControlBoards.get(0).asList());
 
-        if (axis != axisMap.cend()){
-            if (!m_pidInterface->setPid(yarp::dev::VOCAB_PIDTYPE_POSITION, axis->second, pid->second)) {
-                yError() << "Error while setting the PID on " << axis->first;
+    m_controlBoards.clear();
+    m_controlBoards.resize(static_cast<size_t>(remoteControlBoardsList.size()));
+
+    for (int rcb = 0; rcb < remoteControlBoardsList.size(); ++rcb) {
+        PIDControlBoard &board = m_controlBoards[static_cast<size_t>(rcb)];
+        std::string remoteName = remoteControlBoardsList.get(rcb).asString();
+
+        yarp::os::Property options;
+        options.put("local", "/pidHandler/gains" + remoteName);
+        options.put("device", "remote_controlboard");
+        options.put("remote", remoteName);
+
+        board.driver = std::make_unique<yarp::dev::PolyDriver>();
+        if (!board.driver->open(options)) {
+            yError() << "Error while opening " << remoteName << " control board.";
+            return false;
+        }
+
+        yarp::dev::IAxisInfo *axisInfo;
+        yarp::dev::IEncodersTimed *encoders;
+        if (!board.driver->view(board.pidInterface) || !board.pidInterface
+            || !board.driver->view(axisInfo) || !axisInfo
+            || !board.driver->view(encoders) || !encoders) {
+            yError() << "Cannot obtain the PID, axis info and encoders interfaces in control board " << remoteName;
+            return false;
+        }
+
+        int axes;
+        if (!encoders->getAxes(&axes)) {
+            yError() << "Error while retrieving the number of axes of control board " << remoteName;
+            return false;
+        }
+
+        // the axes not controlled by the walking keep the gains they have
+        std::vector<yarp::dev::Pid> boardGains(static_cast<size_t>(axes));
+        if (!board.pidInterface->getPids(yarp::dev::VOCAB_PIDTYPE_POSITION, boardGains.data())) {
+            yError() << "Error while retrieving the PIDs of control board " << remoteName;
+            return false;
+        }
+
+        board.groupGains.assign(m_groupGains.size(), boardGains);
+        for (int ax = 0; ax < axes; ++ax) {
+            yarp::os::ConstString yarpAxisName;
+            if (!axisInfo->getAxisName(ax, yarpAxisName)) {
+                yError() << "Error while retrieving the name of axis " << ax << " of control board " << remoteName;
                 return false;
             }
+
+            AxisMap::const_iterator axis = m_axisMap.find(yarpAxisName.c_str());
+            if (axis == m_axisMap.cend())
+                continue;
+
+            for (size_t group = 0; group < m_groupGains.size(); ++group)
+                board.groupGains[group][static_cast<size_t>(ax)] = m_groupGains[group][static_cast<size_t>(axis->second)];
+        }
+
+        board.changedAxes.assign(m_groupGains.size(), std::vector<std::vector<int>>(m_groupGains.size()));
+        for (size_t from = 0; from < m_groupGains.size(); ++from) {
+            for (size_t to = 0; to < m_groupGains.size(); ++to) {
+                for (size_t ax = 0; ax < static_cast<size_t>(axes); ++ax) {
+                    if (!samePID(board.groupGains[from][ax], board.groupGains[to][ax]))
+                        board.changedAxes[from][to].push_back(static_cast<int>(ax));
+                }
+            }
         }
     }
     return true;
 }
 
-bool WalkingPIDHandler::setAndRestorePIDs(const PIDmap &newPIDmap, const PIDmap &oldPIDmap, const PIDmap &defaultPIDmap, const AxisMap &axisMap, double smoothingTime)
+bool WalkingPIDHandler::setPIDTransition(int currentPIDIndex, int desiredPIDIndex)
 {
     //For the time being we use a common smoothingTime
 
-    if (!setPID(newPIDmap, axisMap, smoothingTime)){
-        yError() << "Failed in setting new PIDs";
+    size_t from = static_cast<size_t>(currentPIDIndex + 1);
+    size_t to = static_cast<size_t>(desiredPIDIndex + 1);
+
+    if ((from >= m_groupGains.size()) || (to >= m_groupGains.size())) {
+        yError() << "Unknown PID group.";
         return false;
     }
 
-    for (PIDmap::const_iterator oldPID = oldPIDmap.cbegin(); oldPID != oldPIDmap.cend(); ++oldPID){
-        PIDmap::const_iterator newPID = newPIDmap.find(oldPID->first);
-        if (newPID == newPIDmap.cend()) {
-            PIDmap::const_iterator defaultPID = defaultPIDmap.find(oldPID->first);
+    // one request for each control board whose gains change. If several axes of the same board
+    // change a single multi-joint call is used (the unchanged axes receive the gains they
+    // already have)
+    for (size_t rcb = 0; rcb < m_controlBoards.size(); ++rcb) {
+        PIDControlBoard &board = m_controlBoards[rcb];
+        const std::vector<int> &changedAxes = board.changedAxes[from][to];
+        const std::vector<yarp::dev::Pid> &desiredGains = board.groupGains[to];
 
-            if (defaultPID != defaultPIDmap.cend()){
-                AxisMap::const_iterator axis = axisMap.find(oldPID->first);
+        if (changedAxes.empty())
+            continue;
 
-                if (axis != axisMap.cend()){
-                    if (!m_pidInterface->setPid(yarp::dev::VOCAB_PIDTYPE_POSITION, axis->second, defaultPID->second)) {
-                        yError() << "Error while setting the default PID on " << axis->first;
-                        return false;
-                    }
-                }
-            } else {
-                yError() << "Unable to restore the default PID for joint " << oldPID->first;
+        if (changedAxes.size() == 1) {
+            if (!board.pidInterface->setPid(yarp::dev::VOCAB_PIDTYPE_POSITION, changedAxes.front(),
+                                            desiredGains[static_cast<size_t>(changedAxes.front())])) {
+                yError() << "Error while setting the PID on axis " << changedAxes.front() << " of control board " << rcb;
                 return false;
             }
+            continue;
+        }
+
+        if (!board.pidInterface->setPids(yarp::dev::VOCAB_PIDTYPE_POSITION, desiredGains.data())) {
+            yError() << "Error while setting the PIDs of control board " << rcb;
+            return false;
         }
     }
     return true;
@@ -620,6 +696,11 @@ bool WalkingPIDHandler::initialize(const yarp::os::Bottle &PIDSettings, yarp::de
             return false;
         }
 
+        if (!computeGroupTransitions()){
+            yError() << "Failed in computing the PID group transitions.";
+            return false;
+        }
+
         if (!(setPID(m_defaultPID))){
             yError("Error while setting the desired PIDs.");
         } else{
@@ -633,6 +714,10 @@ bool WalkingPIDHandler::initialize(const yarp::os::Bottle &PIDSettings, yarp::de
               } else */if (!setGeneralSmoothingTime(m_smoothingTime)) {
                 yError() << "Error while setting the default smoothing time. Deactivating gain scheduling.";
                 m_useGainScheduling = false;
+            } else if (!openPIDControlBoards()) {
+                yError() << "Error while opening the control boards used by the gain scheduling. Deactivating gain scheduling.";
+                m_controlBoards.clear();
+                m_useGainScheduling = false;
             } else {
                 m_handlerThread = std::thread(&WalkingPIDHandler::setPIDThread, this);
             }
@@ -666,47 +751,93 @@ bool WalkingPIDHandler::restorePIDs()
 
 bool WalkingPIDHandler::usingGainScheduling()
 {
-    std::lock_guard<std::mutex> guard(m_mutex);
-
     return m_useGainScheduling;
 }
 
-bool WalkingPIDHandler::updatePhases(const std::deque<bool> &leftIsFixed, const std::deque<bool> &rightIsFixed, double time)
+bool WalkingPIDHandler::updateTimeline(const TrajectoryView<bool> &leftIsFixed, const TrajectoryView<bool> &rightIsFixed)
 {
-    std::lock_guard<std::mutex> guard(m_mutex);
+    if (leftIsFixed.size() != rightIsFixed.size()){
+        yError() << "Incongruous dimension of the leftIsFixed and rightIsFixed vectors.";
+        return false;
+    }
+
+    if (leftIsFixed.empty()){
+        yError() << "Empty contact vectors.";
+        return false;
+    }
+
+    // the samples after the contiguous ones repeat the last one, so they do not add transitions
+    m_timeline.clear();
+    PIDPhase phase;
+    for (size_t instant = 0; instant < leftIsFixed.contiguousSize(); ++instant){
+        if (!guessPhase(leftIsFixed[instant], rightIsFixed[instant], phase))
+            return false;
 
-    if (!guessPhases(leftIsFixed, rightIsFixed))
+        if (m_timeline.empty() || (m_timeline.back().phase != phase))
+            m_timeline.push_back({instant, phase});
+    }
+
+    m_timelineHorizon = leftIsFixed.size();
+    m_timelineTick = 0;
+    m_timelineCursor = 0;
+
+    m_nextActivation.assign(m_PIDs.size(), 0);
+    m_activePIDs.reserve(m_PIDs.size());
+
+    return true;
+}
+
+bool WalkingPIDHandler::updatePhases(double time)
+{
+    if (m_timeline.empty()){
+        yError() << "The phase timeline has not been computed.";
         return false;
+    }
 
-    if (m_phases.front() != m_previousPhase){
+    while ((m_timelineCursor + 1 < m_timeline.size()) && (m_timeline[m_timelineCursor + 1].sample <= m_timelineTick))
+        ++m_timelineCursor;
+
+    const PIDPhase &currentPhase = m_timeline[m_timelineCursor].phase;
+    if (currentPhase != m_previousPhase){
         m_phaseInitTime = time;
-        m_previousPhase = m_phases.front();
+        m_previousPhase = currentPhase;
     }
 
-    std::vector<size_t> desiredPIDs;
+    m_activePIDs.clear();
     for (size_t pid = 0; pid < m_PIDs.size(); ++pid){
-        if (!m_PIDs[pid].computeInitTime(time, m_phases, m_phaseInitTime))
+        // the cursor of each group only moves forward, hence the cost is constant on average
+        size_t &next = m_nextActivation[pid];
+        while ((next < m_timeline.size()) && ((m_timeline[next].sample <= m_timelineTick) ||
+                                              (m_timeline[next].phase != m_PIDs[pid].activationPhase())))
+            ++next;
+
+        size_t samplesToActivation = next < m_timeline.size() ? m_timeline[next].sample - m_timelineTick : m_timelineHorizon;
+
+        if (!m_PIDs[pid].computeInitTime(time, currentPhase, m_phaseInitTime, samplesToActivation))
             return false;
 
         if (m_PIDs[pid].initTime() <= (time + m_firmwareDelay)){
-            desiredPIDs.push_back(pid);
+            m_activePIDs.push_back(pid);
         }
     }
+    ++m_timelineTick;
 
-    if (desiredPIDs.size() > 1){
+    if (m_activePIDs.size() > 1){
         std::ostringstream message;
         message << "The following PID groups would be activated at the same time: ";
-        for (size_t pid = 0; pid < desiredPIDs.size()-1; ++pid)
-            message << m_PIDs[desiredPIDs[pid]].name() << ", ";
-        message << m_PIDs[desiredPIDs.back()].name() << ".";
+        for (size_t pid = 0; pid < m_activePIDs.size()-1; ++pid)
+            message << m_PIDs[m_activePIDs[pid]].name() << ", ";
+        message << m_PIDs[m_activePIDs.back()].name() << ".";
         message << "Only the first will be set to the robot.";
         yWarning("%s", message.str().c_str());
     }
 
-    if (desiredPIDs.size() > 0)
-        m_desiredPIDIndex = static_cast<int>(desiredPIDs[0]);
-
-    m_conditionVariable.notify_one();
+    // m_desiredPIDIndex is written only by this thread, so the lock is taken only when it changes
+    if ((m_activePIDs.size() > 0) && (m_desiredPIDIndex != static_cast<int>(m_activePIDs[0]))){
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_desiredPIDIndex = static_cast<int>(m_activePIDs[0]);
+        m_conditionVariable.notify_one();
+    }
 
     return true;
 }
@@ -728,6 +859,14 @@ bool WalkingPIDHandler::reset()
     return true;
 }
 
+bool WalkingPIDHandler::setThreadAffinity(const std::vector<int> &cores)
+{
+    if (!m_handlerThread.joinable())
+        return true;
+
+    return RealTimeHelper::setThreadAffinity(m_handlerThread, cores);
+}
+
 PIDSchedulingObject::PIDSchedulingObject(const std::string &name, const PIDPhase &activationPhase, double activationOffset, const PIDmap &desiredPIDs)
     :m_name(name)
     ,m_desiredPIDs(desiredPIDs)
@@ -765,28 +904,24 @@ const PIDmap &PIDSchedulingObject::getDesiredGains()
     return m_desiredPIDs;
 }
 
-bool PIDSchedulingObject::computeInitTime(double time, const std::vector<PIDPhase> &phases, double currentPhaseInitTime)
+const PIDPhase &PIDSchedulingObject::activationPhase() const
+{
+    return m_activationPhase;
+}
+
+bool PIDSchedulingObject::computeInitTime(double time, const PIDPhase &currentPhase, double currentPhaseInitTime, size_t samplesToActivation)
 {
     if (currentPhaseInitTime > time){
         yError() << "The initial time of the current phase cannot be greater than the current time.";
         return false;
     }
 
-    if (phases.size() == 0){
-        yError() << "Empty phase vector.";
-        return false;
-    }
-
-    if (phases.front() == m_activationPhase){
+    if (currentPhase == m_activationPhase){
         m_computedInitTime = currentPhaseInitTime + m_activationOffset;
         return true;
     }
 
-    size_t k = 0;
-    while ((k < phases.size()) && (phases[k] != m_activationPhase)){
-        ++k;
-    }
-    m_computedInitTime = time + k*m_dT + m_activationOffset;
+    m_computedInitTime = time + samplesToActivation*m_dT + m_activationOffset;
     return true;
 }
 
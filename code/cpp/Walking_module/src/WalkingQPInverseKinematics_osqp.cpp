@@ -7,7 +7,9 @@
  */
 
 // std
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 // YARP
 #include <yarp/os/LogStream.h>
@@ -26,20 +28,16 @@ bool WalkingQPIK_osqp::initializeMatrices(const yarp::os::Searchable& config)
 {
     yarp::os::Value tempValue;
 
-    // evaluate constant sub-matrix of the hessian matrix
     // get the CoM weight
+    iDynTree::Triplets comWeightMatrix;
     if(!m_useCoMAsConstraint)
     {
         tempValue = config.find("comWeightTriplets");
-        iDynTree::Triplets comWeightMatrix;
         if(!iDynTreeHelper::Triplets::getTripletsFromValues(tempValue, 3, comWeightMatrix))
         {
             yError() << "Initialization failed while reading comWeightTriplets vector.";
             return false;
         }
-
-        m_comWeightMatrix.resize(3, 3);
-        m_comWeightMatrix.setFromConstTriplets(comWeightMatrix);
     }
 
     tempValue = config.find("neckWeightTriplets");
@@ -49,8 +47,6 @@ bool WalkingQPIK_osqp::initializeMatrices(const yarp::os::Searchable& config)
         yError() << "Initialization failed while reading neckWeightTriplets vector.";
         return false;
     }
-    m_neckWeightMatrix.resize(3, 3);
-    m_neckWeightMatrix.setFromConstTriplets(neckWeightMatrix);
 
     // set the matrix related to the joint regularization
     tempValue = config.find("jointRegularizationWeights");
@@ -61,22 +57,6 @@ bool WalkingQPIK_osqp::initializeMatrices(const yarp::os::Searchable& config)
         return false;
     }
 
-    //  m_jointRegulatizationHessian = H' \lamda H
-    m_jointRegulatizationHessian.resize(m_numberOfVariables, m_numberOfVariables);
-    for(int i = 0; i < m_actuatedDOFs; i++)
-        m_jointRegulatizationHessian(i + 6, i + 6) = jointRegularizationWeights(i);
-
-    // evaluate constant sub-matrix of the gradient matrix
-    m_jointRegulatizationGradient.resize(m_numberOfVariables, m_actuatedDOFs);
-    for(int i = 0; i < m_actuatedDOFs; i++)
-        m_jointRegulatizationGradient(i + 6, i) = jointRegularizationWeights(i);
-
-    // resize matrices
-    m_comJacobian.resize(3, m_numberOfVariables);
-    m_neckJacobian.resize(3, m_numberOfVariables);
-    m_leftFootJacobian.resize(6, m_numberOfVariables);
-    m_rightFootJacobian.resize(6, m_numberOfVariables);
-
     tempValue = config.find("jointRegularizationGains");
     iDynTree::VectorDynSize jointRegularizationGains(m_actuatedDOFs);
     if(!YarpHelper::yarpListToiDynTreeVectorDynSize(tempValue, jointRegularizationGains))
@@ -84,9 +64,20 @@ bool WalkingQPIK_osqp::initializeMatrices(const yarp::os::Searchable& config)
         yError() << "Initialization failed while reading jointRegularizationGains vector.";
         return false;
     }
-    m_jointRegulatizationGains.resize(m_actuatedDOFs, m_actuatedDOFs);
-    for(int i = 0; i < m_actuatedDOFs; i++)
-        m_jointRegulatizationGains(i, i) = jointRegularizationGains(i);
+
+    // the hessian and the gradient are evaluated by the problem
+    m_problem = makeQPIKProblem(m_actuatedDOFs);
+    if(!m_problem->initialize(m_actuatedDOFs, m_useCoMAsConstraint, neckWeightMatrix,
+                              comWeightMatrix, jointRegularizationWeights, jointRegularizationGains))
+    {
+        yError() << "Initialization failed while initializing the QP-IK problem.";
+        return false;
+    }
+
+    // resize matrices
+    m_comJacobian.resize(3, m_numberOfVariables);
+    m_leftFootJacobian.resize(6, m_numberOfVariables);
+    m_rightFootJacobian.resize(6, m_numberOfVariables);
 
     if(!YarpHelper::getDoubleFromSearchable(config, "k_posFoot", m_kPosFoot))
     {
@@ -112,9 +103,52 @@ bool WalkingQPIK_osqp::initializeMatrices(const yarp::os::Searchable& config)
         return false;
     }
 
+    m_constrainedOutput = Eigen::VectorXd::Zero(m_numberOfConstraints);
+
+    initializeSparsityPattern();
+
     return true;
 }
 
+void WalkingQPIK_osqp::initializeSparsityPattern()
+{
+    // the hessian matrix is dense. Only the upper triangular part is stored since it is the only
+    // one used by osqp. The elements are stored column by column so the values can be copied
+    // directly inside the CSC value array
+    std::vector<Eigen::Triplet<double>> hessianTriplets;
+    hessianTriplets.reserve(m_numberOfVariables * (m_numberOfVariables + 1) / 2);
+    for(int j = 0; j < m_numberOfVariables; j++)
+        for(int i = 0; i <= j; i++)
+            hessianTriplets.push_back(Eigen::Triplet<double>(i, j, 0.0));
+
+    m_hessianEigen.resize(m_numberOfVariables, m_numberOfVariables);
+    m_hessianEigen.setFromTriplets(hessianTriplets.begin(), hessianTriplets.end());
+    m_hessianEigen.makeCompressed();
+
+    // the jacobians are stored (even if some elements are equal to zero) in the first rows of
+    // each column. The joint regularization constraints are constant and they are stored below
+    int numberOfTaskConstraints;
+    if(m_useCoMAsConstraint)
+        numberOfTaskConstraints = 6 + 6 + 3;
+    else
+        numberOfTaskConstraints = 6 + 6;
+
+    std::vector<Eigen::Triplet<double>> constraintsTriplets;
+    constraintsTriplets.reserve(numberOfTaskConstraints * m_numberOfVariables
+                                + m_jointRegularizationLinearConstraintTriplets.size());
+    for(int j = 0; j < m_numberOfVariables; j++)
+        for(int i = 0; i < numberOfTaskConstraints; i++)
+            constraintsTriplets.push_back(Eigen::Triplet<double>(i, j, 0.0));
+
+    for(const auto& triplet : m_jointRegularizationLinearConstraintTriplets)
+        constraintsTriplets.push_back(Eigen::Triplet<double>(triplet.row + numberOfTaskConstraints,
+                                                             triplet.column, triplet.value));
+
+    m_constraintsMatrix.resize(m_numberOfConstraints, m_numberOfVariables);
+    m_constraintsMatrix.setFromTriplets(constraintsTriplets.begin(), constraintsTriplets.end());
+    m_constraintsMatrix.makeCompressed();
+}
+
 bool WalkingQPIK_osqp::setVelocityBounds(const iDynTree::VectorDynSize& minJointsLimit,
                                          const iDynTree::VectorDynSize& maxJointsLimit)
 {
@@ -266,6 +300,7 @@ bool WalkingQPIK_osqp::setCoMJacobian(const iDynTree::MatrixDynSize& comJacobian
         return false;
     }
     m_comJacobian = comJacobian;
+    m_problem->setCoMJacobian(comJacobian);
 
     return true;
 }
@@ -319,43 +354,27 @@ bool WalkingQPIK_osqp::setNeckJacobian(const iDynTree::MatrixDynSize& neckJacobi
         return false;
     }
 
-    iDynTree::toEigen(m_neckJacobian) = iDynTree::toEigen(neckJacobian).block(3, 0, 3,
-                                                                              m_actuatedDOFs + 6);
+    m_problem->setNeckJacobian(neckJacobian);
 
     return true;
 }
 
 bool WalkingQPIK_osqp::setHessianMatrix()
 {
-    // evaluate the hessian matrix
-    Eigen::SparseMatrix<double> hessianEigenSparse;
+    m_problem->evaluateHessian();
+    Eigen::Ref<const Eigen::MatrixXd> hessian = m_problem->getHessian();
 
-    // in that case the hessian matrix is related only to neck orientation and to
-    // the joint angle
-    m_hessianEigenDense = Eigen::MatrixXd(iDynTree::toEigen(m_jointRegulatizationHessian)) +
-        iDynTree::toEigen(m_neckJacobian).transpose() *
-        iDynTree::toEigen(m_neckWeightMatrix) *
-        iDynTree::toEigen(m_neckJacobian);
-
-    if(!m_useCoMAsConstraint)
+    // copy the upper triangular part inside the preallocated CSC value array
+    double* hessianValues = m_hessianEigen.valuePtr();
+    for(int j = 0; j < m_numberOfVariables; j++)
     {
-        m_hessianEigenDense =  m_hessianEigenDense + iDynTree::toEigen(m_comJacobian).transpose() *
-            iDynTree::toEigen(m_comWeightMatrix) * iDynTree::toEigen(m_comJacobian);
+        std::copy(hessian.col(j).data(), hessian.col(j).data() + j + 1, hessianValues);
+        hessianValues += j + 1;
     }
 
-    Eigen::SparseMatrix<double> hessianEigen = m_hessianEigenDense.sparseView();
-
-    if(m_optimizerSolver->isInitialized())
-    {
-        if(!m_optimizerSolver->updateHessianMatrix(hessianEigen))
-        {
-            yError() << "[setHessianMatrix] Unable to update the hessian matrix.";
-            return false;
-        }
-    }
-    else
+    if(!m_optimizerSolver->isInitialized())
     {
-        if(!m_optimizerSolver->data()->setHessianMatrix(hessianEigen))
+        if(!m_optimizerSolver->data()->setHessianMatrix(m_hessianEigen))
         {
             yError() << "[setHessianMatrix] Unable to set first time the hessian matrix.";
             return false;
@@ -368,26 +387,10 @@ bool WalkingQPIK_osqp::setGradientVector()
 {
     iDynTree::Matrix3x3 errorNeckAttitude = iDynTreeHelper::Rotation::skewSymmetric(m_neckOrientation * m_desiredNeckOrientation.inverse());
 
-    // todo
-    if(m_useCoMAsConstraint)
-    {
-        m_gradient = -iDynTree::toEigen(m_neckJacobian).transpose()
-            * iDynTree::toEigen(m_neckWeightMatrix) *
-            m_kAttFoot * (-m_kNeck * iDynTree::unskew(iDynTree::toEigen(errorNeckAttitude)))
-            - iDynTree::toEigen(m_jointRegulatizationGradient) *
-            (iDynTree::toEigen(m_jointRegulatizationGains) * (iDynTree::toEigen(m_regularizationTerm)
-                                                              - iDynTree::toEigen(m_jointPosition)));
-    }
-    else
-    {
-        m_gradient = -iDynTree::toEigen(m_comJacobian).transpose()
-            * iDynTree::toEigen(m_comWeightMatrix) * iDynTree::toEigen(m_comVelocity)
-            - iDynTree::toEigen(m_neckJacobian).transpose() * iDynTree::toEigen(m_neckWeightMatrix) *
-            m_kAttFoot * (-m_kNeck * iDynTree::unskew(iDynTree::toEigen(errorNeckAttitude)))
-            - iDynTree::toEigen(m_jointRegulatizationGradient) *
-            (iDynTree::toEigen(m_jointRegulatizationGains) * (iDynTree::toEigen(m_regularizationTerm)
-                                                              - iDynTree::toEigen(m_jointPosition)));
-    }
+    m_problem->evaluateGradient(m_comVelocity,
+                                m_kAttFoot * (-m_kNeck * iDynTree::unskew(iDynTree::toEigen(errorNeckAttitude))),
+                                m_regularizationTerm, m_jointPosition);
+    m_gradient = m_problem->getGradient();
 
     if(m_optimizerSolver->isInitialized())
     {
@@ -410,44 +413,26 @@ bool WalkingQPIK_osqp::setGradientVector()
 
 bool WalkingQPIK_osqp::setLinearConstraintMatrix()
 {
-    iDynTree::Triplets constraintsTriplets;
-    constraintsTriplets.addSubMatrix(0, 0, m_leftFootJacobian);
-    constraintsTriplets.addSubMatrix(6, 0, m_rightFootJacobian);
-
-    if(m_useCoMAsConstraint)
-    {
-        constraintsTriplets.addSubMatrix(12, 0, m_comJacobian);
-        iDynTreeHelper::Triplets::pushTripletsAsSubMatrix(15, 0,
-                                                          m_jointRegularizationLinearConstraintTriplets,
-                                                          constraintsTriplets);
-    }
-    else
+    // the jacobians are stored in the first rows of each column (see initializeSparsityPattern())
+    const int* outerIndex = m_constraintsMatrix.outerIndexPtr();
+    double* constraintsValues = m_constraintsMatrix.valuePtr();
+    for(int j = 0; j < m_numberOfVariables; j++)
     {
-        iDynTreeHelper::Triplets::pushTripletsAsSubMatrix(12, 0,
-                                                          m_jointRegularizationLinearConstraintTriplets,
-                                                          constraintsTriplets);
-    }
-
-    iDynSparseMatrix constraintsMatrix(m_numberOfConstraints, m_numberOfVariables);
-    constraintsMatrix.setFromConstTriplets(constraintsTriplets);
-
-    // convert iDynTree sparse matrix in eigen sparse matrix
-    // it is required by the osqp library
-    Eigen::SparseMatrix<double> constraintsMatrixEigen = iDynTree::toEigen(constraintsMatrix);
-
-    m_constraintsMatrixEigenDense = Eigen::MatrixXd(constraintsMatrixEigen);
-
-    if(m_optimizerSolver->isInitialized())
-    {
-        if(!m_optimizerSolver->updateLinearConstraintsMatrix(constraintsMatrixEigen))
+        double* column = constraintsValues + outerIndex[j];
+        for(int i = 0; i < 6; i++)
         {
-            yError() << "[setLinearConstraintsMatrix] Unable to update the constraints matrix.";
-            return false;
+            column[i] = m_leftFootJacobian(i, j);
+            column[i + 6] = m_rightFootJacobian(i, j);
         }
+
+        if(m_useCoMAsConstraint)
+            for(int i = 0; i < 3; i++)
+                column[i + 12] = m_comJacobian(i, j);
     }
-    else
+
+    if(!m_optimizerSolver->isInitialized())
     {
-        if(!m_optimizerSolver->data()->setLinearConstraintsMatrix(constraintsMatrixEigen))
+        if(!m_optimizerSolver->data()->setLinearConstraintsMatrix(m_constraintsMatrix))
         {
             yError() << "[setLinearConstraintsMatrix] Unable to set the constraints matrix.";
             return false;
@@ -456,9 +441,22 @@ bool WalkingQPIK_osqp::setLinearConstraintMatrix()
     return true;
 }
 
+bool WalkingQPIK_osqp::updateMatrices()
+{
+    // the sparsity pattern never changes so only the values have to be updated
+    if(osqp_update_P_A(m_optimizerSolver->workspace().get(),
+                       m_hessianEigen.valuePtr(), OSQP_NULL, m_hessianEigen.nonZeros(),
+                       m_constraintsMatrix.valuePtr(), OSQP_NULL, m_constraintsMatrix.nonZeros()) != 0)
+    {
+        yError() << "[updateMatrices] Unable to update the hessian and the constraints matrix.";
+        return false;
+    }
+    return true;
+}
+
 bool WalkingQPIK_osqp::setBounds()
 {
-    Eigen::VectorXd leftFootCorrection(6);
+    Eigen::Matrix<double, 6, 1> leftFootCorrection;
     leftFootCorrection.block(0,0,3,1) = m_kPosFoot * iDynTree::toEigen((m_leftFootToWorldTransform.getPosition() -
                                                                         m_desiredLeftFootToWorldTransform.getPosition()));
 
@@ -467,7 +465,7 @@ bool WalkingQPIK_osqp::setBounds()
 
     leftFootCorrection.block(3,0,3,1) = m_kAttFoot * (iDynTree::unskew(iDynTree::toEigen(errorLeftAttitude)));
 
-    Eigen::VectorXd rightFootCorrection(6);
+    Eigen::Matrix<double, 6, 1> rightFootCorrection;
     rightFootCorrection.block(0,0,3,1) = m_kPosFoot * iDynTree::toEigen((m_rightFootToWorldTransform.getPosition() -
                                                                          m_desiredRightFootToWorldTransform.getPosition()));
 
@@ -604,6 +602,14 @@ bool WalkingQPIK_osqp::solve()
             return false;
         }
     }
+    else
+    {
+        if(!updateMatrices())
+        {
+            yError() << "[solve] Unable to update the matrices.";
+            return false;
+        }
+    }
 
     if(!m_optimizerSolver->solve())
     {
@@ -623,15 +629,56 @@ bool WalkingQPIK_osqp::solve()
     return true;
 }
 
+void WalkingQPIK_osqp::getStatistics(QPSolverStatistics& statistics)
+{
+    statistics = QPSolverStatistics();
+    if(!m_optimizerSolver->isInitialized())
+        return;
+
+    const OSQPInfo* info = m_optimizerSolver->workspace()->info;
+    statistics.iterations = info->iter;
+    statistics.primalResidual = info->pri_res;
+    statistics.dualResidual = info->dua_res;
+    statistics.solveTime = info->solve_time;
+}
+
+bool WalkingQPIK_osqp::getPrimalVariable(Eigen::VectorXd& primalVariable)
+{
+    if(!m_isSolutionEvaluated)
+    {
+        yError() << "[getPrimalVariable] The solution is not evaluated. "
+                 << "Please call 'solve()' method.";
+        return false;
+    }
+
+    primalVariable = m_optimizerSolver->getSolution();
+    return true;
+}
+
+bool WalkingQPIK_osqp::setPrimalVariable(const Eigen::VectorXd& primalVariable)
+{
+    if(primalVariable.size() != m_numberOfVariables)
+    {
+        yError() << "[setPrimalVariable] The size of the primal variable is not coherent with "
+                 << "the number of variables.";
+        return false;
+    }
+
+    // the first solve initializes the solver
+    if(!m_optimizerSolver->isInitialized())
+        return true;
+
+    return m_optimizerSolver->setPrimalVariable(primalVariable);
+}
+
 bool WalkingQPIK_osqp::isSolutionFeasible()
 {
     double tolerance = 1;
 
-    Eigen::VectorXd constrainedOutput = m_constraintsMatrixEigenDense
-        * m_optimizerSolver->getSolution();
+    m_constrainedOutput.noalias() = m_constraintsMatrix * m_optimizerSolver->getSolution();
 
-    if(((constrainedOutput - m_upperBound).maxCoeff() < tolerance)
-       ||((constrainedOutput - m_lowerBound).maxCoeff() > -tolerance))
+    if(((m_constrainedOutput - m_upperBound).maxCoeff() < tolerance)
+       ||((m_constrainedOutput - m_lowerBound).maxCoeff() > -tolerance))
         return true;
 
     yError() << "[isSolutionFeasible] The constraints are not satisfied.";
@@ -650,7 +697,7 @@ bool WalkingQPIK_osqp::getSolution(iDynTree::VectorDynSize& output)
     if(output.size() != m_actuatedDOFs)
         output.resize(m_actuatedDOFs);
 
-    Eigen::VectorXd solutionEigen = m_optimizerSolver->getSolution();
+    const Eigen::VectorXd& solutionEigen = m_optimizerSolver->getSolution();
 
     for(int i = 0; i < output.size(); i++)
         output(i) = solutionEigen(i + 6);
@@ -684,14 +731,14 @@ bool WalkingQPIK_osqp::getRightFootError(iDynTree::VectorDynSize& output)
     return true;
 }
 
-const Eigen::MatrixXd& WalkingQPIK_osqp::getHessianMatrix() const
+Eigen::Ref<const Eigen::MatrixXd> WalkingQPIK_osqp::getHessianMatrix() const
 {
-    return m_hessianEigenDense;
+    return m_problem->getHessian();
 }
 
-const Eigen::MatrixXd& WalkingQPIK_osqp::getConstraintMatrix() const
+const Eigen::SparseMatrix<double>& WalkingQPIK_osqp::getConstraintMatrix() const
 {
-    return m_constraintsMatrixEigenDense;
+    return m_constraintsMatrix;
 }
 
 const Eigen::VectorXd& WalkingQPIK_osqp::getUpperBound() const
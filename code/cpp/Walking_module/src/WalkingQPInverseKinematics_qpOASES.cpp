@@ -6,6 +6,9 @@
  * @date 2018
  */
 
+// std
+#include <limits>
+
 // YARP
 #include <yarp/os/LogStream.h>
 #include <yarp/os/Value.h>
@@ -25,23 +28,19 @@ bool WalkingQPIK_qpOASES::initializeMatrices(const yarp::os::Searchable& config)
 {
     yarp::os::Value tempValue;
 
-    // evaluate constant sub-matrix of the hessian matrix
     // get the CoM weight
+    iDynTree::Triplets comWeightMatrix;
     if(!m_useCoMAsConstraint)
     {
         tempValue = config.find("comWeightTriplets");
-        iDynTree::Triplets comWeightMatrix;
         if(!iDynTreeHelper::Triplets::getTripletsFromValues(tempValue, 3, comWeightMatrix))
         {
             yError() << "Initialization failed while reading comWeightTriplets vector.";
             return false;
         }
-
-        m_comWeightMatrix.resize(3, 3);
-        m_comWeightMatrix.setFromConstTriplets(comWeightMatrix);
     }
 
-    // get the CoM weight
+    // get the neck weight
     tempValue = config.find("neckWeightTriplets");
     iDynTree::Triplets neckWeightMatrix;
     if(!iDynTreeHelper::Triplets::getTripletsFromValues(tempValue, 3, neckWeightMatrix))
@@ -49,44 +48,37 @@ bool WalkingQPIK_qpOASES::initializeMatrices(const yarp::os::Searchable& config)
         yError() << "Initialization failed while reading neckWeightTriplets vector.";
         return false;
     }
-    m_neckWeightMatrix.resize(3, 3);
-    m_neckWeightMatrix.setFromConstTriplets(neckWeightMatrix);
 
     // set the matrix related to the joint regularization
     tempValue = config.find("jointRegularizationWeights");
     iDynTree::VectorDynSize jointRegularizationWeights(m_actuatedDOFs);
     if(!YarpHelper::yarpListToiDynTreeVectorDynSize(tempValue, jointRegularizationWeights))
     {
-        yError() << "Initialization failed while reading neckWeightTriplets vector.";
+        yError() << "Initialization failed while reading jointRegularizationWeights vector.";
         return false;
     }
 
-    //  m_jointRegulatizationHessian = H' \lamda H
-    m_jointRegulatizationHessian.resize(m_numberOfVariables, m_numberOfVariables);
-    for(int i = 0; i < m_actuatedDOFs; i++)
-        m_jointRegulatizationHessian(i + 6, i + 6) = jointRegularizationWeights(i);
-
-    // evaluate constant sub-matrix of the gradient matrix
-    m_jointRegulatizationGradient.resize(m_numberOfVariables, m_actuatedDOFs);
-    for(int i = 0; i < m_actuatedDOFs; i++)
-        m_jointRegulatizationGradient(i + 6, i) = jointRegularizationWeights(i);
-
-    // resize matrices
-    m_comJacobian.resize(3, m_numberOfVariables);
-    m_neckJacobian.resize(3, m_numberOfVariables);
-    m_leftFootJacobian.resize(6, m_numberOfVariables);
-    m_rightFootJacobian.resize(6, m_numberOfVariables);
-
     tempValue = config.find("jointRegularizationGains");
     iDynTree::VectorDynSize jointRegularizationGains(m_actuatedDOFs);
     if(!YarpHelper::yarpListToiDynTreeVectorDynSize(tempValue, jointRegularizationGains))
     {
-        yError() << "Initialization failed while reading neckWeightTriplets vector.";
+        yError() << "Initialization failed while reading jointRegularizationGains vector.";
         return false;
     }
-    m_jointRegulatizationGains.resize(m_actuatedDOFs, m_actuatedDOFs);
-    for(int i = 0; i < m_actuatedDOFs; i++)
-        m_jointRegulatizationGains(i, i) = jointRegularizationGains(i);
+
+    // the hessian and the gradient are evaluated by the problem
+    m_problem = makeQPIKProblem(m_actuatedDOFs);
+    if(!m_problem->initialize(m_actuatedDOFs, m_useCoMAsConstraint, neckWeightMatrix,
+                              comWeightMatrix, jointRegularizationWeights, jointRegularizationGains))
+    {
+        yError() << "Initialization failed while initializing the QP-IK problem.";
+        return false;
+    }
+
+    // resize matrices
+    m_comJacobian.resize(3, m_numberOfVariables);
+    m_leftFootJacobian.resize(6, m_numberOfVariables);
+    m_rightFootJacobian.resize(6, m_numberOfVariables);
 
     if(!YarpHelper::getDoubleFromSearchable(config, "k_posFoot", m_kPosFoot))
     {
@@ -160,6 +152,12 @@ bool WalkingQPIK_qpOASES::initialize(const yarp::os::Searchable& config,
 
     m_useCoMAsConstraint = config.check("useCoMAsConstraint", yarp::os::Value(false)).asBool();
 
+    // budget of the solver for each tick
+    m_maxNumberOfWorkingSetRecalculations = config.check("max_working_set_recalculations",
+                                                         yarp::os::Value(100)).asInt();
+    m_maxSolverTime = config.check("max_solver_time", yarp::os::Value(0.0)).asDouble();
+    m_maxConsecutiveFallbacks = config.check("max_consecutive_fallbacks", yarp::os::Value(0)).asInt();
+
     // TODO in the future the number of constraints should be added inside
     // the configuration file
     // set the number of variables and the number of constraints
@@ -182,6 +180,7 @@ bool WalkingQPIK_qpOASES::initialize(const yarp::os::Searchable& config,
     m_lowerBound.resize(m_numberOfConstraints);
     m_minJointLimit.resize(m_numberOfVariables);
     m_maxJointLimit.resize(m_numberOfVariables);
+    m_solution.resize(m_numberOfVariables);
     m_regularizationTerm.resize(m_actuatedDOFs);
     m_jointPosition.resize(m_actuatedDOFs);
 
@@ -224,6 +223,8 @@ bool WalkingQPIK_qpOASES::initialize(const yarp::os::Searchable& config,
     m_optimizer->setPrintLevel(qpOASES::PL_LOW);
 
     m_isFirstTime = true;
+    m_isFeasibleSolutionAvailable = false;
+    m_consecutiveFallbacks = 0;
     return true;
 }
 
@@ -268,6 +269,7 @@ bool WalkingQPIK_qpOASES::setCoMJacobian(const iDynTree::MatrixDynSize& comJacob
         return false;
     }
     m_comJacobian = comJacobian;
+    m_problem->setCoMJacobian(comJacobian);
 
     return true;
 }
@@ -321,28 +323,17 @@ bool WalkingQPIK_qpOASES::setNeckJacobian(const iDynTree::MatrixDynSize& neckJac
         return false;
     }
 
-    iDynTree::toEigen(m_neckJacobian) = iDynTree::toEigen(neckJacobian).block(3, 0, 3,
-                                                                              m_actuatedDOFs + 6);
+    m_problem->setNeckJacobian(neckJacobian);
 
     return true;
 }
 
 bool WalkingQPIK_qpOASES::setHessianMatrix()
 {
-    // evaluate the hessian matrix
+    // evaluate the hessian matrix (it is symmetric so the storage order does not matter)
+    m_problem->evaluateHessian();
     Eigen::Map<MatrixXd>(m_hessian.data(), m_numberOfVariables, m_numberOfVariables) =
-        MatrixXd(iDynTree::toEigen(m_jointRegulatizationHessian)) +
-        iDynTree::toEigen(m_neckJacobian).transpose() *
-        iDynTree::toEigen(m_neckWeightMatrix) *
-        iDynTree::toEigen(m_neckJacobian);
-
-    if(!m_useCoMAsConstraint)
-    {
-        Eigen::Map<MatrixXd>(m_hessian.data(), m_numberOfVariables, m_numberOfVariables) =
-            Eigen::Map<MatrixXd>(m_hessian.data(), m_numberOfVariables, m_numberOfVariables) +
-            iDynTree::toEigen(m_comJacobian).transpose() *
-            iDynTree::toEigen(m_comWeightMatrix) * iDynTree::toEigen(m_comJacobian);
-    }
+        m_problem->getHessian();
 
     return true;
 }
@@ -351,27 +342,10 @@ bool WalkingQPIK_qpOASES::setGradientVector()
 {
     iDynTree::Matrix3x3 errorNeckAttitude = iDynTreeHelper::Rotation::skewSymmetric(m_neckOrientation * m_desiredNeckOrientation.inverse());
 
-    if(m_useCoMAsConstraint)
-    {
-        Eigen::Map<MatrixXd>(m_gradient.data(), m_numberOfVariables, 1) =
-            -iDynTree::toEigen(m_neckJacobian).transpose()
-            * iDynTree::toEigen(m_neckWeightMatrix)
-            * (-m_kNeck * iDynTree::unskew(iDynTree::toEigen(errorNeckAttitude)))
-            - iDynTree::toEigen(m_jointRegulatizationGradient) *
-            (iDynTree::toEigen(m_jointRegulatizationGains) * (iDynTree::toEigen(m_regularizationTerm)
-                                                              - iDynTree::toEigen(m_jointPosition)));
-    }
-    else
-    {
-        Eigen::Map<MatrixXd>(m_gradient.data(), m_numberOfVariables, 1)
-            = -iDynTree::toEigen(m_comJacobian).transpose()
-            * iDynTree::toEigen(m_comWeightMatrix) * iDynTree::toEigen(m_comVelocity)
-            - iDynTree::toEigen(m_neckJacobian).transpose() * iDynTree::toEigen(m_neckWeightMatrix)
-            * (-m_kNeck * iDynTree::unskew(iDynTree::toEigen(errorNeckAttitude)))
-            - iDynTree::toEigen(m_jointRegulatizationGradient) *
-            (iDynTree::toEigen(m_jointRegulatizationGains) * (iDynTree::toEigen(m_regularizationTerm)
-                                                              - iDynTree::toEigen(m_jointPosition)));
-    }
+    m_problem->evaluateGradient(m_comVelocity,
+                                -m_kNeck * iDynTree::unskew(iDynTree::toEigen(errorNeckAttitude)),
+                                m_regularizationTerm, m_jointPosition);
+    Eigen::Map<Eigen::VectorXd>(m_gradient.data(), m_numberOfVariables) = m_problem->getGradient();
 
     return true;
 }
@@ -410,7 +384,7 @@ bool WalkingQPIK_qpOASES::setLinearConstraintMatrix()
 
 bool WalkingQPIK_qpOASES::setBounds()
 {
-    Eigen::VectorXd leftFootCorrection(6);
+    Eigen::Matrix<double, 6, 1> leftFootCorrection;
     leftFootCorrection.block(0,0,3,1) = m_kPosFoot * iDynTree::toEigen((m_leftFootToWorldTransform.getPosition() -
                                                                         m_desiredLeftFootToWorldTransform.getPosition()));
 
@@ -419,7 +393,7 @@ bool WalkingQPIK_qpOASES::setBounds()
 
     leftFootCorrection.block(3,0,3,1) = m_kAttFoot * (iDynTree::unskew(iDynTree::toEigen(errorLeftAttitude)));
 
-    Eigen::VectorXd rightFootCorrection(6);
+    Eigen::Matrix<double, 6, 1> rightFootCorrection;
     rightFootCorrection.block(0,0,3,1) = m_kPosFoot * iDynTree::toEigen((m_rightFootToWorldTransform.getPosition() -
                                                                          m_desiredRightFootToWorldTransform.getPosition()));
 
@@ -541,32 +515,99 @@ bool WalkingQPIK_qpOASES::solve()
         return false;
     }
 
-    int nWSR = 100;
+    // nWSR and cpuTime are overwritten by qpOASES with the resources actually used
+    int nWSR = m_maxNumberOfWorkingSetRecalculations;
+    double cpuTime = m_maxSolverTime > 0 ? m_maxSolverTime : std::numeric_limits<double>::max();
 
+    qpOASES::returnValue status;
     if(!m_isFirstTime)
-    {
-        if(m_optimizer->hotstart(m_hessian.data(), m_gradient.data(), m_constraintMatrix.data(),
-                                 m_minJointLimit.data(), m_maxJointLimit.data(),
-                                 m_upperBound.data(), m_lowerBound.data(), nWSR, 0) != qpOASES::SUCCESSFUL_RETURN)
-        {
-            yError() << "[solve] Unable to solve the problem.";
-            return false;
-        }
-    }
+        status = m_optimizer->hotstart(m_hessian.data(), m_gradient.data(), m_constraintMatrix.data(),
+                                       m_minJointLimit.data(), m_maxJointLimit.data(),
+                                       m_upperBound.data(), m_lowerBound.data(), nWSR, &cpuTime);
     else
-    {
-        if(m_optimizer->init(m_hessian.data(), m_gradient.data(), m_constraintMatrix.data(),
-                          m_minJointLimit.data(), m_maxJointLimit.data(),
-                          m_upperBound.data(), m_lowerBound.data(), nWSR, 0) != qpOASES::SUCCESSFUL_RETURN)
-        {
-            yError() << "[solve] Unable to solve the problem.";
-            return false;
-        }
+        status = m_optimizer->init(m_hessian.data(), m_gradient.data(), m_constraintMatrix.data(),
+                                   m_minJointLimit.data(), m_maxJointLimit.data(),
+                                   m_upperBound.data(), m_lowerBound.data(), nWSR, &cpuTime);
+
+    m_numberOfWorkingSetRecalculations = nWSR;
+    m_solverTime = cpuTime;
 
+    if(status == qpOASES::SUCCESSFUL_RETURN)
+    {
+        m_optimizer->getPrimalSolution(m_solution.data());
+        m_isFeasibleSolutionAvailable = true;
+        m_consecutiveFallbacks = 0;
         m_isFirstTime = false;
+        m_isSolutionEvaluated = true;
+        return true;
     }
+
+    // the active set is not reliable if the solver failed, it will be initialized again.
+    // If only the budget is exceeded the next hotstart continues from the current active set
+    if(status != qpOASES::RET_MAX_NWSR_REACHED)
+        m_isFirstTime = true;
+
+    if(!m_isFeasibleSolutionAvailable || m_consecutiveFallbacks >= m_maxConsecutiveFallbacks)
+    {
+        yError() << "[solve] Unable to solve the problem.";
+        return false;
+    }
+
+    m_consecutiveFallbacks++;
+    yWarning() << "[solve] Unable to solve the problem within the budget (" << nWSR
+               << "working set recalculations," << cpuTime << "s). The last feasible solution is used.";
+
     m_isSolutionEvaluated = true;
+    return true;
+}
+
+int WalkingQPIK_qpOASES::getNumberOfWorkingSetRecalculations() const
+{
+    return m_numberOfWorkingSetRecalculations;
+}
 
+double WalkingQPIK_qpOASES::getSolverTime() const
+{
+    return m_solverTime;
+}
+
+void WalkingQPIK_qpOASES::getStatistics(QPSolverStatistics& statistics) const
+{
+    statistics = QPSolverStatistics();
+    statistics.iterations = m_numberOfWorkingSetRecalculations;
+    statistics.solveTime = m_solverTime;
+}
+
+int WalkingQPIK_qpOASES::getNumberOfConsecutiveFallbacks() const
+{
+    return m_consecutiveFallbacks;
+}
+
+bool WalkingQPIK_qpOASES::getPrimalVariable(Eigen::VectorXd& primalVariable)
+{
+    if(!m_isSolutionEvaluated)
+    {
+        yError() << "[getPrimalVariable] The solution is not evaluated. "
+                 << "Please call 'solve()' method.";
+        return false;
+    }
+
+    primalVariable = Eigen::Map<const Eigen::VectorXd>(m_solution.data(), m_solution.size());
+    return true;
+}
+
+bool WalkingQPIK_qpOASES::setPrimalVariable(const Eigen::VectorXd& primalVariable)
+{
+    if(primalVariable.size() != m_numberOfVariables)
+    {
+        yError() << "[setPrimalVariable] The size of the primal variable is not coherent with "
+                 << "the number of variables.";
+        return false;
+    }
+
+    Eigen::Map<Eigen::VectorXd>(m_solution.data(), m_solution.size()) = primalVariable;
+    m_isFeasibleSolutionAvailable = true;
+    m_consecutiveFallbacks = 0;
     return true;
 }
 
@@ -582,12 +623,8 @@ bool WalkingQPIK_qpOASES::getSolution(iDynTree::VectorDynSize& output)
     if(output.size() != m_actuatedDOFs)
         output.resize(m_actuatedDOFs);
 
-    std::vector<double> result(m_numberOfVariables);
-
-    m_optimizer->getPrimalSolution(result.data());
-
     for(int i = 0; i < output.size(); i++)
-        output(i) = result[i + 6];
+        output(i) = m_solution[i + 6];
 
     m_isSolutionEvaluated = false;
     return true;
@@ -602,12 +639,9 @@ bool WalkingQPIK_qpOASES::getLeftFootError(iDynTree::VectorDynSize& output)
     //     return false;
     // }
 
-    std::vector<double> result(m_numberOfVariables);
-    m_optimizer->getPrimalSolution(result.data());
-
     iDynTree::toEigen(output) = Eigen::Map<Eigen::MatrixXd>(m_lowerBound.data(),
                                                             m_numberOfConstraints, 1).block(0, 0, 6, 1)
-        - iDynTree::toEigen(m_leftFootJacobian) * Eigen::Map<Eigen::MatrixXd>(result.data(),
+        - iDynTree::toEigen(m_leftFootJacobian) * Eigen::Map<Eigen::MatrixXd>(m_solution.data(),
                                                                               m_numberOfVariables,
                                                                               1);
     return true;
@@ -621,12 +655,9 @@ bool WalkingQPIK_qpOASES::getRightFootError(iDynTree::VectorDynSize& output)
     //              << "Please call 'solve()' method.";
     //     return false;
     // }
-    std::vector<double> result(m_numberOfVariables);
-    m_optimizer->getPrimalSolution(result.data());
-
     iDynTree::toEigen(output) = Eigen::Map<Eigen::MatrixXd>(m_lowerBound.data(),
                                                             m_numberOfConstraints, 1).block(6, 0, 6, 1)
-        - iDynTree::toEigen(m_rightFootJacobian) * Eigen::Map<Eigen::MatrixXd>(result.data(),
+        - iDynTree::toEigen(m_rightFootJacobian) * Eigen::Map<Eigen::MatrixXd>(m_solution.data(),
                                                                                m_numberOfVariables,
                                                                                1);
     return true;
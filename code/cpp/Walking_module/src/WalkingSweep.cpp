@@ -0,0 +1,289 @@
+/**
+ * @file WalkingSweep.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+// YARP
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+
+#include "WalkingSweep.hpp"
+
+namespace
+{
+    /**
+     * Convert the name of a stage in a column name (e.g. "DCM controller" -> "dcm_controller").
+     */
+    std::string toColumnName(const std::string& name)
+    {
+        std::string column = name;
+        for(auto& character : column)
+            character = std::isalnum(static_cast<unsigned char>(character)) ?
+                std::tolower(static_cast<unsigned char>(character)) : '_';
+        return column;
+    }
+}
+
+bool WalkingSweep::configure(yarp::os::ResourceFinder& rf)
+{
+    // each run modifies its own copy of the configuration
+    m_baseConfiguration.fromString(rf.toString());
+
+    // the runs are executed as fast as possible
+    m_baseConfiguration.put("benchmark_real_time", yarp::os::Value(false));
+
+    std::string sweepFileName = rf.check("sweep_config", yarp::os::Value("dcmWalkingSweep.ini")).asString();
+    std::string sweepFile = rf.findFile(sweepFileName);
+    yarp::os::Property sweepConfiguration;
+    if(sweepFile.empty() || !sweepConfiguration.fromConfigFile(sweepFile))
+    {
+        yError() << "[configure] Unable to read the sweep configuration" << sweepFileName;
+        return false;
+    }
+
+    // each element of the group is (name group key (values))
+    yarp::os::Bottle& parametersGroup = sweepConfiguration.findGroup("PARAMETERS");
+    if(parametersGroup.isNull() || parametersGroup.size() < 2)
+    {
+        yError() << "[configure] The PARAMETERS group of the sweep configuration is empty.";
+        return false;
+    }
+
+    m_parameters.clear();
+    m_numberOfRuns = 1;
+    for(int i = 1; i < parametersGroup.size(); i++)
+    {
+        yarp::os::Bottle* parameterPtr = parametersGroup.get(i).asList();
+        if(parameterPtr == nullptr || parameterPtr->size() != 4 || !parameterPtr->get(3).isList()
+           || parameterPtr->get(3).asList()->size() == 0)
+        {
+            yError() << "[configure] Each swept parameter has to be: <name> <group> <key> (<values>).";
+            return false;
+        }
+
+        Parameter parameter;
+        parameter.name = parameterPtr->get(0).asString();
+        parameter.group = parameterPtr->get(1).asString();
+        parameter.key = parameterPtr->get(2).asString();
+
+        yarp::os::Bottle* valuesPtr = parameterPtr->get(3).asList();
+        for(int j = 0; j < valuesPtr->size(); j++)
+            parameter.values.push_back(valuesPtr->get(j));
+
+        if(m_baseConfiguration.findGroup(parameter.group).isNull())
+        {
+            yError() << "[configure] The group" << parameter.group << "of the parameter"
+                     << parameter.name << "does not exist.";
+            return false;
+        }
+
+        m_numberOfRuns *= parameter.values.size();
+        m_parameters.push_back(parameter);
+    }
+
+    // by default a worker for each core
+    int numberOfThreads = rf.check("sweep_threads", yarp::os::Value(0)).asInt();
+    if(numberOfThreads <= 0)
+        numberOfThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    m_numberOfThreads = std::min(static_cast<std::size_t>(numberOfThreads), m_numberOfRuns);
+
+    m_results.assign(m_numberOfRuns, RunResult());
+
+    yInfo() << "[configure] The sweep has" << m_numberOfRuns << "runs executed by"
+            << m_numberOfThreads << "threads.";
+
+    return true;
+}
+
+void WalkingSweep::getValueIndices(std::size_t run, std::vector<std::size_t>& indices) const
+{
+    indices.resize(m_parameters.size());
+    for(std::size_t i = m_parameters.size(); i > 0; i--)
+    {
+        std::size_t numberOfValues = m_parameters[i - 1].values.size();
+        indices[i - 1] = run % numberOfValues;
+        run /= numberOfValues;
+    }
+}
+
+bool WalkingSweep::setParameter(yarp::os::Property& configuration, const Parameter& parameter,
+                                const yarp::os::Value& value) const
+{
+    // the group is modified in place. The first element is the name of the group
+    yarp::os::Bottle& group = configuration.findGroup(parameter.group);
+    if(group.isNull())
+    {
+        yError() << "[setParameter] Unable to find the group" << parameter.group;
+        return false;
+    }
+
+    for(int i = 1; i < group.size(); i++)
+    {
+        yarp::os::Bottle* option = group.get(i).asList();
+        if(option != nullptr && option->size() > 0 && option->get(0).asString() == parameter.key)
+        {
+            option->clear();
+            option->addString(parameter.key);
+            option->add(value);
+            return true;
+        }
+    }
+
+    // the option is not in the configuration file
+    yarp::os::Bottle& option = group.addList();
+    option.addString(parameter.key);
+    option.add(value);
+    return true;
+}
+
+void WalkingSweep::executeRun(std::size_t run)
+{
+    RunResult& result = m_results[run];
+
+    std::vector<std::size_t> indices;
+    getValueIndices(run, indices);
+
+    // the configuration has to be alive until the end of the run
+    yarp::os::Property configuration;
+    WalkingBenchmark benchmark;
+    {
+        // the model and the configuration files are loaded one run at a time
+        std::lock_guard<std::mutex> guard(m_configurationMutex);
+
+        configuration = m_baseConfiguration;
+        for(std::size_t i = 0; i < m_parameters.size(); i++)
+        {
+            if(!setParameter(configuration, m_parameters[i], m_parameters[i].values[indices[i]]))
+            {
+                yError() << "[executeRun] Unable to set the parameter" << m_parameters[i].name;
+                return;
+            }
+        }
+
+        if(!benchmark.configure(configuration))
+        {
+            yError() << "[executeRun] Unable to configure the run" << run;
+            return;
+        }
+    }
+
+    // unstable set of gains may make the controller fail
+    if(!benchmark.run())
+    {
+        yWarning() << "[executeRun] The run" << run << "failed.";
+        return;
+    }
+
+    result.isSucceeded = true;
+    result.metrics = benchmark.getMetrics();
+    result.stages = benchmark.getStages();
+    result.stageStatistics.resize(result.stages.size());
+    for(std::size_t i = 0; i < result.stages.size(); i++)
+        benchmark.getStageStatistics(result.stages[i], result.stageStatistics[i]);
+}
+
+void WalkingSweep::worker()
+{
+    while(true)
+    {
+        std::size_t run = m_nextRun++;
+        if(run >= m_numberOfRuns)
+            return;
+
+        executeRun(run);
+    }
+}
+
+bool WalkingSweep::run()
+{
+    if(m_numberOfRuns == 0)
+    {
+        yError() << "[run] The sweep is not configured.";
+        return false;
+    }
+
+    auto initTime = std::chrono::steady_clock::now();
+
+    m_nextRun = 0;
+    std::vector<std::thread> workers;
+    for(unsigned int i = 0; i < m_numberOfThreads; i++)
+        workers.emplace_back(&WalkingSweep::worker, this);
+
+    for(auto& thread : workers)
+        thread.join();
+
+    m_elapsedTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - initTime).count();
+
+    std::size_t succeededRuns = std::count_if(m_results.begin(), m_results.end(),
+                                              [](const RunResult& result){return result.isSucceeded;});
+    yInfo() << "[run]" << succeededRuns << "of" << m_numberOfRuns << "runs succeeded in"
+            << m_elapsedTime << "s.";
+
+    return true;
+}
+
+std::string WalkingSweep::getReport() const
+{
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(3);
+
+    // the stages are the same for all the runs
+    std::vector<std::string> stages;
+    for(const auto& result : m_results)
+    {
+        if(result.isSucceeded)
+        {
+            stages = result.stages;
+            break;
+        }
+    }
+
+    report << "run";
+    for(const auto& parameter : m_parameters)
+        report << "," << parameter.name;
+    report << ",succeeded,dcm_error_rms_mm,dcm_error_max_mm,zmp_margin_min_mm";
+    for(const auto& stage : stages)
+        report << "," << toColumnName(stage) << "_avg_ms," << toColumnName(stage) << "_p99_ms";
+    report << "\n";
+
+    std::vector<std::size_t> indices;
+    for(std::size_t run = 0; run < m_results.size(); run++)
+    {
+        const RunResult& result = m_results[run];
+        getValueIndices(run, indices);
+
+        // the values may contain commas (e.g. the triplets)
+        report << run;
+        for(std::size_t i = 0; i < m_parameters.size(); i++)
+            report << ",\"" << m_parameters[i].values[indices[i]].toString() << "\"";
+
+        report << "," << result.isSucceeded;
+        if(result.isSucceeded)
+        {
+            report << "," << result.metrics.dcmErrorRMS * 1000.0
+                   << "," << result.metrics.dcmErrorMax * 1000.0
+                   << "," << result.metrics.minimumZMPMargin * 1000.0;
+            for(const auto& statistics : result.stageStatistics)
+                report << "," << statistics.average << "," << statistics.p99;
+        }
+        else
+        {
+            for(std::size_t i = 0; i < 3 + 2 * stages.size(); i++)
+                report << ",";
+        }
+        report << "\n";
+    }
+
+    return report.str();
+}
@@ -11,8 +11,6 @@
 
 // iDynTree
 #include <iDynTree/Core/EigenHelpers.h>
-#include <iDynTree/yarp/YARPConversions.h>
-#include <iDynTree/yarp/YARPEigenConversions.h>
 
 #include "WalkingZMPController.hpp"
 #include "Utils.hpp"
@@ -54,11 +52,13 @@ bool WalkingZMPController::initialize(const yarp::os::Searchable& config)
         return false;
     }
 
-    yarp::sig::Vector buffer;
-    buffer.resize(2, 0.0);
+    m_samplingTime = samplingTime;
 
-    // instantiate Integrator object
-    m_velocityIntegral = std::make_unique<iCub::ctrl::Integrator>(samplingTime, buffer);
+    // the CoM velocity is integrated in place (as the iCub::ctrl::Integrator does but without
+    // allocating memory in each step)
+    m_controllerOutput.zero();
+    m_previousDesiredCoMVelocity.zero();
+    m_isIntegratorInitialized = true;
 
     return true;
 }
@@ -85,7 +85,7 @@ void WalkingZMPController::setReferenceSignal(const iDynTree::Vector2& zmpDesire
 bool WalkingZMPController::evaluateControl()
 {
     m_controlEvaluated = false;
-    if(m_velocityIntegral == nullptr)
+    if(!m_isIntegratorInitialized)
     {
         yError() << "[evaluateControl] The integrator is not initialized.";
         return false;
@@ -98,14 +98,10 @@ bool WalkingZMPController::evaluateControl()
                                                         iDynTree::toEigen(m_zmpFeedback))
                                              +iDynTree::toEigen(m_comVelocityDesired);
 
-    // integrate the velocity
-    yarp::sig::Vector desiredCoMVelocityYarp(2);
-    yarp::sig::Vector desiredCoMPositionYarp(2);
-    iDynTree::toYarp(m_desiredCoMVelocity, desiredCoMVelocityYarp);
-
-    desiredCoMPositionYarp = m_velocityIntegral->integrate(desiredCoMVelocityYarp);
-
-    iDynTree::toiDynTree(desiredCoMPositionYarp, m_controllerOutput);
+    // integrate the velocity (trapezoidal rule)
+    iDynTree::toEigen(m_controllerOutput) += m_samplingTime / 2.0 * (iDynTree::toEigen(m_desiredCoMVelocity)
+                                                                     + iDynTree::toEigen(m_previousDesiredCoMVelocity));
+    m_previousDesiredCoMVelocity = m_desiredCoMVelocity;
 
     m_controlEvaluated = true;
     return true;
@@ -127,15 +123,13 @@ bool WalkingZMPController::getControllerOutput(iDynTree::Vector2& controllerOutp
 
 bool WalkingZMPController::reset(const iDynTree::Vector2& initialValue)
 {
-    if(m_velocityIntegral == nullptr)
+    if(!m_isIntegratorInitialized)
     {
         yError() << "[reset] The integrator is not initialized.";
         return false;
     }
 
-    yarp::sig::Vector buffer(2);
-    iDynTree::toYarp(initialValue, buffer);
-
-    m_velocityIntegral->reset(buffer);
+    m_controllerOutput = initialValue;
+    m_previousDesiredCoMVelocity.zero();
     return true;
 }
@@ -0,0 +1,201 @@
+/**
+ * @file StreamedGoalTest.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <cstdlib>
+
+// YARP
+#include <yarp/os/LogStream.h>
+
+#include "StreamedGoal.hpp"
+
+namespace
+{
+    // number of ticks spent by the planner to evaluate a trajectory
+    constexpr int plannerTicks = 5;
+
+    /**
+     * Controller that defers the goals as WalkingModule::applyGoal does when the planner is
+     * already evaluating a trajectory.
+     */
+    struct FakeController
+    {
+        bool isPlannerBusy{false};
+        int plannerCounter{0};
+        bool isWalking{true};
+        double goalX{0};
+        double goalY{0};
+        int appliedGoals{0};
+
+        bool applyGoal(double x, double y, bool& isApplied)
+        {
+            isApplied = false;
+            if(!isWalking)
+                return false;
+
+            // the planner is already evaluating the new trajectory
+            if(isPlannerBusy)
+                return true;
+
+            goalX = x;
+            goalY = y;
+            appliedGoals++;
+            isPlannerBusy = true;
+            plannerCounter = plannerTicks;
+
+            isApplied = true;
+            return true;
+        }
+
+        void updatePlanner()
+        {
+            if(isPlannerBusy && --plannerCounter == 0)
+                isPlannerBusy = false;
+        }
+    };
+
+    /**
+     * One tick of the control loop: the goal is retried (as in WalkingModule::processStreamedGoal)
+     * and the planner advances.
+     */
+    bool tick(StreamedGoal& streamedGoal, FakeController& controller)
+    {
+        auto apply = [&](double x, double y, bool& isApplied)
+            {return controller.applyGoal(x, y, isApplied);};
+        bool ok = streamedGoal.apply(apply);
+        controller.updatePlanner();
+        return ok;
+    }
+
+    bool isGoalEqual(const FakeController& controller, double x, double y)
+    {
+        return controller.goalX == x && controller.goalY == y;
+    }
+
+    bool testGoalWhilePlannerIsBusy()
+    {
+        StreamedGoal streamedGoal;
+        FakeController controller;
+
+        // the first goal is applied immediately and the planner becomes busy
+        streamedGoal.set(1.0, 0.0);
+        if(!tick(streamedGoal, controller) || streamedGoal.isPending()
+           || !isGoalEqual(controller, 1.0, 0.0))
+        {
+            yError() << "[testGoalWhilePlannerIsBusy] The first goal is not applied.";
+            return false;
+        }
+
+        // a new goal arrives while the planner is busy: it is kept until the planner finishes
+        streamedGoal.set(2.0, 0.5);
+        for(int i = 1; i < plannerTicks; i++)
+        {
+            if(!tick(streamedGoal, controller) || !streamedGoal.isPending()
+               || !isGoalEqual(controller, 1.0, 0.0))
+            {
+                yError() << "[testGoalWhilePlannerIsBusy] The goal is not deferred at the tick" << i;
+                return false;
+            }
+        }
+
+        // no new sample is received, the pending goal is applied as soon as the planner is free
+        if(!tick(streamedGoal, controller) || streamedGoal.isPending()
+           || !isGoalEqual(controller, 2.0, 0.5) || controller.appliedGoals != 2)
+        {
+            yError() << "[testGoalWhilePlannerIsBusy] The deferred goal is not applied.";
+            return false;
+        }
+
+        // the goal is not applied again
+        for(int i = 0; i < 2 * plannerTicks; i++)
+            tick(streamedGoal, controller);
+
+        if(controller.appliedGoals != 2)
+        {
+            yError() << "[testGoalWhilePlannerIsBusy] The goal is applied more than once.";
+            return false;
+        }
+
+        return true;
+    }
+
+    bool testLatestGoalIsApplied()
+    {
+        StreamedGoal streamedGoal;
+        FakeController controller;
+
+        streamedGoal.set(1.0, 0.0);
+        tick(streamedGoal, controller);
+
+        // only the latest sample received while the planner is busy is applied
+        streamedGoal.set(2.0, 0.0);
+        tick(streamedGoal, controller);
+        streamedGoal.set(3.0, 0.0);
+        tick(streamedGoal, controller);
+
+        while(streamedGoal.isPending())
+            tick(streamedGoal, controller);
+
+        if(!isGoalEqual(controller, 3.0, 0.0) || controller.appliedGoals != 2)
+        {
+            yError() << "[testLatestGoalIsApplied] The latest goal is not the applied one.";
+            return false;
+        }
+
+        return true;
+    }
+
+    bool testRejectedGoal()
+    {
+        StreamedGoal streamedGoal;
+        FakeController controller;
+
+        // a rejected goal is discarded and it is not retried
+        controller.isWalking = false;
+        streamedGoal.set(1.0, 0.0);
+        if(tick(streamedGoal, controller) || streamedGoal.isPending())
+        {
+            yError() << "[testRejectedGoal] The rejected goal is not discarded.";
+            return false;
+        }
+
+        controller.isWalking = true;
+        tick(streamedGoal, controller);
+        if(controller.appliedGoals != 0)
+        {
+            yError() << "[testRejectedGoal] The rejected goal is applied.";
+            return false;
+        }
+
+        // a goal discarded by clear() (the robot stopped walking) is not applied
+        controller.isPlannerBusy = true;
+        controller.plannerCounter = plannerTicks;
+        streamedGoal.set(2.0, 0.0);
+        tick(streamedGoal, controller);
+        streamedGoal.clear();
+        for(int i = 0; i < 2 * plannerTicks; i++)
+            tick(streamedGoal, controller);
+
+        if(controller.appliedGoals != 0)
+        {
+            yError() << "[testRejectedGoal] The cleared goal is applied.";
+            return false;
+        }
+
+        return true;
+    }
+}
+
+int main()
+{
+    if(!testGoalWhilePlannerIsBusy() || !testLatestGoalIsApplied() || !testRejectedGoal())
+        return EXIT_FAILURE;
+
+    yInfo() << "[main] The streamed goals are applied as expected.";
+    return EXIT_SUCCESS;
+}
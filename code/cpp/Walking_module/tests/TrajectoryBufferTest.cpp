@@ -0,0 +1,346 @@
+/**
+ * @file TrajectoryBufferTest.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <vector>
+
+// YARP
+#include <yarp/os/LogStream.h>
+
+// iDynTree
+#include <iDynTree/Core/Position.h>
+
+#include "TrajectoryBuffer.hpp"
+
+namespace
+{
+    // number of random operations (merge or advance) applied to the buffers
+    constexpr int numberOfOperations = 20000;
+
+    // maximum size of a planned trajectory
+    constexpr std::size_t maxTrajectorySize = 60;
+
+    /**
+     * Reference implementation of the trajectory buffer: the deques previously used by the
+     * WalkingModule (StdHelper::appendVectorToDeque and propagateReferenceSignals).
+     */
+    struct DequeTrajectories
+    {
+        std::deque<iDynTree::Transform> leftTrajectory;
+        std::deque<iDynTree::Transform> rightTrajectory;
+        std::deque<iDynTree::Twist> leftTwistTrajectory;
+        std::deque<iDynTree::Twist> rightTwistTrajectory;
+        std::deque<iDynTree::Vector2> DCMPositionDesired;
+        std::deque<iDynTree::Vector2> DCMVelocityDesired;
+        std::deque<bool> leftInContact;
+        std::deque<bool> rightInContact;
+        std::deque<double> comHeightTrajectory;
+        std::deque<double> comHeightVelocity;
+        std::deque<bool> isLeftFixedFrame;
+        std::deque<size_t> mergePoints;
+    };
+
+    template <typename T>
+    bool appendVectorToDeque(const std::vector<T>& input, std::deque<T>& output,
+                             std::size_t initPoint)
+    {
+        if(initPoint > output.size())
+            return false;
+
+        output.resize(input.size() + initPoint);
+        std::copy(input.begin(), input.end(), output.begin() + initPoint);
+        return true;
+    }
+
+    template <typename T>
+    void propagate(std::deque<T>& trajectory)
+    {
+        // the last sample is repeated before popping the first one so that a trajectory with a
+        // single sample is handled too
+        trajectory.push_back(trajectory.back());
+        trajectory.pop_front();
+    }
+
+    /**
+     * Trajectory generated by the fake planner. The samples are identified by a counter.
+     */
+    struct Plan
+    {
+        std::vector<iDynTree::Transform> leftTrajectory;
+        std::vector<iDynTree::Transform> rightTrajectory;
+        std::vector<iDynTree::Twist> leftTwistTrajectory;
+        std::vector<iDynTree::Twist> rightTwistTrajectory;
+        std::vector<iDynTree::Vector2> DCMPositionDesired;
+        std::vector<iDynTree::Vector2> DCMVelocityDesired;
+        std::vector<bool> leftInContact;
+        std::vector<bool> rightInContact;
+        std::vector<double> comHeightTrajectory;
+        std::vector<double> comHeightVelocity;
+        std::vector<bool> isLeftFixedFrame;
+        std::vector<size_t> mergePoints;
+    };
+
+    Plan generatePlan(std::size_t size, std::mt19937& generator, double& counter)
+    {
+        Plan plan;
+        for(std::size_t i = 0; i < size; i++)
+        {
+            counter += 1.0;
+
+            iDynTree::Transform left = iDynTree::Transform::Identity();
+            iDynTree::Transform right = iDynTree::Transform::Identity();
+            left.setPosition(iDynTree::Position(counter, 0.0, 0.0));
+            right.setPosition(iDynTree::Position(-counter, 0.0, 0.0));
+            plan.leftTrajectory.push_back(left);
+            plan.rightTrajectory.push_back(right);
+
+            iDynTree::Twist leftTwist, rightTwist;
+            leftTwist.zero();
+            rightTwist.zero();
+            leftTwist.getLinearVec3()(0) = 2 * counter;
+            rightTwist.getLinearVec3()(0) = -2 * counter;
+            plan.leftTwistTrajectory.push_back(leftTwist);
+            plan.rightTwistTrajectory.push_back(rightTwist);
+
+            iDynTree::Vector2 dcm;
+            dcm(0) = 3 * counter;
+            dcm(1) = -3 * counter;
+            plan.DCMPositionDesired.push_back(dcm);
+            dcm(0) = 4 * counter;
+            plan.DCMVelocityDesired.push_back(dcm);
+
+            plan.leftInContact.push_back(generator() % 2 == 0);
+            plan.rightInContact.push_back(generator() % 2 == 0);
+            plan.isLeftFixedFrame.push_back(generator() % 2 == 0);
+
+            plan.comHeightTrajectory.push_back(5 * counter);
+            plan.comHeightVelocity.push_back(6 * counter);
+        }
+
+        // the first merge point is always equal to 0, the others are increasing
+        plan.mergePoints.push_back(0);
+        for(std::size_t i = 1; i < size; i++)
+            if(generator() % 8 == 0)
+                plan.mergePoints.push_back(i);
+
+        return plan;
+    }
+
+    void fillPlannedTrajectory(const Plan& plan, std::size_t begin,
+                               PlannedTrajectory& trajectory)
+    {
+        std::size_t size = plan.DCMPositionDesired.size();
+
+        // the memory is the one previously used by the buffer, it is allocated if not enough
+        trajectory.samples.reserve(begin + size, 0);
+        trajectory.begin = begin;
+        trajectory.size = size;
+        trajectory.mergePoints = plan.mergePoints;
+
+        trajectory.samples.leftTrajectory.copy(plan.leftTrajectory, begin);
+        trajectory.samples.rightTrajectory.copy(plan.rightTrajectory, begin);
+        trajectory.samples.leftTwistTrajectory.copy(plan.leftTwistTrajectory, begin);
+        trajectory.samples.rightTwistTrajectory.copy(plan.rightTwistTrajectory, begin);
+        trajectory.samples.DCMPositionDesired.copy(plan.DCMPositionDesired, begin);
+        trajectory.samples.DCMVelocityDesired.copy(plan.DCMVelocityDesired, begin);
+        trajectory.samples.leftInContact.copy(plan.leftInContact, begin);
+        trajectory.samples.rightInContact.copy(plan.rightInContact, begin);
+        trajectory.samples.comHeightTrajectory.copy(plan.comHeightTrajectory, begin);
+        trajectory.samples.comHeightVelocity.copy(plan.comHeightVelocity, begin);
+        trajectory.samples.isLeftFixedFrame.copy(plan.isLeftFixedFrame, begin);
+    }
+
+    bool mergeDeques(const Plan& plan, std::size_t mergePoint, DequeTrajectories& deques)
+    {
+        if(!appendVectorToDeque(plan.leftTrajectory, deques.leftTrajectory, mergePoint))
+            return false;
+
+        appendVectorToDeque(plan.rightTrajectory, deques.rightTrajectory, mergePoint);
+        appendVectorToDeque(plan.leftTwistTrajectory, deques.leftTwistTrajectory, mergePoint);
+        appendVectorToDeque(plan.rightTwistTrajectory, deques.rightTwistTrajectory, mergePoint);
+        appendVectorToDeque(plan.DCMPositionDesired, deques.DCMPositionDesired, mergePoint);
+        appendVectorToDeque(plan.DCMVelocityDesired, deques.DCMVelocityDesired, mergePoint);
+        appendVectorToDeque(plan.leftInContact, deques.leftInContact, mergePoint);
+        appendVectorToDeque(plan.rightInContact, deques.rightInContact, mergePoint);
+        appendVectorToDeque(plan.comHeightTrajectory, deques.comHeightTrajectory, mergePoint);
+        appendVectorToDeque(plan.comHeightVelocity, deques.comHeightVelocity, mergePoint);
+        appendVectorToDeque(plan.isLeftFixedFrame, deques.isLeftFixedFrame, mergePoint);
+
+        deques.mergePoints.assign(plan.mergePoints.begin(), plan.mergePoints.end());
+        deques.mergePoints.pop_front();
+        return true;
+    }
+
+    void advanceDeques(DequeTrajectories& deques)
+    {
+        propagate(deques.leftTrajectory);
+        propagate(deques.rightTrajectory);
+        propagate(deques.leftTwistTrajectory);
+        propagate(deques.rightTwistTrajectory);
+        propagate(deques.DCMPositionDesired);
+        propagate(deques.DCMVelocityDesired);
+        propagate(deques.leftInContact);
+        propagate(deques.rightInContact);
+        propagate(deques.comHeightTrajectory);
+        propagate(deques.comHeightVelocity);
+        propagate(deques.isLeftFixedFrame);
+
+        if(!deques.mergePoints.empty())
+        {
+            for(auto& mergePoint : deques.mergePoints)
+                mergePoint--;
+
+            if(deques.mergePoints[0] == 0)
+                deques.mergePoints.pop_front();
+        }
+    }
+
+    bool isEqual(const iDynTree::Transform& a, const iDynTree::Transform& b)
+    {
+        return a.getPosition()(0) == b.getPosition()(0);
+    }
+
+    bool isEqual(const iDynTree::Twist& a, const iDynTree::Twist& b)
+    {
+        return a.getLinearVec3()(0) == b.getLinearVec3()(0);
+    }
+
+    bool isEqual(const iDynTree::Vector2& a, const iDynTree::Vector2& b)
+    {
+        return a(0) == b(0) && a(1) == b(1);
+    }
+
+    bool isEqual(double a, double b)
+    {
+        return a == b;
+    }
+
+    template <typename T>
+    bool compare(const TrajectoryView<T>& view, const std::deque<T>& deque, const char* name)
+    {
+        if(view.size() != deque.size())
+        {
+            yError() << "[compare] The size of" << name << "is" << view.size()
+                     << "while the expected one is" << deque.size();
+            return false;
+        }
+
+        for(std::size_t i = 0; i < deque.size(); i++)
+            if(!isEqual(view[i], deque[i]))
+            {
+                yError() << "[compare] The sample" << i << "of" << name << "is different.";
+                return false;
+            }
+
+        return true;
+    }
+
+    bool compare(const TrajectoryBuffer& buffer, const DequeTrajectories& deques)
+    {
+        if(!compare(buffer.getLeftFootTrajectory(), deques.leftTrajectory, "leftTrajectory")
+           || !compare(buffer.getRightFootTrajectory(), deques.rightTrajectory, "rightTrajectory")
+           || !compare(buffer.getLeftFootTwistTrajectory(), deques.leftTwistTrajectory,
+                       "leftTwistTrajectory")
+           || !compare(buffer.getRightFootTwistTrajectory(), deques.rightTwistTrajectory,
+                       "rightTwistTrajectory")
+           || !compare(buffer.getDCMPositionDesired(), deques.DCMPositionDesired,
+                       "DCMPositionDesired")
+           || !compare(buffer.getDCMVelocityDesired(), deques.DCMVelocityDesired,
+                       "DCMVelocityDesired")
+           || !compare(buffer.getLeftInContact(), deques.leftInContact, "leftInContact")
+           || !compare(buffer.getRightInContact(), deques.rightInContact, "rightInContact")
+           || !compare(buffer.getCoMHeightTrajectory(), deques.comHeightTrajectory,
+                       "comHeightTrajectory")
+           || !compare(buffer.getCoMHeightVelocity(), deques.comHeightVelocity,
+                       "comHeightVelocity")
+           || !compare(buffer.getIsLeftFixedFrame(), deques.isLeftFixedFrame, "isLeftFixedFrame"))
+            return false;
+
+        if(buffer.getNumberOfMergePoints() != deques.mergePoints.size())
+        {
+            yError() << "[compare] The number of merge points is" << buffer.getNumberOfMergePoints()
+                     << "while the expected one is" << deques.mergePoints.size();
+            return false;
+        }
+
+        for(std::size_t i = 0; i < deques.mergePoints.size(); i++)
+            if(buffer.getMergePoint(i) != deques.mergePoints[i])
+            {
+                yError() << "[compare] The merge point" << i << "is" << buffer.getMergePoint(i)
+                         << "while the expected one is" << deques.mergePoints[i];
+                return false;
+            }
+
+        return true;
+    }
+}
+
+int main()
+{
+    // the seed is fixed so that a failure can be reproduced
+    std::mt19937 generator(42);
+    double counter = 0;
+
+    // the buffer is reserved less than required so that the reallocation is tested too
+    TrajectoryBuffer buffer;
+    buffer.reserve(maxTrajectorySize / 2);
+    PlannedTrajectory plannedTrajectory;
+    DequeTrajectories deques;
+
+    for(int operation = 0; operation < numberOfOperations; operation++)
+    {
+        bool shouldMerge = buffer.empty() || generator() % 4 == 0;
+        if(shouldMerge)
+        {
+            std::size_t size = 1 + generator() % maxTrajectorySize;
+
+            // both the swap of the memory (merge point not greater than begin) and the copy of the
+            // planned trajectory are tested. Sometimes the merge point is not valid.
+            std::size_t begin = generator() % maxTrajectorySize;
+            std::size_t mergePoint = 0;
+            if(!deques.leftTrajectory.empty())
+                mergePoint = generator() % (deques.leftTrajectory.size() + 2);
+
+            Plan plan = generatePlan(size, generator, counter);
+            fillPlannedTrajectory(plan, begin, plannedTrajectory);
+
+            bool expected = mergeDeques(plan, mergePoint, deques);
+            if(buffer.merge(plannedTrajectory, mergePoint) != expected)
+            {
+                yError() << "[main] The merge at the operation" << operation
+                         << "returned a wrong value.";
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            // the buffer can advance past the end of the stored trajectories
+            std::size_t steps = generator() % maxTrajectorySize;
+            for(std::size_t i = 0; i < steps; i++)
+            {
+                buffer.advance();
+                advanceDeques(deques);
+            }
+        }
+
+        if(!compare(buffer, deques))
+        {
+            yError() << "[main] The buffer is different from the reference at the operation"
+                     << operation;
+            return EXIT_FAILURE;
+        }
+    }
+
+    yInfo() << "[main] The buffer is equal to the reference after" << numberOfOperations
+            << "operations.";
+    return EXIT_SUCCESS;
+}
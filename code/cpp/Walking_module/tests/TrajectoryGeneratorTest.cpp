@@ -0,0 +1,283 @@
+/**
+ * @file TrajectoryGeneratorTest.cpp
+ * @authors Giulio Romualdi <giulio.romualdi@iit.it>
+ * @copyright 2018 iCub Facility - Istituto Italiano di Tecnologia
+ *            Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ * @date 2018
+ */
+
+// std
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+// YARP
+#include <yarp/os/LogStream.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/Property.h>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/Value.h>
+
+#include "TrajectoryGenerator.hpp"
+#include "TrajectoryBuffer.hpp"
+
+namespace
+{
+    // maximum time spent waiting for a trajectory [s]
+    constexpr double plannerTimeout = 10.0;
+
+    // tolerance used to compare the trajectories [m]
+    constexpr double tolerance = 1e-6;
+
+    /**
+     * Inputs of the planner evaluated at a merge point of the current trajectory.
+     */
+    struct MergePointInputs
+    {
+        std::size_t mergePoint;
+        double initTime;
+        bool correctLeft;
+        iDynTree::Transform measured;
+        iDynTree::Transform otherFoot;
+    };
+
+    MergePointInputs evaluateInputs(const TrajectoryBuffer& trajectory, std::size_t mergePoint,
+                                    double time, double dT)
+    {
+        MergePointInputs inputs;
+        inputs.mergePoint = mergePoint;
+        inputs.initTime = time + mergePoint * dT;
+
+        // the same inputs are used by WalkingModule::askNewTrajectories
+        bool isLeftFixed = trajectory.getIsLeftFixedFrame().front();
+        inputs.correctLeft = !isLeftFixed;
+        inputs.measured = isLeftFixed ? trajectory.getRightFootTrajectory()[mergePoint]
+            : trajectory.getLeftFootTrajectory()[mergePoint];
+        inputs.otherFoot = isLeftFixed ? trajectory.getLeftFootTrajectory()[mergePoint]
+            : trajectory.getRightFootTrajectory()[mergePoint];
+        return inputs;
+    }
+
+    bool waitMainTrajectory(TrajectoryGenerator& generator, std::unique_ptr<PlannedTrajectory>& trajectory)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        while(!generator.isTrajectoryComputed())
+        {
+            if(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() > plannerTimeout)
+            {
+                yError() << "[waitMainTrajectory] The planner did not evaluate the trajectory.";
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return generator.getPlannedTrajectory(trajectory);
+    }
+
+    bool waitSpeculativeTrajectory(TrajectoryGenerator& generator, double initTime,
+                                   const iDynTree::Vector2& goal,
+                                   std::unique_ptr<PlannedTrajectory>& trajectory)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        while(!generator.getSpeculativeTrajectory(initTime, goal, trajectory))
+        {
+            if(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() > plannerTimeout)
+            {
+                yError() << "[waitSpeculativeTrajectory] The speculative planners did not evaluate the trajectory.";
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    bool isEqual(const PlannedTrajectory& a, const PlannedTrajectory& b)
+    {
+        if(a.size != b.size || a.mergePoints != b.mergePoints)
+        {
+            yError() << "[isEqual] The trajectories have different sizes or merge points.";
+            return false;
+        }
+
+        for(std::size_t i = 0; i < a.size; i++)
+        {
+            const auto& DCMa = a.samples.DCMPositionDesired[a.begin + i];
+            const auto& DCMb = b.samples.DCMPositionDesired[b.begin + i];
+            const auto& leftA = a.samples.leftTrajectory[a.begin + i].getPosition();
+            const auto& leftB = b.samples.leftTrajectory[b.begin + i].getPosition();
+            const auto& rightA = a.samples.rightTrajectory[a.begin + i].getPosition();
+            const auto& rightB = b.samples.rightTrajectory[b.begin + i].getPosition();
+
+            for(unsigned int j = 0; j < 2; j++)
+            {
+                if(std::abs(DCMa(j) - DCMb(j)) > tolerance
+                   || std::abs(leftA(j) - leftB(j)) > tolerance
+                   || std::abs(rightA(j) - rightB(j)) > tolerance)
+                {
+                    yError() << "[isEqual] The trajectories are different at the sample" << i;
+                    return false;
+                }
+            }
+
+            if(a.samples.leftInContact[a.begin + i] != b.samples.leftInContact[b.begin + i]
+               || a.samples.rightInContact[a.begin + i] != b.samples.rightInContact[b.begin + i])
+            {
+                yError() << "[isEqual] The contact sequences are different at the sample" << i;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Evaluate the trajectory of the next merge point with the main planner and with the
+     * speculative planners and check that they are equal. The candidate is merged so the next
+     * requests are evaluated after an adopted speculative trajectory.
+     * @param mergePoint merge point of the last merged trajectory (it is updated with the merge
+     * point of the candidate).
+     */
+    bool testSpeculativeTrajectory(TrajectoryGenerator& generator, TrajectoryBuffer& trajectory,
+                                   double& time, double dT, const iDynTree::Vector2& goal,
+                                   std::size_t& mergePoint)
+    {
+        // the candidates are evaluated for the first merge point after the last merged trajectory
+        for(std::size_t i = 0; i <= mergePoint || trajectory.getNumberOfMergePoints() == 0
+                || trajectory.getMergePoint(0) <= 2; i++)
+        {
+            if(i > 100000)
+            {
+                yError() << "[testSpeculativeTrajectory] The trajectory does not contain any merge point.";
+                return false;
+            }
+            trajectory.advance();
+            time += dT;
+        }
+
+        MergePointInputs inputs = evaluateInputs(trajectory, trajectory.getMergePoint(0), time, dT);
+
+        if(!generator.updateSpeculativeTrajectories(inputs.initTime,
+                                                    trajectory.getDCMPositionDesired()[inputs.mergePoint],
+                                                    trajectory.getDCMVelocityDesired()[inputs.mergePoint],
+                                                    inputs.correctLeft, inputs.measured, goal))
+        {
+            yError() << "[testSpeculativeTrajectory] Unable to ask for the speculative trajectories.";
+            return false;
+        }
+
+        generator.addTerminalStep(true);
+        if(!generator.updateTrajectories(inputs.initTime,
+                                         trajectory.getDCMPositionDesired()[inputs.mergePoint],
+                                         trajectory.getDCMVelocityDesired()[inputs.mergePoint],
+                                         inputs.correctLeft, inputs.measured, goal, inputs.otherFoot))
+        {
+            yError() << "[testSpeculativeTrajectory] Unable to ask for the trajectory.";
+            return false;
+        }
+
+        auto mainTrajectory = std::make_unique<PlannedTrajectory>();
+        auto speculativeTrajectory = std::make_unique<PlannedTrajectory>();
+        if(!waitMainTrajectory(generator, mainTrajectory)
+           || !waitSpeculativeTrajectory(generator, inputs.initTime, goal, speculativeTrajectory))
+            return false;
+
+        if(!isEqual(*mainTrajectory, *speculativeTrajectory))
+        {
+            yError() << "[testSpeculativeTrajectory] The candidate of the speculative planner is different "
+                     << "from the trajectory of the main planner.";
+            return false;
+        }
+
+        // the candidate is the last trajectory taken, so it is the one adopted
+        if(!trajectory.merge(*speculativeTrajectory, inputs.mergePoint))
+        {
+            yError() << "[testSpeculativeTrajectory] Unable to merge the candidate trajectory.";
+            return false;
+        }
+        generator.setTrajectoryMerged();
+        mergePoint = inputs.mergePoint;
+        return true;
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    // initialise yarp. The test does not open any port so the yarp server is not required
+    yarp::os::Network yarp;
+
+    // prepare and configure the resource finder (the configuration of the WalkingModule is used)
+    yarp::os::ResourceFinder& rf = yarp::os::ResourceFinder::getResourceFinderSingleton();
+
+    rf.setDefaultConfigFile("dcmWalkingCoordinator.ini");
+
+    rf.configure(argc, argv);
+
+    // the trajectories are always evaluated by the planners
+    yarp::os::Property options;
+    options.fromString(rf.findGroup("TRAJECTORY_PLANNER").tail().toString());
+    options.fromString(rf.findGroup("GENERAL").tail().toString(), false);
+    options.put("useSpeculativePlanning", yarp::os::Value(true));
+    options.put("planCacheSize", yarp::os::Value(0));
+
+    double dT = options.check("sampling_time", yarp::os::Value(0.016)).asDouble();
+    double plannerHorizon = options.check("plannerHorizon", yarp::os::Value(20.0)).asDouble();
+
+    TrajectoryGenerator generator;
+    if(!generator.initialize(options))
+    {
+        yError() << "[main] Unable to initialize the planner.";
+        return EXIT_FAILURE;
+    }
+
+    TrajectoryBuffer trajectory;
+    trajectory.reserve(2 * (static_cast<std::size_t>(plannerHorizon / dT) + 1));
+    auto plannedTrajectory = std::make_unique<PlannedTrajectory>();
+
+    if(!generator.generateFirstTrajectories()
+       || !generator.getPlannedTrajectory(plannedTrajectory)
+       || !trajectory.merge(*plannedTrajectory, 0))
+    {
+        yError() << "[main] Unable to evaluate the first trajectory.";
+        return EXIT_FAILURE;
+    }
+    generator.setTrajectoryMerged();
+    double time = 0.0;
+
+    // the robot starts walking (the trajectory is merged as in WalkingModule::applyGoal)
+    std::size_t mergePoint = 20;
+    iDynTree::Vector2 goal;
+    goal(0) = 0.5;
+    goal(1) = 0.0;
+    MergePointInputs inputs = evaluateInputs(trajectory, mergePoint, time, dT);
+    generator.addTerminalStep(true);
+    if(!generator.updateTrajectories(inputs.initTime, trajectory.getDCMPositionDesired()[mergePoint],
+                                     trajectory.getDCMVelocityDesired()[mergePoint],
+                                     inputs.correctLeft, inputs.measured, goal, inputs.otherFoot)
+       || !waitMainTrajectory(generator, plannedTrajectory)
+       || !trajectory.merge(*plannedTrajectory, mergePoint))
+    {
+        yError() << "[main] Unable to evaluate the walking trajectory.";
+        return EXIT_FAILURE;
+    }
+    generator.setTrajectoryMerged();
+
+    // the first candidate is evaluated after trajectories merged by the main planner, the second
+    // one after an adopted candidate
+    goal(1) = 0.2;
+    if(!testSpeculativeTrajectory(generator, trajectory, time, dT, goal, mergePoint))
+    {
+        yError() << "[main] The speculative trajectory evaluated after the main planner is not correct.";
+        return EXIT_FAILURE;
+    }
+
+    goal(0) = 0.3;
+    goal(1) = -0.2;
+    if(!testSpeculativeTrajectory(generator, trajectory, time, dT, goal, mergePoint))
+    {
+        yError() << "[main] The speculative trajectory evaluated after an adopted candidate is not correct.";
+        return EXIT_FAILURE;
+    }
+
+    yInfo() << "[main] The speculative planners evaluate the same trajectories of the main planner.";
+    return EXIT_SUCCESS;
+}
@@ -34,4 +34,12 @@ service WalkingCommands
      * @return true/false in case of success/failure;
      */
     bool setGoal(1:double x, 2:double y);
+
+    /**
+     * Get the statistics (average, min, max, median, 99th percentile and
+     * number of deadline misses) of the timers evaluated over the last
+     * profiling window.
+     * @return the description of the statistics;
+     */
+    string getProfilingInfo();
 }